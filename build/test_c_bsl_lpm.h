@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_bsl_lpm.h -> to '#include' in src/test/test_c_bsl_lpm.c
+
+// test functions
+
+void test_bsl_basic(void);
+void test_bsl_default(void);
+void test_bsl_random(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_bsl_basic);
+    mu_verify(test_bsl_default);
+    mu_verify(test_bsl_random);
+}
@@ -0,0 +1,19 @@
+// AUTOGENERATED build/test_c_crx_lpm.h -> to '#include' in src/test/test_c_crx_lpm.c
+
+// test functions
+
+void test_crx_basic(void);
+void test_crx_branch(void);
+void test_crx_relayout(void);
+void test_crx_maxlen(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_crx_basic);
+    mu_verify(test_crx_branch);
+    mu_verify(test_crx_relayout);
+    mu_verify(test_crx_maxlen);
+}
@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_key4_by6.h -> to '#include' in src/test/test_c_key4_by6.c
+
+// test functions
+
+void test_key4_by6_good(void);
+void test_key4_by6_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key4_by6_good);
+    mu_verify(test_key4_by6_bad);
+}
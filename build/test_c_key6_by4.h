@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_key6_by4.h -> to '#include' in src/test/test_c_key6_by4.c
+
+// test functions
+
+void test_key6_by4_good(void);
+void test_key6_by4_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key6_by4_good);
+    mu_verify(test_key6_by4_bad);
+}
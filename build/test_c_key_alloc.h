@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_key_alloc.h -> to '#include' in src/test/test_c_key_alloc.c
+
+// test functions
+
+void test_key_alloc_good(void);
+void test_key_alloc_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_alloc_good);
+    mu_verify(test_key_alloc_bad);
+}
@@ -0,0 +1,37 @@
+// AUTOGENERATED build/test_c_key_broadcast.h -> to '#include' in src/test/test_c_key_broadcast.c
+
+// test functions
+
+void test_bcast_null(void);
+void test_bcast_zeros(void);
+void test_bcast_nokey(void);
+void test_bcast_zeromask(void);
+void test_bcast_properzeromask(void);
+void test_bcast_zeroaddr_onesmask(void);
+void test_bcast_masktoobig_1(void);
+void test_bcast_masktoobig_2(void);
+void test_bcast_charbufs(void);
+void test_bcast_noncontiguous(void);
+void test_bcast_good_01(void);
+void test_bcast_good_02(void);
+void test_bcast_good_03(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_bcast_null);
+    mu_verify(test_bcast_zeros);
+    mu_verify(test_bcast_nokey);
+    mu_verify(test_bcast_zeromask);
+    mu_verify(test_bcast_properzeromask);
+    mu_verify(test_bcast_zeroaddr_onesmask);
+    mu_verify(test_bcast_masktoobig_1);
+    mu_verify(test_bcast_masktoobig_2);
+    mu_verify(test_bcast_charbufs);
+    mu_verify(test_bcast_noncontiguous);
+    mu_verify(test_bcast_good_01);
+    mu_verify(test_bcast_good_02);
+    mu_verify(test_bcast_good_03);
+}
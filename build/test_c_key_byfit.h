@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_key_byfit.h -> to '#include' in src/test/test_c_key_byfit.c
+
+// test functions
+
+void test_key_byfit_good(void);
+void test_key_byfit_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_byfit_good);
+    mu_verify(test_key_byfit_bad);
+}
@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_key_bylen.h -> to '#include' in src/test/test_c_key_bylen.c
+
+// test functions
+
+void test_key_bylen_good(void);
+void test_key_bylen_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_bylen_good);
+    mu_verify(test_key_bylen_bad);
+}
@@ -0,0 +1,13 @@
+// AUTOGENERATED build/test_c_key_bynum.h -> to '#include' in src/test/test_c_key_bynum.c
+
+// test functions
+
+void test_key_bylen_good(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_bylen_good);
+}
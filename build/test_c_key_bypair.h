@@ -0,0 +1,21 @@
+// AUTOGENERATED build/test_c_key_bypair.h -> to '#include' in src/test/test_c_key_bypair.c
+
+// test functions
+
+void test_key_bypair_simple(void);
+void test_key_bypair_lenbyte(void);
+void test_key_bypair_nulls(void);
+void test_key_bypair_hosts(void);
+void test_key_bypair_zeromask(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_bypair_simple);
+    mu_verify(test_key_bypair_lenbyte);
+    mu_verify(test_key_bypair_nulls);
+    mu_verify(test_key_bypair_hosts);
+    mu_verify(test_key_bypair_zeromask);
+}
@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_key_bystr.h -> to '#include' in src/test/test_c_key_bystr.c
+
+// test functions
+
+void test_key_bystr_good(void);
+void test_key_bystr_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_bystr_good);
+    mu_verify(test_key_bystr_bad);
+}
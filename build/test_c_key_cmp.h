@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_key_cmp.h -> to '#include' in src/test/test_c_key_cmp.c
+
+// test functions
+
+void test_key_cmp_ipv4_good(void);
+void test_key_cmp_ipv4_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_cmp_ipv4_good);
+    mu_verify(test_key_cmp_ipv4_bad);
+}
@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_key_copy.h -> to '#include' in src/test/test_c_key_copy.c
+
+// test functions
+
+void test_key_copy_good(void);
+void test_key_copy_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_copy_good);
+    mu_verify(test_key_copy_bad);
+}
@@ -0,0 +1,21 @@
+// AUTOGENERATED build/test_c_key_invert.h -> to '#include' in src/test/test_c_key_invert.c
+
+// test functions
+
+void test_invert_null(void);
+void test_invert_zerokey(void);
+void test_invert_no_keybits(void);
+void test_invert_len(void);
+void test_invert_roundtrip(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_invert_null);
+    mu_verify(test_invert_zerokey);
+    mu_verify(test_invert_no_keybits);
+    mu_verify(test_invert_len);
+    mu_verify(test_invert_roundtrip);
+}
@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_key_isin.h -> to '#include' in src/test/test_c_key_isin.c
+
+// test functions
+
+void test_key_isin_simple(void);
+void test_key_isin_lenbyte(void);
+void test_key_isin_masks(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_isin_simple);
+    mu_verify(test_key_isin_lenbyte);
+    mu_verify(test_key_isin_masks);
+}
@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_key_masklen.h -> to '#include' in src/test/test_c_key_masklen.c
+
+// test functions
+
+void test_key_masklen_good(void);
+void test_key_masklen_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_masklen_good);
+    mu_verify(test_key_masklen_bad);
+}
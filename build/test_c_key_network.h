@@ -0,0 +1,25 @@
+// AUTOGENERATED build/test_c_key_network.h -> to '#include' in src/test/test_c_key_network.c
+
+// test functions
+
+void test_nwork_null(void);
+void test_nwork_zeros(void);
+void test_nwork_longermask(void);
+void test_nwork_shortermask(void);
+void test_nwork_zerolenmask(void);
+void test_nwork_allzeromask(void);
+void test_nwork_noncontiguous(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_nwork_null);
+    mu_verify(test_nwork_zeros);
+    mu_verify(test_nwork_longermask);
+    mu_verify(test_nwork_shortermask);
+    mu_verify(test_nwork_zerolenmask);
+    mu_verify(test_nwork_allzeromask);
+    mu_verify(test_nwork_noncontiguous);
+}
@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_key_offset.h -> to '#include' in src/test/test_c_key_offset.c
+
+// test functions
+
+void test_key_incr_ipv4(void);
+void test_key_decr(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_incr_ipv4);
+    mu_verify(test_key_decr);
+}
@@ -0,0 +1,19 @@
+// AUTOGENERATED build/test_c_key_words.h -> to '#include' in src/test/test_c_key_words.c
+
+// test functions
+
+void test_words_masklen(void);
+void test_words_network(void);
+void test_words_cmp(void);
+void test_words_incr(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_words_masklen);
+    mu_verify(test_words_network);
+    mu_verify(test_words_cmp);
+    mu_verify(test_words_incr);
+}
@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_mp_select.h -> to '#include' in src/test/test_c_mp_select.c
+
+// test functions
+
+void test_mp_add(void);
+void test_mp_del(void);
+void test_mp_select(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_mp_add);
+    mu_verify(test_mp_del);
+    mu_verify(test_mp_select);
+}
@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_pool.h -> to '#include' in src/test/test_c_pool.c
+
+// test functions
+
+void test_pool_create(void);
+void test_pool_lpm(void);
+void test_pool_snapshot(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_pool_create);
+    mu_verify(test_pool_lpm);
+    mu_verify(test_pool_snapshot);
+}
@@ -0,0 +1,25 @@
+// AUTOGENERATED build/test_c_rdx_firstleaf.h -> to '#include' in src/test/test_c_rdx_firstleaf.c
+
+// test functions
+
+void test_emptytable(void);
+void test_host0(void);
+void test_host128(void);
+void test_host255(void);
+void test_twosubnets(void);
+void test_threemin(void);
+void test_threemax(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_emptytable);
+    mu_verify(test_host0);
+    mu_verify(test_host128);
+    mu_verify(test_host255);
+    mu_verify(test_twosubnets);
+    mu_verify(test_threemin);
+    mu_verify(test_threemax);
+}
@@ -0,0 +1,13 @@
+// AUTOGENERATED build/test_c_rdx_firstnode.h -> to '#include' in src/test/test_c_rdx_firstnode.c
+
+// test functions
+
+void test_rdx_firstnode(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_rdx_firstnode);
+}
@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_rdx_flush.h -> to '#include' in src/test/test_c_rdx_flush.c
+
+// test functions
+
+void test_rdx_flush_null(void);
+void test_rdx_flush_freekey(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_rdx_flush_null);
+    mu_verify(test_rdx_flush_freekey);
+}
@@ -0,0 +1,25 @@
+// AUTOGENERATED build/test_c_rdx_nextleaf.h -> to '#include' in src/test/test_c_rdx_nextleaf.c
+
+// test functions
+
+void test_emptytable(void);
+void test_host0(void);
+void test_nxhost0(void);
+void test_host128(void);
+void test_endmarker(void);
+void test_endmarkers(void);
+void test_left_right_leafs(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_emptytable);
+    mu_verify(test_host0);
+    mu_verify(test_nxhost0);
+    mu_verify(test_host128);
+    mu_verify(test_endmarker);
+    mu_verify(test_endmarkers);
+    mu_verify(test_left_right_leafs);
+}
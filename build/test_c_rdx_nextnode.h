@@ -0,0 +1,13 @@
+// AUTOGENERATED build/test_c_rdx_nextnode.h -> to '#include' in src/test/test_c_rdx_nextnode.c
+
+// test functions
+
+void test_rdx_nextnode(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_rdx_nextnode);
+}
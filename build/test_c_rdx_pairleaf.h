@@ -0,0 +1,21 @@
+// AUTOGENERATED build/test_c_rdx_pairleaf.h -> to '#include' in src/test/test_c_rdx_pairleaf.c
+
+// test functions
+
+void test_emptytable(void);
+void test_nulls(void);
+void test_host0(void);
+void test_host255(void);
+void test_somepairs(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_emptytable);
+    mu_verify(test_nulls);
+    mu_verify(test_host0);
+    mu_verify(test_host255);
+    mu_verify(test_somepairs);
+}
@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_rng_bytbl.h -> to '#include' in src/test/test_c_rng_bytbl.c
+
+// test functions
+
+void test_rng_bytbl_nested(void);
+void test_rng_bytbl_edges(void);
+void test_rng_bytbl_dup(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_rng_bytbl_nested);
+    mu_verify(test_rng_bytbl_edges);
+    mu_verify(test_rng_bytbl_dup);
+}
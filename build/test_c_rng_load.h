@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_rng_load.h -> to '#include' in src/test/test_c_rng_load.c
+
+// test functions
+
+void test_rng_load_good(void);
+void test_rng_load_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_rng_load_good);
+    mu_verify(test_rng_load_bad);
+}
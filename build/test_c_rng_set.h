@@ -0,0 +1,19 @@
+// AUTOGENERATED build/test_c_rng_set.h -> to '#include' in src/test/test_c_rng_set.c
+
+// test functions
+
+void test_rng_create(void);
+void test_rng_set_get(void);
+void test_rng_set_bad(void);
+void test_rng_del(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_rng_create);
+    mu_verify(test_rng_set_get);
+    mu_verify(test_rng_set_bad);
+    mu_verify(test_rng_del);
+}
@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_rng_totbl.h -> to '#include' in src/test/test_c_rng_totbl.c
+
+// test functions
+
+void test_rng_totbl_good(void);
+void test_rng_totbl_dup(void);
+void test_rng_roundtrip(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_rng_totbl_good);
+    mu_verify(test_rng_totbl_dup);
+    mu_verify(test_rng_roundtrip);
+}
@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_tbl_cache.h -> to '#include' in src/test/test_c_tbl_cache.c
+
+// test functions
+
+void test_tbl_cache_size(void);
+void test_tbl_cache_hits(void);
+void test_tbl_cache_collide(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_cache_size);
+    mu_verify(test_tbl_cache_hits);
+    mu_verify(test_tbl_cache_collide);
+}
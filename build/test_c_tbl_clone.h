@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_tbl_clone.h -> to '#include' in src/test/test_c_tbl_clone.c
+
+// test functions
+
+void test_clone_empty(void);
+void test_clone_shared(void);
+void test_clone_dup(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_clone_empty);
+    mu_verify(test_clone_shared);
+    mu_verify(test_clone_dup);
+}
@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_tbl_compact.h -> to '#include' in src/test/test_c_tbl_compact.c
+
+// test functions
+
+void test_compact_basic(void);
+void test_compact_iterating(void);
+void test_compact_churn(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_compact_basic);
+    mu_verify(test_compact_iterating);
+    mu_verify(test_compact_churn);
+}
@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_tbl_create.h -> to '#include' in src/test/test_c_tbl_create.c
+
+// test functions
+
+void test_tbl_create_with_purge(void);
+void test_tbl_create_no_purge(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_create_with_purge);
+    mu_verify(test_tbl_create_no_purge);
+}
@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_tbl_del.h -> to '#include' in src/test/test_c_tbl_del.c
+
+// test functions
+
+void test_tbl_del_good(void);
+void test_tbl_del_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_del_good);
+    mu_verify(test_tbl_del_bad);
+}
@@ -0,0 +1,19 @@
+// AUTOGENERATED build/test_c_tbl_destroy.h -> to '#include' in src/test/test_c_tbl_destroy.c
+
+// test functions
+
+void test_emptytable(void);
+void test_host0(void);
+void test_nxhost0(void);
+void test_host255(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_emptytable);
+    mu_verify(test_host0);
+    mu_verify(test_nxhost0);
+    mu_verify(test_host255);
+}
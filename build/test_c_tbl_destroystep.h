@@ -0,0 +1,21 @@
+// AUTOGENERATED build/test_c_tbl_destroystep.h -> to '#include' in src/test/test_c_tbl_destroystep.c
+
+// test functions
+
+void test_destroystep_slices(void);
+void test_destroystep_nolimit(void);
+void test_destroystep_flagged(void);
+void test_release(void);
+void test_release_thread(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_destroystep_slices);
+    mu_verify(test_destroystep_nolimit);
+    mu_verify(test_destroystep_flagged);
+    mu_verify(test_release);
+    mu_verify(test_release_thread);
+}
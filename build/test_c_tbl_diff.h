@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_tbl_diff.h -> to '#include' in src/test/test_c_tbl_diff.c
+
+// test functions
+
+void test_tbl_diff_args(void);
+void test_tbl_diff_ops(void);
+void test_tbl_diff_random(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_diff_args);
+    mu_verify(test_tbl_diff_ops);
+    mu_verify(test_tbl_diff_random);
+}
@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_tbl_gcstep.h -> to '#include' in src/test/test_c_tbl_gcstep.c
+
+// test functions
+
+void test_gcstep_basic(void);
+void test_gcstep_changes(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_gcstep_basic);
+    mu_verify(test_gcstep_changes);
+}
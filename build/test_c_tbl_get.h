@@ -0,0 +1,13 @@
+// AUTOGENERATED build/test_c_tbl_get.h -> to '#include' in src/test/test_c_tbl_get.c
+
+// test functions
+
+void test_tbl_get_good(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_get_good);
+}
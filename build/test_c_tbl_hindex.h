@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_tbl_hindex.h -> to '#include' in src/test/test_c_tbl_hindex.c
+
+// test functions
+
+void test_hindex_basic(void);
+void test_hindex_tombstones(void);
+void test_hindex_many(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_hindex_basic);
+    mu_verify(test_hindex_tombstones);
+    mu_verify(test_hindex_many);
+}
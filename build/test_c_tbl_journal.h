@@ -0,0 +1,19 @@
+// AUTOGENERATED build/test_c_tbl_journal.h -> to '#include' in src/test/test_c_tbl_journal.c
+
+// test functions
+
+void test_tbl_journal(void);
+void test_tbl_journal_lost(void);
+void test_tbl_subscribe(void);
+void test_tbl_journal_paths(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_journal);
+    mu_verify(test_tbl_journal_lost);
+    mu_verify(test_tbl_subscribe);
+    mu_verify(test_tbl_journal_paths);
+}
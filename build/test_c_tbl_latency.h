@@ -0,0 +1,21 @@
+// AUTOGENERATED build/test_c_tbl_latency.h -> to '#include' in src/test/test_c_tbl_latency.c
+
+// test functions
+
+void test_latency_toggle(void);
+void test_latency_counts(void);
+void test_latency_quantiles(void);
+void test_latency_host(void);
+void test_latency_internal(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_latency_toggle);
+    mu_verify(test_latency_counts);
+    mu_verify(test_latency_quantiles);
+    mu_verify(test_latency_host);
+    mu_verify(test_latency_internal);
+}
@@ -0,0 +1,21 @@
+// AUTOGENERATED build/test_c_tbl_lpmhdr.h -> to '#include' in src/test/test_c_tbl_lpmhdr.c
+
+// test functions
+
+void test_key_bysockaddr(void);
+void test_key_byhdr(void);
+void test_tbl_lpmsa(void);
+void test_tbl_lpmhdr(void);
+void test_tbl_lpmhdrs(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_key_bysockaddr);
+    mu_verify(test_key_byhdr);
+    mu_verify(test_tbl_lpmsa);
+    mu_verify(test_tbl_lpmhdr);
+    mu_verify(test_tbl_lpmhdrs);
+}
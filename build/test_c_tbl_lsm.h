@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_tbl_lsm.h -> to '#include' in src/test/test_c_tbl_lsm.c
+
+// test functions
+
+void test_tbl_lsm_good(void);
+void test_tbl_lsm_zeromask(void);
+void test_tbl_lsm_parent(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_lsm_good);
+    mu_verify(test_tbl_lsm_zeromask);
+    mu_verify(test_tbl_lsm_parent);
+}
@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_tbl_match4.h -> to '#include' in src/test/test_c_tbl_match4.c
+
+// test functions
+
+void test_match4_select(void);
+void test_match4_edges(void);
+void test_match4_random(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_match4_select);
+    mu_verify(test_match4_edges);
+    mu_verify(test_match4_random);
+}
@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_tbl_record.h -> to '#include' in src/test/test_c_tbl_record.c
+
+// test functions
+
+void test_record_ops(void);
+void test_record_anon(void);
+void test_record_files(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_record_ops);
+    mu_verify(test_record_anon);
+    mu_verify(test_record_files);
+}
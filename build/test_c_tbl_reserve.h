@@ -0,0 +1,19 @@
+// AUTOGENERATED build/test_c_tbl_reserve.h -> to '#include' in src/test/test_c_tbl_reserve.c
+
+// test functions
+
+void test_reserve_basic(void);
+void test_reserve_index(void);
+void test_reserve_gc(void);
+void test_reserve_clone(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_reserve_basic);
+    mu_verify(test_reserve_index);
+    mu_verify(test_reserve_gc);
+    mu_verify(test_reserve_clone);
+}
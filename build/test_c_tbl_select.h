@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_tbl_select.h -> to '#include' in src/test/test_c_tbl_select.c
+
+// test functions
+
+void test_tbl_select(void);
+void test_tbl_select_purge(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_select);
+    mu_verify(test_tbl_select_purge);
+}
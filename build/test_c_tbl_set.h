@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_tbl_set.h -> to '#include' in src/test/test_c_tbl_set.c
+
+// test functions
+
+void test_tbl_set_one(void);
+void test_tbl_set_good(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_set_one);
+    mu_verify(test_tbl_set_good);
+}
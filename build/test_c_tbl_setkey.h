@@ -0,0 +1,15 @@
+// AUTOGENERATED build/test_c_tbl_setkey.h -> to '#include' in src/test/test_c_tbl_setkey.c
+
+// test functions
+
+void test_tbl_setkey_good(void);
+void test_tbl_setkey_bad(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_setkey_good);
+    mu_verify(test_tbl_setkey_bad);
+}
@@ -0,0 +1,19 @@
+// AUTOGENERATED build/test_c_tbl_shape.h -> to '#include' in src/test/test_c_tbl_shape.c
+
+// test functions
+
+void test_shape_empty(void);
+void test_shape_chains(void);
+void test_shape_tombstones(void);
+void test_shape_paths(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_shape_empty);
+    mu_verify(test_shape_chains);
+    mu_verify(test_shape_tombstones);
+    mu_verify(test_shape_paths);
+}
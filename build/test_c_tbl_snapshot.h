@@ -0,0 +1,19 @@
+// AUTOGENERATED build/test_c_tbl_snapshot.h -> to '#include' in src/test/test_c_tbl_snapshot.c
+
+// test functions
+
+void test_tbl_snapshot(void);
+void test_tbl_snapshot_paths(void);
+void test_tbl_snapshot_values(void);
+void test_tbl_snapshot_random(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_snapshot);
+    mu_verify(test_tbl_snapshot_paths);
+    mu_verify(test_tbl_snapshot_values);
+    mu_verify(test_tbl_snapshot_random);
+}
@@ -0,0 +1,17 @@
+// AUTOGENERATED build/test_c_tbl_stack.h -> to '#include' in src/test/test_c_tbl_stack.c
+
+// test functions
+
+void test_tbl_stackpush_pop(void);
+void test_tbl_stack_pop(void);
+void test_tbl_stack_again(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_stackpush_pop);
+    mu_verify(test_tbl_stack_pop);
+    mu_verify(test_tbl_stack_again);
+}
@@ -0,0 +1,19 @@
+// AUTOGENERATED build/test_c_tbl_stackops.h -> to '#include' in src/test/test_c_tbl_stackops.c
+
+// test functions
+
+void test_tbl_stackpop_null(void);
+void test_tbl_stackpush_null(void);
+void test_tbl_stack_size(void);
+void test_tbl_stack_types(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tbl_stackpop_null);
+    mu_verify(test_tbl_stackpush_null);
+    mu_verify(test_tbl_stack_size);
+    mu_verify(test_tbl_stack_types);
+}
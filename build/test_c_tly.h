@@ -0,0 +1,23 @@
+// AUTOGENERATED build/test_c_tly.h -> to '#include' in src/test/test_c_tly.c
+
+// test functions
+
+void test_tly_create(void);
+void test_tly_add(void);
+void test_tly_report_families(void);
+void test_tly_pcap(void);
+void test_tly_pcapng(void);
+void test_tly_engines(void);
+
+// test runner
+
+void
+mu_run_tests(void)
+{
+    mu_verify(test_tly_create);
+    mu_verify(test_tly_add);
+    mu_verify(test_tly_report_families);
+    mu_verify(test_tly_pcap);
+    mu_verify(test_tly_pcapng);
+    mu_verify(test_tly_engines);
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stdint.h>          // uint64_t
+#include <stdlib.h>          // malloc
+#include <arpa/inet.h>       // AF_INET(6)
+#include <string.h>          // memcpy
+#include <time.h>            // clock_gettime
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+#include "crx.h"             // compact radix trie
+
+/*
+ * Benchmark the compact radix trie against the radix tree it is built from:
+ * memory per prefix and longest prefix match throughput, for ipv4 and ipv6
+ * tables with a global routing table like mix of prefix lengths.
+ *
+ * A radix tree prefix costs an entry_t (holding two radix nodes and the key)
+ * plus its share of the mask tree, which is negligible.  The compact trie
+ * costs its nodes and an entry pointer per node.
+ */
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+#define NLOOKUPS 2000000
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+static uint64_t rnd_state = 88172645463325252ULL;
+
+static uint64_t
+rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 7;
+    rnd_state ^= rnd_state << 17;
+    return rnd_state;
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+rnd_key(uint8_t *key, int af)
+{
+    uint64_t w[2] = {rnd(), rnd()};
+
+    IPT_KEYLEN(key) = af == AF_INET ? IP4_KEYLEN : IP6_KEYLEN;
+    memcpy(IPT_KEYPTR(key), w, IPT_KEYLEN(key) - 1);
+    if (af == AF_INET6)
+        IPT_KEYPTR(key)[0] = 0x20 | (IPT_KEYPTR(key)[0] & 0x0f);
+    else if (IPT_KEYPTR(key)[0] == 0 || IPT_KEYPTR(key)[0] >= 224)
+        IPT_KEYPTR(key)[0] = 1 + IPT_KEYPTR(key)[0] % 223;
+}
+
+static void
+bench(int af, size_t npfx)
+{
+    int lens4[] = {24, 24, 24, 24, 24, 24, 23, 22, 22, 21, 20, 19, 16, 18, 8};
+    int lens6[] = {32, 32, 36, 40, 44, 48, 48, 48, 48, 48, 48, 56, 64, 29, 28};
+    int *lens = af == AF_INET ? lens4 : lens6;
+    size_t *count, i, bad = 0, sum = 0;
+    table_t *t = tbl_create(NULL);
+    uint8_t *keys, *addrs, mask[MAX_BINKEY];
+    double t0, trdx = 1e9, tcrx = 1e9, tbuild;
+    entry_t **exp;
+    crx_t *c;
+    int mlen;
+
+    keys = malloc(npfx * MAX_BINKEY);
+    addrs = malloc((size_t)NLOOKUPS * MAX_BINKEY);
+    exp = malloc(NLOOKUPS * sizeof(entry_t *));
+    if (!t || !keys || !addrs || !exp) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    count = af == AF_INET ? &t->count4 : &t->count6;
+    while (*count < npfx) {
+        uint8_t *key = keys + *count * MAX_BINKEY;
+        rnd_key(key, af);
+        mlen = lens[rnd() % NELEMS(lens4)];
+        key_bylen(mask, mlen, af);
+        key_network(key, mask);
+        tbl_setkey(t, key, mlen, &lens[0], NULL);
+    }
+
+    // 7/8 of the lookups are near a known prefix
+    for (i = 0; i < NLOOKUPS; i++) {
+        uint8_t *a = addrs + i * MAX_BINKEY;
+        rnd_key(a, af);
+        if (i % 8)
+            memcpy(a, keys + (rnd() % npfx) * MAX_BINKEY,
+                   af == AF_INET ? 3 : 9);
+    }
+
+    t0 = now();
+    c = crx_create(t, af);
+    tbuild = now() - t0;
+    if (c == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    // interleave the runs and keep the best, to even out warm up effects
+    for (int r = 0; r < 3; r++) {
+        t0 = now();
+        for (i = 0; i < NLOOKUPS; i++)
+            exp[i] = tbl_lpmkey(t, addrs + i * MAX_BINKEY);
+        trdx = min(trdx, now() - t0);
+
+        t0 = now();
+        for (i = 0; i < NLOOKUPS; i++) {
+            entry_t *e = crx_lpm(c, addrs + i * MAX_BINKEY);
+            bad += (e != exp[i]);
+            sum += r == 0 && e != NULL;
+        }
+        tcrx = min(tcrx, now() - t0);
+    }
+
+    printf("ipv%d %7zu pfx %7u nodes build %5.2fs hit %4.1f%%"
+           " | bytes/pfx rdx %5.1f crx %5.1f"
+           " | ns/lookup rdx %6.1f crx %6.1f (%.2fx)%s\n",
+           af == AF_INET ? 4 : 6, npfx, c->count, tbuild,
+           100.0 * sum / NLOOKUPS, (double)sizeof(entry_t),
+           (double)crx_memsize(c) / npfx, 1e9 * trdx / NLOOKUPS,
+           1e9 * tcrx / NLOOKUPS, trdx / tcrx, bad ? "  MISMATCH" : "");
+
+    crx_destroy(&c);
+    tbl_destroy(&t, NULL);
+    free(keys);
+    free(addrs);
+    free(exp);
+}
+
+int
+main(void)
+{
+    size_t sizes[] = {10000, 100000, 500000, 1000000};
+
+    printf("bench_crx: %d lookups per table\n", NLOOKUPS);
+    for (int i = 0; i < NELEMS(sizes); i++)
+        bench(AF_INET, sizes[i]);
+    for (int i = 0; i < NELEMS(sizes) - 1; i++)
+        bench(AF_INET6, sizes[i]);
+
+    return 0;
+}
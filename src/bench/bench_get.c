@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stdint.h>          // uint64_t
+#include <stdlib.h>          // malloc
+#include <arpa/inet.h>       // AF_INET(6)
+#include <string.h>          // memcpy
+#include <time.h>            // clock_gettime
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+/*
+ * Benchmark exact match lookups (tbl_get) with and without the hash index,
+ * on a table of 1M prefixes (half ipv4, half ipv6).  Half of the lookups
+ * hit, the other half use a known network with a different mask length.
+ */
+
+#define NPREFIXES 1000000
+#define NLOOKUPS  2000000
+
+static uint64_t rnd_state = 88172645463325252ULL;
+
+static uint64_t
+rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 7;
+    rnd_state ^= rnd_state << 17;
+    return rnd_state;
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *
+rnd_pfx(char *buf)
+{
+    uint64_t r = rnd();
+    uint8_t a[16];
+
+    memcpy(a, &r, 8);
+    r = rnd();
+    memcpy(a + 8, &r, 8);
+
+    if (r & 1) {
+        inet_ntop(AF_INET, a, buf, MAX_STRKEY);
+        sprintf(buf + strlen(buf), "/%d", 20 + (int)(r >> 8) % 13);
+    } else {
+        a[0] = 0x20 | (a[0] & 0x0f);
+        inet_ntop(AF_INET6, a, buf, MAX_STRKEY);
+        sprintf(buf + strlen(buf), "/%d", 32 + (int)(r >> 8) % 33);
+    }
+
+    return buf;
+}
+
+static double
+run(table_t *t, char *pfx, size_t *found)
+{
+    double t0 = now();
+
+    *found = 0;
+    for (size_t i = 0; i < NLOOKUPS; i++)
+        *found += tbl_get(t, pfx + i * MAX_STRKEY) != NULL;
+
+    return now() - t0;
+}
+
+int
+main(void)
+{
+    table_t *t = tbl_create(NULL);
+    char *pfxs = malloc((size_t)NPREFIXES * MAX_STRKEY);
+    char *lookups = malloc((size_t)NLOOKUPS * MAX_STRKEY);
+    char *src, *slash;
+    size_t found, hit;
+    double trdx, tidx, tbuild, t0;
+    int val = 0;
+
+    if (!t || !pfxs || !lookups) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    /* only count prefixes not seen before */
+    while (t->count4 + t->count6 < NPREFIXES)
+        tbl_set(t, rnd_pfx(pfxs + (t->count4 + t->count6) * MAX_STRKEY),
+                &val, NULL);
+
+    for (size_t i = 0; i < NLOOKUPS; i++) {
+        src = pfxs + (rnd() % NPREFIXES) * MAX_STRKEY;
+        memcpy(lookups + i * MAX_STRKEY, src, MAX_STRKEY);
+        if (i % 2) {
+            /* same network, other mask: almost always a miss */
+            slash = strchr(lookups + i * MAX_STRKEY, '/');
+            sprintf(slash, "/%d", atoi(slash + 1) + 1);
+        }
+    }
+
+    trdx = run(t, lookups, &hit);
+
+    t0 = now();
+    tbl_hindex(t, 1);
+    tbuild = now() - t0;
+
+    tidx = run(t, lookups, &found);
+
+    printf("bench_get: %zu ipv4 + %zu ipv6 prefixes, %d lookups, %.1f%% hit\n",
+           t->count4, t->count6, NLOOKUPS, 100.0 * hit / NLOOKUPS);
+    printf("  index: %zu slots, %.1f MB, built in %.2fs\n",
+           t->index->size, t->index->size * sizeof(hslot_t) / 1048576.0,
+           tbuild);
+    printf("  ns/lookup rdx %6.1f hindex %6.1f%s\n",
+           1e9 * trdx / NLOOKUPS, 1e9 * tidx / NLOOKUPS,
+           found != hit ? "  MISMATCH" : "");
+
+    tbl_destroy(&t, NULL);
+    free(pfxs);
+    free(lookups);
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stdint.h>          // uint32_t
+#include <stdlib.h>          // malloc
+#include <arpa/inet.h>       // AF_INET(6)
+#include <string.h>          // memcpy
+#include <time.h>            // clock_gettime
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+/*
+ * Micro benchmarks for the word-wise key functions versus their byte-wise
+ * reference versions (kref_x), for ipv4 and ipv6 keys.
+ */
+
+#define NKEYS   4096         // keys cycled through, stays in L1/L2
+#define NCALLS  10000000
+
+static uint32_t rnd_state = 2463534242u;
+static uint8_t keys[NKEYS][MAX_BINKEY], masks[NKEYS][MAX_BINKEY];
+static uint8_t near[NKEYS][MAX_BINKEY];
+static volatile long sink;
+
+static uint32_t
+rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+setup(int af)
+{
+    // keys share their first 2 (ipv4) or 6 (ipv6) bytes, like the keys and
+    // masks met during iteration of a tree, half the masks have a radix
+    // style short LEN
+    int shared = af == AF_INET ? 2 : 6, mlen;
+
+    for (int i = 0; i < NKEYS; i++) {
+        IPT_KEYLEN(keys[i]) = KEY_LEN_FAM(af);
+        for (int j = 1; j < KEY_LEN_FAM(af); j++)
+            keys[i][j] = j <= shared ? 0x20 + j : (uint8_t)rnd();
+        mlen = 8 * shared + rnd() % ((af == AF_INET ? 33 : 129) - 8 * shared);
+        key_bylen(masks[i], mlen, af);
+        // near[i] is inside keys[i]/masks[i]
+        memcpy(near[i], keys[i], MAX_BINKEY);
+        key_broadcast(near[i], masks[i]);
+        if (i % 2)
+            IPT_KEYLEN(masks[i]) = 1 + (mlen + 7) / 8;
+    }
+}
+
+/* one function per kernel, so the call overhead is the same for both */
+
+#define BENCH(name, expr)                                       \
+static double                                                   \
+name(void)                                                      \
+{                                                               \
+    uint8_t k[MAX_BINKEY];                                      \
+    long acc = 0;                                               \
+    double t0 = now();                                          \
+    for (long n = 0; n < NCALLS; n++) {                         \
+        int i = n & (NKEYS - 1), j = (n * 7) & (NKEYS - 1);     \
+        (void)i; (void)j; (void)k;                              \
+        acc += (long)(expr);                                    \
+    }                                                           \
+    sink = acc;                                                 \
+    return 1e9 * (now() - t0) / NCALLS;                         \
+}
+
+BENCH(b_masklen, key_masklen(masks[i]))
+BENCH(r_masklen, kref_masklen(masks[i]))
+BENCH(b_cmp, key_cmp(keys[i], keys[j]))
+BENCH(r_cmp, kref_cmp(keys[i], keys[j]))
+BENCH(b_isin, key_isin(keys[i], keys[j], masks[i]))
+BENCH(r_isin, kref_isin(keys[i], keys[j], masks[i]))
+BENCH(b_isin_hit, key_isin(keys[i], near[i], masks[i]))
+BENCH(r_isin_hit, kref_isin(keys[i], near[i], masks[i]))
+BENCH(b_network, (memcpy(k, keys[i], MAX_BINKEY), key_network(k, masks[i])))
+BENCH(r_network, (memcpy(k, keys[i], MAX_BINKEY), kref_network(k, masks[i])))
+BENCH(b_broadcast,
+      (memcpy(k, keys[i], MAX_BINKEY), key_broadcast(k, masks[i])))
+BENCH(r_broadcast,
+      (memcpy(k, keys[i], MAX_BINKEY), kref_broadcast(k, masks[i])))
+BENCH(b_incr, key_incr(keys[i], 1 + (n & 0xffff)) != NULL)
+BENCH(r_incr, kref_incr(keys[i], 1 + (n & 0xffff)) != NULL)
+BENCH(b_decr, key_decr(keys[i], 1 + (n & 0xffff)) != NULL)
+BENCH(r_decr, kref_decr(keys[i], 1 + (n & 0xffff)) != NULL)
+
+typedef struct kernel_t {
+    const char *name;
+    double (*word)(void);
+    double (*byte)(void);
+} kernel_t;
+
+int
+main(void)
+{
+    kernel_t kernels[] = {
+        {"key_masklen", b_masklen, r_masklen},
+        {"key_cmp", b_cmp, r_cmp},
+        {"key_isin/miss", b_isin, r_isin},
+        {"key_isin/hit", b_isin_hit, r_isin_hit},
+        {"key_network", b_network, r_network},
+        {"key_broadcast", b_broadcast, r_broadcast},
+        {"key_incr", b_incr, r_incr},
+        {"key_decr", b_decr, r_decr},
+    };
+    int af[] = {AF_INET, AF_INET6};
+    double w, b;
+
+    printf("bench_keys: %d calls, ns/call word vs byte\n", NCALLS);
+    for (int a = 0; a < 2; a++) {
+        for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+            // best of 3 interleaved runs
+            w = b = 1e9;
+            for (int r = 0; r < 3; r++) {
+                setup(af[a]);
+                b = min(b, kernels[i].byte());
+                setup(af[a]);
+                w = min(w, kernels[i].word());
+            }
+            printf("  %s %-14s word %5.2f byte %5.2f (%.2fx)\n",
+                   af[a] == AF_INET ? "ipv4" : "ipv6", kernels[i].name,
+                   w, b, b / w);
+        }
+    }
+
+    return 0;
+}
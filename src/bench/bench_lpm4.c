@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stdint.h>          // uint32_t
+#include <stdlib.h>          // malloc
+#include <arpa/inet.h>       // AF_INET
+#include <time.h>            // clock_gettime
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+/*
+ * Benchmark IPv4 longest prefix match: the generic rn_match versus the
+ * 32-bit specialised rn_match4, on tables with a global routing table like
+ * mix of prefix lengths.
+ */
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+#define NLOOKUPS 2000000
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+static uint32_t rnd_state = 2463534242u;
+
+static uint32_t
+rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+key4(uint8_t *key, uint32_t a)
+{
+    IPT_KEYLEN(key) = IP4_KEYLEN;
+    for (int i = 4; i > 0; i--, a >>= 8)
+        key[i] = a & 0xff;
+}
+
+static double
+run(table_t *t, uint8_t *addrs, size_t *found)
+{
+    double t0 = now();
+
+    *found = 0;
+    for (size_t i = 0; i < NLOOKUPS; i++)
+        *found += tbl_lpmkey(t, addrs + i * IP4_KEYLEN) != NULL;
+
+    return now() - t0;
+}
+
+static void
+bench(size_t npfx)
+{
+    // over half of a global ipv4 table are /24's
+    int lens[] = {24, 24, 24, 24, 24, 24, 23, 22, 22, 21, 20, 19, 16, 18, 8};
+    table_t *t = tbl_create(NULL);
+    uint8_t key[MAX_BINKEY], *addrs = malloc((size_t)NLOOKUPS * IP4_KEYLEN);
+    uint32_t *nets = malloc(npfx * sizeof(uint32_t));
+    size_t f1, f2;
+    double tgen = 1e9, tspc = 1e9;
+    int val = 0;
+
+    if (!t || !addrs || !nets) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    while (t->count4 < npfx) {
+        nets[t->count4] = rnd() % 0xdf000000u + 0x01000000u;
+        key4(key, nets[t->count4]);
+        tbl_setkey(t, key, lens[rnd() % NELEMS(lens)], &val, NULL);
+    }
+
+    // 3/4 of the lookups are near a known prefix
+    for (size_t i = 0; i < NLOOKUPS; i++)
+        key4(addrs + i * IP4_KEYLEN,
+             i % 4 ? nets[rnd() % npfx] ^ (rnd() & 0x3ff) : rnd());
+
+    // interleave the runs and keep the best, to even out warm up effects
+    for (int r = 0; r < 3; r++) {
+        tbl_match4(t, 0);
+        tgen = min(tgen, run(t, addrs, &f1));
+        tbl_match4(t, 1);
+        tspc = min(tspc, run(t, addrs, &f2));
+    }
+
+    printf("%7zu pfx hit %4.1f%% | ns/lookup rn_match %6.1f rn_match4 %6.1f"
+           " (%.2fx)%s\n", npfx, 100.0 * f1 / NLOOKUPS,
+           1e9 * tgen / NLOOKUPS, 1e9 * tspc / NLOOKUPS, tgen / tspc,
+           f1 != f2 ? "  MISMATCH" : "");
+
+    tbl_destroy(&t, NULL);
+    free(addrs);
+    free(nets);
+}
+
+int
+main(void)
+{
+    size_t sizes[] = {10000, 100000, 500000, 1000000};
+
+    printf("bench_lpm4: %d lookups per table\n", NLOOKUPS);
+    for (int i = 0; i < NELEMS(sizes); i++)
+        bench(sizes[i]);
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stdint.h>          // uint64_t
+#include <stdlib.h>          // malloc
+#include <arpa/inet.h>       // AF_INET6
+#include <string.h>          // memcpy
+#include <time.h>            // clock_gettime
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+#include "bsl.h"             // binary search on prefix lengths
+
+/*
+ * Benchmark IPv6 longest prefix match: radix tree vs binary search on
+ * prefix lengths (with and without bloom filters).
+ *
+ * Tables have a mix of prefix lengths typical for a global IPv6 table and
+ * lookups use addresses inside known prefixes, so most of them match.
+ */
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+#define NLOOKUPS 2000000
+
+static uint64_t rnd_state = 88172645463325252ULL;
+
+static uint64_t
+rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 7;
+    rnd_state ^= rnd_state << 17;
+    return rnd_state;
+}
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+rnd_key(uint8_t *key)
+{
+    uint64_t w[2] = {rnd(), rnd()};
+
+    IPT_KEYLEN(key) = 17;
+    memcpy(IPT_KEYPTR(key), w, 16);
+    IPT_KEYPTR(key)[0] = 0x20 | (IPT_KEYPTR(key)[0] & 0x0f);
+}
+
+static void
+bench(size_t npfx)
+{
+    // rough length distribution of a global ipv6 table
+    int lens[] = {32, 32, 36, 40, 44, 48, 48, 48, 48, 48, 48, 56, 64, 29, 28};
+    table_t *t = tbl_create(NULL);
+    uint8_t *keys, *addrs, mask[MAX_BINKEY];
+    entry_t **exp;
+    bsl_t *b, *bb;
+    size_t i, bad = 0, sum = 0;
+    double t0, trdx, tbsl, tblm, tbuild;
+    int mlen;
+
+    keys = malloc(npfx * MAX_BINKEY);
+    addrs = malloc((size_t)NLOOKUPS * MAX_BINKEY);
+    exp = malloc(NLOOKUPS * sizeof(entry_t *));
+    if (!t || !keys || !addrs || !exp) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (i = 0; t->count6 < npfx; i++) {
+        uint8_t *key = keys + t->count6 * MAX_BINKEY;
+        rnd_key(key);
+        mlen = lens[rnd() % NELEMS(lens)];
+        key_bylen(mask, mlen, AF_INET6);
+        key_network(key, mask);
+        tbl_setkey(t, key, mlen, &lens[0], NULL);
+    }
+
+    for (i = 0; i < NLOOKUPS; i++) {
+        uint8_t *a = addrs + i * MAX_BINKEY;
+        rnd_key(a);
+        if (i % 8) {
+            // 7/8 of the lookups are inside a known prefix
+            memcpy(a, keys + (rnd() % npfx) * MAX_BINKEY, 9);
+        }
+    }
+
+    t0 = now();
+    b = bsl_create(t, AF_INET6, 0);
+    tbuild = now() - t0;
+    bb = bsl_create(t, AF_INET6, 1);
+
+    t0 = now();
+    for (i = 0; i < NLOOKUPS; i++)
+        exp[i] = tbl_lpmkey(t, addrs + i * MAX_BINKEY);
+    trdx = now() - t0;
+
+    t0 = now();
+    for (i = 0; i < NLOOKUPS; i++) {
+        entry_t *e = bsl_lpm(b, addrs + i * MAX_BINKEY);
+        sum += (e != NULL);
+        bad += (e != exp[i]);
+    }
+    tbsl = now() - t0;
+
+    t0 = now();
+    for (i = 0; i < NLOOKUPS; i++)
+        bad += (bsl_lpm(bb, addrs + i * MAX_BINKEY) != exp[i]);
+    tblm = now() - t0;
+
+    printf("%7zu pfx %2d lens %6zu markers %6.1f MB build %5.2fs hit %4.1f%%"
+           " | ns/lookup rdx %6.1f bsl %6.1f bsl+bloom %6.1f%s\n",
+           npfx, b->nlevels, b->markers, bsl_memsize(b) / 1048576.0,
+           tbuild, 100.0 * sum / NLOOKUPS,
+           1e9 * trdx / NLOOKUPS, 1e9 * tbsl / NLOOKUPS,
+           1e9 * tblm / NLOOKUPS, bad ? "  MISMATCH" : "");
+
+    bsl_destroy(&b);
+    bsl_destroy(&bb);
+    tbl_destroy(&t, NULL);
+    free(keys);
+    free(addrs);
+    free(exp);
+}
+
+int
+main(void)
+{
+    size_t sizes[] = {50000, 100000, 250000, 500000};
+
+    printf("bench_lpm6: %d lookups per table\n", NLOOKUPS);
+    for (int i = 0; i < NELEMS(sizes); i++)
+        bench(sizes[i]);
+
+    return 0;
+}
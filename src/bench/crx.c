@@ -0,0 +1,357 @@
+/* # `crx.c`
+ * Compact radix trie, see crx.h
+ */
+
+#include <stdio.h>        // printf
+#include <sys/types.h>    // u_char
+#include <stdint.h>       // uint32_t
+#include <stdlib.h>       // malloc / calloc
+#include <arpa/inet.h>    // AF_INET(6)
+#include <string.h>       // memcpy
+
+#include "radix.h"
+#include "iptable.h"
+#include "crx.h"
+
+/* ## helper functions
+ *
+ * ### `crx_words`
+ * ```c
+ *   static void crx_words(uint32_t *w, uint8_t *key, int words);
+ * ```
+ * Copy the key bytes of binary `key` into `words` host order words, so bit
+ * `i` of the key is bit `31 - i % 32` of word `i / 32`.
+ */
+
+static void
+crx_words(uint32_t *w, uint8_t *key, int words)
+{
+    uint8_t *k = IPT_KEYPTR(key);
+
+    for (int i = 0; i < words; i++, k += 4)
+        w[i] = (uint32_t)k[0] << 24 | (uint32_t)k[1] << 16
+               | (uint32_t)k[2] << 8 | k[3];
+}
+
+/* ### `crx_bit`
+ * ```c
+ *   static inline int crx_bit(uint32_t *w, int pos);
+ * ```
+ * Return bit `pos` of key words `w`, 0 being the most significant bit.
+ */
+
+static inline int
+crx_bit(uint32_t *w, int pos)
+{
+    return (w[pos >> 5] >> (31 - (pos & 31))) & 1;
+}
+
+/* ### `crx_common`
+ * ```c
+ *   static int crx_common(uint32_t *a, uint32_t *b, int words);
+ * ```
+ * Return the number of leading bits that key words `a` and `b` share.
+ */
+
+static int
+crx_common(uint32_t *a, uint32_t *b, int words)
+{
+    for (int i = 0; i < words; i++)
+        if (a[i] != b[i])
+            return 32 * i + __builtin_clz(a[i] ^ b[i]);
+
+    return 32 * words;
+}
+
+/* ### `crx_match`
+ * ```c
+ *   static inline int crx_match(uint32_t *a, uint32_t *k, int mlen);
+ * ```
+ * Check whether key words `a` start with the first `mlen` bits of `k`.
+ * - returns 1 if so, 0 otherwise
+ */
+
+static inline int
+crx_match(uint32_t *a, uint32_t *k, int mlen)
+{
+    int i = 0;
+
+    for (; mlen >= 32; mlen -= 32, i++)
+        if (a[i] != k[i]) return 0;
+
+    return mlen == 0 || ((a[i] ^ k[i]) >> (32 - mlen)) == 0;
+}
+
+/* ### `crx_node`
+ * ```c
+ *   static uint32_t crx_node(crx_t *c, uint32_t *w, int mlen, entry_t *e);
+ * ```
+ * Append a node for the first `mlen` bits of key words `w` to engine `c`, a
+ * prefix if `e` is not NULL.  Grows the node array as needed, so pointers to
+ * nodes are invalid afterwards.
+ * - returns the index of the new node, 0 on failure
+ */
+
+static uint32_t
+crx_node(crx_t *c, uint32_t *w, int mlen, entry_t *e)
+{
+    uint32_t *n, size;
+    entry_t **entry;
+    int i;
+
+    if (c->count == c->size) {
+        if (c->size > UINT32_MAX / 2) return 0;
+        size = c->size ? 2 * c->size : 64;
+        if ((n = realloc(c->node, (size_t)size * c->stride * sizeof(*n)))
+            == NULL) return 0;
+        c->node = n;
+        if ((entry = realloc(c->entry, (size_t)size * sizeof(*entry)))
+            == NULL) return 0;
+        c->entry = entry;
+        c->size = size;
+    }
+
+    n = c->node + (size_t)c->count * c->stride;
+    n[CRX_CHILD] = n[CRX_CHILD + 1] = 0;
+    n[CRX_INFO] = (uint32_t)mlen | (e ? CRXF_PREFIX : 0);
+    for (i = 0; i < c->words; i++, mlen -= 32)
+        n[CRX_KEY + i] = mlen >= 32 ? w[i]
+                         : mlen <= 0 ? 0 : w[i] & ~(UINT32_MAX >> mlen);
+    c->entry[c->count] = e;
+
+    return c->count++;
+}
+
+/* ### `crx_insert`
+ * ```c
+ *   static int crx_insert(crx_t *c, uint32_t *w, int mlen, entry_t *e);
+ * ```
+ * Insert prefix `e`, whose key words are `w` and mask length `mlen`, into
+ * engine `c`.  A child with a longer key that does not start with the new
+ * prefix gets a new branching node as parent.
+ * - returns 1 on success, 0 on failure
+ */
+
+static int
+crx_insert(crx_t *c, uint32_t *w, int mlen, entry_t *e)
+{
+    uint32_t i = 1, j, x, y, *n, *m;
+    int b, len;
+
+    for (;;) {
+        n = c->node + (size_t)i * c->stride;
+        if ((int)CRX_MLEN(n) == mlen) {
+            n[CRX_INFO] |= CRXF_PREFIX;
+            c->entry[i] = e;
+            return 1;
+        }
+
+        b = crx_bit(w, CRX_MLEN(n));
+        if ((j = n[CRX_CHILD + b]) == 0) {
+            if ((x = crx_node(c, w, mlen, e)) == 0) return 0;
+            c->node[(size_t)i * c->stride + CRX_CHILD + b] = x;
+            return 1;
+        }
+
+        m = c->node + (size_t)j * c->stride;
+        len = crx_common(w, m + CRX_KEY, c->words);
+        if (len >= (int)CRX_MLEN(m) && mlen >= (int)CRX_MLEN(m)) {
+            i = j;                                 // descend
+            continue;
+        }
+        if (len > mlen) len = mlen;
+
+        /* j moves down, below the new prefix or a new branching node */
+        if ((x = crx_node(c, w, len, len == mlen ? e : NULL)) == 0) return 0;
+        m = c->node + (size_t)j * c->stride;
+        c->node[(size_t)x * c->stride + CRX_CHILD + crx_bit(m + CRX_KEY, len)]
+            = j;
+        if (len < mlen) {
+            if ((y = crx_node(c, w, mlen, e)) == 0) return 0;
+            c->node[(size_t)x * c->stride + CRX_CHILD + crx_bit(w, len)] = y;
+        }
+        c->node[(size_t)i * c->stride + CRX_CHILD + b] = x;
+
+        return 1;
+    }
+}
+
+/* ### `crx_relayout`
+ * ```c
+ *   static int crx_relayout(crx_t *c);
+ * ```
+ * Renumber the nodes of engine `c` in depth first order, so each node is
+ * followed by its left subtree and a lookup mostly moves forward through
+ * memory.  Also trims the arrays to the nodes in use.
+ * - returns 1 on success, 0 on failure
+ */
+
+static int
+crx_relayout(crx_t *c)
+{
+    uint32_t stack[2 * (IP6_MAXMASK + 2)], *order, *node, *n, *o, i, j;
+    entry_t **entry;
+    int top = 0;
+
+    order = malloc((size_t)c->count * sizeof(*order));
+    node = malloc((size_t)c->count * c->stride * sizeof(*node));
+    entry = malloc((size_t)c->count * sizeof(*entry));
+    if (order == NULL || node == NULL || entry == NULL) {
+        free(order);
+        free(node);
+        free(entry);
+        return 0;
+    }
+
+    /* pre-order walk assigns the new indices */
+    order[0] = 0;
+    stack[top++] = 1;
+    for (j = 1; top > 0; j++) {
+        i = stack[--top];
+        order[i] = j;
+        n = c->node + (size_t)i * c->stride;
+        if (n[CRX_CHILD + 1]) stack[top++] = n[CRX_CHILD + 1];
+        if (n[CRX_CHILD]) stack[top++] = n[CRX_CHILD];
+    }
+
+    for (i = 0; i < c->count; i++) {
+        n = c->node + (size_t)i * c->stride;
+        o = node + (size_t)order[i] * c->stride;
+        memcpy(o, n, c->stride * sizeof(*n));
+        o[CRX_CHILD] = order[n[CRX_CHILD]];
+        o[CRX_CHILD + 1] = order[n[CRX_CHILD + 1]];
+        entry[order[i]] = c->entry[i];
+    }
+
+    free(order);
+    free(c->node);
+    free(c->entry);
+    c->node = node;
+    c->entry = entry;
+    c->size = c->count;
+
+    return 1;
+}
+
+/* ## crx functions
+ *
+ * ### `crx_create`
+ * ```c
+ *   crx_t *crx_create(table_t *t, int af);
+ * ```
+ * Build an engine from the `af` radix tree of table `t`.  Prefixes flagged
+ * for deletion are ignored.  The engine refers to the table's entries, so it
+ * must not outlive the table and should be rebuilt once the table's
+ * generation changes.
+ * - returns the engine on success, NULL on failure
+ */
+
+crx_t *
+crx_create(table_t *t, int af)
+{
+    struct radix_node_head *head;
+    struct radix_node *rn;
+    uint32_t w[4] = {0};
+    crx_t *c;
+
+    if (t == NULL) return NULL;
+    if (af == AF_INET) head = t->head4;
+    else if (af == AF_INET6) head = t->head6;
+    else return NULL;
+
+    if ((c = calloc(1, sizeof(*c))) == NULL) return NULL;
+    c->af = af;
+    c->words = af == AF_INET ? 1 : 4;
+    c->stride = CRX_KEY + c->words;
+    c->maxlen = MAX_MASKLEN(af);
+    c->gen = t->gen;
+
+    /* node 0 is never used, node 1 is the root */
+    if (crx_node(c, w, 0, NULL) != 0 || crx_node(c, w, 0, NULL) != 1)
+        goto fail;
+
+    for (rn = rdx_firstleaf(&head->rh); rn; rn = rdx_nextleaf(rn)) {
+        if (rn->rn_flags & IPTF_DELETE) continue;
+        crx_words(w, (uint8_t *)rn->rn_key, c->words);
+        if (! crx_insert(c, w, key_masklen(rn->rn_mask), (entry_t *)rn))
+            goto fail;
+        c->prefixes++;
+    }
+
+    if (! crx_relayout(c)) goto fail;
+
+    return c;
+
+fail:
+    crx_destroy(&c);
+    return NULL;
+}
+
+/* ### `crx_lpm`
+ * ```c
+ *   entry_t *crx_lpm(crx_t *c, uint8_t *addr);
+ * ```
+ * Longest prefix match for binary address `addr`.  The walk stops at the
+ * first node whose key bits differ from the address, the last prefix seen
+ * before that is the best match.
+ * - returns the matching entry, NULL if there is none
+ */
+
+entry_t *
+crx_lpm(crx_t *c, uint8_t *addr)
+{
+    uint32_t a[4], i = 1, best = 0, *n;
+    int mlen;
+
+    if (c == NULL || addr == NULL) return NULL;
+    if (KEY_AF_FAM(addr) != c->af) return NULL;
+
+    crx_words(a, addr, c->words);
+    while (i) {
+        n = c->node + (size_t)i * c->stride;
+        mlen = CRX_MLEN(n);
+        if (! crx_match(a, n + CRX_KEY, mlen)) break;
+        if (n[CRX_INFO] & CRXF_PREFIX) best = i;
+        if (mlen == c->maxlen) break;
+        i = n[CRX_CHILD + crx_bit(a, mlen)];
+    }
+
+    return c->entry[best];
+}
+
+/* ### `crx_memsize`
+ * ```c
+ *   size_t crx_memsize(crx_t *c);
+ * ```
+ * Return the number of bytes allocated for engine `c`.
+ */
+
+size_t
+crx_memsize(crx_t *c)
+{
+    if (c == NULL) return 0;
+
+    return sizeof(*c) + (size_t)c->size * c->stride * sizeof(uint32_t)
+           + (size_t)c->size * sizeof(entry_t *);
+}
+
+/* ### `crx_destroy`
+ * ```c
+ *   int crx_destroy(crx_t **c);
+ * ```
+ * Free all resources of engine `*c`, the table's entries are not touched.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+crx_destroy(crx_t **c)
+{
+    if (c == NULL || *c == NULL) return 0;
+
+    free((*c)->node);
+    free((*c)->entry);
+    free(*c);
+    *c = NULL;
+
+    return 1;
+}
@@ -0,0 +1,101 @@
+/* ---
+ * title: crx reference
+ * author: hertogp
+ * tags: C api longest prefix match compact radix trie
+ * ...
+ *
+ * Compact radix trie, an alternative node layout for iptable's lookups.
+ *
+ */
+
+#ifndef crx_h
+#define crx_h
+
+/* # crx.h
+ *
+ * A read-only lookup engine built from one of the radix trees of an iptable,
+ * using a path compressed binary trie with a compact node layout.  Where a
+ * BSD radix tree spends two `struct radix_node`'s per prefix, linked by
+ * pointers and with the key and mask elsewhere on the heap, the nodes of a
+ * `crx_t` live in a single array and refer to each other by 32-bit indices.
+ * Each node carries its key bits inline, so a lookup never dereferences
+ * anything but the nodes on its path.  An ipv4 node takes 16 bytes and an
+ * ipv6 node 28 bytes, so 4 resp. 2 of them fit in a cache line.  After the
+ * build, the nodes are renumbered in depth first order, so a node's subtree
+ * follows it in memory.
+ *
+ * Nodes are packed as arrays of `uint32_t`, with `stride` words per node:
+ * - `CRX_CHILD`, two words, the indices of the children, 0 means none
+ * - `CRX_INFO`, the number of key bits in use (bits 0-7) and flags
+ * - `CRX_KEY`, 1 (ipv4) or 4 (ipv6) words, the masked key in host order
+ *
+ * Node 0 is never used, so index 0 can mean none.  Node 1 is the root, with
+ * zero key bits in use.  Every node's key extends that of its parent.  A node
+ * flagged `CRXF_PREFIX` is an actual prefix, others only exist to branch.
+ *
+ * Like [`bsl_t`](bsl.h), the engine is a snapshot: changes to the table after
+ * the engine was built are not seen and `gen` records the table's generation
+ * at build time, so callers can tell when to rebuild.
+ *
+ * crx is not part of libiptable.  Its ipv6 lookups are slower than those of
+ * the radix tree, so it lives with the benchmarks: `bench_crx` compares both
+ * and the library keeps using the radix tree and [`bsl_t`](../bsl.h).
+ *
+ * ## `#define's`
+ *
+ * `CRX_CHILD`, `CRX_INFO`, `CRX_KEY`
+ * : word offsets of the members of a node
+ *
+ * `CRXF_PREFIX`
+ * : info flag, node holds an actual prefix
+ *
+ * `CRX_MLEN(n)`
+ * : the number of key bits in use by node `n`
+ */
+
+#define CRX_CHILD   0
+#define CRX_INFO    2
+#define CRX_KEY     3
+#define CRXF_PREFIX 0x100
+#define CRX_MLEN(n) ((n)[CRX_INFO] & 0xff)
+
+/* ## Structures
+ *
+ * ### `crx_t`
+ * The engine has the following members:
+ * - `int af`, the AF family of the tree the engine was built from
+ * - `int words`, the number of key words per node, 1 for ipv4, 4 for ipv6
+ * - `int stride`, the number of words per node
+ * - `int maxlen`, the maximum mask length for the AF family
+ * - `uint64_t gen`, the table's generation at build time
+ * - `size_t prefixes`, the number of prefixes stored
+ * - `uint32_t count`, the number of nodes in use, including node 0
+ * - `uint32_t size`, the number of nodes allocated
+ * - `uint32_t *node`, the packed nodes
+ * - `entry_t **entry`, the entry for each node, NULL if not a prefix
+ *
+ * The entries are kept apart from the nodes, since they are only needed once
+ * a lookup has found its best matching node.
+ */
+
+typedef struct crx_t {
+    int af;                         // AF_INET or AF_INET6
+    int words;                      // key words per node
+    int stride;                     // words per node
+    int maxlen;                     // max mask length
+    uint64_t gen;                   // table generation at build time
+    size_t prefixes;                // prefixes stored
+    uint32_t count;                 // nodes in use, including node 0
+    uint32_t size;                  // nodes allocated
+    uint32_t *node;                 // packed nodes
+    entry_t **entry;                // entry per node, NULL if none
+} crx_t;
+
+// -- PROTOTYPES
+
+crx_t *crx_create(table_t *, int);
+entry_t *crx_lpm(crx_t *, uint8_t *);
+size_t crx_memsize(crx_t *);
+int crx_destroy(crx_t **);
+
+#endif
@@ -0,0 +1,425 @@
+/* # `bsl.c`
+ * Binary search on prefix lengths, see bsl.h
+ */
+
+#include <stdio.h>        // printf
+#include <sys/types.h>    // u_char
+#include <stdint.h>       // uint64_t
+#include <stdlib.h>       // malloc / calloc
+#include <arpa/inet.h>    // AF_INET(6)
+#include <string.h>       // memcpy
+
+#include "radix.h"
+#include "iptable.h"
+#include "bsl.h"
+
+/* ## helper functions
+ *
+ * ### `bsl_hash`
+ * ```c
+ *   static uint64_t bsl_hash(uint64_t w0, uint64_t w1);
+ * ```
+ * Hash a masked key, given as two words.  The low bits select a slot, the
+ * high bits feed the bloom filter, see `bsl_probes`.
+ */
+
+static uint64_t
+bsl_hash(uint64_t w0, uint64_t w1)
+{
+    uint64_t h;
+
+    h = w0 * 0x9E3779B97F4A7C15ULL;
+    h ^= (w1 + 0x632BE59BD9B4E019ULL) * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+
+    return h;
+}
+
+/* ### `bsl_words`
+ * ```c
+ *   static void bsl_words(uint64_t *w, uint8_t *key);
+ * ```
+ * Copy the key bytes of binary `key` into two words, zero padded.  The byte
+ * order of the words is irrelevant as long as keys and masks are copied the
+ * same way.
+ */
+
+static void
+bsl_words(uint64_t *w, uint8_t *key)
+{
+    w[0] = w[1] = 0;
+    memcpy(w, IPT_KEYPTR(key), IPT_KEYLEN(key) - 1);
+}
+
+/* ### `bsl_find`
+ * ```c
+ *   static bslslot_t *bsl_find(bsllevel_t *lvl, uint64_t *w, uint64_t h);
+ * ```
+ * Return the slot holding masked key `w` with hash `h`, or the empty slot
+ * where it would go.
+ */
+
+static bslslot_t *
+bsl_find(bsllevel_t *lvl, uint64_t *w, uint64_t h)
+{
+    size_t idx = h & (lvl->size - 1);
+    bslslot_t *s;
+
+    for (;; idx = (idx + 1) & (lvl->size - 1)) {
+        s = lvl->slot + idx;
+        if (!(s->flags & BSLF_USED))
+            return s;
+        if (s->w[0] == w[0] && s->w[1] == w[1])
+            return s;
+    }
+}
+
+/* ### `bsl_grow`
+ * ```c
+ *   static int bsl_grow(bsllevel_t *lvl);
+ * ```
+ * Double the number of slots of a level and rehash its slots.
+ * Returns 1 on success, 0 on failure.
+ */
+
+static int
+bsl_grow(bsllevel_t *lvl)
+{
+    bslslot_t *old = lvl->slot, *s;
+    size_t osize = lvl->size;
+
+    lvl->size = osize ? 2 * osize : 16;
+    if ((lvl->slot = calloc(lvl->size, sizeof(bslslot_t))) == NULL) {
+        lvl->slot = old;
+        lvl->size = osize;
+        return 0;
+    }
+
+    for (size_t i = 0; i < osize; i++) {
+        if (!(old[i].flags & BSLF_USED)) continue;
+        s = bsl_find(lvl, old[i].w, bsl_hash(old[i].w[0], old[i].w[1]));
+        *s = old[i];
+    }
+    free(old);
+
+    return 1;
+}
+
+/* ### `bsl_insert`
+ * ```c
+ *   static bslslot_t *bsl_insert(bsllevel_t *lvl, uint64_t *w);
+ * ```
+ * Return the slot for masked key `w`, adding it if needed.  The hash table
+ * is kept at most half full.  Returns NULL on failure.
+ */
+
+static bslslot_t *
+bsl_insert(bsllevel_t *lvl, uint64_t *w)
+{
+    bslslot_t *s;
+
+    if (2 * (lvl->count + 1) > lvl->size && ! bsl_grow(lvl))
+        return NULL;
+
+    s = bsl_find(lvl, w, bsl_hash(w[0], w[1]));
+    if (!(s->flags & BSLF_USED)) {
+        s->w[0] = w[0];
+        s->w[1] = w[1];
+        s->flags = BSLF_USED;
+        lvl->count++;
+    }
+
+    return s;
+}
+
+/* ### `bsl_level`
+ * ```c
+ *   static int bsl_level(bsl_t *b, int mlen);
+ * ```
+ * Return the index of the level for prefix length `mlen`, -1 if not found.
+ */
+
+static int
+bsl_level(bsl_t *b, int mlen)
+{
+    int lo = 0, hi = b->nlevels - 1, mid;
+
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (b->level[mid].mlen == mlen) return mid;
+        if (b->level[mid].mlen < mlen) lo = mid + 1;
+        else hi = mid - 1;
+    }
+
+    return -1;
+}
+
+/* ### `bsl_bmp`
+ * ```c
+ *   static entry_t *bsl_bmp(bsl_t *b, int idx, uint64_t *w);
+ * ```
+ * Find the best matching prefix for key `w` among the actual prefixes stored
+ * in levels `idx` and below.  Used at build time to set a marker's bmp.
+ */
+
+static entry_t *
+bsl_bmp(bsl_t *b, int idx, uint64_t *w)
+{
+    uint64_t k[2];
+    bslslot_t *s;
+    bsllevel_t *lvl;
+
+    for (; idx >= 0; idx--) {
+        lvl = b->level + idx;
+        k[0] = w[0] & lvl->m[0];
+        k[1] = w[1] & lvl->m[1];
+        s = bsl_find(lvl, k, bsl_hash(k[0], k[1]));
+        if (s->flags & BSLF_PREFIX)
+            return s->bmp;
+    }
+
+    return b->dflt;
+}
+
+/* ### `bsl_probes`
+ * ```c
+ *   static void bsl_probes(uint64_t h, size_t bbits, uint64_t *bit);
+ * ```
+ * Derive the 2 bloom filter bits for hash `h`.  The first comes from the high
+ * half of `h`, the second from the high half of a remix of `h`, so both can
+ * address all `bbits` bits and do not share any input bits.
+ */
+
+static inline void
+bsl_probes(uint64_t h, size_t bbits, uint64_t *bit)
+{
+    bit[0] = (h >> 32) & (bbits - 1);
+    h *= 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29;
+    bit[1] = (h >> 32) & (bbits - 1);
+}
+
+/* ### `bsl_bloom`
+ * ```c
+ *   static int bsl_bloom(bsllevel_t *lvl);
+ * ```
+ * Create a bloom filter for a level with 8 bits per slot in use and set 2
+ * bits per key.  Returns 1 on success, 0 on failure.
+ */
+
+static int
+bsl_bloom(bsllevel_t *lvl)
+{
+    uint64_t h, bit[2];
+
+    for (lvl->bbits = 64; lvl->bbits < 8 * lvl->count; lvl->bbits <<= 1)
+        ;
+    if ((lvl->bloom = calloc(lvl->bbits / 64, sizeof(uint64_t))) == NULL)
+        return 0;
+
+    for (size_t i = 0; i < lvl->size; i++) {
+        if (!(lvl->slot[i].flags & BSLF_USED)) continue;
+        h = bsl_hash(lvl->slot[i].w[0], lvl->slot[i].w[1]);
+        bsl_probes(h, lvl->bbits, bit);
+        lvl->bloom[bit[0] / 64] |= 1ULL << (bit[0] & 63);
+        lvl->bloom[bit[1] / 64] |= 1ULL << (bit[1] & 63);
+    }
+
+    return 1;
+}
+
+/* ## engine functions
+ *
+ * ### `bsl_create`
+ * ```c
+ *   bsl_t *bsl_create(table_t *t, int af, int bloom);
+ * ```
+ * Build an engine from the `af` radix tree of table `t`, with bloom filters
+ * if `bloom` is non-zero.  Prefixes flagged for deletion are ignored.  The
+ * engine refers to the table's entries, so it must not outlive the table and
+ * should be rebuilt once the table's generation changes.
+ * - returns the engine on success, NULL on failure
+ */
+
+bsl_t *
+bsl_create(table_t *t, int af, int bloom)
+{
+    struct radix_node_head *head;
+    struct radix_node *rn;
+    bsl_t *b = NULL;
+    uint8_t mask[MAX_BINKEY];
+    uint64_t w[2], k[2];
+    int have[IP6_MAXMASK + 1] = {0};
+    int mlen, idx, lo, hi, mid;
+    size_t count;
+    bslslot_t *s;
+
+    if (t == NULL) return NULL;
+    if (af == AF_INET) head = t->head4;
+    else if (af == AF_INET6) head = t->head6;
+    else return NULL;
+
+    if ((b = calloc(1, sizeof(*b))) == NULL) return NULL;
+    b->af = af;
+    b->gen = t->gen;
+
+    /* collect the distinct prefix lengths */
+    for (rn = rdx_firstleaf(&head->rh); rn; rn = rdx_nextleaf(rn))
+        if (!(rn->rn_flags & IPTF_DELETE))
+            have[key_masklen(rn->rn_mask)] = 1;
+
+    for (mlen = 1; mlen <= IP6_MAXMASK; mlen++) {
+        if (! have[mlen]) continue;
+        b->level[b->nlevels].mlen = mlen;
+        if (! key_bylen(mask, mlen, af)) goto fail;
+        bsl_words(b->level[b->nlevels].m, mask);
+        b->nlevels++;
+    }
+
+    /* add the actual prefixes, each being its own bmp */
+    for (rn = rdx_firstleaf(&head->rh); rn; rn = rdx_nextleaf(rn)) {
+        if (rn->rn_flags & IPTF_DELETE) continue;
+        if ((mlen = key_masklen(rn->rn_mask)) == 0) {
+            b->dflt = (entry_t *)rn;
+            b->prefixes++;
+            continue;
+        }
+        bsl_words(w, (uint8_t *)rn->rn_key);
+        idx = bsl_level(b, mlen);
+        k[0] = w[0] & b->level[idx].m[0];
+        k[1] = w[1] & b->level[idx].m[1];
+        if ((s = bsl_insert(b->level + idx, k)) == NULL) goto fail;
+        s->flags |= BSLF_PREFIX;
+        s->bmp = (entry_t *)rn;
+        b->prefixes++;
+    }
+
+    /* add markers on the binary search path leading to each prefix */
+    for (rn = rdx_firstleaf(&head->rh); rn; rn = rdx_nextleaf(rn)) {
+        if (rn->rn_flags & IPTF_DELETE) continue;
+        if ((mlen = key_masklen(rn->rn_mask)) == 0) continue;
+        bsl_words(w, (uint8_t *)rn->rn_key);
+        idx = bsl_level(b, mlen);
+        for (lo = 0, hi = b->nlevels - 1; lo <= hi;) {
+            mid = (lo + hi) / 2;
+            if (mid == idx) break;
+            if (mid > idx) {
+                hi = mid - 1;
+                continue;
+            }
+            k[0] = w[0] & b->level[mid].m[0];
+            k[1] = w[1] & b->level[mid].m[1];
+            count = b->level[mid].count;
+            if ((s = bsl_insert(b->level + mid, k)) == NULL) goto fail;
+            if (b->level[mid].count > count) {
+                s->bmp = bsl_bmp(b, mid - 1, k);
+                b->markers++;
+            }
+            lo = mid + 1;
+        }
+    }
+
+    for (idx = 0; bloom && idx < b->nlevels; idx++)
+        if (! bsl_bloom(b->level + idx)) goto fail;
+
+    return b;
+
+fail:
+    bsl_destroy(&b);
+    return NULL;
+}
+
+/* ### `bsl_lpm`
+ * ```c
+ *   entry_t *bsl_lpm(bsl_t *b, uint8_t *addr);
+ * ```
+ * Longest prefix match for binary address `addr`.
+ * - returns the matching entry, NULL if there is none
+ */
+
+entry_t *
+bsl_lpm(bsl_t *b, uint8_t *addr)
+{
+    entry_t *best;
+    bsllevel_t *lvl;
+    bslslot_t *s;
+    uint64_t a[2], k[2], h, bit[2];
+    int lo, hi, mid;
+
+    if (b == NULL || addr == NULL) return NULL;
+    if (KEY_AF_FAM(addr) != b->af) return NULL;
+
+    bsl_words(a, addr);
+    best = b->dflt;
+    for (lo = 0, hi = b->nlevels - 1; lo <= hi;) {
+        mid = (lo + hi) / 2;
+        lvl = b->level + mid;
+        k[0] = a[0] & lvl->m[0];
+        k[1] = a[1] & lvl->m[1];
+        h = bsl_hash(k[0], k[1]);
+
+        if (lvl->bloom) {
+            bsl_probes(h, lvl->bbits, bit);
+            if (!(lvl->bloom[bit[0] / 64] & (1ULL << (bit[0] & 63)))
+                || !(lvl->bloom[bit[1] / 64] & (1ULL << (bit[1] & 63)))) {
+                hi = mid - 1;  /* definitely not here, try shorter */
+                continue;
+            }
+        }
+
+        s = bsl_find(lvl, k, h);
+        if (s->flags & BSLF_USED) {
+            if (s->bmp) best = s->bmp;
+            lo = mid + 1;      /* prefix or marker, try longer */
+        } else
+            hi = mid - 1;      /* try shorter */
+    }
+
+    return best;
+}
+
+/* ### `bsl_memsize`
+ * ```c
+ *   size_t bsl_memsize(bsl_t *b);
+ * ```
+ * Return the number of bytes allocated for engine `b`.
+ */
+
+size_t
+bsl_memsize(bsl_t *b)
+{
+    size_t size;
+
+    if (b == NULL) return 0;
+
+    size = sizeof(*b);
+    for (int i = 0; i < b->nlevels; i++)
+        size += b->level[i].size * sizeof(bslslot_t) + b->level[i].bbits / 8;
+
+    return size;
+}
+
+/* ### `bsl_destroy`
+ * ```c
+ *   int bsl_destroy(bsl_t **b);
+ * ```
+ * Free all resources of engine `*b`, the table's entries are not touched.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+bsl_destroy(bsl_t **b)
+{
+    if (b == NULL || *b == NULL) return 0;
+
+    for (int i = 0; i < (*b)->nlevels; i++) {
+        free((*b)->level[i].slot);
+        free((*b)->level[i].bloom);
+    }
+    free(*b);
+    *b = NULL;
+
+    return 1;
+}
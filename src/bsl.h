@@ -0,0 +1,108 @@
+/* ---
+ * title: bsl reference
+ * author: hertogp
+ * tags: C api longest prefix match binary search prefix lengths
+ * ...
+ *
+ * Binary search on prefix lengths, an alternative lookup engine for iptable.
+ *
+ */
+
+#ifndef bsl_h
+#define bsl_h
+
+/* # bsl.h
+ *
+ * A read-only lookup engine built from one of the radix trees of an iptable,
+ * using binary search on prefix lengths (Waldvogel et al., "Scalable High
+ * Speed IP Routing Lookups", SIGCOMM '97).  Each distinct prefix length gets
+ * a hash table of prefixes of that length.  A lookup does a binary search on
+ * the sorted lengths, probing one hash table per step, so it takes O(log W)
+ * probes where W is the number of distinct lengths.  Markers guide the search
+ * towards longer prefixes and carry their best matching prefix, computed at
+ * build time, so the search never needs to backtrack.
+ *
+ * Optionally, each length gets a small bloom filter that is checked before
+ * its hash table, to skip most probes that would miss.
+ *
+ * The engine is a snapshot: changes to the table after the engine was built
+ * are not seen.  `bsl_t`'s `gen` records the table's generation at build time,
+ * so callers can tell when to rebuild.
+ *
+ * ## `#define's`
+ *
+ * `BSLF_USED`
+ * : slot flag, slot is in use
+ *
+ * `BSLF_PREFIX`
+ * : slot flag, slot holds an actual prefix (otherwise it's only a marker)
+ */
+
+#define BSLF_USED   1
+#define BSLF_PREFIX 2
+
+/* ## Structures
+ *
+ * ### `bslslot_t`
+ * A slot in the hash table of a prefix length has members:
+ * - `uint64_t w[2]`, the (masked) key, copied into two words
+ * - `entry_t *bmp`, the best matching prefix for this key, may be NULL
+ * - `int flags`, see `BSLF_x`
+ */
+
+typedef struct bslslot_t {
+    uint64_t w[2];                  // masked key as two words
+    entry_t *bmp;                   // best matching prefix, NULL if none
+    int flags;                      // BSLF_USED, BSLF_PREFIX
+} bslslot_t;
+
+/* ### `bsllevel_t`
+ * A level holds all prefixes and markers of a single prefix length:
+ * - `int mlen`, the prefix length
+ * - `uint64_t m[2]`, the mask for this length, as two words
+ * - `size_t size`, the number of slots, a power of 2
+ * - `size_t count`, the number of slots in use
+ * - `bslslot_t *slot`, the hash table itself, using linear probing
+ * - `uint64_t *bloom`, optional bloom filter, NULL if not used
+ * - `size_t bbits`, the number of bits in the bloom filter, a power of 2
+ */
+
+typedef struct bsllevel_t {
+    int mlen;                       // prefix length
+    uint64_t m[2];                  // mask as two words
+    size_t size;                    // number of slots, a power of 2
+    size_t count;                   // slots in use
+    bslslot_t *slot;                // hash table, linear probing
+    uint64_t *bloom;                // optional bloom filter
+    size_t bbits;                   // bloom filter size in bits
+} bsllevel_t;
+
+/* ### `bsl_t`
+ * The engine has the following members:
+ * - `int af`, the AF family of the tree the engine was built from
+ * - `int nlevels`, the number of distinct prefix lengths (excluding /0)
+ * - `entry_t *dflt`, the /0 prefix, if any
+ * - `uint64_t gen`, the table's generation at build time
+ * - `size_t prefixes`, the number of prefixes stored
+ * - `size_t markers`, the number of markers stored
+ * - `bsllevel_t level[]`, the levels, sorted by prefix length
+ */
+
+typedef struct bsl_t {
+    int af;                         // AF_INET or AF_INET6
+    int nlevels;                    // number of levels in use
+    entry_t *dflt;                  // default route, if any
+    uint64_t gen;                   // table generation at build time
+    size_t prefixes;                // prefixes stored
+    size_t markers;                 // markers stored
+    bsllevel_t level[IP6_MAXMASK];  // levels sorted by mlen
+} bsl_t;
+
+// -- PROTOTYPES
+
+bsl_t *bsl_create(table_t *, int, int);
+entry_t *bsl_lpm(bsl_t *, uint8_t *);
+size_t bsl_memsize(bsl_t *);
+int bsl_destroy(bsl_t **);
+
+#endif
@@ -6,10 +6,12 @@
 // #include <sys/socket.h>
 #include <stddef.h>       // offsetof
 #include <stdlib.h>       // malloc / calloc
+#include <stdint.h>       // SIZE_MAX
 // #include <netinet/in.h>   // sockaddr_in
 #include <arpa/inet.h>    // inet_pton and friends
 #include <string.h>       // strlen
 #include <ctype.h>        // isdigit
+#include <time.h>         // clock_gettime
 
 #include "radix.h"
 #include "iptable.h"
@@ -40,6 +42,109 @@ uint8_t  max_mask[RDX_MAX_KEYLEN] = {
  *
  */
 
+/*
+ * ### `kw_load`
+ * ```c
+ *   static void kw_load(uint64_t *w, const uint8_t *k, int n);
+ * ```
+ * Load the first `n` (at most 16) bytes at `k` into two host order words,
+ * most significant first, as if `k` were a 128 bit big endian number padded
+ * with zero bytes.  The word versions of the key functions use this to work
+ * on (up to) 128 bits at once rather than on one byte at a time.
+ */
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define KW_BE64(x) __builtin_bswap64(x)
+#else
+#define KW_BE64(x) (x)
+#endif
+
+static inline void
+kw_load(uint64_t *w, const uint8_t *k, int n)
+{
+    uint32_t x;
+
+    /* fixed size copies for full ipv4/ipv6 keys compile to plain loads */
+    if (n == 16) {
+        memcpy(w, k, 16);
+        w[0] = KW_BE64(w[0]);
+        w[1] = KW_BE64(w[1]);
+    } else if (n == 4) {
+        memcpy(&x, k, 4);
+        w[0] = (uint64_t)ntohl(x) << 32;
+        w[1] = 0;
+    } else {
+        /* e.g. radix masks, whose LEN only covers their non-zero bytes: two
+         * overlapping fixed size copies never read beyond k[n-1] */
+        uint8_t buf[16] = {0};
+
+        n = n > 16 ? 16 : n;
+        if (n >= 8) {
+            memcpy(buf, k, 8);
+            memcpy(buf + n - 8, k + n - 8, 8);
+        } else if (n >= 4) {
+            memcpy(buf, k, 4);
+            memcpy(buf + n - 4, k + n - 4, 4);
+        } else {
+            for (int i = 0; i < n; i++)
+                buf[i] = k[i];
+        }
+        memcpy(w, buf, 16);
+        w[0] = KW_BE64(w[0]);
+        w[1] = KW_BE64(w[1]);
+    }
+}
+
+/*
+ * ### `kw_store`
+ * ```c
+ *   static void kw_store(uint8_t *k, const uint64_t *w, int n);
+ * ```
+ * Store the first `n` (at most 16) bytes of the words `w` at `k`, the
+ * inverse of `kw_load`.
+ */
+
+static inline void
+kw_store(uint8_t *k, const uint64_t *w, int n)
+{
+    uint64_t buf[2];
+    uint32_t x;
+
+    if (n == 4) {
+        x = htonl((uint32_t)(w[0] >> 32));
+        memcpy(k, &x, 4);
+        return;
+    }
+    buf[0] = KW_BE64(w[0]);
+    buf[1] = KW_BE64(w[1]);
+    memcpy(k, buf, n > 16 ? 16 : n < 0 ? 0 : n);
+}
+
+/*
+ * ### `kw_unit`
+ * ```c
+ *   static void kw_unit(uint64_t *w, int ulen);
+ * ```
+ * Shift the 128 bit number in the words `w` to the right, so that it becomes
+ * the index of the /`ulen` subnet the address belongs to.
+ */
+
+static inline void
+kw_unit(uint64_t *w, int ulen)
+{
+    int n = 128 - ulen;
+
+    if (n >= 128) {
+        w[0] = w[1] = 0;
+    } else if (n >= 64) {
+        w[1] = w[0] >> (n - 64);
+        w[0] = 0;
+    } else if (n > 0) {
+        w[1] = (w[1] >> n) | (w[0] << (64 - n));
+        w[0] >>= n;
+    }
+}
+
 /*
  * ### `key_alloc`
  * ```c
@@ -154,6 +259,77 @@ key_bystr(uint8_t *dst, int *mlen, int *af, const char *s)
     return NULL;  /* NOT REACHED */
 }
 
+/*
+ * ### `key_bysockaddr`
+ * ```c
+ * uint8_t *key_bysockaddr(uint8_t *dst, const struct sockaddr *sa);
+ * ```
+ *
+ * Store the address of `sa`, a `struct sockaddr_in` or `struct sockaddr_in6`
+ * as given by its `sa_family`, as a binary key in `dst`.  Returns NULL on
+ * failure.  Assumes `dst`'s size MAX_BINKEY, which fits both ipv4/ipv6.
+ */
+
+uint8_t *
+key_bysockaddr(uint8_t *dst, const struct sockaddr *sa)
+{
+    const uint8_t *src = (const uint8_t *)sa;
+
+    if (dst == NULL || sa == NULL) return NULL;
+
+    if (sa->sa_family == AF_INET) {
+        IPT_KEYLEN(dst) = IP4_KEYLEN;
+        memcpy(IPT_KEYPTR(dst), src + offsetof(struct sockaddr_in, sin_addr),
+               IP4_KEYLEN - 1);
+        return dst;
+    }
+    if (sa->sa_family == AF_INET6) {
+        IPT_KEYLEN(dst) = IP6_KEYLEN;
+        memcpy(IPT_KEYPTR(dst), src + offsetof(struct sockaddr_in6, sin6_addr),
+               IP6_KEYLEN - 1);
+        return dst;
+    }
+
+    return NULL;
+}
+
+/*
+ * ### `key_byhdr`
+ * ```c
+ * uint8_t *key_byhdr(uint8_t *dst, const uint8_t *hdr, size_t len, int dir);
+ * ```
+ *
+ * Store the source (`dir` is `HDR_SRC`) or destination (`dir` is `HDR_DST`)
+ * address of the raw ipv4 or ipv6 header at `hdr` as a binary key in `dst`.
+ * The IP version is taken from the header itself, `len` is the number of
+ * bytes available at `hdr`.  Returns NULL for an unknown version or if `len`
+ * is too short for the header.  Assumes `dst`'s size MAX_BINKEY.
+ */
+
+uint8_t *
+key_byhdr(uint8_t *dst, const uint8_t *hdr, size_t len, int dir)
+{
+    if (dst == NULL || hdr == NULL || len < 1) return NULL;
+    if (dir != HDR_SRC && dir != HDR_DST) return NULL;
+
+    switch (hdr[0] >> 4) {
+    case 4:
+        if (len < 20) return NULL;
+        IPT_KEYLEN(dst) = IP4_KEYLEN;
+        memcpy(IPT_KEYPTR(dst), hdr + (dir == HDR_SRC ? 12 : 16),
+               IP4_KEYLEN - 1);
+        return dst;
+    case 6:
+        if (len < 40) return NULL;
+        IPT_KEYLEN(dst) = IP6_KEYLEN;
+        memcpy(IPT_KEYPTR(dst), hdr + (dir == HDR_SRC ? 8 : 24),
+               IP6_KEYLEN - 1);
+        return dst;
+    }
+
+    return NULL;
+}
+
 /*
  * ### `key_byfit`
  * ```c
@@ -169,8 +345,7 @@ key_bystr(uint8_t *dst, int *mlen, int *af, const char *s)
 uint8_t *
 key_byfit(uint8_t *m, uint8_t *a, uint8_t *b)
 {
-  uint8_t *x, *xmax, off=0;
-  int af, trail = 0xFF;
+  int af, nbits, lo = 0, diff = -1, ones = 0, mlen;
 
   if ( m == NULL || a == NULL || b == NULL)
     return NULL;
@@ -179,38 +354,29 @@ key_byfit(uint8_t *m, uint8_t *a, uint8_t *b)
   af = KEY_AF_FAM(a);
   if (AF_UNKNOWN(af))
     return NULL;
-  *m = IPT_KEYLEN(a);  /* set mask's LEN byte */
-
-  /* set mask bytes that honor 'a's lowest 1-bit and 'b' as a maximum */
-  xmax = m + *m; x = m+1; a++; b++;
-  for (; x < xmax; x++, a++, b++) {
-    if (off) {
-      *x = 0x00;
-      trail &= *b;
-    } else if (*a == *b) {
-      *x = 0xFF;
-    } else {
-      /* runs once for 1st byte where a,b keys differ */
-      off = xmax - x;
-      *x = (*a & -*a)-1;
-      while (*x > (*b - *a))
-          *x = *x >> 1;
-      *x = ~*x;
-    }
-  }
-
-  /* need to ensure the broadcast address: (y|~m) <= z, since there are
-   * trailing bytes < 0xFF.  So if the broadcast address, at the xmark spot
-   * equals *z's byte, the mask needs to be expanded by 1 bit.
-   */
 
-  if (trail != 0xFF) {
-    x = x - off; a = a - off; b = b -off;
-    if ((0xFF & (*a | ~*x)) == *b)
-      *x = 0x80 | (*x >> 1);
+  /* lo: bits needed so that a is its own network address, i.e. one past a's
+   * lowest 1-bit.  diff: the first bit where a and b differ.  ones: the
+   * number of trailing 1-bits of b. */
+  nbits = (IPT_KEYLEN(a) - 1) * 8;
+  for (int i = 0; i < nbits; i++) {
+    int abit = (a[1 + i/8] >> (7 - i%8)) & 1;
+    int bbit = (b[1 + i/8] >> (7 - i%8)) & 1;
+    if (abit) lo = i + 1;
+    if (diff < 0 && abit != bbit) diff = i;
+    ones = bbit ? ones + 1 : 0;
   }
 
-  return m;
+  /* a == b yields a host mask.  Otherwise, a mask longer than diff keeps the
+   * broadcast address below b, while a mask at or before diff only works if
+   * b's remaining bits are all 1's. */
+  if (diff < 0)
+    mlen = nbits;
+  else
+    mlen = nbits - ones <= diff ? nbits - ones : diff + 1;
+  mlen = mlen < lo ? lo : mlen;
+
+  return key_bylen(m, mlen, af);
 }
 
 /* ### `key_bylen`
@@ -297,27 +463,17 @@ int key_masklen(void *key)
     // counts the nr of consequtive 1-bits starting with the MSB first.
     // - a radix mask key's KEYLEN indicates the num of non-zero bytes in the
     //   mask.  Hence, it may be smaller than 1+IP{4,6}_KEYLEN
-
-    int size = 0, cnt = 0;
-    uint8_t *cp;
+    //   (bytes beyond KEYLEN are loaded as 0's, so they stop the count)
+    uint64_t w[2];
 
     // sanity check
     if (key == NULL) return -1;
 
-    size = IPT_KEYLEN((uint8_t *)key);        // nr of bytes in key
-    cp = IPT_KEYPTR((uint8_t *)key);          // pick up start of key
-
-    // count bits of all-1's bytes
-    for(; --size > 0 && *cp == 0xff; cnt += 8, cp++)
-        ;
-
-    if (size <= 0) return cnt;               // got them all
-
-    // count 1-bits from MSB to LSB stopping at first 0-bit
-    for (uint8_t m=0x80; m > 0 && *cp & m; m = m >> 1, cnt++)
-        ;
+    kw_load(w, IPT_KEYPTR((uint8_t *)key), IPT_KEYLEN((uint8_t *)key) - 1);
 
-    return cnt;
+    if (~w[0]) return __builtin_clzll(~w[0]);
+    if (~w[1]) return 64 + __builtin_clzll(~w[1]);
+    return 128;
 }
 
 /* ### `key_tostr`
@@ -430,22 +586,29 @@ key_bynum(uint8_t *key, size_t num, int af)
 uint8_t *
 key_incr(uint8_t *key, size_t num)
 {
-  uint8_t *x = key, n, prev;
+  uint64_t w[2], lo;
 
   if (key == NULL)
       return NULL;
-  if (KEY_AF_FAM(key) == AF_UNSPEC)
-      return NULL;
 
-  for (x = x + *x -1; num && (x > key); x--) {
-    n = num & 0xff;
-    num >>= 8;
-    prev = *x;
-    *x += n;
-    if (*x < prev)
-        num++;
+  if (KEY_IS_IP4(key)) {
+      /* 32 bits, any carry out of the low 32 bits means a wrap */
+      kw_load(w, IPT_KEYPTR(key), 4);
+      lo = (w[0] >> 32) + (uint64_t)num;
+      w[0] = lo << 32;
+      kw_store(IPT_KEYPTR(key), w, 4);
+      return (lo >> 32 || lo < (uint64_t)num) ? NULL : key;
   }
-  if (num > 0)
+  if (! KEY_IS_IP6(key))
+      return NULL;
+
+  /* 128 bits as hi:lo, carry from lo into hi */
+  kw_load(w, IPT_KEYPTR(key), 16);
+  lo = w[1];
+  w[1] += (uint64_t)num;
+  w[0] += (w[1] < lo);
+  kw_store(IPT_KEYPTR(key), w, 16);
+  if (w[1] < lo && w[0] == 0)
       return NULL;  /* wrapped around */
 
   return key;
@@ -464,22 +627,29 @@ key_incr(uint8_t *key, size_t num)
 uint8_t *
 key_decr(uint8_t *key, size_t num)
 {
-  uint8_t *x = key, n, prev;
+  uint64_t w[2], lo;
 
   if (key == NULL)
       return NULL;
-  if (KEY_AF_FAM(key) == AF_UNSPEC)
-      return NULL;
 
-  for (x = x + *x -1; num && (x > key); x--) {
-    n = num & 0xff;
-    num >>= 8;
-    prev = *x;
-    *x -= n;
-    if (*x > prev)
-        num++;
+  if (KEY_IS_IP4(key)) {
+      /* 32 bits, borrowing beyond the low 32 bits means a wrap */
+      kw_load(w, IPT_KEYPTR(key), 4);
+      lo = w[0] >> 32;
+      w[0] = (lo - (uint64_t)num) << 32;
+      kw_store(IPT_KEYPTR(key), w, 4);
+      return (uint64_t)num > lo ? NULL : key;
   }
-  if (num > 0)
+  if (! KEY_IS_IP6(key))
+      return NULL;
+
+  /* 128 bits as hi:lo, borrow from hi into lo */
+  kw_load(w, IPT_KEYPTR(key), 16);
+  lo = w[1];
+  w[1] -= (uint64_t)num;
+  w[0] -= (w[1] > lo);
+  kw_store(IPT_KEYPTR(key), w, 16);
+  if (w[1] > lo && w[0] == UINT64_MAX)
       return NULL;  /* wrapped around */
 
   return key;
@@ -566,18 +736,21 @@ key_network(void *key, void *mask)
     //   to be 0x00 (some radix tree masks seem to do this).
     int klen, mlen;
     uint8_t *k = key, *m = mask;
+    uint64_t kw[2], mw[2];
 
     // sanity check
     if (k == NULL || m == NULL) return 0;
     klen = IPT_KEYLEN(k);
     mlen = IPT_KEYLEN(m);
-    k = IPT_KEYPTR(k);      // skip LEN byte
-    m = IPT_KEYPTR(m);      // skip LEN byte
 
     if (klen < 2) return 0;     // no key, no network address
     if (mlen > klen) return 0;  // donot overrun key
-    for(mlen--; --klen; mlen--)
-        *(k++) &= (mlen > 0) ? *(m++) : 0x00;
+
+    kw_load(kw, IPT_KEYPTR(k), klen - 1);
+    kw_load(mw, IPT_KEYPTR(m), mlen - 1);
+    kw[0] &= mw[0];
+    kw[1] &= mw[1];
+    kw_store(IPT_KEYPTR(k), kw, klen - 1);
 
     return 1;
 }
@@ -597,6 +770,7 @@ key_broadcast(void *key, void *mask)
 {
     int klen, mlen;
     uint8_t *k = key, *m = mask;
+    uint64_t kw[2], mw[2];
 
     if (k == NULL || m == NULL) return 0;
 
@@ -606,11 +780,11 @@ key_broadcast(void *key, void *mask)
     if (klen < 2) return 0;      /* no key, no bcast address */
     if (mlen > klen) return 0;   /* mask may be smaller, never larger */
 
-    k = IPT_KEYPTR(k);
-    m = IPT_KEYPTR(m);
-
-    for(mlen--; --klen; mlen--)
-        *(k++) |= (mlen > 0) ? ~*(m++) : 0xff;
+    kw_load(kw, IPT_KEYPTR(k), klen - 1);
+    kw_load(mw, IPT_KEYPTR(m), mlen - 1);
+    kw[0] |= ~mw[0];
+    kw[1] |= ~mw[1];
+    kw_store(IPT_KEYPTR(k), kw, klen - 1);
 
     return 1;
 }
@@ -626,17 +800,18 @@ int
 key_cmp(void *a, void *b)
 {
     uint8_t keylen, *aa = a, *bb = b;
+    uint64_t aw[2], bw[2];
 
     if (aa == NULL || bb == NULL) return -2;       // need real keys
     keylen = IPT_KEYLEN(aa);
     if (keylen != IPT_KEYLEN(bb)) return -2;       // different AF_families
     if (keylen < 2) return -2;                     // need key bits to compare
 
-    for(; --keylen > 0 && *aa==*bb; aa++, bb++)
-        ;
+    kw_load(aw, IPT_KEYPTR(aa), keylen - 1);
+    kw_load(bw, IPT_KEYPTR(bb), keylen - 1);
 
-    if (*aa < *bb) return -1;
-    if (*aa > *bb) return 1;
+    if (aw[0] != bw[0]) return aw[0] < bw[0] ? -1 : 1;
+    if (aw[1] != bw[1]) return aw[1] < bw[1] ? -1 : 1;
     return 0;
 }
 
@@ -655,20 +830,22 @@ key_isin(void *a, void *b, void *m)
 {
     uint8_t *aa = a, *bb = b, *mm = m;
     int matchlen = 0;  // how many bytes to match depends on mask
+    uint64_t aw[2], bw[2], mw[2];
 
     // sanity checks
     if(aa == NULL || bb == NULL) return 0;
 
-    // if((matchlen = IPT_KEYLEN(aa)) != IPT_KEYLEN(bb)) return 0;
     matchlen = min(IPT_KEYLEN(aa), IPT_KEYLEN(bb));
     matchlen = mm ? min(matchlen, IPT_KEYLEN(mm)) : matchlen;
-    mm = mm ? mm+1 : max_mask;
+    if (matchlen < 2) return 1;  // nothing to compare
 
-    aa++; bb++;
-    for (; --matchlen > 0; aa++, bb++, mm++)
-        if ((*aa ^ *bb) & *mm) return 0;
+    // keys load at their full length, the mask is cut at matchlen (its
+    // bytes beyond that load as 0's) and so decides what is compared
+    kw_load(aw, IPT_KEYPTR(aa), IPT_KEYLEN(aa) - 1);
+    kw_load(bw, IPT_KEYPTR(bb), IPT_KEYLEN(bb) - 1);
+    kw_load(mw, mm ? IPT_KEYPTR(mm) : max_mask, matchlen - 1);
 
-    return 1;
+    return ((aw[0] ^ bw[0]) & mw[0]) == 0 && ((aw[1] ^ bw[1]) & mw[1]) == 0;
 }
 
 /*
@@ -877,105 +1054,388 @@ key_toredo(int get, uint8_t *v6, uint8_t *ts, uint8_t *tc, int *udp,
     return 1;
 }
 
-/* ## radix node functions
+/* ## reference key functions
+ *
+ * Byte-wise versions of the key functions that process keys one word at a
+ * time.  They are not used by the library itself, but serve as a reference
+ * in differential tests and benchmarks.
  */
 
-/* ### _dumprn`
+/* ### `kref_masklen`
  * ```c
- *   void _dumprn(const char *s, struct radix_node *rn);
+ *   int kref_masklen(void *key);
  * ```
- * dump radix node characteristics to stderr
+ * Count the number of consequtive 1-bits, starting with the msb first.
  */
 
-void _dumprn(const char *s, struct radix_node *rn)
+int kref_masklen(void *key)
 {
-    char dbuf[MAX_STRKEY];
-    fprintf(stderr, "%10s rn @ %p", s, (void*)rn);
-    if(rn!=NULL) {
-        if(RDX_ISLEAF(rn)) {
-            fprintf(stderr, " %s", key_tostr(dbuf, rn->rn_key));
-            fprintf(stderr, "/%d", key_masklen(rn->rn_mask));
-            fprintf(stderr, ", keylen %d", IPT_KEYLEN(rn->rn_key));
-        }
-        fprintf(stderr, ", isroot %d", rn->rn_flags & RNF_ROOT);
-        fprintf(stderr, ", isleaf %d", RDX_ISLEAF(rn));
-        fprintf(stderr, ", isNORM %d", rn->rn_flags & RNF_NORMAL);
-        fprintf(stderr, ", flags  %d", rn->rn_flags);
-        fprintf(stderr, ", rn_bit %d", rn->rn_bit);
-    }
-    fprintf(stderr, "\n");
-}
+    // counts the nr of consequtive 1-bits starting with the MSB first.
+    // - a radix mask key's KEYLEN indicates the num of non-zero bytes in the
+    //   mask.  Hence, it may be smaller than 1+IP{4,6}_KEYLEN
 
-/* ### `rdx_flush`
- * ```c
- *   int rdx_flush(struct radix_node *rn, void *args);
- * ```
- * free user controlled resources.
- *
- * Called by walktree, rdx_flush:
- * - frees the key and, if applicable,
- * - uses the purge function to allow user controlled resources to be freed.
- * The purge function is supplied at tree creation time.
- *
- * Note: rdx_flush is called from walktree and only on _LEAF_ nodes, so the rn
- * pointer is cast to pointer to entry_t.  As a walktree_f_t, it always returns
- * the value 0 to indicate success, otherwise the walkabout would stop.
- */
+    int size = 0, cnt = 0;
+    uint8_t *cp;
 
-int
-rdx_flush(struct radix_node *rn, void *args)
-{
-    struct entry_t *entry = NULL;
-    purge_t *arg = NULL;
-    struct radix_node_head *rnh = NULL;
+    // sanity check
+    if (key == NULL) return -1;
 
-    if (rn == NULL) return 0;
-    if (args == NULL) return 0;  /* need args for head pointer */
+    size = IPT_KEYLEN((uint8_t *)key);        // nr of bytes in key
+    cp = IPT_KEYPTR((uint8_t *)key);          // pick up start of key
 
-    arg = (purge_t *)args;
-    rnh = arg->head;
+    // count bits of all-1's bytes
+    for(; --size > 0 && *cp == 0xff; cnt += 8, cp++)
+        ;
 
-    /* remove entry [rn[2], ptr] from the tree */
-    entry = (entry_t *)rnh->rnh_deladdr(rn->rn_key, rn->rn_mask, &rnh->rh);
+    if (size <= 0) return cnt;               // got them all
 
-    if (entry == NULL) return 0;
+    // count 1-bits from MSB to LSB stopping at first 0-bit
+    for (uint8_t m=0x80; m > 0 && *cp & m; m = m >> 1, cnt++)
+        ;
 
-    /* invalidate the entry before it's freed */
-    *entry->rn[0].rn_key = -1;  /* illegal KEYLEN */
-    free(entry->rn[0].rn_key);
-    /* entry->rn[0].rn_key = NULL; */
+    return cnt;
+}
 
-    if (entry->value != NULL && arg->purge != NULL)
-        arg->purge(arg->args, &entry->value);
+/*
+ * ### `kref_incr`
+ * ```c
+ *   uint8_t *kref_incr(uint8_t *key, size_t num);
+ * ```
+ * Increment `key` with `num`.  Returns key on success, NULL on failure (e.g.
+ * when wrapping around the available address space) which usually means the
+ * resulting `key` value is meaningless.
+ */
 
-    free(entry);
+uint8_t *
+kref_incr(uint8_t *key, size_t num)
+{
+  uint8_t *x = key, n, prev;
 
-    return 0;
+  if (key == NULL)
+      return NULL;
+  if (KEY_AF_FAM(key) == AF_UNSPEC)
+      return NULL;
+
+  for (x = x + *x -1; num && (x > key); x--) {
+    n = num & 0xff;
+    num >>= 8;
+    prev = *x;
+    *x += n;
+    if (*x < prev)
+        num++;
+  }
+  if (num > 0)
+      return NULL;  /* wrapped around */
+
+  return key;
 }
 
-/* ### `rdx_firstleaf`
+/*
+ * ### `kref_decr`
  * ```c
- *   struct radix_node *rdx_firstleaf(struct radix_head *rh);
+ *   uint8_t *kref_decr(uint8_t *key, size_t num);
  * ```
- * Find first non-ROOT leaf of in the prefix or mask tree
- * Return NULL if none found.
- *
- * Note: the /0 mask is never stored in the mask tree even if stored explicitly
- * using prefix/0.  Hence, the /0 mask won't be found by this function.
+ * Decrement `key` with `num`. Returns `key` on success, NULL on failure (e.g.
+ * when wrapping around the available address space) which usually means the
+ * resulting `key` value is meaningless.
  */
 
-struct radix_node *
-rdx_firstleaf(struct radix_head *rh)
+uint8_t *
+kref_decr(uint8_t *key, size_t num)
 {
-    // find first leaf in tree
-    struct radix_node *rn = NULL;
+  uint8_t *x = key, n, prev;
 
-    if (rh == NULL) return NULL;
+  if (key == NULL)
+      return NULL;
+  if (KEY_AF_FAM(key) == AF_UNSPEC)
+      return NULL;
 
-    /* goto treetop's left */
-    rn = rh->rnh_treetop->rn_left;
-    while(! RDX_ISLEAF(rn))
-        rn = rn->rn_left;
+  for (x = x + *x -1; num && (x > key); x--) {
+    n = num & 0xff;
+    num >>= 8;
+    prev = *x;
+    *x -= n;
+    if (*x > prev)
+        num++;
+  }
+  if (num > 0)
+      return NULL;  /* wrapped around */
+
+  return key;
+}
+
+/* ### `kref_network`
+ * ```c
+ *   int kref_network(void *key, void *mask);
+ * ```
+ */
+
+int
+kref_network(void *key, void *mask)
+{
+    // apply mask to key, 1 on success, 0 on failure
+    // - a mask's length may indicate the num of non-zero bytes instead of the
+    //   entire length of the mask byte array.  Such 'missing' bytes are taken
+    //   to be 0x00 (some radix tree masks seem to do this).
+    int klen, mlen;
+    uint8_t *k = key, *m = mask;
+
+    // sanity check
+    if (k == NULL || m == NULL) return 0;
+    klen = IPT_KEYLEN(k);
+    mlen = IPT_KEYLEN(m);
+    k = IPT_KEYPTR(k);      // skip LEN byte
+    m = IPT_KEYPTR(m);      // skip LEN byte
+
+    if (klen < 2) return 0;     // no key, no network address
+    if (mlen > klen) return 0;  // donot overrun key
+    for(mlen--; --klen; mlen--)
+        *(k++) &= (mlen > 0) ? *(m++) : 0x00;
+
+    return 1;
+}
+
+/* ### `kref_broadcast`
+ * ```c
+ *   int kref_broadcast(void *key, void *mask);
+ * ```
+ * set key to broadcast address, using mask
+ * - 1 on success, 0 on failure
+ * - mask LEN <= key LEN, 'missing' mask bytes are taken to be 0x00
+ *   (a radix tree artifact).
+ */
+
+int
+kref_broadcast(void *key, void *mask)
+{
+    int klen, mlen;
+    uint8_t *k = key, *m = mask;
+
+    if (k == NULL || m == NULL) return 0;
+
+    klen = IPT_KEYLEN(k);
+    mlen = IPT_KEYLEN(m);
+
+    if (klen < 2) return 0;      /* no key, no bcast address */
+    if (mlen > klen) return 0;   /* mask may be smaller, never larger */
+
+    k = IPT_KEYPTR(k);
+    m = IPT_KEYPTR(m);
+
+    for(mlen--; --klen; mlen--)
+        *(k++) |= (mlen > 0) ? ~*(m++) : 0xff;
+
+    return 1;
+}
+
+/* ### `kref_cmp`
+ * ```c
+ *   int kref_cmp(void *a, void *b);
+ * ```
+ * Returns -1 if a<b, 0 if a==b, 1 if a>b; or -2 on errors
+ */
+
+int
+kref_cmp(void *a, void *b)
+{
+    uint8_t keylen, *aa = a, *bb = b;
+
+    if (aa == NULL || bb == NULL) return -2;       // need real keys
+    keylen = IPT_KEYLEN(aa);
+    if (keylen != IPT_KEYLEN(bb)) return -2;       // different AF_families
+    if (keylen < 2) return -2;                     // need key bits to compare
+
+    for(; --keylen > 0 && *aa==*bb; aa++, bb++)
+        ;
+
+    if (*aa < *bb) return -1;
+    if (*aa > *bb) return 1;
+    return 0;
+}
+
+/* ### `kref_isin`
+ * ```c
+ *   int kref_isin(void *a, void *b, void *m);
+ * ```
+ * return 1 iff a/m includes b, 0 otherwise
+ * note:
+ * - also means b/m includes a
+ * - any radix keys/masks may have short(er) KEYLEN's than usual
+ */
+
+int
+kref_isin(void *a, void *b, void *m)
+{
+    uint8_t *aa = a, *bb = b, *mm = m;
+    int matchlen = 0;  // how many bytes to match depends on mask
+
+    // sanity checks
+    if(aa == NULL || bb == NULL) return 0;
+
+    // if((matchlen = IPT_KEYLEN(aa)) != IPT_KEYLEN(bb)) return 0;
+    matchlen = min(IPT_KEYLEN(aa), IPT_KEYLEN(bb));
+    matchlen = mm ? min(matchlen, IPT_KEYLEN(mm)) : matchlen;
+    mm = mm ? mm+1 : max_mask;
+
+    aa++; bb++;
+    for (; --matchlen > 0; aa++, bb++, mm++)
+        if ((*aa ^ *bb) & *mm) return 0;
+
+    return 1;
+}
+
+/* ## entry functions
+ *
+ * Entries come from the table's reserved blocks, while available, or from the
+ * heap otherwise.  See [`tbl_reserve`](### `tbl_reserve`).
+ */
+
+/* ### `en_new`
+ * ```c
+ *   static entry_t *en_new(table_t *t);
+ * ```
+ * Allocate a zeroed entry for table `t`, taking one off its free list if
+ * possible.
+ * - returns the entry on success, NULL on failure
+ */
+
+static entry_t *
+en_new(table_t *t)
+{
+    entry_t *e = t->efree;
+
+    if (e == NULL) return calloc(sizeof(*e), 1);
+
+    t->efree = e->value;
+    t->nfree--;
+    memset(e, 0, sizeof(*e));
+
+    return e;
+}
+
+/* ### `en_free`
+ * ```c
+ *   static void en_free(table_t *t, entry_t *e);
+ * ```
+ * Release entry `e` of table `t`, which may be NULL.  An entry from one of
+ * the table's reserved blocks goes back on its free list, others are freed.
+ */
+
+static void
+en_free(table_t *t, entry_t *e)
+{
+    eslab_t *s = t ? t->slab : NULL;
+
+    for (; s; s = s->next)
+        if (e >= s->e && e < s->e + s->size) {
+            e->value = t->efree;
+            t->efree = e;
+            t->nfree++;
+            return;
+        }
+
+    free(e);
+}
+
+/* ## radix node functions
+ */
+
+/* ### _dumprn`
+ * ```c
+ *   void _dumprn(const char *s, struct radix_node *rn);
+ * ```
+ * dump radix node characteristics to stderr
+ */
+
+void _dumprn(const char *s, struct radix_node *rn)
+{
+    char dbuf[MAX_STRKEY];
+    fprintf(stderr, "%10s rn @ %p", s, (void*)rn);
+    if(rn!=NULL) {
+        if(RDX_ISLEAF(rn)) {
+            fprintf(stderr, " %s", key_tostr(dbuf, rn->rn_key));
+            fprintf(stderr, "/%d", key_masklen(rn->rn_mask));
+            fprintf(stderr, ", keylen %d", IPT_KEYLEN(rn->rn_key));
+        }
+        fprintf(stderr, ", isroot %d", rn->rn_flags & RNF_ROOT);
+        fprintf(stderr, ", isleaf %d", RDX_ISLEAF(rn));
+        fprintf(stderr, ", isNORM %d", rn->rn_flags & RNF_NORMAL);
+        fprintf(stderr, ", flags  %d", rn->rn_flags);
+        fprintf(stderr, ", rn_bit %d", rn->rn_bit);
+    }
+    fprintf(stderr, "\n");
+}
+
+/* ### `rdx_flush`
+ * ```c
+ *   int rdx_flush(struct radix_node *rn, void *args);
+ * ```
+ * free user controlled resources.
+ *
+ * Called by walktree, rdx_flush:
+ * - releases the entry (and the key it holds) and, if applicable,
+ * - uses the purge function to allow user controlled resources to be freed.
+ * The purge function is supplied at tree creation time.  Entries go back to
+ * the free list of `tbl`, if given and they came from its reserved blocks.
+ *
+ * Note: rdx_flush is called from walktree and only on _LEAF_ nodes, so the rn
+ * pointer is cast to pointer to entry_t.  As a walktree_f_t, it always returns
+ * the value 0 to indicate success, otherwise the walkabout would stop.
+ */
+
+int
+rdx_flush(struct radix_node *rn, void *args)
+{
+    struct entry_t *entry = NULL;
+    purge_t *arg = NULL;
+    struct radix_node_head *rnh = NULL;
+
+    if (rn == NULL) return 0;
+    if (args == NULL) return 0;  /* need args for head pointer */
+
+    arg = (purge_t *)args;
+    rnh = arg->head;
+
+    /* remove entry [rn[2], ptr] from the tree */
+    entry = (entry_t *)rnh->rnh_deladdr(rn->rn_key, rn->rn_mask, &rnh->rh);
+
+    if (entry == NULL) return 0;
+
+    /* invalidate the entry before it's freed */
+    *entry->rn[0].rn_key = -1;  /* illegal KEYLEN */
+
+    if (entry->value != NULL && arg->purge != NULL)
+        arg->purge(arg->args, &entry->value);
+    mp_destroy(&entry->mpath, arg->purge, arg->args);
+
+    en_free(arg->tbl, entry);
+
+    return 0;
+}
+
+/* ### `rdx_firstleaf`
+ * ```c
+ *   struct radix_node *rdx_firstleaf(struct radix_head *rh);
+ * ```
+ * Find first non-ROOT leaf of in the prefix or mask tree
+ * Return NULL if none found.
+ *
+ * Note: the /0 mask is never stored in the mask tree even if stored explicitly
+ * using prefix/0.  Hence, the /0 mask won't be found by this function.
+ */
+
+struct radix_node *
+rdx_firstleaf(struct radix_head *rh)
+{
+    // find first leaf in tree
+    struct radix_node *rn = NULL;
+
+    if (rh == NULL) return NULL;
+
+    /* goto treetop's left */
+    rn = rh->rnh_treetop->rn_left;
+    while(! RDX_ISLEAF(rn))
+        rn = rn->rn_left;
 
     /* if 1 or more 0/msk's were inserted, return the first one */
     if(rn->rn_dupedkey)
@@ -1225,408 +1685,3679 @@ rdx_nextnode(table_t *t, int *type, void **ptr)
     return 1;
 }
 
-/* ## table functions
+/* ## hash index functions
+ *
+ * The optional exact match index of a table, see `hindex_t`.  Since the
+ * index always mirrors the radix trees, a miss in the index is a miss in the
+ * trees as well.
  */
 
-/* ### `tbl_create`
+/* ### `hx_hash`
  * ```c
- *   table_t *tbl_create(purge_f_t *fp):
+ *   static uint32_t hx_hash(uint8_t *key, int mlen);
  * ```
- * Create a new iptable with 2 radix trees.
+ * FNV-1a hash of the (af, network, masklen) of a prefix.  The key's length
+ * byte doubles as the AF family.
  */
 
-table_t *
-tbl_create(purge_f_t *fp)
+static uint32_t
+hx_hash(uint8_t *key, int mlen)
 {
-    table_t *tbl = NULL;
+    uint32_t hash = 2166136261u;
 
-    /* calloc so all ptrs & counters are set to NULL/zero */
-    tbl = calloc(sizeof(*tbl), 1);
-    if (tbl == NULL) return NULL;
+    for (int i = 0; i < IPT_KEYLEN(key); i++)
+        hash = (hash ^ key[i]) * 16777619u;
 
-    if (rn_inithead((void **)&tbl->head4, 8) == 0) {
-        free(tbl);
-        return NULL;
-    }
-    if (rn_inithead((void **)&tbl->head6, 8) == 0) {
-        rn_detachhead((void **)&tbl->head4);
-        free(tbl);
-        return NULL;
+    return (hash ^ (uint32_t)mlen) * 16777619u;
+}
+
+/* ### `hx_find`
+ * ```c
+ *   static hslot_t *hx_find(hindex_t *x, uint8_t *key, int mlen,
+ *                           uint32_t hash);
+ * ```
+ * Return the slot holding the entry for network `key`/`mlen`, or the free
+ * slot where it would go.
+ */
+
+static hslot_t *
+hx_find(hindex_t *x, uint8_t *key, int mlen, uint32_t hash)
+{
+    size_t idx = hash & (x->size - 1);
+    hslot_t *slot;
+
+    for (;; idx = (idx + 1) & (x->size - 1)) {
+        slot = x->slot + idx;
+        if (slot->entry == NULL)
+            return slot;
+        if (slot->hash == hash && slot->mlen == mlen
+            && memcmp(slot->entry->rn[0].rn_key, key, IPT_KEYLEN(key)) == 0)
+            return slot;
     }
+}
 
-    tbl->purge = fp;
+/* ### `hx_get`
+ * ```c
+ *   static entry_t *hx_get(hindex_t *x, uint8_t *key, int mlen);
+ * ```
+ * Return the entry for network `key`/`mlen`, NULL if not found.  Entries
+ * flagged for deletion are returned as well, just like `rnh_lookup` would.
+ */
 
-    return tbl;
+static entry_t *
+hx_get(hindex_t *x, uint8_t *key, int mlen)
+{
+    return hx_find(x, key, mlen, hx_hash(key, mlen))->entry;
 }
 
-/* ### `tbl_walk`
+/* ### `hx_resize`
  * ```c
- *   int tbl_walk(table_t *t, walktree_f_t *f, void *fargs);
+ *   static int hx_resize(table_t *t, size_t count);
  * ```
- * run f(args, leaf) on leafs in IPv4 tree and IPv6 tree
+ * Make sure the table's index has room for `count` entries, doubling its
+ * size as often as needed to keep it at most 3/4 full.
+ * - returns 1 on success, 0 on failure
  */
-int
-tbl_walk(table_t *t, walktree_f_t *f, void *fargs)
+
+static int
+hx_resize(table_t *t, size_t count)
 {
-    if (t == NULL) return 0;
-    t->head4->rnh_walktree(&t->head4->rh, f, fargs);
-    t->head6->rnh_walktree(&t->head6->rh, f, fargs);
+    hindex_t *x;
+    hslot_t *slot;
+    size_t size;
 
-   return 1;
+    if (t->index == NULL) return 1;
+    if (count > SIZE_MAX / 4) return 0;
+
+    for (size = t->index->size; 4 * count > 3 * size; size *= 2)
+        if (size > (SIZE_MAX - sizeof(*x)) / sizeof(hslot_t) / 2) return 0;
+    if (size == t->index->size) return 1;
+
+    if ((x = calloc(sizeof(*x) + size * sizeof(hslot_t), 1)) == NULL)
+        return 0;
+    x->size = size;
+    x->count = t->index->count;
+
+    for (size_t i = 0; i < t->index->size; i++) {
+        if (t->index->slot[i].entry == NULL) continue;
+        slot = x->slot + (t->index->slot[i].hash & (size - 1));
+        while (slot->entry)
+            slot = x->slot + ((slot - x->slot + 1) & (size - 1));
+        *slot = t->index->slot[i];
+    }
+
+    free(t->index);
+    t->index = x;
+
+    return 1;
 }
 
-/* ### `tbl_destroy`
+/* ### `hx_reserve`
  * ```c
- *   int tbl_destroy(table_t **t, void *pargs);
+ *   static int hx_reserve(table_t *t);
  * ```
- * Destroy table, free all resources owned by table and user
- * - return 1 on success, 0 on failure
+ * Make sure the table's index has room for one more entry, so a subsequent
+ * `hx_put` cannot fail.
+ * - returns 1 on success, 0 on failure
  */
 
-int
-tbl_destroy(table_t **t, void *pargs)
+static int
+hx_reserve(table_t *t)
 {
-    purge_t args;  // args to flush radix nodes & free userdata
+    return t->index == NULL || hx_resize(t, t->index->count + 1);
+}
 
-    if (t == NULL || *t == NULL) return 0;  // nothing to free
+/* ### `hx_put`
+ * ```c
+ *   static void hx_put(hindex_t *x, entry_t *e, int mlen);
+ * ```
+ * Add entry `e` with mask length `mlen` to the index, which must have room
+ * for it, see `hx_reserve`.
+ */
 
-    // pickup user purge callback & its contextual args
-    args.purge = (*t)->purge;
-    args.args = pargs;
+static void
+hx_put(hindex_t *x, entry_t *e, int mlen)
+{
+    uint8_t *key = (uint8_t *)e->rn[0].rn_key;
+    uint32_t hash = hx_hash(key, mlen);
+    hslot_t *slot = hx_find(x, key, mlen, hash);
 
-    // clear ipv4 table
-    args.head = (*t)->head4;
-    (*t)->head4->rnh_walktree(&(*t)->head4->rh, rdx_flush, &args);
+    if (slot->entry) return;  /* already indexed */
 
-    /* walktree misses out on RightEnd-marker's dupedkey, of which it can 
-     * have only 1
-     * */
-    if((*t)->head4->rnh_nodes[2].rn_dupedkey)
-        rdx_flush((*t)->head4->rnh_nodes[2].rn_dupedkey, &args);
+    slot->hash = hash;
+    slot->mlen = mlen;
+    slot->entry = e;
+    x->count++;
+}
 
-    rn_detachhead((void **)&(*t)->head4);
+/* ### `hx_del`
+ * ```c
+ *   static void hx_del(hindex_t *x, uint8_t *key, int mlen);
+ * ```
+ * Remove the entry for network `key`/`mlen` from the index, if present.
+ * Uses backward shift deletion, so no tombstones are needed in the index.
+ */
 
-    // clear ipv6 table
-    args.head = (*t)->head6;
-    (*t)->head6->rnh_walktree(&(*t)->head6->rh, rdx_flush, &args);
+static void
+hx_del(hindex_t *x, uint8_t *key, int mlen)
+{
+    hslot_t *hole = hx_find(x, key, mlen, hx_hash(key, mlen));
+    size_t i, j, home, mask = x->size - 1;
+
+    if (hole->entry == NULL) return;
+
+    i = j = (size_t)(hole - x->slot);
+    for (;;) {
+        x->slot[i].entry = NULL;
+        do {
+            j = (j + 1) & mask;
+            if (x->slot[j].entry == NULL) {
+                x->count--;
+                return;
+            }
+            home = x->slot[j].hash & mask;
+            /* slot j may move into hole i unless its home lies in (i, j] */
+        } while (i <= j ? (i < home && home <= j) : (i < home || home <= j));
+        x->slot[i] = x->slot[j];
+        i = j;
+    }
+}
 
-    /* walktree misses RightEnd-marker's dupedkey */
-    if ((*t)->head6->rnh_nodes[2].rn_dupedkey)
-        rdx_flush(((*t)->head6->rnh_nodes)[2].rn_dupedkey, &args);
-    rn_detachhead((void **)&(*t)->head6);
+/* ## journal functions
+ *
+ * ### `jr_log`
+ * ```c
+ *   static void jr_log(table_t *t, int op, uint8_t *addr, int mlen);
+ * ```
+ * Record a change of prefix `addr/mlen` in the journal of table `t`, if it
+ * has one, overwriting the oldest record when full, and notify the
+ * subscriber, if any.  Called after the change was made.
+ */
 
-    // clear the stack
-    while ((*t)->top != NULL) tbl_stackpop(*t);
+static void
+jr_log(table_t *t, int op, uint8_t *addr, int mlen)
+{
+    journal_t *j = t->journal;
+    jrec_t *r;
 
-    free(*t);
-    *t = NULL;
+    if (j == NULL) return;
 
-    return 1;
+    j->seq++;
+    r = j->rec + (j->seq & (j->size - 1));
+    r->seq = j->seq;
+    memcpy(r->key, addr, IPT_KEYLEN(addr));
+    r->mlen = (uint8_t)mlen;
+    r->op = (uint8_t)op;
+
+    if (j->notify)
+        j->notify(j->nargs, r);
 }
 
-/* ### `tbl_get`
+/* ### `jr_path`
  * ```c
- *   entry_t *tbl_get(table_t *t, const char *s);
+ *   static void jr_path(table_t *t, entry_t *e);
  * ```
- * Get an exact match for addr/mask prefix.
+ * Journal a change of the paths of entry `e` as a `JRNL_SET` of its prefix.
  */
 
-entry_t *
-tbl_get(table_t *t, const char *s)
+static void
+jr_path(table_t *t, entry_t *e)
 {
-    // An exact lookup for addr/mask, missing mask is set to AF's max mask
-    // uint8_t *addr = NULL;
-    uint8_t addr[MAX_BINKEY];
-    uint8_t mask[MAX_BINKEY];
-    int mlen = -1, af = AF_UNSPEC;
-    struct radix_node_head *head = NULL;
-    entry_t *e = NULL;
+    int mlen = key_masklen(e->rn->rn_mask);
 
-    // get head, af, addr, mask, or bail on error
-    if (t == NULL || s == NULL) return NULL;
-    if (! key_bystr(addr, &mlen, &af, s)) return NULL;
+    if (mlen < 0) mlen = MAX_MASKLEN(KEY_AF_FAM(e->key));
+    jr_log(t, JRNL_SET, e->key, mlen);
+}
 
-    if (af == AF_INET) head = t->head4;
-    else if (af == AF_INET6) head = t->head6;
-    else return NULL;
+/* ## latency functions
+ *
+ * Tables with latency histograms (see [`tbl_latency`](### `tbl_latency`))
+ * time one in every `mask + 1` operations of each kind.  A table without
+ * them pays a single test per operation and when compiled with
+ * `IPT_NOSTATS` there is nothing left to pay for.
+ *
+ * ### `lt_start`
+ * ```c
+ *   static inline uint64_t lt_start(table_t *t, int op);
+ * ```
+ * Count operation `op` on table `t` and decide whether to time it.
+ * - returns the current time in nanoseconds if so, 0 otherwise
+ */
 
-    if (! key_bylen(mask, mlen, af)) return NULL;
-    if (! key_network(addr, mask)) return NULL;
+#ifndef IPT_NOSTATS
 
-    e = (entry_t *)head->rnh_lookup(addr, mask, &head->rh); // exact match
+static inline uint64_t
+lt_start(table_t *t, int op)
+{
+    struct timespec ts;
 
-    /* itr_gc, node deleted but not yet gc'd */
-    if (e && (e->rn->rn_flags & IPTF_DELETE))
-        return NULL;
+    if (t == NULL || t->lat == NULL) return 0;
+    if (t->lat->ops[op]++ & t->lat->mask) return 0;
 
-    return e;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec + 1;
 }
 
-/* ### `tbl_set`
+/* ### `lt_bucket`
  * ```c
- *   int tbl_set(table_t *t, const char *s, void *v, void *pargs);
+ *   static inline int lt_bucket(uint64_t ns);
  * ```
+ * - returns the histogram bucket for a sample of `ns` nanoseconds
  */
 
-int
-tbl_set(table_t *t, const char *s, void *v, void *pargs)
+static inline int
+lt_bucket(uint64_t ns)
 {
-    // A missing mask is taken to mean AF's max mask
-    // - applies mask before searching/setting the tree
-    /* uint8_t *addr = NULL; */
+    int b;
 
-    uint8_t addr[MAX_BINKEY], mask[MAX_BINKEY], *treekey = NULL;
-    int mlen = -1, af = AF_UNSPEC;
-    entry_t *e = NULL;
-    struct radix_node *rn = NULL;
-    struct radix_node_head *head = NULL;
+    if (ns < 4) return (int)ns;
+    b = 64 - __builtin_clzll(ns);             // significant bits, >= 3
+    return 4 * (b - 2) + (int)((ns >> (b - 3)) & 3);
+}
 
-    // get head, af, addr, mask, or bail on error
-    if (t == NULL || s == NULL) return 0;
-    if (! key_bystr(addr, &mlen, &af, s)) return 0;
-    if (! key_bylen(mask, mlen, af)) return 0;
-    if (! key_network(addr, mask)) return 0;
+/* ### `lt_stop`
+ * ```c
+ *   static inline void lt_stop(table_t *t, int op, uint64_t t0);
+ * ```
+ * Add the time passed since `t0`, as returned by `lt_start`, to the
+ * histogram of operation `op`.  Does nothing if `t0` is 0.
+ */
 
-    if (af == AF_INET) head = t->head4;
-    else if (af == AF_INET6) head = t->head6;
-    else return 0;
+static inline void
+lt_stop(table_t *t, int op, uint64_t t0)
+{
+    struct timespec ts;
+    uint64_t ns;
 
-    e = (entry_t *)head->rnh_lookup(addr, mask, &head->rh); // exact match
-    if (e) {
-        /* purge called to free userdata */
-        if(e->value && t->purge)
-            t->purge(pargs, &e->value);
-        e->value = v;
+    if (t0 == 0 || t->lat == NULL) return;
 
-        /* no need to update stats if e was not flagged as deleted */
-        if((e->rn->rn_flags & IPTF_DELETE) == 0)
-            return 1;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ns = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec + 1 - t0;
+    t->lat->samples[op]++;
+    t->lat->sum[op] += ns;
+    if (ns > t->lat->max[op]) t->lat->max[op] = ns;
+    t->lat->hist[op][lt_bucket(ns)]++;
+}
 
-        e->rn->rn_flags &= ~IPTF_DELETE;  // clear delete flag
+#else
 
-    } else {
-        // add new entry, need to donate a new key for the tree to keep
-        if (!(e = calloc(sizeof(* e),1))) return 0;
-        e->value = v;
-        treekey = key_copy(addr);
+#define lt_start(t, op) ((void)(t), (uint64_t)0)
+#define lt_stop(t, op, t0) ((void)(t0))
 
-        rn = head->rnh_addaddr(treekey, mask, &head->rh, e->rn);
-        if (!rn) {
-            if (t->purge)
-                t->purge(pargs, &e->value);
-            free(e);
-            free(treekey); // t'was not stored
-            return 0;
-        }
+#endif
 
-    }
+/* ## trace functions
+ *
+ * A table with a recorder (see [`tbl_record`](### `tbl_record`)) appends
+ * each operation to its trace file, before carrying it out.  Keys can be
+ * anonymized in a prefix-preserving manner, so a replay of the trace builds
+ * a tree of the same shape and lookups find the same (anonymized) matches.
+ *
+ * ### `tr_mix`
+ * ```c
+ *   static inline uint64_t tr_mix(uint64_t x);
+ * ```
+ * - returns `x` with its bits mixed (splitmix64's finalizer)
+ */
 
-    if (af == AF_INET) t->count4++;
-    else t->count6++;
+static inline uint64_t
+tr_mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
 
-    return 1;
+    return x;
 }
 
-/* ### `tbl_del`
+/* ### `tr_anon`
  * ```c
- *   int tbl_del(table_t *t, const char *s, void *pargs);
+ *   static void tr_anon(uint8_t *key, uint64_t secret);
  * ```
+ * Anonymize binary `key` in place: each bit is flipped, or not, depending
+ * on `secret` and the original bits preceding it.  So keys sharing their
+ * first `n` bits still do after anonymization and nothing more can be
+ * inferred without the secret.
  */
 
-int
-tbl_del(table_t *t, const char *s, void *pargs)
+static void
+tr_anon(uint8_t *key, uint64_t secret)
 {
-    // Deletion requires exact match on prefix
-    // - a missing mask is set to AF's max mask
-    entry_t *e;
-    struct radix_node_head *head = NULL;
-    uint8_t addr[MAX_BINKEY], mask[MAX_BINKEY];
-    int mlen = -1, af = AF_UNSPEC;
-
-    // get head, af, addr, mask, or bail on error
-    if (t == NULL || s == NULL) return 0;
-    if (! key_bystr(addr, &mlen, &af, s)) return 0;
-    if (! key_bylen(mask, mlen, af)) return 0;
-    if (! key_network(addr, mask)) return 0;
-
-    if (af == AF_INET) head = t->head4;
-    else if (af == AF_INET6) head = t->head6;
-    else return 0;
+    uint64_t w[2], pfx[2] = {0, 0}, bit, orig;
+    int n = IPT_KEYLEN(key) - 1;
+
+    kw_load(w, IPT_KEYPTR(key), n);
+    for (int i = 0; i < 8 * n; i++) {
+        bit = (uint64_t)1 << (63 - i % 64);
+        orig = w[i / 64] & bit;
+        if (tr_mix(secret ^ tr_mix(pfx[0] ^ tr_mix(pfx[1] ^ (uint64_t)i))) & 1)
+            w[i / 64] ^= bit;
+        pfx[i / 64] |= orig;                  // the original bits so far
+    }
+    kw_store(IPT_KEYPTR(key), w, n);
+}
 
-    if (t->itr_lock) {
-        /* active iterator(s), so flag node (if any & needed) for DELETION */
-        e = (entry_t *)head->rnh_lookup(addr, mask, &head->rh);
-        if (!e || (e->rn->rn_flags & IPTF_DELETE)) return 0;
-        e->rn->rn_flags |= IPTF_DELETE;
-        /* fprintf(stderr, "flagged %s", s); */
+/* ### `tr_log`
+ * ```c
+ *   static int tr_log(table_t *t, int op, const uint8_t *key, int mlen);
+ * ```
+ * Append a record for operation `op` on `key` with mask length `mlen` (-1
+ * for none) to the trace of table `t`, which must have one.  The iterator
+ * operations take no key.  A failed write stops the recording.
+ * - returns 1 on success, 0 on failure
+ */
 
-    } else {
-        e = (entry_t *)head->rnh_deladdr(addr, mask, &head->rh);
-        if (!e) return 0;
-        free(e->rn[0].rn_key);                      // free the key
-        if(e->value != NULL && t->purge != NULL)
-            t->purge(pargs, &e->value);             // free the user data
-        free(e);                                    // free the entry
+static int
+tr_log(table_t *t, int op, const uint8_t *key, int mlen)
+{
+    trace_t *tr = t->trace;
+    uint8_t buf[2 + MAX_BINKEY];
+    size_t n = 0;
+
+    if (tr->err) return 0;
+
+    buf[n++] = (uint8_t)op;
+    switch (op) {
+    case TRC_SET:
+    case TRC_DEL:
+    case TRC_GET:
+    case TRC_ADDPATH:
+    case TRC_DELPATH:
+        buf[n++] = mlen < 0 || mlen > 255 ? 255 : (uint8_t)mlen;
+        /* fall through */
+    case TRC_LPM:
+        if (key == NULL) return 0;
+        if (IPT_KEYLEN(key) != IP4_KEYLEN && IPT_KEYLEN(key) != IP6_KEYLEN)
+            return 0;
+        memcpy(buf + n, key, IPT_KEYLEN(key));
+        if (tr->anon) tr_anon(buf + n, tr->anon);
+        n += IPT_KEYLEN(key);
+        break;
+    case TRC_ITR:
+    case TRC_NEXT:
+    case TRC_END:
+        break;
+    default:
+        return 0;
     }
 
-    /* if we get here, a non-deleted node was found, so decrement counter */
-    if (af == AF_INET) t->count4--;
-    else t->count6--;
+    if (fwrite(buf, 1, n, tr->fp) != n) {
+        tr->err = 1;
+        return 0;
+    }
+    tr->count++;
 
     return 1;
 }
 
-/* ### `tbl_lpm`
+/* ### `tr_key`
  * ```c
- *   entry_t *tbl_lpm(table_t *t, const char *s);
+ *   static inline void tr_key(table_t *t, int op, const uint8_t *key,
+ *                             int mlen);
  * ```
+ * Record operation `op` on binary `key` if table `t` is being recorded.
  */
 
-entry_t *
-tbl_lpm(table_t *t, const char *s)
+static inline void
+tr_key(table_t *t, int op, const uint8_t *key, int mlen)
+{
+    if (t && t->trace) tr_log(t, op, key, mlen);
+}
+
+/* ### `tr_str`
+ * ```c
+ *   static inline void tr_str(table_t *t, int op, const char *s);
+ * ```
+ * Record operation `op` on prefix string `s` if table `t` is being
+ * recorded.  Strings that are not a prefix are not recorded.
+ */
+
+static inline void
+tr_str(table_t *t, int op, const char *s)
 {
-    // longest prefix match for address (a /mask is ignored)
-    struct radix_node_head *head = NULL;
     uint8_t addr[MAX_BINKEY];
     int mlen = -1, af = AF_UNSPEC;
-    struct radix_node *rn;
-    entry_t *e = NULL; /* defaults to no match found */
-
-    if (t == NULL || s == NULL) return NULL;
-    if (! key_bystr(addr, &mlen, &af, s)) return NULL;
 
-    if (af == AF_INET) head = t->head4;
-    else if (af == AF_INET6) head = t->head6;
-    else return NULL;
+    if (t == NULL || t->trace == NULL || s == NULL) return;
+    if (key_bystr(addr, &mlen, &af, s))
+        tr_log(t, op, addr, mlen);
+}
 
-    /* rn will be the longest prefix match (if any) */
-    rn = head->rnh_matchaddr(addr, &head->rh);
+/* ## persistent tree functions
+ *
+ * A table may keep a persistent copy of its prefixes in a path compressed
+ * binary trie per AF family, see [`tbl_persist`](### `tbl_persist`).  Nodes
+ * are reference counted and only modified in place while exclusively owned,
+ * so taking a snapshot is a matter of grabbing a reference to both roots.
+ *
+ * A change is done in two steps: `pt_prep` allocates everything it might
+ * need up front, before the radix tree is modified, after which `pt_apply`
+ * cannot fail.  So the persistent trees always mirror the radix trees.
+ */
 
-    /* cannot return rn if it was flagged for deletion */
-    while(rn && (rn->rn_flags & IPTF_DELETE))
-        rn = tbl_lsm(rn);
+typedef struct ptprep_t {
+    int n;                          // spare nodes available
+    ptval_t *val;                   // value to set, NULL for a delete
+    ptnode_t *spare[PT_MAXPATH];    // preallocated nodes
+} ptprep_t;
 
-    e = rn ? (entry_t *)rn : NULL;
+/* ### `pt_bit`
+ * ```c
+ *   static int pt_bit(const uint8_t *key, int i);
+ * ```
+ * - returns bit `i` of `key`, counting from 0 at the most significant bit
+ */
 
-    return e;
+static inline int
+pt_bit(const uint8_t *key, int i)
+{
+    return (key[1 + i / 8] >> (7 - i % 8)) & 1;
 }
 
-/* ### `tbl_lsm`
+/* ### `pt_common`
  * ```c
- *   struct radix_node *tbl_lsm(struct radix_node *rn);
+ *   static int pt_common(const uint8_t *a, const uint8_t *b, int max);
  * ```
- * Given a leaf, find a less specific leaf or fail
- * - used by tbl_lpm in case the match is flagged for deletion
+ * - returns the number of leading bits `a` and `b` share, at most `max`
  */
 
-struct radix_node *
-tbl_lsm(struct radix_node *rn)
+static int
+pt_common(const uint8_t *a, const uint8_t *b, int max)
 {
-    /* less specific match for rn'n address and masklength */
-    struct radix_node *org_rn;
-    int rn_bit = rn->rn_bit;
+    int bits = 0;
+    uint8_t x;
 
-    if (rn == NULL) return NULL;
-    /* candidates are checked against rn's key, so it MUST be a leaf */
-    if (!RDX_ISLEAF(rn)) return NULL;
+    for (int i = 1; bits < max; i++, bits += 8)
+        if ((x = a[i] ^ b[i])) {
+            bits += __builtin_clz((unsigned int)x) - 24;
+            break;
+        }
 
-    /* search less specific entries in dupedkey chain, if any */
-    for(org_rn = rn; rn; rn = rn->rn_dupedkey)
-        if ((rn->rn_flags & RNF_NORMAL)
-            && rn_bit < rn->rn_bit)
-            return rn;
+    return bits < max ? bits : max;
+}
 
-    /* go to parent of dupedchain */
-    for (rn = org_rn; RDX_ISLEAF(rn);)
-        rn = rn->rn_parent;
+/* ### `pt_valunref`
+ * ```c
+ *   static void pt_valunref(ptval_t *v, purge_f_t *purge, void *pargs);
+ * ```
+ * Drop a reference to value `v`, which is freed (and its user data purged,
+ * if `purge` is not NULL) when it was the last one.
+ */
 
-    /* go up the tree */
-    do {
+static void
+pt_valunref(ptval_t *v, purge_f_t *purge, void *pargs)
+{
+    if (v == NULL || --v->refs > 0) return;
+    if (purge && v->value) purge(pargs, &v->value);
+    free(v);
+}
 
-        struct radix_mask *m;
-        rn = rn->rn_parent;
-        m = rn->rn_mklist;
-        struct radix_node *x = rn;
-        while (m) {
-            if (m->rm_flags & RNF_NORMAL) {
-                if (rn_bit <= m->rm_bit && !(m->rm_leaf->rn_flags & IPTF_DELETE))
-                    return (m->rm_leaf);
-            } else {
-                // off = min(rn->rn_offset, matched_off);
-                // x = rn_search_m(v, rn, m->rm_mask);
-                /* search w/ mask */
-                for(; x->rn_bit >= 0;) {
-                    if((x->rn_bmask & m->rm_mask[x->rn_offset]) &&
-                       (x->rn_bmask & org_rn->rn_key[x->rn_offset]))
-                        x = x->rn_right;
-                    else
-                        x = x->rn_left;
-                }
-                while (x && x->rn_mask != m->rm_mask)
-                    x = x->rn_dupedkey;
-                //if (x && rn_satisfies_leaf(v, x, off))
-                //    return (x);
-                if (x && key_isin(org_rn->rn_key, x->rn_key, x->rn_mask))
-                    return x;
+/* ### `pt_unref`
+ * ```c
+ *   static void pt_unref(ptnode_t *n, purge_f_t *purge, void *pargs);
+ * ```
+ * Drop a reference to node `n`.  When it was the last one, the node is freed
+ * and its value and subtrees are released in turn.
+ */
+
+static void
+pt_unref(ptnode_t *n, purge_f_t *purge, void *pargs)
+{
+    if (n == NULL || --n->refs > 0) return;
+    pt_valunref(n->val, purge, pargs);
+    pt_unref(n->child[0], purge, pargs);
+    pt_unref(n->child[1], purge, pargs);
+    free(n);
+}
+
+/* ### `pt_node`
+ * ```c
+ *   static ptnode_t *pt_node(ptprep_t *p, uint8_t *key, int mlen,
+ *                            ptval_t *val);
+ * ```
+ * Take a spare node and set it up for prefix `key/mlen` with value `val`
+ * (which may be NULL) and no subtrees.
+ * - returns the node, owned by the caller
+ */
+
+static ptnode_t *
+pt_node(ptprep_t *p, uint8_t *key, int mlen, ptval_t *val)
+{
+    ptnode_t *n = p->spare[--p->n];
+    int len = IPT_KEYLEN(key);
+
+    n->refs = 1;
+    n->val = val;
+    n->child[0] = n->child[1] = NULL;
+    n->mlen = (uint8_t)mlen;
+    n->key[0] = (uint8_t)len;
+    for (int i = 1; i < len; i++, mlen -= 8)
+        n->key[i] = mlen >= 8 ? key[i]
+                  : mlen > 0 ? key[i] & (uint8_t)(0xff << (8 - mlen)) : 0;
+
+    return n;
+}
+
+/* ### `pt_own`
+ * ```c
+ *   static ptnode_t *pt_own(ptprep_t *p, ptnode_t *n);
+ * ```
+ * Turn the caller's reference to `n` into an exclusively owned node, which
+ * is `n` itself if nobody else refers to it, or a copy of `n` otherwise.
+ * A copy shares the value and subtrees of `n`.
+ * - returns the node, owned by the caller
+ */
+
+static ptnode_t *
+pt_own(ptprep_t *p, ptnode_t *n)
+{
+    ptnode_t *c;
+
+    if (n->refs == 1) return n;
+
+    c = p->spare[--p->n];
+    *c = *n;
+    c->refs = 1;
+    if (c->val) c->val->refs++;
+    if (c->child[0]) c->child[0]->refs++;
+    if (c->child[1]) c->child[1]->refs++;
+    n->refs--;
+
+    return c;
+}
+
+/* ### `pt_need`
+ * ```c
+ *   static int pt_need(ptnode_t *n, uint8_t *key, int mlen);
+ * ```
+ * Count the nodes a change of prefix `key/mlen` in the tree rooted at `n`
+ * needs: a copy of each node on its path that is shared, directly or by way
+ * of a shared ancestor, plus 2 should the prefix not be there yet.
+ * - returns the number of nodes needed
+ */
+
+static int
+pt_need(ptnode_t *n, uint8_t *key, int mlen)
+{
+    int shared = 0, need = 0;
+
+    for (; n; n = n->child[pt_bit(key, n->mlen)]) {
+        if (n->mlen > mlen || pt_common(n->key, key, n->mlen) < n->mlen)
+            break;
+        if (n->refs > 1) shared = 1;
+        need += shared;
+        if (n->mlen == mlen) return need;
+    }
+
+    return need + 2;
+}
+
+/* ### `pt_prep`
+ * ```c
+ *   static int pt_prep(table_t *t, ptprep_t *p, uint8_t *addr, int mlen,
+ *                      void *v, int set, void *pargs);
+ * ```
+ * Prepare a change of prefix `addr/mlen` in the persistent tree of table `t`,
+ * if it has one, by allocating the nodes needed and, if `set` is non-zero,
+ * the (copy of) value `v`.
+ * - returns 1 on success, 0 on failure (nothing is allocated)
+ */
+
+static int
+pt_prep(table_t *t, ptprep_t *p, uint8_t *addr, int mlen, void *v, int set,
+        void *pargs)
+{
+    persist_t *ps = t->persist;
+    int need;
+
+    p->n = 0;
+    p->val = NULL;
+    if (ps == NULL) return 1;
+
+    if (set) {
+        if ((p->val = malloc(sizeof(ptval_t))) == NULL) return 0;
+        p->val->refs = 1;
+        p->val->value = ps->dup && v ? ps->dup(pargs, v) : v;
+        if (p->val->value == NULL && v) {
+            free(p->val);
+            return 0;
+        }
+    }
+
+    need = pt_need(ps->root[KEY_IS_IP6(addr)], addr, mlen);
+    for (; p->n < need; p->n++)
+        if ((p->spare[p->n] = malloc(sizeof(ptnode_t))) == NULL) {
+            while (p->n > 0) free(p->spare[--p->n]);
+            pt_valunref(p->val, ps->purge, pargs);
+            return 0;
+        }
+
+    return 1;
+}
+
+/* ### `pt_done`
+ * ```c
+ *   static void pt_done(table_t *t, ptprep_t *p, void *pargs);
+ * ```
+ * Release whatever a prepared change did not use: the spare nodes and, for
+ * a change that was abandoned, the value.
+ */
+
+static void
+pt_done(table_t *t, ptprep_t *p, void *pargs)
+{
+    while (p->n > 0) free(p->spare[--p->n]);
+    if (p->val && t->persist) pt_valunref(p->val, t->persist->purge, pargs);
+    p->val = NULL;
+}
+
+/* ### `pt_set`
+ * ```c
+ *   static void pt_set(ptnode_t **link, uint8_t *key, int mlen, ptprep_t *p,
+ *                      purge_f_t *purge, void *pargs);
+ * ```
+ * Set prefix `key/mlen` to the prepared value in the tree referred to by
+ * `*link`, copying the shared nodes on its path.  A value replaced is
+ * released.
+ */
+
+static void
+pt_set(ptnode_t **link, uint8_t *key, int mlen, ptprep_t *p,
+       purge_f_t *purge, void *pargs)
+{
+    ptnode_t *n, *leaf, *g;
+    int bits = 0;
+
+    for (n = *link; n; n = *link) {
+        bits = pt_common(n->key, key, min(n->mlen, mlen));
+        if (bits < n->mlen) break;           // n is off the path
+        n = *link = pt_own(p, n);
+        if (n->mlen == mlen) {               // already there, replace value
+            pt_valunref(n->val, purge, pargs);
+            n->val = p->val;
+            p->val = NULL;
+            return;
+        }
+        link = &n->child[pt_bit(key, n->mlen)];
+    }
+
+    leaf = pt_node(p, key, mlen, p->val);
+    p->val = NULL;
+
+    if (n == NULL)
+        *link = leaf;
+    else if (bits == mlen) {
+        /* new prefix covers n */
+        leaf->child[pt_bit(n->key, mlen)] = n;
+        *link = leaf;
+    } else {
+        /* new prefix and n part ways at bit `bits` */
+        g = pt_node(p, key, bits, NULL);
+        g->child[pt_bit(key, bits)] = leaf;
+        g->child[pt_bit(n->key, bits)] = n;
+        *link = g;
+    }
+}
+
+/* ### `pt_del`
+ * ```c
+ *   static void pt_del(ptnode_t **link, uint8_t *key, int mlen, ptprep_t *p,
+ *                      purge_f_t *purge, void *pargs);
+ * ```
+ * Delete prefix `key/mlen` from the tree referred to by `*link`, copying the
+ * shared nodes on its path.  Branching nodes left with a single subtree are
+ * removed as well.
+ */
+
+static void
+pt_del(ptnode_t **link, uint8_t *key, int mlen, ptprep_t *p,
+       purge_f_t *purge, void *pargs)
+{
+    ptnode_t **path[PT_MAXPATH], *n;
+    int depth = 0;
+
+    for (n = *link; n; n = *link) {
+        if (n->mlen > mlen || pt_common(n->key, key, n->mlen) < n->mlen)
+            return;                          // not there
+        n = *link = pt_own(p, n);
+        if (n->mlen == mlen) break;
+        path[depth++] = link;
+        link = &n->child[pt_bit(key, n->mlen)];
+    }
+    if (n == NULL || n->val == NULL) return;
+
+    pt_valunref(n->val, purge, pargs);
+    n->val = NULL;
+
+    /* nodes on the path are owned, so they can be freed */
+    for (;;) {
+        n = *link;
+        if (n->val || (n->child[0] && n->child[1])) break;
+        *link = n->child[0] ? n->child[0] : n->child[1];
+        free(n);
+        if (depth == 0) break;
+        link = path[--depth];
+    }
+}
+
+/* ### `pt_apply`
+ * ```c
+ *   static void pt_apply(table_t *t, ptprep_t *p, uint8_t *addr, int mlen,
+ *                        void *pargs);
+ * ```
+ * Carry out a change prepared by `pt_prep` on the persistent tree of table
+ * `t`: a set if a value was prepared, a delete otherwise.
+ */
+
+static void
+pt_apply(table_t *t, ptprep_t *p, uint8_t *addr, int mlen, void *pargs)
+{
+    persist_t *ps = t->persist;
+    ptnode_t **root;
+
+    if (ps == NULL) return;
+
+    root = &ps->root[KEY_IS_IP6(addr)];
+    if (p->val)
+        pt_set(root, addr, mlen, p, ps->purge, pargs);
+    else
+        pt_del(root, addr, mlen, p, ps->purge, pargs);
+
+    pt_done(t, p, pargs);
+}
+
+/* ## table functions
+ */
+
+/* ### `tbl_create`
+ * ```c
+ *   table_t *tbl_create(purge_f_t *fp):
+ * ```
+ * Create a new iptable with 2 radix trees.  The ipv4 tree uses the 32-bit
+ * specialised longest prefix match, see [`tbl_match4`](### `tbl_match4`).
+ */
+
+table_t *
+tbl_create(purge_f_t *fp)
+{
+    table_t *tbl = NULL;
+
+    /* calloc so all ptrs & counters are set to NULL/zero */
+    tbl = calloc(sizeof(*tbl), 1);
+    if (tbl == NULL) return NULL;
+
+    if (rn_inithead((void **)&tbl->head4, 8) == 0) {
+        free(tbl);
+        return NULL;
+    }
+    if (rn_inithead((void **)&tbl->head6, 8) == 0) {
+        rn_detachhead((void **)&tbl->head4);
+        free(tbl);
+        return NULL;
+    }
+
+    tbl->purge = fp;
+    tbl->head4->rnh_matchaddr = rn_match4;  // see tbl_match4
+
+    return tbl;
+}
+
+/* ### `tbl_reserve`
+ * ```c
+ *   int tbl_reserve(table_t *t, size_t n);
+ * ```
+ * A capacity hint: make room for `n` more prefixes in table `t`, so that
+ * adding them takes no further allocations (other than those of the radix
+ * trees' mask tree, which holds at most one entry per mask length).  This
+ * reserves a block of entries, unless enough are left over from earlier
+ * reservations, and grows the index, if any, to fit.  Entries taken from a
+ * block go back to the table's free list when deleted, the blocks are freed
+ * along with the table.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_reserve(table_t *t, size_t n)
+{
+    eslab_t *s;
+
+    if (t == NULL) return 0;
+    if (! hx_resize(t, (t->index ? t->index->count : 0) + n)) return 0;
+    if (n <= t->nfree) return 1;
+
+    n -= t->nfree;
+    if (n > (SIZE_MAX - sizeof(*s)) / sizeof(entry_t)) return 0;
+    if ((s = malloc(sizeof(*s) + n * sizeof(entry_t))) == NULL) return 0;
+    s->size = n;
+    s->next = t->slab;
+    t->slab = s;
+
+    while (n-- > 0) {
+        s->e[n].value = t->efree;
+        t->efree = s->e + n;
+    }
+    t->nfree += s->size;
+
+    return 1;
+}
+
+/* ### `tbl_clone`
+ * ```c
+ *   table_t *tbl_clone(table_t *t, dup_f_t *dup, void *dargs);
+ * ```
+ * Create a copy of table `t` by rebuilding both radix trees from the ordered
+ * sequence of leafs in `t`.  The binary keys and masks already stored in the
+ * trees are copied as-is, so no prefix strings are parsed along the way.
+ *
+ * If `dup` is not NULL, it is called as `dup(dargs, value)` to obtain the
+ * value for each copied entry, otherwise the value pointer is shared by both
+ * tables.  Leafs flagged for deletion are not copied.  The clone uses the
+ * same purge function as `t` and `dargs` doubles as its contextual argument
+ * should the clone need to be destroyed halfway.
+ * - returns the new table on success, NULL on failure
+ */
+
+table_t *
+tbl_clone(table_t *t, dup_f_t *dup, void *dargs)
+{
+    table_t *c = NULL;
+    struct radix_node_head *src[2], *dst[2];
+    struct radix_node *rn;
+    size_t *count[2];
+    entry_t *e;
+
+    if (t == NULL) return NULL;
+    if ((c = tbl_create(t->purge)) == NULL) return NULL;
+    if (! tbl_reserve(c, t->count4 + t->count6)) goto fail;
+    if (t->cache && ! tbl_cache(c, t->cache->size)) goto fail;
+    c->head4->rnh_matchaddr = t->head4->rnh_matchaddr;
+
+    src[0] = t->head4, dst[0] = c->head4, count[0] = &c->count4;
+    src[1] = t->head6, dst[1] = c->head6, count[1] = &c->count6;
+
+    for (int i = 0; i < 2; i++) {
+        for (rn = rdx_firstleaf(&src[i]->rh); rn; rn = rdx_nextleaf(rn)) {
+            if (rn->rn_flags & IPTF_DELETE) continue;
+
+            if ((e = en_new(c)) == NULL) goto fail;
+            e->value = ((entry_t *)rn)->value;
+            if (dup && e->value && !(e->value = dup(dargs, e->value))) {
+                en_free(c, e);
+                goto fail;
             }
-            m = m->rm_mklist;
+            if (! mp_copy(&e->mpath, ((entry_t *)rn)->mpath, dup, dargs,
+                          c->purge)) {
+                if (dup && e->value && c->purge)
+                    c->purge(dargs, &e->value);
+                en_free(c, e);
+                goto fail;
+            }
+
+            /* the mask is re-interned in the clone's own mask tree */
+            memcpy(e->key, rn->rn_key, IPT_KEYLEN(rn->rn_key));
+            if (!dst[i]->rnh_addaddr(e->key, rn->rn_mask, &dst[i]->rh,
+                                     e->rn)) {
+                if (dup && e->value && c->purge)
+                    c->purge(dargs, &e->value);
+                mp_destroy(&e->mpath, dup ? c->purge : NULL, dargs);
+                en_free(c, e);
+                goto fail;
+            }
+            *count[i] += 1;
         }
+    }
+
+    if (t->index && ! tbl_hindex(c, 1)) goto fail;
 
-    } while (rn && (rn != rn->rn_parent) && !(rn->rn_flags & RNF_ROOT)); /* treetop */
+    return c;
 
+fail:
+    tbl_destroy(&c, dargs);
     return NULL;
 }
 
-/* ### `tbl_stackpush`
+/* ### `tbl_bytes`
  * ```c
- *   int tbl_stackpush(table_t *t, int type, void *elm);
+ *   static size_t tbl_bytes(table_t *t);
  * ```
+ * Estimate the memory held by table `t` for its entries, which include the
+ * leafs and keys, and for its masks.  A mask node is allocated by `radix.c`
+ * with room for the largest key and is only released with its tree.
+ * - returns the number of bytes
  */
 
-int
-tbl_stackpush(table_t *t, int type, void *elm)
+static size_t
+tbl_bytes(table_t *t)
 {
-    // insert element into stack
-    stackElm_t *node = NULL;
+    struct radix_node_head *heads[2] = {t->head4, t->head6};
+    struct radix_node *rn;
+    size_t n = t->count4 + t->count6 + t->nfree, bytes = 0;
 
-    if (t == NULL) return 0;     /* no table, no stack */
-    if (elm == NULL) return 0;   /* ignore NULL elements */
+    for (eslab_t *s = t->slab; s; s = s->next) {
+        bytes += sizeof(*s) + s->size * sizeof(entry_t);
+        n -= s->size;
+    }
+    bytes += n * sizeof(entry_t);              // entries on the heap
 
-    node = calloc(1, sizeof(stackElm_t));
+    for (int i = 0; i < 2; i++)
+        for (rn = rdx_firstleaf(&heads[i]->rh.rnh_masks->head); rn;
+             rn = rdx_nextleaf(rn))
+            bytes += 32 + 2 * sizeof(*rn);     // see rn_addmask
 
-    if (! node) return 0;
+    return bytes;
+}
 
-    node->type = type;
-    node->elm = elm;
-    node->next = t->top;
-    t->top = node;
-    t->size += 1;
+/* ### `sh_walk`
+ * ```c
+ *   static void sh_walk(struct radix_node *rn, size_t depth, shape_t *s);
+ * ```
+ * Add the subtree at `rn`, at `depth` internal nodes below the top of its
+ * tree, to shape `s`.  The recursion is bounded by the number of bits in a
+ * key, since every internal node below tests a later bit.
+ */
+
+static void
+sh_walk(struct radix_node *rn, size_t depth, shape_t *s)
+{
+    struct radix_mask *m;
+    entry_t *e;
+    size_t n = 0;
+
+    if (! RDX_ISLEAF(rn)) {
+        s->internal++;
+        for (m = rn->rn_mklist; m; m = m->rm_mklist)
+            n++;
+        s->rmasks += n;
+        s->mklist[min(n, SHP_MAXLEN - 1)]++;
+        if (n > s->maxmklist) s->maxmklist = n;
+        sh_walk(rn->rn_left, depth + 1, s);
+        sh_walk(rn->rn_right, depth + 1, s);
+        return;
+    }
+
+    /* the end markers are not entries, but may head a chain */
+    for (; rn; rn = rn->rn_dupedkey) {
+        if (RDX_ISROOT(rn)) continue;
+        e = (entry_t *)rn;
+        n++;
+        s->entries++;
+        if (rn->rn_flags & IPTF_DELETE) s->tombstones++;
+        s->depth[min(depth, SHP_MAXLEN - 1)]++;
+        s->sumdepth += depth;
+        if (e->mpath)
+            s->mem_paths += sizeof(mpath_t) + e->mpath->size * sizeof(path_t);
+    }
+    if (n == 0) return;
+    s->chains++;
+    s->chain[min(n, SHP_MAXLEN - 1)]++;
+    if (n > s->maxchain) s->maxchain = n;
+    if (depth > s->maxdepth) s->maxdepth = depth;
+}
+
+/* ### `tbl_shape`
+ * ```c
+ *   int tbl_shape(table_t *t, int af, shape_t *s);
+ * ```
+ * Describe the shape of the radix tree of table `t` for `af` (`AF_INET` or
+ * `AF_INET6`) in `s`: its node counts, the histograms of entry depth, chain
+ * and mask list lengths and the memory held by each of its components, see
+ * [`shape_t`](### `shape_t`).  Takes a single pass over the tree and one
+ * over its mask tree, so it is cheap enough to run as a health check, but
+ * the table must not be modified meanwhile.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_shape(table_t *t, int af, shape_t *s)
+{
+    struct radix_node_head *head;
+    struct radix_node *rn;
+
+    if (t == NULL || s == NULL) return 0;
+    if (af == AF_INET) head = t->head4;
+    else if (af == AF_INET6) head = t->head6;
+    else return 0;
+
+    memset(s, 0, sizeof(*s));
+    sh_walk(head->rh.rnh_treetop, 0, s);
+    for (rn = rdx_firstleaf(&head->rh.rnh_masks->head); rn;
+         rn = rdx_nextleaf(rn))
+        s->masks++;
+
+    s->mem_entries = s->entries * sizeof(entry_t);
+    s->mem_rmasks = s->rmasks * sizeof(struct radix_mask);
+    s->mem_masks = s->masks * (32 + 2 * sizeof(*rn));  // see rn_addmask
+    s->mem_heads = sizeof(*head) + sizeof(struct radix_mask_head);
 
     return 1;
 }
 
-/* ### `tbl_stackpop`
+/* ### `tbl_compact`
  * ```c
- *   int tbl_stackpop(table_t *t);
+ *   int tbl_compact(table_t *t, size_t *bytes, void *pargs);
  * ```
+ * Rebuild both radix trees of table `t` into freshly allocated storage.  All
+ * entries (and thus their leafs and keys) are laid out in key order in a
+ * single block, while the new mask trees only hold the masks still in use.
+ * Values and multipaths are moved, not copied, and the index, if any, is
+ * rebuilt.  Entries flagged for deletion are purged first, using `pargs`.
+ * Since iterators refer to the old radix nodes, compaction is refused while
+ * `t->itr_lock` is non-zero.  If `bytes` is not NULL, it receives the
+ * (estimated) number of bytes reclaimed.  On failure, `t` is left as is.
+ * - returns 1 on success, 0 on failure
  */
 
 int
-tbl_stackpop(table_t *t)
+tbl_compact(table_t *t, size_t *bytes, void *pargs)
 {
-    // pop & free top element
-    stackElm_t *node;
+    table_t *c;
+    struct radix_node_head *src[2], *dst[2], *head;
+    struct radix_node *rn, *cn;
+    size_t before, nfree, *count[2];
+    eslab_t *slab;
+    entry_t *e, *efree;
+    hindex_t *index;
+
+    if (t == NULL || ! tbl_gc(t, pargs)) return 0;
+    if ((c = tbl_create(NULL)) == NULL) return 0;  // purges nothing
+    if (! tbl_reserve(c, t->count4 + t->count6)) goto fail;
+    c->head4->rnh_matchaddr = t->head4->rnh_matchaddr;
+
+    src[0] = t->head4, dst[0] = c->head4, count[0] = &c->count4;
+    src[1] = t->head6, dst[1] = c->head6, count[1] = &c->count6;
+
+    for (int i = 0; i < 2; i++) {
+        for (rn = rdx_firstleaf(&src[i]->rh); rn; rn = rdx_nextleaf(rn)) {
+            if ((e = en_new(c)) == NULL) goto fail;
+            e->value = ((entry_t *)rn)->value;
+            memcpy(e->key, rn->rn_key, IPT_KEYLEN(rn->rn_key));
+            if (!dst[i]->rnh_addaddr(e->key, rn->rn_mask, &dst[i]->rh,
+                                     e->rn)) {
+                en_free(c, e);
+                goto fail;
+            }
+            *count[i] += 1;
+        }
+    }
+    if (t->index && ! tbl_hindex(c, 1)) goto fail;
+
+    /* both trees have the same leafs in the same order */
+    for (int i = 0; i < 2; i++) {
+        rn = rdx_firstleaf(&src[i]->rh);
+        cn = rdx_firstleaf(&dst[i]->rh);
+        for (; rn && cn; rn = rdx_nextleaf(rn), cn = rdx_nextleaf(cn)) {
+            ((entry_t *)cn)->mpath = ((entry_t *)rn)->mpath;
+            ((entry_t *)rn)->mpath = NULL;
+        }
+    }
 
-    if (t == NULL) return 0;       /* no table, no stack */
-    if (t->top == NULL) return 0;  /* no stack, no pop */
+    /* swap storage, `c` is left with the old trees and no purge function */
+    before = tbl_bytes(t);
+    head = t->head4, t->head4 = c->head4, c->head4 = head;
+    head = t->head6, t->head6 = c->head6, c->head6 = head;
+    slab = t->slab, t->slab = c->slab, c->slab = slab;
+    efree = t->efree, t->efree = c->efree, c->efree = efree;
+    nfree = t->nfree, t->nfree = c->nfree, c->nfree = nfree;
+    index = t->index, t->index = c->index, c->index = index;
+    t->gen++;                // invalidates the cache and lookup engines
+
+    if (bytes) {
+        *bytes = tbl_bytes(t);
+        *bytes = before > *bytes ? before - *bytes : 0;
+    }
+    tbl_destroy(&c, pargs);
 
-    node = t->top;
-    t->top = node->next;
-    free(node);
+    return 1;
 
-    t->size -= 1;
-    if(t->top == NULL)  /* just in case somebody messed with the size */
-        t->size = 0;
+fail:
+    tbl_destroy(&c, pargs);
+    return 0;
+}
+
+/* ### `tbl_live`
+ * ```c
+ *   static struct radix_node *tbl_live(struct radix_node *rn);
+ * ```
+ * Return the first leaf, starting at `rn`, that is not flagged for deletion,
+ * or NULL when the end of the tree is reached.
+ */
+
+static struct radix_node *
+tbl_live(struct radix_node *rn)
+{
+    while (rn && !RDX_ISROOT(rn) && (rn->rn_flags & IPTF_DELETE))
+        rn = rdx_nextleaf(rn);
+
+    return (rn && RDX_ISROOT(rn)) ? NULL : rn;
+}
+
+/* ### `tbl_diffinit`
+ * ```c
+ *   int tbl_diffinit(diff_t *d, table_t *a, table_t *b, eq_f_t *eq,
+ *                    void *eargs);
+ * ```
+ * Prepare `d` for an ordered merge of old table `a` and new table `b`, whose
+ * differences are then obtained by calling `tbl_diffnext`.  If `eq` is not
+ * NULL, it is called as `eq(eargs, va, vb)` to compare the values of prefixes
+ * present in both tables, otherwise their value pointers are compared.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_diffinit(diff_t *d, table_t *a, table_t *b, eq_f_t *eq, void *eargs)
+{
+    if (d == NULL || a == NULL || b == NULL) return 0;
+
+    d->a = a;
+    d->b = b;
+    d->af = AF_INET;
+    d->ra = tbl_live(rdx_firstleaf(&a->head4->rh));
+    d->rb = tbl_live(rdx_firstleaf(&b->head4->rh));
+    d->eq = eq;
+    d->eargs = eargs;
+
+    return 1;
+}
+
+/* ### `tbl_diffnext`
+ * ```c
+ *   int tbl_diffnext(diff_t *d, entry_t **ea, entry_t **eb);
+ * ```
+ * Advance the merge in `d` to the next difference and return its `TDIFF_x`
+ * operation, with the old entry in `*ea` and the new entry in `*eb` (NULL
+ * for the side without the prefix).  Leafs of both trees are compared on
+ * their key and, for equal keys, on their mask, so each leaf is visited only
+ * once and the whole diff runs in O(n + m).  No strings are formatted.
+ *
+ * Leafs flagged for deletion are skipped, so the tables may be modified
+ * between calls as long as deletions are deferred (as they are while Lua
+ * iterators are active).
+ * - returns `TDIFF_NONE` (0) when done or on failure
+ */
+
+int
+tbl_diffnext(diff_t *d, entry_t **ea, entry_t **eb)
+{
+    struct radix_node *ra, *rb;
+    int cmp, ma, mb;
+
+    if (d == NULL || ea == NULL || eb == NULL) return TDIFF_NONE;
+
+    for (;;) {
+        ra = d->ra = tbl_live(d->ra);
+        rb = d->rb = tbl_live(d->rb);
+
+        if (ra == NULL && rb == NULL) {
+            if (d->af == AF_INET6) return TDIFF_NONE;
+            d->af = AF_INET6;
+            d->ra = rdx_firstleaf(&d->a->head6->rh);
+            d->rb = rdx_firstleaf(&d->b->head6->rh);
+            continue;
+        }
+
+        if (ra == NULL) cmp = 1;
+        else if (rb == NULL) cmp = -1;
+        else if ((cmp = key_cmp(ra->rn_key, rb->rn_key)) == 0) {
+            /* more specific prefixes come first in a dupedkey chain */
+            ma = key_masklen(ra->rn_mask);
+            mb = key_masklen(rb->rn_mask);
+            cmp = ma > mb ? -1 : ma < mb;
+        }
+
+        if (cmp < 0) {
+            d->ra = rdx_nextleaf(ra);
+            *ea = (entry_t *)ra;
+            *eb = NULL;
+            return TDIFF_DEL;
+        }
+        if (cmp > 0) {
+            d->rb = rdx_nextleaf(rb);
+            *ea = NULL;
+            *eb = (entry_t *)rb;
+            return TDIFF_ADD;
+        }
+
+        d->ra = rdx_nextleaf(ra);
+        d->rb = rdx_nextleaf(rb);
+        *ea = (entry_t *)ra;
+        *eb = (entry_t *)rb;
+        if (d->eq ? ! d->eq(d->eargs, (*ea)->value, (*eb)->value)
+                  : (*ea)->value != (*eb)->value)
+            return TDIFF_CHG;
+    }
+}
+
+/* ### `tbl_diff`
+ * ```c
+ *   int tbl_diff(table_t *a, table_t *b, eq_f_t *eq, diff_f_t *f,
+ *                void *args);
+ * ```
+ * Run `f(args, op, ea, eb)` for each difference between old table `a` and
+ * new table `b`, in key order, ipv4 before ipv6.  Values of prefixes present
+ * in both are compared using `eq(args, va, vb)`, or their pointers if `eq` is
+ * NULL.  The diff stops early if `f` returns 0.
+ * - returns 1 on success, 0 on failure or when stopped by `f`
+ */
+
+int
+tbl_diff(table_t *a, table_t *b, eq_f_t *eq, diff_f_t *f, void *args)
+{
+    diff_t d;
+    entry_t *ea, *eb;
+    int op;
+
+    if (f == NULL || ! tbl_diffinit(&d, a, b, eq, args)) return 0;
+
+    while ((op = tbl_diffnext(&d, &ea, &eb)) != TDIFF_NONE)
+        if (! f(args, op, ea, eb))
+            return 0;
+
+    return 1;
+}
+
+/* ### `tbl_walk`
+ * ```c
+ *   int tbl_walk(table_t *t, walktree_f_t *f, void *fargs);
+ * ```
+ * run f(args, leaf) on leafs in IPv4 tree and IPv6 tree
+ */
+int
+tbl_walk(table_t *t, walktree_f_t *f, void *fargs)
+{
+    if (t == NULL) return 0;
+    t->head4->rnh_walktree(&t->head4->rh, f, fargs);
+    t->head6->rnh_walktree(&t->head6->rh, f, fargs);
+
+   return 1;
+}
+
+/* ### `tbl_destroy`
+ * ```c
+ *   int tbl_destroy(table_t **t, void *pargs);
+ * ```
+ * Destroy table, free all resources owned by table and user
+ * - return 1 on success, 0 on failure
+ */
+
+int
+tbl_destroy(table_t **t, void *pargs)
+{
+    purge_t args;  // args to flush radix nodes & free userdata
+
+    if (t == NULL || *t == NULL) return 0;  // nothing to free
+
+    // pickup user purge callback & its contextual args
+    args.purge = (*t)->purge;
+    args.args = pargs;
+    args.tbl = *t;
+
+    // clear ipv4 table
+    args.head = (*t)->head4;
+    (*t)->head4->rnh_walktree(&(*t)->head4->rh, rdx_flush, &args);
+
+    /* walktree misses out on RightEnd-marker's dupedkey, of which it can 
+     * have only 1
+     * */
+    if((*t)->head4->rnh_nodes[2].rn_dupedkey)
+        rdx_flush((*t)->head4->rnh_nodes[2].rn_dupedkey, &args);
+
+    rn_detachhead((void **)&(*t)->head4);
+
+    // clear ipv6 table
+    args.head = (*t)->head6;
+    (*t)->head6->rnh_walktree(&(*t)->head6->rh, rdx_flush, &args);
+
+    /* walktree misses RightEnd-marker's dupedkey */
+    if ((*t)->head6->rnh_nodes[2].rn_dupedkey)
+        rdx_flush(((*t)->head6->rnh_nodes)[2].rn_dupedkey, &args);
+    rn_detachhead((void **)&(*t)->head6);
+
+    // clear the stack
+    while ((*t)->top != NULL) tbl_stackpop(*t);
+
+    tbl_persist(*t, 0, NULL, pargs);
+    while ((*t)->slab) {
+        eslab_t *s = (*t)->slab;
+        (*t)->slab = s->next;
+        free(s);
+    }
+    free((*t)->cache);
+    free((*t)->index);
+    free((*t)->journal);
+    free((*t)->lat);
+    tbl_record(*t, NULL, 0);
+    free(*t);
+    *t = NULL;
+
+    return 1;
+}
+
+/* ### `tbl_release`
+ * ```c
+ *   int tbl_release(table_t *t, void *pargs);
+ * ```
+ * Free all values and paths of table `t` using its purge callback, also of
+ * entries flagged for deletion and those held by its persistent tree, which
+ * is disabled.  The table keeps its prefixes, now without values, and no
+ * longer has a purge callback.  So `tbl_destroy` or `tbl_destroystep` on a
+ * released table never calls back into the caller and can be run on some
+ * other thread, provided nothing else uses the table.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_release(table_t *t, void *pargs)
+{
+    struct radix_node *rn;
+    entry_t *e;
+
+    if (t == NULL) return 0;
+
+    tbl_persist(t, 0, NULL, pargs);
+    for (int i = 0; i < 2; i++)
+        for (rn = rdx_firstleaf(i ? &t->head6->rh : &t->head4->rh); rn;
+             rn = rdx_nextleaf(rn)) {
+            e = (entry_t *)rn;
+            if (e->value != NULL && t->purge != NULL)
+                t->purge(pargs, &e->value);
+            e->value = NULL;
+            mp_destroy(&e->mpath, t->purge, pargs);
+        }
+    t->purge = NULL;
+
+    return 1;
+}
+
+/* ### `tbl_destroystep`
+ * ```c
+ *   int tbl_destroystep(table_t **t, void *pargs, size_t n);
+ * ```
+ * Incremental version of `tbl_destroy`, which removes at most `n` prefixes
+ * per call (0 means no limit), purging their values.  Once both trees are
+ * empty, the table itself is destroyed and `*t` is set to NULL.  Removing a
+ * prefix costs a bit more than `tbl_destroy` does, but the host decides how
+ * much work is done at a time.  The table must not be used otherwise while
+ * it is being destroyed.
+ * - returns 1 if there is work left, 0 if the table is gone (or on failure)
+ */
+
+int
+tbl_destroystep(table_t **t, void *pargs, size_t n)
+{
+    struct radix_node *rn;
+    purge_t args;
+
+    if (t == NULL || *t == NULL) return 0;
+
+    args.purge = (*t)->purge;
+    args.args = pargs;
+    args.tbl = *t;
+    args.head = (*t)->head4;
+
+    for (size_t i = 0; n == 0 || i < n;) {
+        if ((rn = rdx_firstleaf(&args.head->rh)) == NULL) {
+            if (args.head == (*t)->head6) break;
+            args.head = (*t)->head6;
+            continue;
+        }
+        rdx_flush(rn, &args);
+        i++;
+    }
+
+    if (rdx_firstleaf(&(*t)->head4->rh) || rdx_firstleaf(&(*t)->head6->rh))
+        return 1;
+
+    tbl_destroy(t, pargs);
+
+    return 0;
+}
+
+/* ### `tb_get`
+ * ```c
+ *   static entry_t *tb_get(table_t *t, const char *s);
+ * ```
+ * Does the work of `tbl_get`, which wraps it to time the lookup.
+ */
+
+static entry_t *
+tb_get(table_t *t, const char *s)
+{
+    // An exact lookup for addr/mask, missing mask is set to AF's max mask
+    // uint8_t *addr = NULL;
+    uint8_t addr[MAX_BINKEY];
+    uint8_t mask[MAX_BINKEY];
+    int mlen = -1, af = AF_UNSPEC;
+    struct radix_node_head *head = NULL;
+    entry_t *e = NULL;
+
+    // get head, af, addr, mask, or bail on error
+    if (t == NULL || s == NULL) return NULL;
+    if (! key_bystr(addr, &mlen, &af, s)) return NULL;
+
+    if (af == AF_INET) head = t->head4;
+    else if (af == AF_INET6) head = t->head6;
+    else return NULL;
+
+    if (! key_bylen(mask, mlen, af)) return NULL;
+    if (! key_network(addr, mask)) return NULL;
+
+    if (t->index)
+        e = hx_get(t->index, addr, mlen < 0 ? MAX_MASKLEN(af) : mlen);
+    else
+        e = (entry_t *)head->rnh_lookup(addr, mask, &head->rh);
+
+    /* itr_gc, node deleted but not yet gc'd */
+    if (e && (e->rn->rn_flags & IPTF_DELETE))
+        return NULL;
+
+    return e;
+}
+
+/* ### `tbl_get`
+ * ```c
+ *   entry_t *tbl_get(table_t *t, const char *s);
+ * ```
+ * Get an exact match for addr/mask prefix.
+ */
+
+entry_t *
+tbl_get(table_t *t, const char *s)
+{
+    uint64_t t0;
+    entry_t *rv;
+
+    tr_str(t, TRC_GET, s);
+    t0 = lt_start(t, LAT_GET);
+    rv = tb_get(t, s);
+    lt_stop(t, LAT_GET, t0);
+
+    return rv;
+}
+
+/* ### `tbl_rawget`
+ * ```c
+ *   entry_t *tbl_rawget(table_t *t, const char *s);
+ * ```
+ * Same as `tbl_get`, but neither recorded nor timed.  For lookups a host
+ * does on its own behalf, e.g. to check arguments or to filter an iterator,
+ * so traces and latencies only reflect the operations its users asked for.
+ */
+
+entry_t *
+tbl_rawget(table_t *t, const char *s)
+{
+    return tb_get(t, s);
+}
+
+/* ### `tbl_set`
+ * ```c
+ *   int tbl_set(table_t *t, const char *s, void *v, void *pargs);
+ * ```
+ */
+
+int
+tbl_set(table_t *t, const char *s, void *v, void *pargs)
+{
+    // A missing mask is taken to mean AF's max mask
+    uint8_t addr[MAX_BINKEY];
+    int mlen = -1, af = AF_UNSPEC;
+
+    if (t == NULL || s == NULL) return 0;
+    if (! key_bystr(addr, &mlen, &af, s)) return 0;
+
+    return tbl_setkey(t, addr, mlen, v, pargs);
+}
+
+/* ### `tb_setkey`
+ * ```c
+ *   static int tb_setkey(table_t *t, uint8_t *key, int mlen, void *v,
+ *                        void *pargs);
+ * ```
+ * Does the work of `tbl_setkey`, which wraps it to time the change.
+ */
+
+static int
+tb_setkey(table_t *t, uint8_t *key, int mlen, void *v, void *pargs)
+{
+    // - applies mask before searching/setting the tree
+    uint8_t addr[MAX_BINKEY], mask[MAX_BINKEY];
+    int af = AF_UNSPEC;
+    entry_t *e = NULL;
+    struct radix_node *rn = NULL;
+    struct radix_node_head *head = NULL;
+    ptprep_t prep;
+
+    // get head, af, addr, mask, or bail on error
+    if (t == NULL || key == NULL) return 0;
+
+    af = KEY_AF_FAM(key);
+    if (af == AF_INET) head = t->head4;
+    else if (af == AF_INET6) head = t->head6;
+    else return 0;
+
+    memcpy(addr, key, IPT_KEYLEN(key));
+    if (! key_bylen(mask, mlen, af)) return 0;
+    if (! key_network(addr, mask)) return 0;
+    if (mlen < 0) mlen = MAX_MASKLEN(af);
+    if (! pt_prep(t, &prep, addr, mlen, v, 1, pargs)) return 0;
+
+    if (t->index)
+        e = hx_get(t->index, addr, mlen);
+    else
+        e = (entry_t *)head->rnh_lookup(addr, mask, &head->rh);
+    t->gen++;
+    if (e) {
+        /* purge called to free userdata */
+        if(e->value && t->purge)
+            t->purge(pargs, &e->value);
+        e->value = v;
+
+        /* no need to update stats if e was not flagged as deleted */
+        if((e->rn->rn_flags & IPTF_DELETE) == 0) {
+            pt_apply(t, &prep, addr, mlen, pargs);
+            jr_log(t, JRNL_SET, addr, mlen);
+            return 1;
+        }
+
+        e->rn->rn_flags &= ~IPTF_DELETE;  // clear delete flag
+        t->ndel--;
+        mp_destroy(&e->mpath, t->purge, pargs);  // paths died with the entry
+
+    } else {
+        // add new entry, which holds the key for the tree to keep
+        if (! hx_reserve(t) || !(e = en_new(t))) {
+            pt_done(t, &prep, pargs);
+            return 0;
+        }
+        e->value = v;
+        memcpy(e->key, addr, IPT_KEYLEN(addr));
+
+        rn = head->rnh_addaddr(e->key, mask, &head->rh, e->rn);
+        if (!rn) {
+            /* caller still owns v */
+            en_free(t, e);
+            pt_done(t, &prep, pargs);
+            return 0;
+        }
+        if (t->index) hx_put(t->index, e, mlen);
+
+    }
+
+    if (af == AF_INET) t->count4++;
+    else t->count6++;
+    pt_apply(t, &prep, addr, mlen, pargs);
+    jr_log(t, JRNL_SET, addr, mlen);
+
+    return 1;
+}
+
+/* ### `tbl_setkey`
+ * ```c
+ *   int tbl_setkey(table_t *t, uint8_t *key, int mlen, void *v, void *pargs);
+ * ```
+ * Same as `tbl_set`, but takes a binary `key` and mask length `mlen` rather
+ * than a prefix string.  A `mlen` of -1 means AF's max mask.  The mask is
+ * applied to a copy of `key`, so the caller's key is not modified.
+ * - returns 1 on success, 0 on failure in which case the caller still owns `v`
+ */
+
+int
+tbl_setkey(table_t *t, uint8_t *key, int mlen, void *v, void *pargs)
+{
+    uint64_t t0;
+    int rv;
+
+    tr_key(t, TRC_SET, key, mlen);
+    t0 = lt_start(t, LAT_SET);
+    rv = tb_setkey(t, key, mlen, v, pargs);
+    lt_stop(t, LAT_SET, t0);
+
+    return rv;
+}
+
+/* ### `tb_del`
+ * ```c
+ *   static int tb_del(table_t *t, const char *s, void *pargs);
+ * ```
+ * Does the work of `tbl_del`, which wraps it to time the deletion.
+ */
+
+static int
+tb_del(table_t *t, const char *s, void *pargs)
+{
+    // Deletion requires exact match on prefix
+    // - a missing mask is set to AF's max mask
+    entry_t *e;
+    struct radix_node_head *head = NULL;
+    uint8_t addr[MAX_BINKEY], mask[MAX_BINKEY];
+    int mlen = -1, af = AF_UNSPEC;
+    ptprep_t prep;
+
+    // get head, af, addr, mask, or bail on error
+    if (t == NULL || s == NULL) return 0;
+    if (! key_bystr(addr, &mlen, &af, s)) return 0;
+    if (! key_bylen(mask, mlen, af)) return 0;
+    if (! key_network(addr, mask)) return 0;
+    if (mlen < 0) mlen = MAX_MASKLEN(af);
+
+    if (af == AF_INET) head = t->head4;
+    else if (af == AF_INET6) head = t->head6;
+    else return 0;
+
+    if (! pt_prep(t, &prep, addr, mlen, NULL, 0, pargs)) return 0;
+
+    if (t->itr_lock) {
+        /* active iterator(s), so flag node (if any & needed) for DELETION */
+        if (t->index)
+            e = hx_get(t->index, addr, mlen);
+        else
+            e = (entry_t *)head->rnh_lookup(addr, mask, &head->rh);
+        if (!e || (e->rn->rn_flags & IPTF_DELETE)) {
+            pt_done(t, &prep, pargs);
+            return 0;
+        }
+        e->rn->rn_flags |= IPTF_DELETE;
+        t->ndel++;
+        /* fprintf(stderr, "flagged %s", s); */
+
+    } else {
+        /* keep a sweep by tbl_gcstep off the leaf about to be freed */
+        if (t->gcnext && t->gcnext == head->rnh_lookup(addr, mask, &head->rh))
+            t->gcnext = rdx_nextleaf(t->gcnext);
+        e = (entry_t *)head->rnh_deladdr(addr, mask, &head->rh);
+        if (!e) {
+            pt_done(t, &prep, pargs);
+            return 0;
+        }
+        if (t->index) hx_del(t->index, addr, mlen);
+        if(e->value != NULL && t->purge != NULL)
+            t->purge(pargs, &e->value);             // free the user data
+        mp_destroy(&e->mpath, t->purge, pargs);     // free any paths
+        en_free(t, e);                              // free entry & key
+    }
+
+    /* if we get here, a non-deleted node was found, so decrement counter */
+    t->gen++;
+    if (af == AF_INET) t->count4--;
+    else t->count6--;
+    pt_apply(t, &prep, addr, mlen, pargs);
+    jr_log(t, JRNL_DEL, addr, mlen);
+
+    return 1;
+}
+
+/* ### `tbl_del`
+ * ```c
+ *   int tbl_del(table_t *t, const char *s, void *pargs);
+ * ```
+ */
+
+int
+tbl_del(table_t *t, const char *s, void *pargs)
+{
+    uint64_t t0;
+    int rv;
+
+    tr_str(t, TRC_DEL, s);
+    t0 = lt_start(t, LAT_DEL);
+    rv = tb_del(t, s, pargs);
+    lt_stop(t, LAT_DEL, t0);
+
+    return rv;
+}
+
+/* ### `tbl_lpm`
+ * ```c
+ *   entry_t *tbl_lpm(table_t *t, const char *s);
+ * ```
+ */
+
+entry_t *
+tbl_lpm(table_t *t, const char *s)
+{
+    // longest prefix match for address (a /mask is ignored)
+    uint8_t addr[MAX_BINKEY];
+    int mlen = -1, af = AF_UNSPEC;
+
+    if (t == NULL || s == NULL) return NULL;
+    if (! key_bystr(addr, &mlen, &af, s)) return NULL;
+
+    return tbl_lpmkey(t, addr);
+}
+
+/* ### `tb_lpmkey`
+ * ```c
+ *   static entry_t *tb_lpmkey(table_t *t, uint8_t *addr);
+ * ```
+ * Does the work of `tbl_lpmkey`, which wraps it to time the lookup.
+ */
+
+static entry_t *
+tb_lpmkey(table_t *t, uint8_t *addr)
+{
+    struct radix_node_head *head = NULL;
+    struct radix_node *rn;
+    lpmslot_t *slot = NULL;
+    uint32_t hash = 2166136261u;  /* FNV-1a */
+    int af;
+
+    if (t == NULL || addr == NULL) return NULL;
+
+    af = KEY_AF_FAM(addr);
+    if (af == AF_INET) head = t->head4;
+    else if (af == AF_INET6) head = t->head6;
+    else return NULL;
+
+    if (t->cache) {
+        for (int i = 0; i < IPT_KEYLEN(addr); i++)
+            hash = (hash ^ addr[i]) * 16777619u;
+        slot = t->cache->slot + (hash & (t->cache->size - 1));
+        if (slot->gen == t->gen
+            && memcmp(slot->key, addr, IPT_KEYLEN(addr)) == 0) {
+            t->cache->hits++;
+            return slot->entry;
+        }
+        t->cache->misses++;
+    }
+
+    /* rn will be the longest prefix match (if any) */
+    rn = head->rnh_matchaddr(addr, &head->rh);
+
+    /* cannot return rn if it was flagged for deletion */
+    while(rn && (rn->rn_flags & IPTF_DELETE))
+        rn = tbl_lsm(rn);
+
+    if (slot) {
+        slot->gen = t->gen;
+        slot->entry = (entry_t *)rn;
+        memcpy(slot->key, addr, IPT_KEYLEN(addr));
+    }
+
+    return (entry_t *)rn;
+}
+
+/* ### `tbl_lpmkey`
+ * ```c
+ *   entry_t *tbl_lpmkey(table_t *t, uint8_t *addr);
+ * ```
+ * Same as `tbl_lpm`, but takes a binary address.  If the table has a cache,
+ * it is consulted first and updated on a miss.
+ */
+
+entry_t *
+tbl_lpmkey(table_t *t, uint8_t *addr)
+{
+    uint64_t t0;
+    entry_t *rv;
+
+    tr_key(t, TRC_LPM, addr, -1);
+    t0 = lt_start(t, LAT_LPM);
+    rv = tb_lpmkey(t, addr);
+    lt_stop(t, LAT_LPM, t0);
+
+    return rv;
+}
+
+/* ### `tbl_rawlpm`
+ * ```c
+ *   entry_t *tbl_rawlpm(table_t *t, uint8_t *addr);
+ * ```
+ * Same as `tbl_lpmkey`, but neither recorded nor timed, see `tbl_rawget`.
+ */
+
+entry_t *
+tbl_rawlpm(table_t *t, uint8_t *addr)
+{
+    return tb_lpmkey(t, addr);
+}
+
+/* ### `tbl_lpmsa`
+ * ```c
+ *   entry_t *tbl_lpmsa(table_t *t, const struct sockaddr *sa);
+ * ```
+ * Same as `tbl_lpm`, but takes a `struct sockaddr_in` or `sockaddr_in6`.
+ * The binary key is built on the stack, see `key_bysockaddr`.
+ * - returns the matching entry, NULL if there is none
+ */
+
+entry_t *
+tbl_lpmsa(table_t *t, const struct sockaddr *sa)
+{
+    uint8_t addr[MAX_BINKEY];
+
+    if (t == NULL || ! key_bysockaddr(addr, sa)) return NULL;
+
+    return tbl_lpmkey(t, addr);
+}
+
+/* ### `tbl_lpmhdr`
+ * ```c
+ *   entry_t *tbl_lpmhdr(table_t *t, const uint8_t *hdr, size_t len, int dir);
+ * ```
+ * Same as `tbl_lpm`, but takes the source or destination address, as
+ * selected by `dir`, of the raw ipv4 or ipv6 header at `hdr` with `len` bytes
+ * available, see `key_byhdr`.
+ * - returns the matching entry, NULL if there is none
+ */
+
+entry_t *
+tbl_lpmhdr(table_t *t, const uint8_t *hdr, size_t len, int dir)
+{
+    uint8_t addr[MAX_BINKEY];
+
+    if (t == NULL || ! key_byhdr(addr, hdr, len, dir)) return NULL;
+
+    return tbl_lpmkey(t, addr);
+}
+
+/* ### `tbl_lpmhdrs`
+ * ```c
+ *   size_t tbl_lpmhdrs(table_t *t, const uint8_t **pkts, const size_t *lens,
+ *                      size_t n, size_t off, int dir, entry_t **res);
+ * ```
+ * Batch form of `tbl_lpmhdr` for a vector of `n` packet buffers, whose IP
+ * header starts at offset `off` (e.g. 14 for untagged ethernet frames).  If
+ * `lens` is not NULL, it holds the length of each buffer, otherwise each
+ * buffer is assumed to hold a complete header.  The match for `pkts[i]` is
+ * stored in `res[i]`, NULL for no match or an invalid packet.
+ * - returns the number of packets with a match
+ */
+
+size_t
+tbl_lpmhdrs(table_t *t, const uint8_t **pkts, const size_t *lens, size_t n,
+            size_t off, int dir, entry_t **res)
+{
+    size_t len, found = 0;
+
+    if (t == NULL || pkts == NULL || res == NULL) return 0;
+
+    for (size_t i = 0; i < n; i++) {
+        len = lens ? lens[i] : off + 40;
+        res[i] = NULL;
+        if (pkts[i] == NULL || len <= off) continue;
+        res[i] = tbl_lpmhdr(t, pkts[i] + off, len - off, dir);
+        found += res[i] != NULL;
+    }
+
+    return found;
+}
+
+/* ### `tbl_cache`
+ * ```c
+ *   int tbl_cache(table_t *t, size_t size);
+ * ```
+ * Enable the longest prefix match cache of table `t` with (at least) `size`
+ * slots, rounded up to a power of 2.  A `size` of 0 disables the cache.  Any
+ * previous cache is discarded, including its hit and miss counters.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_cache(table_t *t, size_t size)
+{
+    lpmcache_t *cache = NULL;
+    size_t slots = 1;
+
+    if (t == NULL) return 0;
+
+    if (size > 0) {
+        while (slots < size && slots < SIZE_MAX / 2)
+            slots <<= 1;
+        if (slots > (SIZE_MAX - sizeof(*cache)) / sizeof(lpmslot_t))
+            return 0;
+        cache = calloc(sizeof(*cache) + slots * sizeof(lpmslot_t), 1);
+        if (cache == NULL) return 0;
+        cache->size = slots;
+    }
+
+    free(t->cache);
+    t->cache = cache;
+    t->gen++;  /* a zeroed slot must never match */
+
+    return 1;
+}
+
+/* ### `tbl_match4`
+ * ```c
+ *   int tbl_match4(table_t *t, int enable);
+ * ```
+ * Select the longest prefix match routine used by the ipv4 tree of table
+ * `t`: `rn_match4` (`enable` non-zero, the default) which handles keys and
+ * masks as 32-bit integers, or the generic, byte oriented `rn_match`.  Both
+ * yield the same results.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_match4(table_t *t, int enable)
+{
+    if (t == NULL) return 0;
+
+    t->head4->rnh_matchaddr = enable ? rn_match4 : rn_match;
+
+    return 1;
+}
+
+/* ### `tbl_hindex`
+ * ```c
+ *   int tbl_hindex(table_t *t, int enable);
+ * ```
+ * Enable (`enable` non-zero) or disable the exact match index of table `t`.
+ * When enabled, the index is built from all entries currently in both radix
+ * trees and from then on maintained by `tbl_set(key)` and `tbl_del`.  While
+ * enabled, exact lookups by `tbl_get`, `tbl_set(key)` and `tbl_del` use the
+ * index instead of a radix tree descent.  Enabling an enabled index rebuilds
+ * it.
+ * - returns 1 on success, 0 on failure (the table is left as it was)
+ */
+
+int
+tbl_hindex(table_t *t, int enable)
+{
+    hindex_t *x = NULL;
+    struct radix_node *rn;
+    struct radix_node_head *heads[2];
+    size_t size = 16, count;
+
+    if (t == NULL) return 0;
+
+    if (enable) {
+        /* flagged entries are still in the trees, so count the leafs */
+        count = 0;
+        heads[0] = t->head4, heads[1] = t->head6;
+        for (int i = 0; i < 2; i++)
+            for (rn = rdx_firstleaf(&heads[i]->rh); rn; rn = rdx_nextleaf(rn))
+                count++;
+        count += t->nfree;  // room for entries reserved, see tbl_reserve
+
+        while (4 * count > 3 * size && size < SIZE_MAX / 2)
+            size <<= 1;
+        if (size > (SIZE_MAX - sizeof(*x)) / sizeof(hslot_t)) return 0;
+        x = calloc(sizeof(*x) + size * sizeof(hslot_t), 1);
+        if (x == NULL) return 0;
+        x->size = size;
+
+        for (int i = 0; i < 2; i++)
+            for (rn = rdx_firstleaf(&heads[i]->rh); rn; rn = rdx_nextleaf(rn))
+                hx_put(x, (entry_t *)rn, key_masklen(rn->rn_mask));
+    }
+
+    free(t->index);
+    t->index = x;
+
+    return 1;
+}
+
+/* ### `tbl_journal`
+ * ```c
+ *   int tbl_journal(table_t *t, size_t size);
+ * ```
+ * Enable the change journal of table `t`, keeping (at least) the last `size`
+ * changes, rounded up to a power of 2.  A `size` of 0 disables the journal.
+ * Any previous journal's records are discarded, but its sequence number and
+ * subscriber carry over so consumers notice the records they have lost.
+ * Disabling the journal does reset the sequence number.
+ * Once enabled, each successful `tbl_set(key)` and `tbl_del` appends a
+ * record.  Deferred deletions are recorded when the prefix is flagged.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_journal(table_t *t, size_t size)
+{
+    journal_t *j = NULL;
+    size_t slots = 1;
+
+    if (t == NULL) return 0;
+
+    if (size > 0) {
+        while (slots < size && slots < SIZE_MAX / 2)
+            slots <<= 1;
+        if (slots > (SIZE_MAX - sizeof(*j)) / sizeof(jrec_t))
+            return 0;
+        j = calloc(sizeof(*j) + slots * sizeof(jrec_t), 1);
+        if (j == NULL) return 0;
+        j->size = slots;
+        if (t->journal) {
+            j->seq = j->base = t->journal->seq;
+            j->notify = t->journal->notify;
+            j->nargs = t->journal->nargs;
+        }
+    }
+
+    free(t->journal);
+    t->journal = j;
+
+    return 1;
+}
+
+/* ### `tbl_subscribe`
+ * ```c
+ *   int tbl_subscribe(table_t *t, jrnl_f_t *f, void *fargs);
+ * ```
+ * Set (or, if `f` is NULL, clear) the subscriber of the journal of table `t`,
+ * which is called as `f(fargs, rec)` right after each change is recorded.
+ * The journal must be enabled first.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_subscribe(table_t *t, jrnl_f_t *f, void *fargs)
+{
+    if (t == NULL || t->journal == NULL) return 0;
+
+    t->journal->notify = f;
+    t->journal->nargs = fargs;
+
+    return 1;
+}
+
+/* ### `tbl_jnext`
+ * ```c
+ *   int tbl_jnext(table_t *t, uint64_t *seq, jrec_t **rec);
+ * ```
+ * Read the journal of table `t` on from `*seq`, the sequence number of the
+ * last change seen by the caller (0 to start from the beginning).  If there
+ * is a next record, it is stored in `*rec` and `*seq` is advanced to it.  If
+ * the records after `*seq` have been overwritten, `*seq` is moved up to just
+ * before the oldest record still available and the caller should
+ * resynchronize (e.g. using [`tbl_diff`](### `tbl_diff`)) before reading on.
+ * - returns 1 if a record was read, 0 if none is pending, -1 if records
+ *   were lost (or on failure, in which case `*seq` is not changed)
+ */
+
+int
+tbl_jnext(table_t *t, uint64_t *seq, jrec_t **rec)
+{
+    journal_t *j;
+    uint64_t oldest;
+
+    if (t == NULL || seq == NULL || rec == NULL) return -1;
+    if ((j = t->journal) == NULL) return -1;
+
+    /* records after oldest are still available */
+    oldest = j->seq - j->base > j->size ? j->seq - j->size : j->base;
+    if (*seq == j->seq) return 0;
+    if (*seq > j->seq || *seq < oldest) {
+        /* overwritten, or a cursor from a journal since disabled */
+        *seq = oldest;
+        return -1;
+    }
+
+    *seq += 1;
+    *rec = j->rec + (*seq & (j->size - 1));
+
+    return 1;
+}
+
+/* ### `tbl_latency`
+ * ```c
+ *   int tbl_latency(table_t *t, size_t every);
+ * ```
+ * Enable the latency histograms of table `t`, timing one in `every`
+ * operations (rounded up to a power of 2) of each kind, see
+ * [`latency_t`](### `latency_t`).  An `every` of 0 disables the histograms.
+ * Changing the rate keeps the samples collected so far, disabling and then
+ * enabling them again starts afresh.  Timing uses the monotonic clock,
+ * which costs some 20-50ns per sample, hence the sampling.
+ * - returns 1 on success, 0 on failure (always, when compiled with
+ *   `IPT_NOSTATS`)
+ */
+
+int
+tbl_latency(table_t *t, size_t every)
+{
+    uint64_t slots = 1;
+
+    if (t == NULL) return 0;
+
+#ifdef IPT_NOSTATS
+    (void)slots;
+    (void)every;
+    return 0;
+#else
+    if (every == 0) {
+        free(t->lat);
+        t->lat = NULL;
+        return 1;
+    }
+
+    while (slots < every && slots < ((uint64_t)1 << 62))
+        slots <<= 1;
+    if (t->lat == NULL && (t->lat = calloc(sizeof(*t->lat), 1)) == NULL)
+        return 0;
+    t->lat->mask = slots - 1;
+
+    return 1;
+#endif
+}
+
+/* ### `tbl_latq`
+ * ```c
+ *   uint64_t tbl_latq(table_t *t, int op, double q);
+ * ```
+ * Estimate quantile `q` (0 < q <= 1, e.g. 0.99) of the latency of operation
+ * `op` (`LAT_SET` etc) of table `t`, from its histogram.  The estimate is the
+ * upper bound of the bucket holding the quantile, capped by the slowest
+ * sample, so it overstates the latency by less than 25%.
+ * - returns the latency in nanoseconds, 0 if there are no samples (or on
+ *   failure)
+ */
+
+uint64_t
+tbl_latq(table_t *t, int op, double q)
+{
+    latency_t *lat;
+    uint64_t rank, seen = 0, hi = 0;
+    int b;
+
+    if (t == NULL || (lat = t->lat) == NULL) return 0;
+    if (op < 0 || op >= LAT_NOPS || !(q > 0.0 && q <= 1.0)) return 0;
+    if (lat->samples[op] == 0) return 0;
+
+    rank = (uint64_t)(q * (double)lat->samples[op]);
+    if ((double)rank < q * (double)lat->samples[op]) rank++;
+
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+        seen += lat->hist[op][i];
+        if (seen < rank) continue;
+        if (i < 4)
+            hi = (uint64_t)i;
+        else {
+            b = i / 4 + 2;
+            hi = ((uint64_t)(4 + i % 4 + 1) << (b - 3)) - 1;
+        }
+        break;
+    }
+
+    return min(hi, lat->max[op]);
+}
+
+/* ### `tbl_latstart`
+ * ```c
+ *   uint64_t tbl_latstart(table_t *t, int op);
+ * ```
+ * Lets the host time operations the library cannot see, like the steps of
+ * its own iterators (`LAT_ITR`), in the histograms of table `t`.
+ * - returns a timestamp to pass on to `tbl_latstop`, 0 if not sampled
+ */
+
+uint64_t
+tbl_latstart(table_t *t, int op)
+{
+    if (op < 0 || op >= LAT_NOPS) return 0;
+
+    return lt_start(t, op);
+}
+
+/* ### `tbl_latstop`
+ * ```c
+ *   void tbl_latstop(table_t *t, int op, uint64_t t0);
+ * ```
+ * Record the time passed since `t0`, as returned by `tbl_latstart`, for
+ * operation `op` of table `t`.
+ */
+
+void
+tbl_latstop(table_t *t, int op, uint64_t t0)
+{
+    if (t == NULL || op < 0 || op >= LAT_NOPS) return;
+
+    lt_stop(t, op, t0);
+}
+
+/* ### `tbl_record`
+ * ```c
+ *   int tbl_record(table_t *t, const char *fname, uint64_t anon);
+ * ```
+ * Start recording the operations on table `t` to the trace file `fname`,
+ * see [Trace operations](### Trace operations) for its format.  A non-zero
+ * `anon` is the secret used to anonymize the keys recorded, see `tr_anon`.
+ * Values are never recorded.  A `fname` of NULL stops the recording and
+ * closes the trace file, as does `tbl_destroy`.  Starting a new trace stops
+ * the current one.  Each table needs a trace file of its own.
+ * - returns 1 on success, 0 on failure (including a failed write to the
+ *   trace that was stopped)
+ */
+
+int
+tbl_record(table_t *t, const char *fname, uint64_t anon)
+{
+    trace_t *tr;
+    uint8_t hdr[6];
+    int ok = 1;
+
+    if (t == NULL) return 0;
+
+    if ((tr = t->trace) != NULL) {
+        t->trace = NULL;
+        if (fclose(tr->fp) != 0 || tr->err) ok = 0;
+        free(tr);
+    }
+    if (fname == NULL) return ok;
+
+    if ((tr = calloc(sizeof(*tr), 1)) == NULL) return 0;
+    if ((tr->fp = fopen(fname, "wb")) == NULL) {
+        free(tr);
+        return 0;
+    }
+    memcpy(hdr, TRC_MAGIC, 4);
+    hdr[4] = TRC_VERSION;
+    hdr[5] = anon ? TRC_ANON : 0;
+    if (fwrite(hdr, 1, sizeof(hdr), tr->fp) != sizeof(hdr)) {
+        fclose(tr->fp);
+        free(tr);
+        return 0;
+    }
+    tr->anon = anon;
+    t->trace = tr;
+
+    return ok;
+}
+
+/* ### `tbl_trace`
+ * ```c
+ *   int tbl_trace(table_t *t, int op, uint8_t *key, int mlen);
+ * ```
+ * Lets the host record operations the library cannot see, like iterators
+ * starting, stepping and finishing (`TRC_ITR`, `TRC_NEXT`, `TRC_END`), in
+ * the trace of table `t`.  The iterator operations take no `key`.
+ * - returns 1 if a record was written, 0 otherwise
+ */
+
+int
+tbl_trace(table_t *t, int op, uint8_t *key, int mlen)
+{
+    if (t == NULL || t->trace == NULL) return 0;
+
+    return tr_log(t, op, key, mlen);
+}
+
+/* ### `tbl_persist`
+ * ```c
+ *   int tbl_persist(table_t *t, int enable, dup_f_t *dup, void *pargs);
+ * ```
+ * Enable or disable the persistent tree of table `t`, from which snapshots
+ * are taken (see [`tbl_snapshot`](### `tbl_snapshot`)).  Enabling builds the
+ * tree from the table's current prefixes, so it takes time proportional to
+ * their number, and is a no-op if the tree already exists.  If `dup` is not
+ * NULL, it is called as `dup(pargs, value)` for each value stored in the
+ * tree and the table's purge function frees those copies once no snapshot
+ * refers to them.  Otherwise the value pointers are shared with the table
+ * and the caller must keep them alive for as long as snapshots are in use.
+ *
+ * While enabled, each change of the table costs one pass down the path of
+ * the prefix changed plus a copy of each node on that path still shared
+ * with a snapshot.  The `pargs` given to `tbl_set(key)` and `tbl_del` are
+ * passed on to `dup` and the purge function.  Disabling drops the table's
+ * reference to the tree; existing snapshots stay valid.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_persist(table_t *t, int enable, dup_f_t *dup, void *pargs)
+{
+    struct radix_node_head *heads[2];
+    struct radix_node *rn;
+    persist_t *ps;
+    ptprep_t prep;
+    uint8_t *key;
+    int mlen;
+
+    if (t == NULL) return 0;
+
+    if (! enable) {
+        if ((ps = t->persist) == NULL) return 1;
+        t->persist = NULL;
+        pt_unref(ps->root[0], ps->purge, pargs);
+        pt_unref(ps->root[1], ps->purge, pargs);
+        free(ps);
+        return 1;
+    }
+
+    if (t->persist) return 1;
+    if ((ps = calloc(1, sizeof(*ps))) == NULL) return 0;
+    ps->dup = dup;
+    ps->purge = dup ? t->purge : NULL;
+    t->persist = ps;
+
+    heads[0] = t->head4, heads[1] = t->head6;
+    for (int i = 0; i < 2; i++)
+        for (rn = rdx_firstleaf(&heads[i]->rh); rn; rn = rdx_nextleaf(rn)) {
+            if (rn->rn_flags & IPTF_DELETE) continue;
+            key = (uint8_t *)rn->rn_key;
+            mlen = key_masklen(rn->rn_mask);
+            if (! pt_prep(t, &prep, key, mlen, ((entry_t *)rn)->value, 1,
+                          pargs)) {
+                tbl_persist(t, 0, NULL, pargs);
+                return 0;
+            }
+            pt_apply(t, &prep, key, mlen, pargs);
+        }
+
+    return 1;
+}
+
+/* ### `tbl_snapshot`
+ * ```c
+ *   snap_t *tbl_snapshot(table_t *t);
+ * ```
+ * Take a snapshot of table `t`, which must have its persistent tree enabled
+ * (see [`tbl_persist`](### `tbl_persist`)).  This takes constant time: the
+ * snapshot refers to the current roots of the tree, whose nodes are never
+ * modified while shared.  Later changes of `t` are not seen by the
+ * snapshot, which stays valid even after `t` is destroyed.  Use
+ * [`snp_destroy`](### `snp_destroy`) to release it.
+ * - returns the snapshot on success, NULL on failure
+ */
+
+snap_t *
+tbl_snapshot(table_t *t)
+{
+    snap_t *s;
+
+    if (t == NULL || t->persist == NULL) return NULL;
+    if ((s = malloc(sizeof(*s))) == NULL) return NULL;
+
+    for (int i = 0; i < 2; i++)
+        if ((s->root[i] = t->persist->root[i]))
+            s->root[i]->refs++;
+    s->count4 = t->count4;
+    s->count6 = t->count6;
+    s->purge = t->persist->purge;
+
+    return s;
+}
+
+/* ### `tbl_gc`
+ * ```c
+ *   int tbl_gc(table_t *t, void *pargs);
+ * ```
+ * Remove all entries flagged for deletion from both radix trees (and the
+ * index, if any).  `pargs` is passed on to the table's purge callback.  Does
+ * nothing while `t->itr_lock` is non-zero, since iterators may still refer
+ * to flagged entries.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_gc(table_t *t, void *pargs)
+{
+    struct radix_node *rn, *nxt;
+    purge_t args;
+    struct radix_node_head *heads[2];
+
+    if (t == NULL || t->itr_lock) return 0;
+
+    args.purge = t->purge;
+    args.args = pargs;
+    args.tbl = t;
+    heads[0] = t->head4, heads[1] = t->head6;
+
+    for (int i = 0; i < 2; i++) {
+        args.head = heads[i];
+        for (rn = rdx_firstleaf(&heads[i]->rh); rn; rn = nxt) {
+            nxt = rdx_nextleaf(rn);
+            if (!(rn->rn_flags & IPTF_DELETE)) continue;
+            if (t->index)
+                hx_del(t->index, (uint8_t *)rn->rn_key,
+                       key_masklen(rn->rn_mask));
+            rdx_flush(rn, &args);
+        }
+    }
+
+    /* nothing left to flush, so any sweep in progress is done as well */
+    t->ndel = 0;
+    t->gcaf = 0;
+    t->gcnext = NULL;
+
+    return 1;
+}
+
+/* ### `tbl_gcstep`
+ * ```c
+ *   int tbl_gcstep(table_t *t, void *pargs, size_t n);
+ * ```
+ * Incremental version of `tbl_gc`, which visits at most `n` leaves per call
+ * (0 means no limit) and removes those flagged for deletion.  The sweep
+ * resumes where the previous call left off, so a host can spread the work
+ * over many calls and keep each one short.  The table may be modified in
+ * between calls: prefixes deleted ahead of the sweep move it along, prefixes
+ * added behind it are simply not visited.  Like `tbl_gc`, it does nothing
+ * while `t->itr_lock` is non-zero.
+ * - returns 1 if there is work left, 0 if all flagged entries are gone
+ */
+
+int
+tbl_gcstep(table_t *t, void *pargs, size_t n)
+{
+    struct radix_node *rn;
+    purge_t args;
+
+    if (t == NULL) return 0;
+    if (t->ndel == 0 && t->gcaf == 0) return 0;
+    if (t->itr_lock) return 1;
+
+    args.purge = t->purge;
+    args.args = pargs;
+    args.tbl = t;
+
+    if (t->gcaf == 0) {
+        t->gcaf = AF_INET;
+        t->gcnext = rdx_firstleaf(&t->head4->rh);
+    }
+
+    for (size_t i = 0; n == 0 || i < n; i++) {
+        if ((rn = t->gcnext) == NULL) {
+            if (t->gcaf == AF_INET6) {
+                t->gcaf = 0;
+                break;
+            }
+            t->gcaf = AF_INET6;
+            t->gcnext = rdx_firstleaf(&t->head6->rh);
+            continue;
+        }
+        t->gcnext = rdx_nextleaf(rn);
+        if (!(rn->rn_flags & IPTF_DELETE)) continue;
+        if (t->index)
+            hx_del(t->index, (uint8_t *)rn->rn_key, key_masklen(rn->rn_mask));
+        args.head = t->gcaf == AF_INET ? t->head4 : t->head6;
+        rdx_flush(rn, &args);
+        t->ndel--;
+    }
+
+    /* entries flagged behind the sweep need another one */
+    return t->gcaf != 0 || t->ndel > 0;
+}
+
+/* ### `tbl_addpath`
+ * ```c
+ *   int tbl_addpath(table_t *t, const char *s, void *v, uint32_t weight);
+ * ```
+ * Add a path with value `v` and `weight` to the multipath set of prefix `s`,
+ * which must already be present in the table.  A `weight` of 0 counts as 1.
+ * The radix tree itself is not modified, the change is journaled as a
+ * `JRNL_SET` of the prefix.  Paths are not part of the persistent tree, so
+ * snapshots do not see them.
+ * - returns 1 on success, 0 on failure in which case the caller still owns `v`
+ */
+
+int
+tbl_addpath(table_t *t, const char *s, void *v, uint32_t weight)
+{
+    entry_t *e;
+
+    tr_str(t, TRC_ADDPATH, s);
+    if ((e = tb_get(t, s)) == NULL) return 0;
+
+    if (! mp_add(&e->mpath, v, weight)) return 0;
+    jr_path(t, e);
+
+    return 1;
+}
+
+/* ### `tbl_delpath`
+ * ```c
+ *   int tbl_delpath(table_t *t, const char *s, size_t idx, void *pargs);
+ * ```
+ * Remove the path at index `idx` from the multipath set of prefix `s` and
+ * purge its value.  The remaining paths keep their relative order.  Like
+ * [`tbl_addpath`](### `tbl_addpath`), the change is journaled as a `JRNL_SET`
+ * of the prefix.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tbl_delpath(table_t *t, const char *s, size_t idx, void *pargs)
+{
+    entry_t *e;
+
+    tr_str(t, TRC_DELPATH, s);
+    if ((e = tb_get(t, s)) == NULL) return 0;
+
+    if (! mp_del(&e->mpath, idx, t->purge, pargs)) return 0;
+    jr_path(t, e);
+
+    return 1;
+}
+
+/* ### `tbl_select`
+ * ```c
+ *   void *tbl_select(table_t *t, const char *s, uint32_t hash);
+ * ```
+ * Do a longest prefix match for address `s` and, if the matching entry has
+ * a multipath set, return the value of the path selected by the flow `hash`.
+ * Otherwise, return the entry's value.
+ * - returns the selected value, or NULL if there is no match
+ */
+
+void *
+tbl_select(table_t *t, const char *s, uint32_t hash)
+{
+    uint8_t addr[MAX_BINKEY];
+    int mlen = -1, af = AF_UNSPEC;
+    entry_t *e;
+
+    if (t == NULL || s == NULL) return NULL;
+    if (! key_bystr(addr, &mlen, &af, s)) return NULL;
+    if ((e = tb_lpmkey(t, addr)) == NULL) return NULL;
+    if (e->mpath == NULL || e->mpath->count == 0) return e->value;
+
+    return mp_select(e->mpath, hash);
+}
+
+/* ### `tbl_lsm`
+ * ```c
+ *   struct radix_node *tbl_lsm(struct radix_node *rn);
+ * ```
+ * Given a leaf, find a less specific leaf or fail
+ * - used by tbl_lpm in case the match is flagged for deletion
+ */
+
+struct radix_node *
+tbl_lsm(struct radix_node *rn)
+{
+    /* less specific match for rn'n address and masklength */
+    struct radix_node *org_rn;
+    int rn_bit = rn->rn_bit;
+
+    if (rn == NULL) return NULL;
+    /* candidates are checked against rn's key, so it MUST be a leaf */
+    if (!RDX_ISLEAF(rn)) return NULL;
+
+    /* search less specific entries in dupedkey chain, if any */
+    for(org_rn = rn; rn; rn = rn->rn_dupedkey)
+        if ((rn->rn_flags & RNF_NORMAL)
+            && rn_bit < rn->rn_bit)
+            return rn;
+
+    /* go to parent of dupedchain */
+    for (rn = org_rn; RDX_ISLEAF(rn);)
+        rn = rn->rn_parent;
+
+    /* go up the tree, starting with the dupedchain's parent itself */
+    for (;; rn = rn->rn_parent) {
+
+        struct radix_mask *m;
+        struct radix_node *x;
+        m = rn->rn_mklist;
+        while (m) {
+            x = rn;
+            if (m->rm_flags & RNF_NORMAL) {
+                if (rn_bit <= m->rm_bit && !(m->rm_leaf->rn_flags & IPTF_DELETE))
+                    return (m->rm_leaf);
+            } else {
+                // off = min(rn->rn_offset, matched_off);
+                // x = rn_search_m(v, rn, m->rm_mask);
+                /* search w/ mask */
+                for(; x->rn_bit >= 0;) {
+                    if((x->rn_bmask & m->rm_mask[x->rn_offset]) &&
+                       (x->rn_bmask & org_rn->rn_key[x->rn_offset]))
+                        x = x->rn_right;
+                    else
+                        x = x->rn_left;
+                }
+                while (x && x->rn_mask != m->rm_mask)
+                    x = x->rn_dupedkey;
+                //if (x && rn_satisfies_leaf(v, x, off))
+                //    return (x);
+                if (x && !(x->rn_flags & IPTF_DELETE)
+                    && key_isin(org_rn->rn_key, x->rn_key, x->rn_mask))
+                    return x;
+            }
+            m = m->rm_mklist;
+        }
+
+        if (rn == rn->rn_parent || (rn->rn_flags & RNF_ROOT))
+            break;  /* treetop */
+    }
+
+    return NULL;
+}
+
+/* ### `tbl_span`
+ * ```c
+ *   static double tbl_span(table_t *t, uint8_t *addr, int mlen, int ulen,
+ *                          int first);
+ * ```
+ * Count the /`ulen` subnets of `addr`/`mlen` that overlap with one or more
+ * prefixes in the table.  If a less specific (or equal) prefix covers
+ * `addr`/`mlen`, all of its subnets are counted.  Otherwise, the leafs below
+ * `addr`/`mlen` are visited in key order and each one adds the subnets it
+ * touches which were not counted already.  Stops at the first overlap if
+ * `first` is true.
+ * - returns the count, or -1 on errors
+ */
+
+static double
+tbl_span(table_t *t, uint8_t *addr, int mlen, int ulen, int first)
+{
+    struct radix_node_head *head = NULL;
+    struct radix_node *rn;
+    uint8_t net[MAX_BINKEY], mask[MAX_BINKEY], bcast[MAX_BINKEY];
+    uint64_t s[2], e[2], last[2] = {0, 0};
+    int af, nbytes, seen = 0;
+    double count = 0.0;
+
+    if (t == NULL || addr == NULL) return -1;
+
+    af = KEY_AF_FAM(addr);
+    if (af == AF_INET) head = t->head4;
+    else if (af == AF_INET6) head = t->head6;
+    else return -1;
+
+    if (mlen < 0 || ulen < mlen || ulen > MAX_MASKLEN(af)) return -1;
+    if (! key_bylen(mask, mlen, af)) return -1;
+    memcpy(net, addr, IPT_KEYLEN(addr));
+    if (! key_network(net, mask)) return -1;
+
+    /* a less specific prefix covers all subnets */
+    rn = (struct radix_node *)tb_lpmkey(t, net);
+    while (rn && ((rn->rn_flags & IPTF_DELETE)
+                  || key_masklen(rn->rn_mask) > mlen))
+        rn = tbl_lsm(rn);
+    if (rn) {
+        if (first) return 1;
+        for (count = 1.0, ulen -= mlen; ulen > 0; ulen--)
+            count *= 2;
+        return count;
+    }
+
+    /* below this node, all keys share the first mlen bits */
+    for (rn = head->rh.rnh_treetop;
+         !RDX_ISLEAF(rn) && rn->rn_bit < IPT_KEYOFFSET + mlen;)
+        if (net[rn->rn_offset] & rn->rn_bmask)
+            rn = rn->rn_right;
+        else
+            rn = rn->rn_left;
+    while (!RDX_ISLEAF(rn))
+        rn = rn->rn_left;
+
+    nbytes = KEY_LEN_FAM(af) - 1;
+    for (; rn; rn = rdx_nextleaf(rn)) {
+        if (RDX_ISROOT(rn))
+            continue;
+        if (! key_isin(net, rn->rn_key, mask))
+            break;
+        if (rn->rn_flags & IPTF_DELETE)
+            continue;
+
+        memcpy(bcast, rn->rn_key, IPT_KEYLEN(rn->rn_key));
+        key_broadcast(bcast, rn->rn_mask);
+        kw_load(s, (uint8_t *)rn->rn_key + 1, nbytes);
+        kw_load(e, bcast + 1, nbytes);
+        kw_unit(s, ulen);
+        kw_unit(e, ulen);
+
+        if (seen) {
+            /* skip subnets already counted */
+            if (e[0] < last[0] || (e[0] == last[0] && e[1] <= last[1]))
+                continue;
+            if (s[0] < last[0] || (s[0] == last[0] && s[1] <= last[1])) {
+                s[1] = last[1] + 1;
+                s[0] = last[0] + (s[1] == 0);
+            }
+        }
+        count += (double)(e[0] - s[0] - (e[1] < s[1])) * 18446744073709551616.0
+                 + (double)(e[1] - s[1]) + 1;
+        last[0] = e[0];
+        last[1] = e[1];
+        seen = 1;
+        if (first) break;
+    }
+
+    return count;
+}
+
+/* ### `tbl_covered`
+ * ```c
+ *   double tbl_covered(table_t *t, uint8_t *addr, int mlen, int ulen);
+ * ```
+ * Return the number of /`ulen` subnets of prefix `addr`/`mlen` that overlap
+ * with at least one prefix in the table, without enumerating those subnets.
+ * Use `ulen` equal to the AF's max mask to count host addresses.  The count is
+ * a double, since an ipv6 prefix has up to 2^128 subnets.
+ * - returns -1 if `mlen` or `ulen` are invalid for `addr`'s AF family
+ */
+
+double
+tbl_covered(table_t *t, uint8_t *addr, int mlen, int ulen)
+{
+    return tbl_span(t, addr, mlen, ulen, 0);
+}
+
+/* ### `tbl_overlaps`
+ * ```c
+ *   int tbl_overlaps(table_t *t, uint8_t *addr, int mlen);
+ * ```
+ * Check whether prefix `addr`/`mlen` overlaps with any prefix in the table,
+ * i.e. is covered by a less specific or contains a more specific prefix.
+ * - returns 1 if it does, 0 otherwise
+ */
+
+int
+tbl_overlaps(table_t *t, uint8_t *addr, int mlen)
+{
+    return tbl_span(t, addr, mlen, mlen, 1) > 0;
+}
+
+/* ### `tbl_stackpush`
+ * ```c
+ *   int tbl_stackpush(table_t *t, int type, void *elm);
+ * ```
+ */
+
+int
+tbl_stackpush(table_t *t, int type, void *elm)
+{
+    // insert element into stack
+    stackElm_t *node = NULL;
+
+    if (t == NULL) return 0;     /* no table, no stack */
+    if (elm == NULL) return 0;   /* ignore NULL elements */
+
+    node = calloc(1, sizeof(stackElm_t));
+
+    if (! node) return 0;
+
+    node->type = type;
+    node->elm = elm;
+    node->next = t->top;
+    t->top = node;
+    t->size += 1;
+
+    return 1;
+}
+
+/* ### `tbl_stackpop`
+ * ```c
+ *   int tbl_stackpop(table_t *t);
+ * ```
+ */
+
+int
+tbl_stackpop(table_t *t)
+{
+    // pop & free top element
+    stackElm_t *node;
+
+    if (t == NULL) return 0;       /* no table, no stack */
+    if (t->top == NULL) return 0;  /* no stack, no pop */
+
+    node = t->top;
+    t->top = node->next;
+    free(node);
+
+    t->size -= 1;
+    if(t->top == NULL)  /* just in case somebody messed with the size */
+        t->size = 0;
+
+    return 1;
+}
+
+/* ## trace file functions
+ *
+ * ### `trc_header`
+ * ```c
+ *   int trc_header(FILE *fp, int *flags);
+ * ```
+ * Read and check the header of the trace file `fp`, written by
+ * [`tbl_record`](### `tbl_record`), and store its flags (e.g. `TRC_ANON`) in
+ * `*flags`, if not NULL.
+ * - returns 1 on success, 0 if it is not a trace file (of this version)
+ */
+
+int
+trc_header(FILE *fp, int *flags)
+{
+    uint8_t hdr[6];
+
+    if (fp == NULL) return 0;
+    if (fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) return 0;
+    if (memcmp(hdr, TRC_MAGIC, 4) != 0 || hdr[4] != TRC_VERSION) return 0;
+    if (flags) *flags = hdr[5];
+
+    return 1;
+}
+
+/* ### `trc_read`
+ * ```c
+ *   int trc_read(FILE *fp, trec_t *rec);
+ * ```
+ * Read the next record of trace file `fp`, whose header was read already by
+ * `trc_header`, into `rec`.
+ * - returns 1 if a record was read, 0 at the end of the file, -1 if the
+ *   record is invalid or truncated
+ */
+
+int
+trc_read(FILE *fp, trec_t *rec)
+{
+    int c;
+
+    if (fp == NULL || rec == NULL) return -1;
+    if ((c = fgetc(fp)) == EOF) return 0;
+
+    rec->op = (uint8_t)c;
+    rec->mlen = 255;
+    IPT_KEYLEN(rec->key) = 0;
+
+    switch (rec->op) {
+    case TRC_SET:
+    case TRC_DEL:
+    case TRC_GET:
+    case TRC_ADDPATH:
+    case TRC_DELPATH:
+        if ((c = fgetc(fp)) == EOF) return -1;
+        rec->mlen = (uint8_t)c;
+        /* fall through */
+    case TRC_LPM:
+        if ((c = fgetc(fp)) != IP4_KEYLEN && c != IP6_KEYLEN) return -1;
+        IPT_KEYLEN(rec->key) = (uint8_t)c;
+        if (fread(IPT_KEYPTR(rec->key), 1, c - 1, fp) != (size_t)(c - 1))
+            return -1;
+        return 1;
+    case TRC_ITR:
+    case TRC_NEXT:
+    case TRC_END:
+        return 1;
+    }
+
+    return -1;
+}
+
+/* ## multipath functions
+ *
+ * An entry's multipath set is an array of weighted paths, grown on demand.
+ * Path selection follows the Modulo-N hash (RFC2991) of the bundled
+ * `bsd/radix_mpath.c`: the flow hash modulo the total weight picks a path,
+ * so a flow always maps to the same path as long as the set is unchanged.
+ */
+
+/* ### `mp_add`
+ * ```c
+ *   int mp_add(mpath_t **mp, void *v, uint32_t weight);
+ * ```
+ * Append a path with value `v` and `weight` to the multipath set `*mp`, which
+ * is created if needed.  A `weight` of 0 counts as 1.
+ * - returns 1 on success, 0 on failure in which case the caller still owns `v`
+ */
+
+int
+mp_add(mpath_t **mp, void *v, uint32_t weight)
+{
+    mpath_t *new;
+    size_t size;
+
+    if (mp == NULL) return 0;
+
+    if (*mp == NULL || (*mp)->count == (*mp)->size) {
+        size = *mp ? 2 * (*mp)->size : 2;
+        new = realloc(*mp, sizeof(mpath_t) + size * sizeof(path_t));
+        if (new == NULL) return 0;
+        if (*mp == NULL) {
+            new->count = 0;
+            new->total = 0;
+        }
+        new->size = size;
+        *mp = new;
+    }
+
+    weight = weight ? weight : 1;
+    (*mp)->path[(*mp)->count].value = v;
+    (*mp)->path[(*mp)->count].weight = weight;
+    (*mp)->count++;
+    (*mp)->total += weight;
+
+    return 1;
+}
+
+/* ### `mp_del`
+ * ```c
+ *   int mp_del(mpath_t **mp, size_t idx, purge_f_t *purge, void *pargs);
+ * ```
+ * Remove the path at index `idx` from multipath set `*mp` and purge its value.
+ * The set is freed once its last path is removed.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+mp_del(mpath_t **mp, size_t idx, purge_f_t *purge, void *pargs)
+{
+    path_t *p;
+
+    if (mp == NULL || *mp == NULL || idx >= (*mp)->count) return 0;
+
+    p = (*mp)->path + idx;
+    (*mp)->total -= p->weight;
+    if (p->value && purge)
+        purge(pargs, &p->value);
+
+    (*mp)->count--;
+    memmove(p, p + 1, ((*mp)->count - idx) * sizeof(path_t));
+
+    if ((*mp)->count == 0) {
+        free(*mp);
+        *mp = NULL;
+    }
+
+    return 1;
+}
+
+/* ### `mp_destroy`
+ * ```c
+ *   int mp_destroy(mpath_t **mp, purge_f_t *purge, void *pargs);
+ * ```
+ * Purge the values of all paths in multipath set `*mp` and free the set.
+ * - returns 1 on success, 0 if there was no set to begin with
+ */
+
+int
+mp_destroy(mpath_t **mp, purge_f_t *purge, void *pargs)
+{
+    if (mp == NULL || *mp == NULL) return 0;
+
+    for (size_t i = 0; purge && i < (*mp)->count; i++)
+        if ((*mp)->path[i].value)
+            purge(pargs, &(*mp)->path[i].value);
+
+    free(*mp);
+    *mp = NULL;
+
+    return 1;
+}
+
+/* ### `mp_copy`
+ * ```c
+ *   int mp_copy(mpath_t **dst, mpath_t *src, dup_f_t *dup, void *dargs,
+ *               purge_f_t *purge);
+ * ```
+ * Add the paths of multipath set `src` to `*dst`, using `dup` (if not NULL)
+ * to copy their values.  On failure, paths already added to `*dst` are
+ * removed again and their (dup'd) values purged.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+mp_copy(mpath_t **dst, mpath_t *src, dup_f_t *dup, void *dargs,
+        purge_f_t *purge)
+{
+    void *v;
+
+    if (dst == NULL) return 0;
+    if (src == NULL) return 1;
+
+    for (size_t i = 0; i < src->count; i++) {
+        v = src->path[i].value;
+        if (dup && v && !(v = dup(dargs, v)))
+            goto fail;
+        if (! mp_add(dst, v, src->path[i].weight)) {
+            if (dup && v && purge)
+                purge(dargs, &v);
+            goto fail;
+        }
+    }
+
+    return 1;
+
+fail:
+    mp_destroy(dst, dup ? purge : NULL, dargs);
+    return 0;
+}
+
+/* ### `mp_select`
+ * ```c
+ *   void *mp_select(mpath_t *mp, uint32_t hash);
+ * ```
+ * Select a path using the flow `hash`, each path receiving a share of all
+ * hashes proportional to its weight.
+ * - returns the selected path's value, NULL if the set is empty
+ */
+
+void *
+mp_select(mpath_t *mp, uint32_t hash)
+{
+    uint64_t weight;
+    size_t i;
+
+    if (mp == NULL || mp->count == 0) return NULL;
+
+    weight = hash % mp->total;
+    for (i = 0; weight >= mp->path[i].weight; i++)
+        weight -= mp->path[i].weight;
+
+    return mp->path[i].value;
+}
+
+/* ## snapshot functions
+ *
+ * A snapshot is read through its own persistent trees, so it needs none of
+ * the table's radix trees, caches or indices.  Nothing in a snapshot is ever
+ * modified, so multiple threads may read the same snapshot.
+ */
+
+/* ### `snp_get`
+ * ```c
+ *   ptnode_t *snp_get(snap_t *s, uint8_t *key, int mlen);
+ * ```
+ * Get an exact match for prefix `key/mlen` in snapshot `s`.  A `mlen` of -1
+ * means AF's max mask.  Bits of `key` beyond `mlen` are ignored.
+ * - returns the matching node, or NULL if not found
+ */
+
+ptnode_t *
+snp_get(snap_t *s, uint8_t *key, int mlen)
+{
+    ptnode_t *n;
+    int af;
+
+    if (s == NULL || key == NULL) return NULL;
+    af = KEY_AF_FAM(key);
+    if (AF_UNKNOWN(af)) return NULL;
+    if (mlen < 0) mlen = MAX_MASKLEN(af);
+    if (mlen > MAX_MASKLEN(af)) return NULL;
+
+    for (n = s->root[af == AF_INET6]; n && n->mlen <= mlen;
+         n = n->child[pt_bit(key, n->mlen)]) {
+        if (pt_common(n->key, key, n->mlen) < n->mlen) break;
+        if (n->mlen == mlen) return n->val ? n : NULL;
+    }
+
+    return NULL;
+}
+
+/* ### `snp_lpm`
+ * ```c
+ *   ptnode_t *snp_lpm(snap_t *s, uint8_t *addr);
+ * ```
+ * Do a longest prefix match for binary address `addr` in snapshot `s`.
+ * - returns the matching node, or NULL if not found
+ */
+
+ptnode_t *
+snp_lpm(snap_t *s, uint8_t *addr)
+{
+    ptnode_t *n, *best = NULL;
+    int af;
+
+    if (s == NULL || addr == NULL) return NULL;
+    af = KEY_AF_FAM(addr);
+    if (AF_UNKNOWN(af)) return NULL;
+
+    for (n = s->root[af == AF_INET6]; n; n = n->child[pt_bit(addr, n->mlen)]) {
+        if (pt_common(n->key, addr, n->mlen) < n->mlen) break;
+        if (n->val) best = n;
+        if (n->mlen == MAX_MASKLEN(af)) break;
+    }
+
+    return best;
+}
+
+/* ### `snp_first`
+ * ```c
+ *   ptnode_t *snp_first(snap_t *s, snpitr_t *itr);
+ * ```
+ * Start a walk across all prefixes of snapshot `s`, using `itr` to keep
+ * track of where it is.  Prefixes are visited in key order, ipv4 before
+ * ipv6, and a prefix comes before the more specifics it covers.
+ * - returns the first node, or NULL if the snapshot is empty
+ */
+
+ptnode_t *
+snp_first(snap_t *s, snpitr_t *itr)
+{
+    if (s == NULL || itr == NULL) return NULL;
+
+    itr->s = s;
+    itr->af = 0;
+    itr->top = 0;
+    if (s->root[0])
+        itr->stack[itr->top++] = s->root[0];
+
+    return snp_next(itr);
+}
+
+/* ### `snp_next`
+ * ```c
+ *   ptnode_t *snp_next(snpitr_t *itr);
+ * ```
+ * Continue a walk started by `snp_first`.
+ * - returns the next node, or NULL when done
+ */
+
+ptnode_t *
+snp_next(snpitr_t *itr)
+{
+    ptnode_t *n;
+
+    if (itr == NULL || itr->s == NULL) return NULL;
+
+    for (;;) {
+        while (itr->top > 0) {
+            n = itr->stack[--itr->top];
+            if (n->child[1]) itr->stack[itr->top++] = n->child[1];
+            if (n->child[0]) itr->stack[itr->top++] = n->child[0];
+            if (n->val) return n;
+        }
+        if (itr->af) return NULL;
+        itr->af = 1;
+        if (itr->s->root[1])
+            itr->stack[itr->top++] = itr->s->root[1];
+    }
+}
+
+/* ### `snp_destroy`
+ * ```c
+ *   int snp_destroy(snap_t **s, void *pargs);
+ * ```
+ * Release snapshot `*s`.  Nodes and values no longer referred to by the
+ * table or another snapshot are freed, `pargs` is passed on to the purge
+ * function.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+snp_destroy(snap_t **s, void *pargs)
+{
+    if (s == NULL || *s == NULL) return 0;
+
+    pt_unref((*s)->root[0], (*s)->purge, pargs);
+    pt_unref((*s)->root[1], (*s)->purge, pargs);
+    free(*s);
+    *s = NULL;
+
+    return 1;
+}
+
+/* ## range functions
+ *
+ * A range table maps disjoint, arbitrary address intervals to user data.  It
+ * complements the radix tree based table for datasets that come as start-stop
+ * ranges, rather than CIDR prefixes, which would otherwise need to be exploded
+ * into many prefixes first.  The intervals for each AF family are kept in an
+ * array sorted by their start address, so a point lookup is a binary search.
+ */
+
+/* ### `rng_ivls`
+ * ```c
+ *   static int rng_ivls(range_t *r, int af, interval_t ***ivl, size_t **cnt,
+ *                       size_t **size);
+ * ```
+ * Set pointers to the interval array, its counter and its allocated size for
+ * the given AF family.  Returns 1 on success, 0 for an unknown AF family.
+ */
+
+static int
+rng_ivls(range_t *r, int af, interval_t ***ivl, size_t **cnt, size_t **size)
+{
+    if (af == AF_INET) {
+        *ivl = &r->ivl4, *cnt = &r->count4, *size = &r->size4;
+    } else if (af == AF_INET6) {
+        *ivl = &r->ivl6, *cnt = &r->count6, *size = &r->size6;
+    } else
+        return 0;
+
+    return 1;
+}
+
+/* ### `rng_upper`
+ * ```c
+ *   static size_t rng_upper(interval_t *ivl, size_t cnt, uint8_t *addr);
+ * ```
+ * Binary search for the index of the first interval whose start address is
+ * larger than `addr`.  So the interval at index-1, if any, is the only one
+ * that might contain `addr`.
+ */
+
+static size_t
+rng_upper(interval_t *ivl, size_t cnt, uint8_t *addr)
+{
+    size_t lo = 0, hi = cnt, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (key_cmp(ivl[mid].start, addr) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* ### `rng_cmp`
+ * ```c
+ *   static int rng_cmp(const void *a, const void *b);
+ * ```
+ * qsort comparison of two intervals: ipv4 sorts before ipv6, after that
+ * intervals are sorted by their start address.
+ */
+
+static int
+rng_cmp(const void *a, const void *b)
+{
+    const interval_t *x = a, *y = b;
+
+    if (IPT_KEYLEN(x->start) != IPT_KEYLEN(y->start))
+        return IPT_KEYLEN(x->start) < IPT_KEYLEN(y->start) ? -1 : 1;
+
+    /* same LEN byte, so memcmp is a byte-wise unsigned key comparison */
+    return memcmp(x->start, y->start, IPT_KEYLEN(x->start));
+}
+
+/* ### `rng_merge`
+ * ```c
+ *   static interval_t *rng_merge(interval_t *a, size_t na, interval_t *b,
+ *                                size_t nb);
+ * ```
+ * Merge two sorted arrays of intervals into a newly allocated array of
+ * `na + nb` intervals.  Returns NULL if any two intervals overlap or if memory
+ * could not be allocated.  Neither `a` nor `b` are modified.
+ */
+
+static interval_t *
+rng_merge(interval_t *a, size_t na, interval_t *b, size_t nb)
+{
+    interval_t *m, *nxt, *last = NULL;
+    size_t i = 0, j = 0, k = 0;
+
+    if ((m = malloc((na + nb) * sizeof(interval_t))) == NULL)
+        return NULL;
+
+    while (i < na || j < nb) {
+        if (j >= nb || (i < na && key_cmp(a[i].start, b[j].start) <= 0))
+            nxt = a + i++;
+        else
+            nxt = b + j++;
+
+        if (last && key_cmp(last->stop, nxt->start) >= 0) {
+            free(m);
+            return NULL;    /* overlapping intervals */
+        }
+        m[k] = *nxt;
+        last = m + k++;
+    }
+
+    return m;
+}
+
+/* ### `rng_create`
+ * ```c
+ *   range_t *rng_create(purge_f_t *fp);
+ * ```
+ * Create a new, empty range table.  `fp` is called to free user data when an
+ * interval is deleted or replaced, or when the range table is destroyed.
+ */
+
+range_t *
+rng_create(purge_f_t *fp)
+{
+    range_t *rng = NULL;
+
+    /* calloc so all ptrs & counters are set to NULL/zero */
+    rng = calloc(sizeof(*rng), 1);
+    if (rng == NULL) return NULL;
+
+    rng->purge = fp;
+
+    return rng;
+}
+
+/* ### `rng_destroy`
+ * ```c
+ *   int rng_destroy(range_t **r, void *pargs);
+ * ```
+ * Destroy range table, free all resources owned by range table and user.
+ * - return 1 on success, 0 on failure
+ */
+
+int
+rng_destroy(range_t **r, void *pargs)
+{
+    if (r == NULL || *r == NULL) return 0;
+
+    if ((*r)->purge) {
+        for (size_t i = 0; i < (*r)->count4; i++)
+            if ((*r)->ivl4[i].value)
+                (*r)->purge(pargs, &(*r)->ivl4[i].value);
+        for (size_t i = 0; i < (*r)->count6; i++)
+            if ((*r)->ivl6[i].value)
+                (*r)->purge(pargs, &(*r)->ivl6[i].value);
+    }
+
+    free((*r)->ivl4);
+    free((*r)->ivl6);
+    free(*r);
+    *r = NULL;
+
+    return 1;
+}
+
+/* ### `rng_get`
+ * ```c
+ *   interval_t *rng_get(range_t *r, uint8_t *addr);
+ * ```
+ * Return the interval that contains address `addr`, NULL if there is none.
+ */
+
+interval_t *
+rng_get(range_t *r, uint8_t *addr)
+{
+    interval_t **ivl;
+    size_t *cnt, *size, idx;
+
+    if (r == NULL || addr == NULL) return NULL;
+    if (! rng_ivls(r, KEY_AF_FAM(addr), &ivl, &cnt, &size)) return NULL;
+
+    idx = rng_upper(*ivl, *cnt, addr);
+    if (idx == 0) return NULL;
+    if (key_cmp(addr, (*ivl)[idx-1].stop) > 0) return NULL;
+
+    return *ivl + idx - 1;
+}
+
+/* ### `rng_set`
+ * ```c
+ *   int rng_set(range_t *r, uint8_t *start, uint8_t *stop, void *v,
+ *               void *pargs);
+ * ```
+ * Store interval [`start`, `stop`] with value `v` in range table `r`.  If the
+ * exact same interval is already present, its value is purged and replaced
+ * by `v`.  An interval that overlaps one (or more) intervals already present
+ * is refused.
+ * - returns 1 on success, 0 on failure in which case the caller still owns `v`
+ */
+
+int
+rng_set(range_t *r, uint8_t *start, uint8_t *stop, void *v, void *pargs)
+{
+    interval_t **ivl, *e;
+    size_t *cnt, *size, idx, nsize;
+
+    if (r == NULL || start == NULL || stop == NULL) return 0;
+    if (KEY_AF_FAM(start) != KEY_AF_FAM(stop)) return 0;
+    if (! rng_ivls(r, KEY_AF_FAM(start), &ivl, &cnt, &size)) return 0;
+    if (key_cmp(start, stop) > 0) return 0;
+
+    idx = rng_upper(*ivl, *cnt, start);
+
+    if (idx > 0) {
+        e = *ivl + idx - 1;
+        if (key_cmp(e->start, start) == 0 && key_cmp(e->stop, stop) == 0) {
+            if (e->value && r->purge)
+                r->purge(pargs, &e->value);
+            e->value = v;
+            return 1;
+        }
+        if (key_cmp(e->stop, start) >= 0)
+            return 0;  /* overlaps with preceding interval */
+    }
+    if (idx < *cnt && key_cmp((*ivl)[idx].start, stop) <= 0)
+        return 0;      /* overlaps with next interval */
+
+    if (*cnt == *size) {
+        nsize = *size ? 2 * *size : 16;
+        if (!(e = realloc(*ivl, nsize * sizeof(interval_t)))) return 0;
+        *ivl = e;
+        *size = nsize;
+    }
+
+    e = *ivl + idx;
+    memmove(e + 1, e, (*cnt - idx) * sizeof(interval_t));
+    memcpy(e->start, start, IPT_KEYLEN(start));
+    memcpy(e->stop, stop, IPT_KEYLEN(stop));
+    e->value = v;
+    *cnt += 1;
+
+    return 1;
+}
+
+/* ### `rng_del`
+ * ```c
+ *   int rng_del(range_t *r, uint8_t *start, uint8_t *stop, void *pargs);
+ * ```
+ * Delete interval [`start`, `stop`] from range table `r`.  Deletion requires
+ * an exact match on both `start` and `stop`.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+rng_del(range_t *r, uint8_t *start, uint8_t *stop, void *pargs)
+{
+    interval_t **ivl, *e;
+    size_t *cnt, *size, idx;
+
+    if (r == NULL || start == NULL || stop == NULL) return 0;
+    if (! rng_ivls(r, KEY_AF_FAM(start), &ivl, &cnt, &size)) return 0;
+
+    idx = rng_upper(*ivl, *cnt, start);
+    if (idx == 0) return 0;
+
+    e = *ivl + idx - 1;
+    if (key_cmp(e->start, start) != 0 || key_cmp(e->stop, stop) != 0)
+        return 0;
+
+    if (e->value && r->purge)
+        r->purge(pargs, &e->value);
+    memmove(e, e + 1, (*cnt - idx) * sizeof(interval_t));
+    *cnt -= 1;
+
+    return 1;
+}
+
+/* ### `rng_load`
+ * ```c
+ *   int rng_load(range_t *r, interval_t *ivl, size_t n);
+ * ```
+ * Bulk load `n` intervals, ipv4 and/or ipv6, into range table `r`.  The array
+ * `ivl` is sorted in place and merged with the intervals already present in a
+ * single pass.  The load is all or nothing: if any interval is invalid or
+ * overlaps with another one, nothing is added.
+ * - returns 1 on success (values are then owned by `r`), 0 on failure
+ */
+
+int
+rng_load(range_t *r, interval_t *ivl, size_t n)
+{
+    interval_t *m4 = NULL, *m6 = NULL;
+    size_t n4;
+
+    if (r == NULL || (ivl == NULL && n > 0)) return 0;
+    if (n == 0) return 1;
+
+    for (size_t i = 0; i < n; i++) {
+        if (AF_UNKNOWN(KEY_AF_FAM(ivl[i].start))) return 0;
+        if (KEY_AF_FAM(ivl[i].start) != KEY_AF_FAM(ivl[i].stop)) return 0;
+        if (key_cmp(ivl[i].start, ivl[i].stop) > 0) return 0;
+    }
+
+    qsort(ivl, n, sizeof(interval_t), rng_cmp);
+    for (n4 = 0; n4 < n && KEY_IS_IP4(ivl[n4].start); n4++)
+        ;
+
+    /* merge into new arrays first, so failure leaves r untouched */
+    if (n4 > 0 && !(m4 = rng_merge(r->ivl4, r->count4, ivl, n4)))
+        return 0;
+    if (n > n4 && !(m6 = rng_merge(r->ivl6, r->count6, ivl + n4, n - n4))) {
+        free(m4);
+        return 0;
+    }
+
+    if (m4) {
+        free(r->ivl4);
+        r->ivl4 = m4;
+        r->count4 += n4;
+        r->size4 = r->count4;
+    }
+    if (m6) {
+        free(r->ivl6);
+        r->ivl6 = m6;
+        r->count6 += n - n4;
+        r->size6 = r->count6;
+    }
+
+    return 1;
+}
+
+/* ### `rng_bytbl`
+ * ```c
+ *   int rng_bytbl(range_t *r, table_t *t, dup_f_t *dup, void *dargs);
+ * ```
+ * Add the address space covered by table `t` to range table `r` as disjoint
+ * intervals, honoring longest prefix match semantics: e.g. 10.0.0.0/8 with a
+ * more specific 10.10.0.0/16 yields three intervals, two of which carry the
+ * value of the /8.  Since a value may end up in multiple intervals, `dup` is
+ * called to obtain the value for each interval.  If `dup` is NULL, values are
+ * shared which only makes sense if `r` has no purge function.  Adding
+ * intervals that overlap with those already present in `r` fails.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+rng_bytbl(range_t *r, table_t *t, dup_f_t *dup, void *dargs)
+{
+    struct radix_node_head *heads[2];
+    struct radix_node *rn;
+    interval_t *pfx = NULL, *ivl = NULL, tmp;
+    interval_t *stk[IP6_MAXMASK + 1];   /* at most 1 nesting per mask length */
+    uint8_t pos[MAX_BINKEY], hi[MAX_BINKEY];
+    size_t n = 0, m = 0, top, i, j;
+    int done, rv = 0;
+
+    if (r == NULL || t == NULL) return 0;
+
+    if (!(pfx = malloc((t->count4 + t->count6 + 1) * sizeof(interval_t))))
+        return 0;
+    /* flattening n nested prefixes yields at most 2n-1 intervals */
+    if (!(ivl = malloc((2 * (t->count4 + t->count6) + 1) * sizeof(interval_t)))) {
+        free(pfx);
+        return 0;
+    }
+
+    heads[0] = t->head4, heads[1] = t->head6;
+    for (int h = 0; h < 2; h++) {
+
+        /* collect prefixes as intervals, in key order */
+        n = 0;
+        for (rn = rdx_firstleaf(&heads[h]->rh); rn; rn = rdx_nextleaf(rn)) {
+            if (rn->rn_flags & IPTF_DELETE) continue;
+            memcpy(pfx[n].start, rn->rn_key, IPT_KEYLEN((uint8_t *)rn->rn_key));
+            memcpy(pfx[n].stop, rn->rn_key, IPT_KEYLEN((uint8_t *)rn->rn_key));
+            key_broadcast(pfx[n].stop, rn->rn_mask);
+            pfx[n++].value = ((entry_t *)rn)->value;
+        }
+
+        /* dupedkey chains run more specific first, reverse each run so a
+         * prefix always precedes the prefixes it contains */
+        for (i = 0; i < n; i = j) {
+            for (j = i + 1; j < n && key_cmp(pfx[i].start, pfx[j].start) == 0;)
+                j++;
+            for (size_t a = i, b = j - 1; a < b; a++, b--) {
+                tmp = pfx[a];
+                pfx[a] = pfx[b];
+                pfx[b] = tmp;
+            }
+        }
+
+        /* sweep: emit the parts of each prefix not covered by more
+         * specifics, using a stack of currently enclosing prefixes */
+        done = 0, top = 0;
+        for (i = 0; i <= n; i++) {
+            while (top > 0
+                   && (i == n || key_cmp(stk[top-1]->stop, pfx[i].start) < 0)) {
+                if (!done && key_cmp(pos, stk[top-1]->stop) <= 0) {
+                    memcpy(ivl[m].start, pos, IPT_KEYLEN(pos));
+                    memcpy(ivl[m].stop, stk[top-1]->stop, IPT_KEYLEN(pos));
+                    ivl[m++].value = stk[top-1]->value;
+                    memcpy(pos, stk[top-1]->stop, IPT_KEYLEN(pos));
+                    done = key_incr(pos, 1) ? 0 : 1;
+                }
+                top--;
+            }
+            if (i == n) break;
+
+            memcpy(hi, pfx[i].start, IPT_KEYLEN(pfx[i].start));
+            if (top > 0 && !done && key_decr(hi, 1)
+                && key_cmp(pos, hi) <= 0) {
+                memcpy(ivl[m].start, pos, IPT_KEYLEN(pos));
+                memcpy(ivl[m].stop, hi, IPT_KEYLEN(hi));
+                ivl[m++].value = stk[top-1]->value;
+            }
+            memcpy(pos, pfx[i].start, IPT_KEYLEN(pfx[i].start));
+            done = 0;
+            stk[top++] = pfx + i;
+        }
+    }
+
+    /* values for the new intervals */
+    for (i = 0; dup && i < m; i++) {
+        if (ivl[i].value && !(ivl[i].value = dup(dargs, ivl[i].value))) {
+            m = i;  /* purge only the ones that were dup'd */
+            goto done;
+        }
+    }
+
+    if (rng_load(r, ivl, m)) {
+        m = 0;      /* r now owns the values */
+        rv = 1;
+    }
+
+done:
+    for (i = 0; dup && r->purge && i < m; i++)
+        if (ivl[i].value)
+            r->purge(dargs, &ivl[i].value);
+    free(pfx);
+    free(ivl);
+
+    return rv;
+}
+
+/* ### `rng_totbl`
+ * ```c
+ *   int rng_totbl(range_t *r, table_t *t, dup_f_t *dup, void *dargs);
+ * ```
+ * Add all intervals in range table `r` to table `t` by splitting each
+ * interval into the smallest set of prefixes that cover it exactly.  Existing
+ * prefixes in `t` have their values replaced.  Since a value may end up with
+ * multiple prefixes, `dup` is called to obtain the value for each prefix.  If
+ * `dup` is NULL, values are shared which only makes sense if `t` has no purge
+ * function.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+rng_totbl(range_t *r, table_t *t, dup_f_t *dup, void *dargs)
+{
+    interval_t *ivl;
+    uint8_t addr[MAX_BINKEY], mask[MAX_BINKEY];
+    size_t cnt;
+    void *v;
+
+    if (r == NULL || t == NULL) return 0;
+
+    for (int h = 0; h < 2; h++) {
+        ivl = h ? r->ivl6 : r->ivl4;
+        cnt = h ? r->count6 : r->count4;
+
+        for (size_t i = 0; i < cnt; i++) {
+            memcpy(addr, ivl[i].start, IPT_KEYLEN(ivl[i].start));
+            for (;;) {
+                if (! key_byfit(mask, addr, ivl[i].stop)) return 0;
+                v = ivl[i].value;
+                if (dup && v && !(v = dup(dargs, v))) return 0;
+                if (! tbl_setkey(t, addr, key_masklen(mask), v, dargs)) {
+                    if (dup && v && t->purge)
+                        t->purge(dargs, &v);
+                    return 0;
+                }
+                if (! key_broadcast(addr, mask)) return 0;
+                if (key_cmp(addr, ivl[i].stop) >= 0) break;
+                key_incr(addr, 1);
+            }
+        }
+    }
 
     return 1;
 }
@@ -11,6 +11,8 @@
 #ifndef iptable_h
 #define iptable_h
 
+#include <stdio.h>           // FILE, used by the trace functions
+
 /* # iptable.h
  *
  * ## `#define's`
@@ -99,10 +101,14 @@
  *
  * `MAX_STRKEY`
  * : buffer size to hold both ipv4/ipv6 prefix/len strings
+ *
+ * `MAX_MASKLEN(af)`
+ * : the maximum mask length for given AF family
  */
 
 #define MAX_BINKEY IP6_KEYLEN
 #define MAX_STRKEY IP6_PFXSTRLEN
+#define MAX_MASKLEN(af) (af==AF_INET ? IP4_MAXMASK : IP6_MAXMASK)
 
 /* ### AF_x
  * `AF_UNKNOWN(f)`
@@ -139,6 +145,17 @@
 #define RDX_ISRCHILD(rn) (rn->rn_parent->rn_right == rn)
 #define RDX_MAX_KEYLEN    32
 
+/* ### HDR_x
+ * `HDR_SRC`
+ * : select the source address of a raw IP header, see `key_byhdr`
+ *
+ * `HDR_DST`
+ * : select the destination address of a raw IP header, see `key_byhdr`
+ */
+
+#define HDR_SRC 0
+#define HDR_DST 1
+
 /* ### RDX FLAG
  * `IPTF_DELETE`
  * : additional radix node flag to indicate node was deleted
@@ -176,18 +193,158 @@
 #define TRDX_MASK_HEAD 3
 #define TRDX_MASK 4
 
+/* ### Diff operations
+ * The differences between two tables reported by `tbl_diffnext` and
+ * `tbl_diff`:
+ * - `TDIFF_NONE` -- no more differences
+ * - `TDIFF_ADD` -- a prefix only present in the new table
+ * - `TDIFF_DEL` -- a prefix only present in the old table
+ * - `TDIFF_CHG` -- a prefix present in both, but with a different value
+ */
+
+#define TDIFF_NONE 0
+#define TDIFF_ADD 1
+#define TDIFF_DEL 2
+#define TDIFF_CHG 3
+
+/* ### Journal operations
+ * The operations recorded by a table's journal:
+ * - `JRNL_SET` -- a prefix was added, its value replaced or its paths changed
+ * - `JRNL_DEL` -- a prefix was deleted
+ */
+
+#define JRNL_SET 1
+#define JRNL_DEL 2
+
+/* ### Latency operations
+ * The operations timed by a table's latency histograms, see
+ * [`tbl_latency`](### `tbl_latency`):
+ * - `LAT_SET` -- `tbl_set` and `tbl_setkey`
+ * - `LAT_GET` -- `tbl_get`
+ * - `LAT_LPM` -- `tbl_lpm` and its variants, all of which use `tbl_lpmkey`
+ * - `LAT_DEL` -- `tbl_del`
+ * - `LAT_ITR` -- a single step of an iterator, timed by the host using
+ *   `tbl_latstart` and `tbl_latstop`
+ *
+ * Lookups the library or a host does internally, e.g. `tbl_select` or
+ * `tbl_rawget`, are not timed.  `LAT_NOPS` is the number of operations,
+ * `LAT_BUCKETS` the number of buckets per histogram.  Defining `IPT_NOSTATS` at compile time removes the
+ * instrumentation altogether and `tbl_latency` then always fails.
+ */
+
+#define LAT_SET 0
+#define LAT_GET 1
+#define LAT_LPM 2
+#define LAT_DEL 3
+#define LAT_ITR 4
+#define LAT_NOPS 5
+#define LAT_BUCKETS 252
+
+/* ### Trace operations
+ * The operations recorded by a table's recorder, see
+ * [`tbl_record`](### `tbl_record`):
+ * - `TRC_SET` -- `tbl_set` or `tbl_setkey`, with the key and mask length
+ * - `TRC_DEL` -- `tbl_del`, with the key and mask length
+ * - `TRC_GET` -- `tbl_get`, with the key and mask length
+ * - `TRC_LPM` -- `tbl_lpm` or one of its variants, with the address
+ * - `TRC_ITR` -- an iterator was started, recorded by the host
+ * - `TRC_NEXT` -- an iterator took a step, recorded by the host
+ * - `TRC_END` -- an iterator was finished, recorded by the host
+ * - `TRC_ADDPATH` -- `tbl_addpath`, with the key and mask length
+ * - `TRC_DELPATH` -- `tbl_delpath`, with the key and mask length
+ *
+ * Only operations asked for by the caller are recorded, not the lookups
+ * done internally by e.g. `tbl_select` or `tbl_covered`.  Path records
+ * carry neither the weight nor the index of the path.
+ *
+ * A trace file starts with the magic `TRC_MAGIC`, a version byte
+ * (`TRC_VERSION`) and a flags byte (`TRC_ANON` if its keys are anonymized),
+ * followed by the records.  A record is an op byte followed, for the set,
+ * del, get and path operations, by a mask length byte (255 for none) and the
+ * binary key or, for `TRC_LPM`, by just the binary key.  The iterator
+ * operations are a single byte.  `TRC_NOPS` is one more than the highest op.
+ */
+
+#define TRC_SET 1
+#define TRC_DEL 2
+#define TRC_GET 3
+#define TRC_LPM 4
+#define TRC_ITR 5
+#define TRC_NEXT 6
+#define TRC_END 7
+#define TRC_ADDPATH 8
+#define TRC_DELPATH 9
+#define TRC_NOPS 10
+
+#define TRC_MAGIC "IPTR"
+#define TRC_VERSION 1
+#define TRC_ANON 1
+
+/* ### `SHP_MAXLEN`
+ * The number of buckets of the histograms of a tree's shape, see
+ * [`shape_t`](### `shape_t`).  Depths and lengths beyond the last bucket
+ * are counted in the last bucket.
+ */
+
+#define SHP_MAXLEN 160
+
+/* ### `PT_MAXPATH`
+ * The maximum number of nodes on a path in a persistent tree, see
+ * [`ptnode_t`](### `ptnode_t`): one per prefix length (0..128) plus the
+ * (at most) 2 nodes added by a single insert.
+ */
+
+#define PT_MAXPATH (IP6_MAXMASK + 3)
+
 // taken from radix.c
 #define min(a, b) ((a) < (b) ? (a) : (b))
 
 /* ## Structures
  */
 
+/*
+ * ### `path_t`
+ * A path has 2 members:
+ *
+ * - `void *value`, which points to user data, e.g. a next-hop
+ * - `uint32_t weight`, the relative share of flows this path receives
+ */
+
+typedef struct path_t {
+    void *value;                    // user data, freed by purge_f_t callback
+    uint32_t weight;                // relative weight, at least 1
+} path_t;
+
+/*
+ * ### `mpath_t`
+ * A multipath set has the following members:
+ *
+ * - `size_t count`, the number of paths in use
+ * - `size_t size`, the number of paths allocated
+ * - `uint64_t total`, the sum of the weights of all paths
+ * - `path_t path[]`, the paths themselves
+ *
+ * An entry may hold a set of equal cost paths alongside its value, so a
+ * lookup can select one of them based on a flow hash without any help from
+ * the caller (see [`mp_select`](### `mp_select`)).  Adding or removing a path
+ * only touches this set, not the radix tree.
+ */
+
+typedef struct mpath_t {
+    size_t count;                   // paths in use
+    size_t size;                    // paths allocated
+    uint64_t total;                 // sum of path weights
+    path_t path[];                  // the paths
+} mpath_t;
+
 /*
  * ### `entry_t`
- * The type `entry_t` has 2 members:
+ * The type `entry_t` has 4 members:
  *
  * - `rn[2]`, an array of two radix nodes: a leaf & an internal node.
  * - `void *value`, which points to user data.
+ * - `mpath_t *mpath`, optional multipath set, NULL if there is none.
+ * - `uint8_t key[MAX_BINKEY]`, the binary key the leaf node refers to.
  *
  * The radix tree stores/retrieves pointers to `radix leaf nodes` using binary
  * keys. So a user data structure must begin with an array of two radix nodes:
@@ -199,19 +356,262 @@
  * That pointer is then recast to `entry_t *` in order to access the user data
  * associated with the matched binary key in the tree via the `value` pointer.
  *
+ * The key the tree keeps for the entry lives in the entry itself, so a prefix
+ * takes a single allocation (see also [`eslab_t`](### `eslab_t`)).
  */
 
 typedef struct entry_t {
     struct radix_node rn[2];        // leaf & internal radix nodes
     void *value;                    // user data, freed by purge_f_t callback
+    mpath_t *mpath;                 // optional paths, freed along with entry
+    uint8_t key[MAX_BINKEY];        // the leaf's binary key
 } entry_t;
 
+/* ### `eslab_t`
+ * A block of entries reserved up front, see [`tbl_reserve`](### `tbl_reserve`):
+ * - `struct eslab_t *next`, the block reserved before this one, if any
+ * - `size_t size`, the number of entries in the block
+ * - `entry_t e[]`, the entries
+ *
+ * Unused entries of all blocks are kept on the table's free list, linked by
+ * their `value` pointer.  A deleted entry returns to the free list if it came
+ * from a block, so the blocks are only freed along with the table.
+ */
+
+typedef struct eslab_t {
+    struct eslab_t *next;           // block reserved before this one
+    size_t size;                    // number of entries
+    entry_t e[];
+} eslab_t;
+
+/* ### `lpmslot_t`
+ * A slot in the longest prefix match cache has members:
+ * - `uint64_t gen`, the table's generation when the slot was filled
+ * - `entry_t *entry`, the entry matched, NULL if there was no match
+ * - `uint8_t key[MAX_BINKEY]`, the binary address that was looked up
+ */
+
+typedef struct lpmslot_t {
+    uint64_t gen;                   // table generation at fill time
+    entry_t *entry;                 // cached match, NULL for no match
+    uint8_t key[MAX_BINKEY];        // binary address looked up
+} lpmslot_t;
+
+/* ### `lpmcache_t`
+ * An optional, direct-mapped cache of longest prefix match results with
+ * members:
+ * - `size_t size`, the number of slots, always a power of 2
+ * - `uint64_t hits`, number of lookups answered by the cache
+ * - `uint64_t misses`, number of lookups that needed a tree descent
+ * - `lpmslot_t slot[]`, the slots
+ *
+ * A slot is only valid if its generation equals that of its table.  Since
+ * the table's generation is bumped by every change to its set of prefixes,
+ * invalidating the whole cache is a single increment.
+ */
+
+typedef struct lpmcache_t {
+    size_t size;                    // number of slots, a power of 2
+    uint64_t hits;
+    uint64_t misses;
+    lpmslot_t slot[];
+} lpmcache_t;
+
+/* ### `hslot_t`
+ * A slot in the exact match hash index has members:
+ * - `uint32_t hash`, the hash of the slot's (network, masklen) pair
+ * - `int mlen`, the mask length of the entry
+ * - `entry_t *entry`, the indexed entry, NULL if the slot is free
+ *
+ * The network itself is not copied, it is the entry's radix key.
+ */
+
+typedef struct hslot_t {
+    uint32_t hash;                  // hash of (network, mlen)
+    int mlen;                       // mask length of entry
+    entry_t *entry;                 // indexed entry, NULL if free
+} hslot_t;
+
+/* ### `hindex_t`
+ * An optional open addressing hash index (linear probing) of all entries in
+ * both radix trees, keyed on the (af, network, masklen) of the prefix, with
+ * members:
+ * - `size_t size`, the number of slots, always a power of 2
+ * - `size_t count`, the number of slots in use
+ * - `hslot_t slot[]`, the slots
+ *
+ * Entries flagged for deletion stay in the index as long as they are in
+ * their radix tree, so the index always mirrors the trees exactly.
+ */
+
+typedef struct hindex_t {
+    size_t size;                    // number of slots, a power of 2
+    size_t count;                   // slots in use
+    hslot_t slot[];
+} hindex_t;
+
+/* ### `jrec_t`
+ * A journal record describes a single change of a table:
+ * - `uint64_t seq`, the sequence number of the change, the first is 1
+ * - `uint8_t key[MAX_BINKEY]`, the binary key of the prefix (its network)
+ * - `uint8_t mlen`, the mask length of the prefix
+ * - `uint8_t op`, either `JRNL_SET` or `JRNL_DEL`
+ *
+ * A record carries no value: by the time it is read, the value set may have
+ * been replaced and freed.  Consumers look up the prefix's current value.
+ */
+
+typedef struct jrec_t {
+    uint64_t seq;                   // sequence number of the change
+    uint8_t key[MAX_BINKEY];        // binary key of the prefix
+    uint8_t mlen;                   // mask length of the prefix
+    uint8_t op;                     // JRNL_SET or JRNL_DEL
+} jrec_t;
+
+/* ### `jrnl_f_t`
+ * A user callback, see [`tbl_subscribe`](### `tbl_subscribe`), called after
+ * each change recorded in a table's journal:
+ * ```c
+ *   typedef void jrnl_f_t(void *fargs, jrec_t *rec);
+ * ```
+ * It is called with the contextual argument given to `tbl_subscribe` and the
+ * record just added.  It must not modify the table.
+ */
+
+typedef void jrnl_f_t(void *, jrec_t *);  // user callback for changes
+
+/* ### `journal_t`
+ * An optional ring buffer of the most recent changes to a table, with
+ * members:
+ * - `size_t size`, the number of records, always a power of 2
+ * - `uint64_t seq`, the sequence number of the last change recorded
+ * - `uint64_t base`, the sequence number the journal started at
+ * - `jrnl_f_t *notify`, an optional subscriber callback
+ * - `void *nargs`, the contextual argument for `notify`
+ * - `jrec_t rec[]`, the records, change `seq` lives at `seq % size`
+ *
+ * The journal has no notion of consumers: each consumer keeps the sequence
+ * number of the last change it has seen and reads on from there (see
+ * [`tbl_jnext`](### `tbl_jnext`)).  A consumer that falls more than `size`
+ * changes behind has lost records and must resynchronize.
+ */
+
+typedef struct journal_t {
+    size_t size;                    // number of records, a power of 2
+    uint64_t seq;                   // sequence number of the last record
+    uint64_t base;                  // sequence number at creation
+    jrnl_f_t *notify;               // optional subscriber callback
+    void *nargs;                    // contextual argument for notify
+    jrec_t rec[];
+} journal_t;
+
+/* ### `latency_t`
+ * Optional per operation latency histograms of a table, with members:
+ * - `uint64_t mask`, an operation is timed if `(ops & mask) == 0`
+ * - `uint64_t ops[LAT_NOPS]`, the number of operations seen
+ * - `uint64_t samples[LAT_NOPS]`, the number of operations timed
+ * - `uint64_t sum[LAT_NOPS]`, the sum of the samples, in nanoseconds
+ * - `uint64_t max[LAT_NOPS]`, the slowest sample, in nanoseconds
+ * - `uint64_t hist[LAT_NOPS][LAT_BUCKETS]`, the histograms
+ *
+ * The buckets are log-linear: 4 per power of 2 so a bucket's width is at
+ * most a quarter of its lower bound.  Buckets 0..3 hold 0..3 nanoseconds,
+ * after that a sample `ns` with `b` significant bits goes into bucket
+ * `4 * (b - 2) + the 2 bits following the most significant one`.
+ */
+
+typedef struct latency_t {
+    uint64_t mask;                  // sample 1 in mask + 1 operations
+    uint64_t ops[LAT_NOPS];         // operations seen
+    uint64_t samples[LAT_NOPS];     // operations timed
+    uint64_t sum[LAT_NOPS];         // total time sampled, in ns
+    uint64_t max[LAT_NOPS];         // slowest sample, in ns
+    uint64_t hist[LAT_NOPS][LAT_BUCKETS];
+} latency_t;
+
+/* ### `trace_t`
+ * An optional recorder of the operations on a table, with members:
+ * - `FILE *fp`, the trace file being written
+ * - `uint64_t anon`, the secret for anonymizing keys, 0 for none
+ * - `uint64_t count`, the number of records written so far
+ * - `int err`, set when a write failed, after which nothing is recorded
+ */
+
+typedef struct trace_t {
+    FILE *fp;                       // trace file being written
+    uint64_t anon;                  // anonymization secret, 0 if none
+    uint64_t count;                 // records written
+    int err;                        // a write failed
+} trace_t;
+
+/* ### `trec_t`
+ * A record read back from a trace file by [`trc_read`](### `trc_read`):
+ * - `uint8_t op`, one of `TRC_SET` etc.
+ * - `uint8_t mlen`, the mask length, 255 if none or not applicable
+ * - `uint8_t key[MAX_BINKEY]`, the binary key, its LEN is 0 if there is none
+ */
+
+typedef struct trec_t {
+    uint8_t op;                     // TRC_xxx
+    uint8_t mlen;                   // mask length, 255 for none
+    uint8_t key[MAX_BINKEY];        // binary key, if any
+} trec_t;
+
+/* ### `shape_t`
+ * The shape of a table's radix tree, see [`tbl_shape`](### `tbl_shape`),
+ * with members:
+ * - `size_t entries`, the number of leafs holding a prefix
+ * - `size_t tombstones`, entries flagged for deletion, included above
+ * - `size_t internal`, the number of internal nodes
+ * - `size_t chains`, leaf positions, i.e. chains of dupedkey leafs
+ * - `size_t rmasks`, radix masks on the mask lists of internal nodes
+ * - `size_t masks`, the number of masks in the tree's mask tree
+ * - `size_t maxdepth`, the depth of the deepest entry
+ * - `size_t sumdepth`, the sum of the depths of all entries
+ * - `size_t maxchain`, the longest dupedkey chain
+ * - `size_t maxmklist`, the longest mask list
+ * - `size_t depth[SHP_MAXLEN]`, entries per depth
+ * - `size_t chain[SHP_MAXLEN]`, dupedkey chains per length
+ * - `size_t mklist[SHP_MAXLEN]`, internal nodes per mask list length
+ * - `size_t mem_entries`, bytes held by entries, which include the leafs
+ * - `size_t mem_rmasks`, bytes held by the radix masks
+ * - `size_t mem_masks`, bytes held by the mask tree
+ * - `size_t mem_paths`, bytes held by the entries' multipaths
+ * - `size_t mem_heads`, bytes held by the tree's heads
+ *
+ * The depth of an entry is the number of internal nodes visited on the way
+ * down from the top of the tree to its chain.  A lookup descends that far,
+ * walks the chain and, on the way back up, the mask lists it meets.
+ */
+
+typedef struct shape_t {
+    size_t entries;                 // leafs holding a prefix
+    size_t tombstones;              // entries flagged for deletion
+    size_t internal;                // internal nodes
+    size_t chains;                  // dupedkey chains
+    size_t rmasks;                  // radix masks on the mask lists
+    size_t masks;                   // masks in the mask tree
+    size_t maxdepth;                // depth of deepest entry
+    size_t sumdepth;                // sum of entry depths
+    size_t maxchain;                // longest dupedkey chain
+    size_t maxmklist;               // longest mask list
+    size_t depth[SHP_MAXLEN];       // entries per depth
+    size_t chain[SHP_MAXLEN];       // chains per length
+    size_t mklist[SHP_MAXLEN];      // internal nodes per mask list length
+    size_t mem_entries;             // bytes for entries
+    size_t mem_rmasks;              // bytes for radix masks
+    size_t mem_masks;               // bytes for the mask tree
+    size_t mem_paths;               // bytes for multipaths
+    size_t mem_heads;               // bytes for the heads
+} shape_t;
+
 /* ### `purge_t`
  * The type `purge_t` has the following members:
  *
  * - `struct radix_node_head *head`, the head of a radix tree
  * - `purge_f_t *purge`, a callback function pointer; to free user data
  * - `void *args`, an opague pointer to be interpreted by `purge`
+ * - `struct table_t *tbl`, the table the entries belong to, may be NULL
  *
  * This structure is used to relay contextual arguments to the user callback
  * function upon deletion time.  The different levels of memory ownership
@@ -249,12 +649,97 @@ typedef struct entry_t {
 
 typedef void purge_f_t(void *, void **); // user callback to free value
 
+/* ### `dup_f_t`
+ * A user callback used by [`tbl_clone`](### `tbl_clone`) to copy user data:
+ * ```c
+ *   typedef void *dup_f_t(void *dargs, void *value);
+ * ```
+ * It is called with the contextual argument given to `tbl_clone` and the
+ * `value` of an entry being cloned and should return the value to be stored
+ * in the new table, or NULL to signal failure.
+ */
+
+typedef void *dup_f_t(void *, void *);   // user callback to copy value
+
+/* ### `eq_f_t`
+ * A user callback used by [`tbl_diff`](### `tbl_diff`) to compare values:
+ * ```c
+ *   typedef int eq_f_t(void *eargs, void *a, void *b);
+ * ```
+ * It is called with a contextual argument and the values of a prefix present
+ * in both tables and should return non-zero if the values are equal.
+ */
+
+typedef int eq_f_t(void *, void *, void *);  // user callback to compare values
+
+/* ### `diff_f_t`
+ * A user callback used by [`tbl_diff`](### `tbl_diff`) to report a change:
+ * ```c
+ *   typedef int diff_f_t(void *dargs, int op, entry_t *a, entry_t *b);
+ * ```
+ * It is called with a contextual argument, the `TDIFF_x` operation and the
+ * old and new entries (`a` is NULL for an addition, `b` is NULL for a
+ * removal) and should return zero to stop the diff.
+ */
+
+typedef int diff_f_t(void *, int, entry_t *, entry_t *); // user diff callback
+
 typedef struct purge_t {            // args for rdx_flush
    struct radix_node_head *head;    // head of tree where rdx_flush operates
    purge_f_t *purge;                // the callback to free entry->value
    void *args;                      // extra args for the callback
+   struct table_t *tbl;             // table owning the entries, may be NULL
 } purge_t;
 
+/* ### `ptval_t`
+ * A value stored in a persistent tree, shared by all versions of the nodes
+ * that refer to it:
+ * - `size_t refs`, the number of nodes referring to it
+ * - `void *value`, the user data, usually a copy made by a `dup_f_t`
+ */
+
+typedef struct ptval_t {
+    size_t refs;                    // nodes referring to this value
+    void *value;                    // user data
+} ptval_t;
+
+/* ### `ptnode_t`
+ * A node of a persistent, path compressed binary trie:
+ * - `size_t refs`, the number of parents (or roots) referring to it
+ * - `ptval_t *val`, the prefix's value, NULL for a branching node
+ * - `struct ptnode_t *child[2]`, the subtrees, selected by the bit following
+ *   the node's prefix
+ * - `uint8_t mlen`, the prefix length of the node
+ * - `uint8_t key[MAX_BINKEY]`, the prefix's network address
+ *
+ * Nodes are never modified once shared (`refs` > 1).  A change copies the
+ * shared nodes on the path from the root down to where the change is made
+ * (path copying), so older roots keep seeing the tree as it was.  Nodes
+ * owned by a single parent are modified in place.
+ */
+
+typedef struct ptnode_t {
+    size_t refs;                    // parents or roots referring to node
+    ptval_t *val;                   // value if node is a prefix, else NULL
+    struct ptnode_t *child[2];      // subtrees, by bit after the prefix
+    uint8_t mlen;                   // prefix length
+    uint8_t key[MAX_BINKEY];        // network address of the prefix
+} ptnode_t;
+
+/* ### `persist_t`
+ * The optional persistent copy of a table's prefixes, see
+ * [`tbl_persist`](### `tbl_persist`):
+ * - `ptnode_t *root[2]`, the ipv4 resp. ipv6 persistent trees
+ * - `dup_f_t *dup`, copies a value into the trees, NULL to share it
+ * - `purge_f_t *purge`, frees the copies, NULL if values are shared
+ */
+
+typedef struct persist_t {
+    ptnode_t *root[2];              // ipv4 and ipv6 trees
+    dup_f_t *dup;                   // copies values, NULL shares them
+    purge_f_t *purge;               // frees copies, NULL if shared
+} persist_t;
+
 /* ### `stackElm_t`
  * A stack element has members:
  * - `int type`, denotes the type of this element
@@ -287,6 +772,20 @@ typedef struct stackElm_t {
  * - `int itr_lock`, indicates the presence of active iterators
  * - `stackElm_t *top`, the stack to iterate across all radix nodes in all trees
  * - `size_t size`, the current size of the of the stack
+ * - `uint64_t gen`, generation counter bumped by each change of prefixes
+ * - `lpmcache_t *cache`, optional cache for `tbl_lpm`, NULL if disabled
+ * - `hindex_t *index`, optional exact match index, NULL if disabled
+ * - `journal_t *journal`, optional change journal, NULL if disabled
+ * - `persist_t *persist`, optional persistent tree, NULL if disabled
+ * - `eslab_t *slab`, entries reserved up front, NULL if none
+ * - `entry_t *efree`, free list of reserved entries not in use
+ * - `size_t nfree`, the number of entries on the free list
+ * - `size_t ndel`, the number of entries flagged for deletion
+ * - `size_t gcslice`, leaves per step when flushing deletions, 0 if no limit
+ * - `int gcaf`, the tree being swept by `tbl_gcstep`, 0 if none
+ * - `struct radix_node *gcnext`, the next leaf to be visited by the sweep
+ * - `latency_t *lat`, optional latency histograms, NULL if disabled
+ * - `trace_t *trace`, optional operation recorder, NULL if disabled
  *
  * Two separate radix trees are used to store ipv4 resp. ipv6 binary keys.
  * Table operations detect the type of prefix used and access the corresponding
@@ -297,10 +796,25 @@ typedef struct stackElm_t {
  * The `itr_lock` is actually a Lua specific feature to track the presence of
  * any currently active tree iterators (there are a few).  This allows for
  * postponed radix node removal while some iterator is still traversing one of
- * the trees.
+ * the trees.  Flagged entries are removed in one go by
+ * [`tbl_gc`](### `tbl_gc`), or a slice at a time by
+ * [`tbl_gcstep`](### `tbl_gcstep`) whose sweep position is kept in `gcaf`
+ * and `gcnext`.
  *
- * Finally, the `*top` and `size` exist in order to be able to graph the
- * tree(s).
+ * The `*top` and `size` exist in order to be able to graph the tree(s).
+ *
+ * Finally, the `cache` is disabled by default.  When enabled (see
+ * [`tbl_cache`](### `tbl_cache`)) lookups write to it, so a table with a
+ * cache must not be shared by concurrent readers.  The `index`, also
+ * disabled by default (see [`tbl_hindex`](### `tbl_hindex`)), is only
+ * written to when prefixes are added or removed.  The same goes for the
+ * `journal` (see [`tbl_journal`](### `tbl_journal`)), which records the
+ * changes made to the table, and the `persist` tree (see
+ * [`tbl_persist`](### `tbl_persist`)) from which snapshots are taken.
+ * The latency histograms `lat` (see [`tbl_latency`](### `tbl_latency`))
+ * are updated by lookups as well, so the same caveat as for the cache
+ * applies.  That goes for the `trace` recorder too (see
+ * [`tbl_record`](### `tbl_record`)), which writes every operation to a file.
  *
  */
 
@@ -313,8 +827,121 @@ typedef struct table_t {
     int itr_lock;                   // count of currently active iterators
     stackElm_t *top;                // only used to iterate across radix nodes
     size_t size;                    // number of elms on the stack
+    uint64_t gen;                   // bumped on every change of prefixes
+    lpmcache_t *cache;              // optional lpm cache, NULL if disabled
+    hindex_t *index;                // optional exact index, NULL if disabled
+    journal_t *journal;             // optional change journal, NULL if disabled
+    persist_t *persist;             // optional persistent tree, NULL if disabled
+    eslab_t *slab;                  // reserved entries, NULL if none
+    entry_t *efree;                 // free list of reserved entries
+    size_t nfree;                   // entries on the free list
+    size_t ndel;                    // entries flagged for deletion
+    size_t gcslice;                 // leaves per gc step, 0 if unlimited
+    int gcaf;                       // tree being swept, 0 if none
+    struct radix_node *gcnext;      // next leaf to sweep
+    latency_t *lat;                 // optional histograms, NULL if disabled
+    trace_t *trace;                 // optional recorder, NULL if disabled
 } table_t;
 
+/* ### `diff_t`
+ * The state of an ordered merge of two tables, see `tbl_diffnext`:
+ * - `table_t *a`, the old table
+ * - `table_t *b`, the new table
+ * - `struct radix_node *ra, *rb`, the next leaf in `a` resp. `b` to compare
+ * - `int af`, the AF family of the trees being merged
+ * - `eq_f_t *eq`, value comparison, if NULL the value pointers are compared
+ * - `void *eargs`, the contextual argument for `eq`
+ *
+ * Both tables are walked in key order (and, for equal keys, from more to
+ * less specific), ipv4 before ipv6, so the merge takes a single pass.
+ */
+
+typedef struct diff_t {
+    table_t *a;                     // old table
+    table_t *b;                     // new table
+    struct radix_node *ra;          // next leaf in a, NULL if exhausted
+    struct radix_node *rb;          // next leaf in b, NULL if exhausted
+    int af;                         // AF_INET or AF_INET6
+    eq_f_t *eq;                     // value equality, NULL compares pointers
+    void *eargs;                    // contextual argument for eq
+} diff_t;
+
+/* ### `snap_t`
+ * An immutable view of a table, see [`tbl_snapshot`](### `tbl_snapshot`):
+ * - `ptnode_t *root[2]`, the ipv4 resp. ipv6 roots at the time it was taken
+ * - `size_t count4, count6`, the number of ipv4 resp. ipv6 prefixes
+ * - `purge_f_t *purge`, frees values copied into the trees, if any
+ *
+ * A snapshot holds a reference to both roots, which keeps the nodes alive no
+ * matter how the table changes afterwards.
+ */
+
+typedef struct snap_t {
+    ptnode_t *root[2];              // ipv4 and ipv6 roots
+    size_t count4;                  // number of ipv4 prefixes
+    size_t count6;                  // number of ipv6 prefixes
+    purge_f_t *purge;               // frees copied values, NULL if shared
+} snap_t;
+
+/* ### `snpitr_t`
+ * The state of a preorder walk across a snapshot, see `snp_first`:
+ * - `snap_t *s`, the snapshot being walked
+ * - `int af`, index of the root being walked, 0 for ipv4, 1 for ipv6
+ * - `int top`, the number of nodes on the stack
+ * - `ptnode_t *stack[PT_MAXPATH]`, the subtrees still to visit
+ */
+
+typedef struct snpitr_t {
+    snap_t *s;                      // snapshot being walked
+    int af;                         // 0 for ipv4, 1 for ipv6
+    int top;                        // nodes on the stack
+    ptnode_t *stack[PT_MAXPATH];    // subtrees to visit
+} snpitr_t;
+
+/* ### `interval_t`
+ * An interval has the following members:
+ * - `uint8_t start[MAX_BINKEY]`, binary key of the first address
+ * - `uint8_t stop[MAX_BINKEY]`, binary key of the last address
+ * - `void *value`, which points to user data
+ *
+ * Both `start` and `stop` are included in the interval and must belong to the
+ * same AF family.  Unlike a prefix, an interval need not be aligned on any
+ * CIDR boundary.
+ */
+
+typedef struct interval_t {
+    uint8_t start[MAX_BINKEY];      // first address in interval
+    uint8_t stop[MAX_BINKEY];       // last address in interval
+    void *value;                    // user data, freed by purge_f_t callback
+} interval_t;
+
+/* ### `range_t`
+ * A range table has the following members:
+ * - `interval_t *ivl4`, array of ipv4 intervals
+ * - `interval_t *ivl6`, array of ipv6 intervals
+ * - `size_t count4`, the number of ipv4 intervals stored
+ * - `size_t count6`, the number of ipv6 intervals stored
+ * - `size_t size4`, the number of ipv4 intervals allocated
+ * - `size_t size6`, the number of ipv6 intervals allocated
+ * - `purge_f_t *purge`, user callback for freeing user data
+ *
+ * A range table stores disjoint intervals of addresses, kept sorted on their
+ * `start` address so that a point lookup is a binary search.  Intervals are
+ * never split or merged: an interval overlapping one already stored is
+ * refused.  Bulk loading (see [`rng_load`](### `rng_load`)) sorts and merges
+ * in one go, which is far cheaper than adding intervals one at a time.
+ */
+
+typedef struct range_t {
+    interval_t *ivl4;               // ipv4 intervals, sorted by start
+    interval_t *ivl6;               // ipv6 intervals, sorted by start
+    size_t count4;
+    size_t count6;
+    size_t size4;                   // allocated ipv4 intervals
+    size_t size6;                   // allocated ipv6 intervals
+    purge_f_t *purge;               // callback to free userdata
+} range_t;
+
 
 // -- PROTOTYPES
 
@@ -335,7 +962,9 @@ uint8_t *key_byfit(uint8_t *m, uint8_t *a, uint8_t *b);
 uint8_t *key_bylen(uint8_t *, int, int);
 uint8_t *key_bynum(uint8_t *, size_t, int);
 uint8_t *key_bypair(uint8_t *, const void *, const void *);
+uint8_t *key_byhdr(uint8_t *, const uint8_t *, size_t, int);
 uint8_t *key_bystr(uint8_t *, int *, int *, const char *);
+uint8_t *key_bysockaddr(uint8_t *, const struct sockaddr *);
 uint8_t *key_decr(uint8_t *, size_t);
 uint8_t *key_incr(uint8_t *, size_t);
 uint8_t *key_ynp(uint8_t *, uint8_t *, int, int);
@@ -344,6 +973,16 @@ int key6_6to4(uint8_t *, uint8_t *);
 int key4_by6(uint8_t *, uint8_t *);
 int key_toredo(int, uint8_t *, uint8_t *, uint8_t *, int *, int *);
 
+// -- kref funcs (byte-wise reference versions of key funcs)
+
+int kref_broadcast(void *, void *);
+int kref_cmp(void *, void *);
+int kref_isin(void *, void *, void *);
+int kref_masklen(void *);
+int kref_network(void *, void *);
+uint8_t *kref_decr(uint8_t *, size_t);
+uint8_t *kref_incr(uint8_t *, size_t);
+
 uint8_t *key_alloc(int);
 uint8_t *key_copy(uint8_t *);
 
@@ -361,16 +1000,88 @@ int rdx_flush(struct radix_node *, void *);
 // -- tbl funcs
 
 table_t *tbl_create(purge_f_t *);
+table_t *tbl_clone(table_t *, dup_f_t *, void *);
+int tbl_reserve(table_t *, size_t);
+int tbl_compact(table_t *, size_t *, void *);
+int tbl_shape(table_t *, int, shape_t *);
 entry_t *tbl_get(table_t *, const char *);
+entry_t *tbl_rawget(table_t *, const char *);
 entry_t *tbl_lpm(table_t *, const char *);
+entry_t *tbl_lpmkey(table_t *, uint8_t *);
+entry_t *tbl_rawlpm(table_t *, uint8_t *);
+entry_t *tbl_lpmsa(table_t *, const struct sockaddr *);
+entry_t *tbl_lpmhdr(table_t *, const uint8_t *, size_t, int);
+size_t tbl_lpmhdrs(table_t *, const uint8_t **, const size_t *, size_t, size_t,
+                   int, entry_t **);
+int tbl_cache(table_t *, size_t);
+int tbl_hindex(table_t *, int);
+int tbl_match4(table_t *, int);
+int tbl_journal(table_t *, size_t);
+int tbl_subscribe(table_t *, jrnl_f_t *, void *);
+int tbl_jnext(table_t *, uint64_t *, jrec_t **);
+int tbl_latency(table_t *, size_t);
+uint64_t tbl_latq(table_t *, int, double);
+uint64_t tbl_latstart(table_t *, int);
+void tbl_latstop(table_t *, int, uint64_t);
+int tbl_record(table_t *, const char *, uint64_t);
+int tbl_trace(table_t *, int, uint8_t *, int);
+int tbl_persist(table_t *, int, dup_f_t *, void *);
+snap_t *tbl_snapshot(table_t *);
+int tbl_gc(table_t *, void *);
+int tbl_gcstep(table_t *, void *, size_t);
 struct radix_node *tbl_lsm(struct radix_node *);
+double tbl_covered(table_t *, uint8_t *, int, int);
+int tbl_overlaps(table_t *, uint8_t *, int);
 int tbl_set(table_t *, const char *, void *, void *);
+int tbl_setkey(table_t *, uint8_t *, int, void *, void *);
 int tbl_del(table_t *, const char *, void *);
 int tbl_destroy(table_t **, void *);
+int tbl_release(table_t *, void *);
+int tbl_destroystep(table_t **, void *, size_t);
+
+int tbl_addpath(table_t *, const char *, void *, uint32_t);
+int tbl_delpath(table_t *, const char *, size_t, void *);
+void *tbl_select(table_t *, const char *, uint32_t);
+
+int tbl_diffinit(diff_t *, table_t *, table_t *, eq_f_t *, void *);
+int tbl_diffnext(diff_t *, entry_t **, entry_t **);
+int tbl_diff(table_t *, table_t *, eq_f_t *, diff_f_t *, void *);
 
 int tbl_walk(table_t *, walktree_f_t *, void *);
 int tbl_stackpush(table_t *, int, void *);
 int tbl_stackpop(table_t *);
 
+// -- trc funcs
+
+int trc_header(FILE *, int *);
+int trc_read(FILE *, trec_t *);
+
+// -- mp funcs
+
+int mp_add(mpath_t **, void *, uint32_t);
+int mp_del(mpath_t **, size_t, purge_f_t *, void *);
+int mp_destroy(mpath_t **, purge_f_t *, void *);
+int mp_copy(mpath_t **, mpath_t *, dup_f_t *, void *, purge_f_t *);
+void *mp_select(mpath_t *, uint32_t);
+
+// -- snp funcs
+
+ptnode_t *snp_get(snap_t *, uint8_t *, int);
+ptnode_t *snp_lpm(snap_t *, uint8_t *);
+ptnode_t *snp_first(snap_t *, snpitr_t *);
+ptnode_t *snp_next(snpitr_t *);
+int snp_destroy(snap_t **, void *);
+
+// -- rng funcs
+
+range_t *rng_create(purge_f_t *);
+int rng_destroy(range_t **, void *);
+interval_t *rng_get(range_t *, uint8_t *);
+int rng_set(range_t *, uint8_t *, uint8_t *, void *, void *);
+int rng_del(range_t *, uint8_t *, uint8_t *, void *);
+int rng_load(range_t *, interval_t *, size_t);
+int rng_bytbl(range_t *, table_t *, dup_f_t *, void *);
+int rng_totbl(range_t *, table_t *, dup_f_t *, void *);
+
 
 #endif
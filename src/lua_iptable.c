@@ -9,6 +9,7 @@
 #include <arpa/inet.h>
 #include <string.h>
 #include <stdarg.h>
+#include <pthread.h>
 
 #include "lua.h"
 #include "lualib.h"
@@ -16,6 +17,8 @@
 
 #include "radix.h"
 #include "iptable.h"
+#include "bsl.h"
+#include "pool.h"
 #include "debug.h"
 
 #include "lua_iptable.h"
@@ -36,6 +39,38 @@ typedef struct itr_gc_t {
   table_t *t;
 } itr_gc_t;
 
+/*
+ * ### `grave_t`
+ *
+ * Where collected tables go when destroying them right away would take too
+ * long, one per Lua state, kept in the registry (see `iptm_gc`):
+ *
+ * - `table_t **tbl`, tables with a slice, destroyed by `iptable.step()`
+ * - `size_t count, size`, the number of parked tables and the array's size
+ * - `int background`, whether other tables go to the reaper thread
+ * - `int closed`, the state is closing so tables are destroyed right away
+ * - `table_t **queue`, released tables the reaper thread is to destroy
+ * - `size_t qcount, qsize`, the number of queued tables and the queue's size
+ * - `int running, stop`, whether the reaper runs resp. should stop
+ * - `pthread_t reaper`, `mtx` and `cv`, the reaper thread and its queue lock
+ *
+ * The reaper only ever sees released tables (see `tbl_release`), so it never
+ * calls back into Lua.
+ */
+
+typedef struct grave_t {
+  table_t **tbl;
+  size_t count, size;
+  int background;
+  int closed;
+  table_t **queue;
+  size_t qcount, qsize;
+  int running, stop;
+  pthread_t reaper;
+  pthread_mutex_t mtx;
+  pthread_cond_t cv;
+} grave_t;
+
 
 // library function called by Lua to initialize
 
@@ -47,11 +82,24 @@ static int lipt_error(lua_State *, int, int, const char *, ...);
 static int lipt_vferror(lua_State *, int, int, const char *, va_list);
 static table_t *iptL_gettable(lua_State *, int);
 static int iptL_getpfxstr(lua_State *, int, const char **, size_t *);
+static int iptL_getchunk(lua_State *, int, lua_Integer *);
+static void iptL_pushcount(lua_State *, double);
 static int *iptL_refpcreate(lua_State *);
+static int iptL_refreserve(lua_State *, lua_Integer);
 static void iptL_refpdelete(void *, void **);
+static void *iptL_refpdup(void *, void *);
 static int iptL_getaf(lua_State *L, int, int *);
+static int iptL_getaddr(lua_State *, int, uint8_t *);
+static range_t *iptL_getrange(lua_State *, int);
+static snap_t *iptL_getsnap(lua_State *, int);
 static int iptL_getbinkey(lua_State *, int, uint8_t *, size_t *);
+static int iptL_valeq(void *, void *, void *);
 static int ipt_itr_gc(lua_State *);
+static int ipt_pool_gc(lua_State *);
+static int ipt_grave_gc(lua_State *);
+static grave_t *iptL_getgrave(lua_State *);
+static int grave_push(table_t ***, size_t *, size_t *, table_t *);
+static void *grave_reaper(void *);
 static int iter_error(lua_State *, int, const char *, ...);
 static int iter_fail_f(lua_State *);
 
@@ -75,14 +123,17 @@ static int iter_hosts(lua_State *);
 static int iter_hosts_f(lua_State *);
 static int iter_interval(lua_State *);
 static int iter_interval_f(lua_State *);
+static int iter_intervals_f(lua_State *);
 static int iter_subnets(lua_State *);
 static int iter_subnets_f(lua_State *);
 
 // iptable module functions
 
 static int ipt_address(lua_State *);
+static int ipt_background(lua_State *);
 static int ipt_broadcast(lua_State *);
 static int ipt_dnsptr(lua_State *);
+static int ipt_hostcount(lua_State *);
 static int ipt_invert(lua_State *);
 static int ipt_properties(lua_State *);
 static int ipt_longhand(lua_State *);
@@ -92,15 +143,22 @@ static int ipt_neighbor(lua_State *L);
 static int ipt_network(lua_State *);
 static int ipt_new(lua_State *);
 static int ipt_offset(lua_State *);
+static int ipt_ranges(lua_State *);
 static int ipt_reverse(lua_State *);
 static int ipt_size(lua_State *);
 static int ipt_split(lua_State *);
+static int ipt_step(lua_State *);
+static int ipt_subnetcount(lua_State *);
 static int ipt_tobin(lua_State *);
 static int ipt_toredo(lua_State *);
 static int ipt_tostr(lua_State *);
 
 // iptable instance iterators
 
+static int iter_changes(lua_State *);
+static int iter_changes_f(lua_State *);
+static int iter_diff(lua_State *);
+static int iter_diff_f(lua_State *);
 static int iter_kv(lua_State *);
 static int iter_kv_f(lua_State *);
 static int iter_less(lua_State *);
@@ -116,19 +174,61 @@ static int iter_radixes(lua_State *);
 
 // iptable instance methods
 
+static int iptm_addpath(lua_State *);
+static int iptm_cache(lua_State *);
+static int iptm_clone(lua_State *);
+static int iptm_compact(lua_State *);
 static int iptm_counts(lua_State *);
+static int iptm_delpath(lua_State *);
 static int iptm_gc(lua_State *);
+static int iptm_hindex(lua_State *);
+static int iptm_journal(lua_State *);
 static int iptm_index(lua_State *);
 static int iptm_len(lua_State *);
+static int iptm_lookup(lua_State *);
 static int iptm_newindex(lua_State *);
+static int iptm_paths(lua_State *);
+static int iptm_record(lua_State *);
+static int iptm_select(lua_State *);
+static int iptm_snapshot(lua_State *);
+static int iptm_shape(lua_State *);
+static int iptm_slice(lua_State *);
+static int iptm_stats(lua_State *);
+static int iptm_step(lua_State *);
 static int iptm_tostring(lua_State *);
 
+// iprange instance methods
+
+static int iter_intervals(lua_State *);
+static int rngm_counts(lua_State *);
+static int rngm_find(lua_State *);
+static int rngm_gc(lua_State *);
+static int rngm_index(lua_State *);
+static int rngm_len(lua_State *);
+static int rngm_load(lua_State *);
+static int rngm_set(lua_State *);
+static int rngm_totable(lua_State *);
+static int rngm_tostring(lua_State *);
+
+// snapshot instance methods
+
+static int iter_snap(lua_State *);
+static int iter_snap_f(lua_State *);
+static int snpm_counts(lua_State *);
+static int snpm_gc(lua_State *);
+static int snpm_index(lua_State *);
+static int snpm_len(lua_State *);
+static int snpm_newindex(lua_State *);
+static int snpm_tostring(lua_State *);
+
 // iptable module function array
 
 static const struct luaL_Reg funcs [] = {
     {"address", ipt_address},
+    {"background", ipt_background},
     {"broadcast", ipt_broadcast},
     {"dnsptr", ipt_dnsptr},
+    {"hostcount", ipt_hostcount},
     {"hosts", iter_hosts},
     {"interval", iter_interval},
     {"invert", ipt_invert},
@@ -140,9 +240,12 @@ static const struct luaL_Reg funcs [] = {
     {"network", ipt_network},
     {"new", ipt_new},
     {"offset", ipt_offset},
+    {"ranges", ipt_ranges},
     {"reverse", ipt_reverse},
     {"size", ipt_size},
     {"split", ipt_split},
+    {"step", ipt_step},
+    {"subnetcount", ipt_subnetcount},
     {"subnets", iter_subnets},
     {"tobin", ipt_tobin},
     {"toredo", ipt_toredo},
@@ -159,7 +262,25 @@ static const struct luaL_Reg meths [] = {
     {"__len", iptm_len},
     {"__tostring", iptm_tostring},
     {"__pairs", iter_kv},
+    {"addpath", iptm_addpath},
+    {"cache", iptm_cache},
+    {"changes", iter_changes},
+    {"clone", iptm_clone},
+    {"compact", iptm_compact},
     {"counts", iptm_counts},
+    {"delpath", iptm_delpath},
+    {"diff", iter_diff},
+    {"hindex", iptm_hindex},
+    {"journal", iptm_journal},
+    {"lookup", iptm_lookup},
+    {"paths", iptm_paths},
+    {"record", iptm_record},
+    {"select", iptm_select},
+    {"snapshot", iptm_snapshot},
+    {"shape", iptm_shape},
+    {"slice", iptm_slice},
+    {"stats", iptm_stats},
+    {"step", iptm_step},
     {"masks", iter_masks},
     {"supernets", iter_supernets},
     {"more", iter_more},
@@ -168,6 +289,35 @@ static const struct luaL_Reg meths [] = {
     {NULL, NULL}
 };
 
+// iprange instance methods array
+
+static const struct luaL_Reg rmeths [] = {
+    {"__gc", rngm_gc},
+    {"__index", rngm_index},
+    {"__len", rngm_len},
+    {"__tostring", rngm_tostring},
+    {"counts", rngm_counts},
+    {"find", rngm_find},
+    {"intervals", iter_intervals},
+    {"load", rngm_load},
+    {"set", rngm_set},
+    {"totable", rngm_totable},
+    {NULL, NULL}
+};
+
+// snapshot instance methods array
+
+static const struct luaL_Reg smeths [] = {
+    {"__gc", snpm_gc},
+    {"__index", snpm_index},
+    {"__newindex", snpm_newindex},
+    {"__len", snpm_len},
+    {"__pairs", iter_snap},
+    {"__tostring", snpm_tostring},
+    {"counts", snpm_counts},
+    {NULL, NULL}
+};
+
 /*
  Special addresses used to check for properties, plus required masks
  See
@@ -242,6 +392,27 @@ luaopen_iptable (lua_State *L)
     lua_settable(L, -3);                    // [GC{}]
     lua_settop(L, 0);                       // []
 
+    /* LUA_IPT_POOL metatable */
+    luaL_newmetatable(L, LUA_IPT_POOL);     // [P{}]
+    lua_pushcfunction(L, ipt_pool_gc);      // [P{} f]
+    lua_setfield(L, -2, "__gc");            // [P{}]
+    lua_settop(L, 0);                       // []
+
+    /* LUA_IPT_GRAVE metatable and this state's graveyard */
+    if (luaL_newmetatable(L, LUA_IPT_GRAVE)) {  // [G{}]
+        grave_t *g;
+        lua_pushcfunction(L, ipt_grave_gc);     // [G{} f]
+        lua_setfield(L, -2, "__gc");            // [G{}]
+        g = lua_newuserdatauv(L, sizeof(grave_t), 0);  // [G{} g]
+        memset(g, 0, sizeof(*g));
+        pthread_mutex_init(&g->mtx, NULL);
+        pthread_cond_init(&g->cv, NULL);
+        lua_rotate(L, -2, 1);                   // [g G{}]
+        lua_setmetatable(L, -2);                // [g]
+        lua_setfield(L, LUA_REGISTRYINDEX, LUA_IPT_GRAVEYARD);  // []
+    }
+    lua_settop(L, 0);                       // []
+
     /* LUA_IPTABLE_ID metatable */
     luaL_newmetatable(L, LUA_IPTABLE_ID);   // [{} ]
     lua_pushvalue(L, -1);                   // [{}, {} ]
@@ -249,6 +420,16 @@ luaopen_iptable (lua_State *L)
     luaL_setfuncs(L, meths, 0);             // [{M, meths}]
     lua_settop(L, 0);                       // []
 
+    /* LUA_IPRANGE_ID metatable, its __index is a function */
+    luaL_newmetatable(L, LUA_IPRANGE_ID);   // [{}]
+    luaL_setfuncs(L, rmeths, 0);            // [{rmeths}]
+    lua_settop(L, 0);                       // []
+
+    /* LUA_IPT_SNAP metatable, its __index is a function */
+    luaL_newmetatable(L, LUA_IPT_SNAP);     // [{}]
+    luaL_setfuncs(L, smeths, 0);            // [{smeths}]
+    lua_settop(L, 0);                       // []
+
     /* IPTABLE libary table */
     luaL_newlibtable(L, funcs);
     luaL_setfuncs(L, funcs, 0);             // [{F}]
@@ -431,6 +612,74 @@ iptL_gettable(lua_State *L, int idx)
     return (table_t *)*t;
 }
 
+/*
+ * ### `iptL_getrange`
+ * ```c
+ * static range_t * iptL_getrange(lua_State *, int);
+ * ```
+ *
+ * Checks whether the stack value at the given index contains a userdata of
+ * type [`LUA_IPRANGE_ID`](### LUA_IPRANGE_ID) and returns a `range_t` pointer.
+ * Errors out to Lua if the stack value has the wrong type.
+ */
+
+static range_t *
+iptL_getrange(lua_State *L, int idx)
+{
+    dbg_stack("inc(.) <--");   // [.. r ..]
+
+    void **r = luaL_checkudata(L, idx, LUA_IPRANGE_ID);
+    luaL_argcheck(L, r != NULL, idx, "`iprange' expected");
+    return (range_t *)*r;
+}
+
+/*
+ * ### `iptL_getsnap`
+ * ```c
+ * static snap_t * iptL_getsnap(lua_State *, int);
+ * ```
+ *
+ * Checks whether the stack value at the given index contains a userdata of
+ * type [`LUA_IPT_SNAP`](### LUA_IPT_SNAP) and returns a `snap_t` pointer.
+ * Errors out to Lua if the stack value has the wrong type.
+ */
+
+static snap_t *
+iptL_getsnap(lua_State *L, int idx)
+{
+    dbg_stack("inc(.) <--");   // [.. s ..]
+
+    void **s = luaL_checkudata(L, idx, LUA_IPT_SNAP);
+    luaL_argcheck(L, s != NULL, idx, "`iptsnap' expected");
+    return (snap_t *)*s;
+}
+
+/*
+ * ### `iptL_getaddr`
+ * ```c
+ * static int iptL_getaddr(lua_State *L, int idx, uint8_t *addr);
+ * ```
+ *
+ * Convert the address string at given `idx` to a binary key in `addr`, which
+ * is assumed to be of size MAX_BINKEY.  A mask, if any, is ignored.
+ * Returns 1 on success, 0 on failure.
+ */
+
+static int
+iptL_getaddr(lua_State *L, int idx, uint8_t *addr)
+{
+    const char *pfx = NULL;
+    size_t len = 0;
+    int mlen = -1, af = AF_UNSPEC;
+
+    if (! iptL_getpfxstr(L, idx, &pfx, &len))
+        return 0;
+    if (! key_bystr(addr, &mlen, &af, pfx))
+        return 0;
+
+    return 1;
+}
+
 /*
  * ### `iptL_getaf`
  * ```c
@@ -505,6 +754,44 @@ iptL_getbinkey(lua_State *L, int idx, uint8_t *buf, size_t *len)
     return 1;
 }
 
+/*
+ * ### `iptL_valeq`
+ * ```c
+ * static int iptL_valeq(void *L, void *a, void *b);
+ * ```
+ *
+ * The `eq_f_t` callback used by `iter_diff_f` to compare the values of a
+ * prefix present in both tables.  The values are the registry references of
+ * the Lua values.  If the iterator has a user supplied function (its 3rd
+ * upvalue), it is called with both values and its result decides, otherwise
+ * the values are compared using Lua's `==`.  Since the callback runs while
+ * `iter_diff_f` is running, its upvalues are still accessible.
+ * Returns 1 if the values are equal, 0 otherwise.
+ */
+
+static int
+iptL_valeq(void *eargs, void *a, void *b)
+{
+    lua_State *L = eargs;
+    int eq;
+
+    if (lua_isfunction(L, lua_upvalueindex(3))) {
+        lua_pushvalue(L, lua_upvalueindex(3));      // [.. f]
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)a);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)b);
+        lua_call(L, 2, 1);                          // [.. eq]
+        eq = lua_toboolean(L, -1);
+        lua_pop(L, 1);
+    } else {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)a);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)b);
+        eq = lua_compare(L, -2, -1, LUA_OPEQ);
+        lua_pop(L, 2);
+    }
+
+    return eq;
+}
+
 
 /*
  * ### `iptL_getpfxstr`
@@ -530,6 +817,50 @@ iptL_getpfxstr(lua_State *L, int idx, const char **pfx, size_t *len)
     return 1;
 }
 
+/*
+ * ### `iptL_getchunk`
+ * ```c
+ * static int iptL_getchunk(lua_State *L, int idx, lua_Integer *chunk);
+ * ```
+ *
+ * Sets `chunk` to the chunk size at `L[idx]`, if any.  A missing or nil value
+ * means no chunks (0) are to be used, otherwise it must be a positive integer.
+ * Returns 1 on success, 0 on failure.
+ */
+
+static int
+iptL_getchunk(lua_State *L, int idx, lua_Integer *chunk)
+{
+    dbg_stack("inc(.) <--");          // [.. n ..]
+    *chunk = 0;
+    if (lua_isnoneornil(L, idx))
+        return 1;
+    if (! lua_isinteger(L, idx) || lua_tointeger(L, idx) < 1)
+        return 0;
+    *chunk = lua_tointeger(L, idx);
+
+    return 1;
+}
+
+/*
+ * ### `iptL_pushcount`
+ * ```c
+ * static void iptL_pushcount(lua_State *L, double count);
+ * ```
+ *
+ * Pushes a count of hosts or subnets as an integer if it can be represented
+ * exactly, as a float otherwise (ipv6 counts can get large).
+ */
+
+static void
+iptL_pushcount(lua_State *L, double count)
+{
+    if (count < 9007199254740992.0)  /* 2^53 */
+        lua_pushinteger(L, (lua_Integer)count);
+    else
+        lua_pushnumber(L, count);
+}
+
 /*
  * ### `iptL_refpcreate`
  * ```c
@@ -549,6 +880,37 @@ iptL_refpcreate(lua_State *L)
     return refp;
 }
 
+/*
+ * ### `iptL_refreserve`
+ * ```c
+ * static int iptL_refreserve(lua_State *L, lua_Integer n);
+ * ```
+ *
+ * Grow `LUA_REGISTRYINDEX` by taking `n` placeholder references and releasing
+ * them again.  The registry keeps its size and the released ids are reused by
+ * later calls to `luaL_ref`, so storing `n` values does not rehash it.
+ * - returns 1 on success, 0 on failure (out of memory)
+ */
+
+static int
+iptL_refreserve(lua_State *L, lua_Integer n)
+{
+    int *refs;
+
+    if (n <= 0) return 1;
+    if ((refs = malloc((size_t)n * sizeof(int))) == NULL) return 0;
+
+    for (lua_Integer i = 0; i < n; i++) {
+        lua_pushboolean(L, 1);
+        refs[i] = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+    for (lua_Integer i = n; i > 0; i--)
+        luaL_unref(L, LUA_REGISTRYINDEX, refs[i - 1]);
+
+    free(refs);
+    return 1;
+}
+
 /*
  * ### `iptL_refpdelete`
  * ```c
@@ -572,6 +934,27 @@ iptL_refpdelete(void *L, void **r)
     *refp = NULL;
 }
 
+/*
+ * ### `iptL_refpdup`
+ * ```c
+ * static void *iptL_refpdup(void *L, void *r);
+ * ```
+ *
+ * Create a new reference for the Lua value referenced by `r` (treated as an
+ * *int) and return a pointer to it.  Function signature is as per `dup_f_t`
+ * (see iptable.h) and is used when cloning a table: both tables then refer to
+ * the same Lua value, each through its own reference.
+ */
+
+static void *
+iptL_refpdup(void *L, void *r)
+{
+    lua_State *LL = L;
+
+    lua_rawgeti(LL, LUA_REGISTRYINDEX, *(int *)r);  // [.. v]
+    return iptL_refpcreate(LL);                     // [..]
+}
+
 // k,v-setters for Table on top of L (iter_radix/iter_supernets_f) helpers
 
 /*
@@ -1034,14 +1417,166 @@ static int
 iptm_gc(lua_State *L) {
     dbg_stack("inc(.) <--");  // [t]
 
-    table_t *t = iptL_gettable(L, 1);
-    tbl_destroy(&t, L);
+    table_t **t = luaL_checkudata(L, 1, LUA_IPTABLE_ID);
+    grave_t *g = iptL_getgrave(L);
+    int ok = 0;
+
+    if (*t == NULL) return 0;
+
+    /* with active iterators, their guards still refer to the table */
+    if (g && !g->closed && (*t)->itr_lock == 0) {
+        if ((*t)->gcslice) {
+            /* the first slice now, the rest by iptable.step() */
+            ok = ! tbl_destroystep(t, L, (*t)->gcslice)
+                 || grave_push(&g->tbl, &g->count, &g->size, *t);
+
+        } else if (g->background) {
+            /* values are Lua's, so those are released here */
+            tbl_release(*t, L);
+            pthread_mutex_lock(&g->mtx);
+            if (! g->running && pthread_create(&g->reaper, NULL,
+                                               grave_reaper, g) == 0)
+                g->running = 1;
+            if (g->running && grave_push(&g->queue, &g->qcount, &g->qsize, *t))
+                ok = 1, pthread_cond_signal(&g->cv);
+            pthread_mutex_unlock(&g->mtx);
+        }
+    }
+
+    if (ok)
+        *t = NULL;
+    else
+        tbl_destroy(t, L);
 
     dbg_stack("out(0) ==>");
 
     return 0;
 }
 
+/*
+ * ### `iptL_getgrave`
+ * ```c
+ * static grave_t *iptL_getgrave(lua_State *L);
+ * ```
+ *
+ * Return the graveyard of the Lua state, NULL if there is none.
+ */
+
+static grave_t *
+iptL_getgrave(lua_State *L)
+{
+    grave_t *g;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, LUA_IPT_GRAVEYARD);
+    g = luaL_testudata(L, -1, LUA_IPT_GRAVE);
+    lua_pop(L, 1);
+
+    return g;
+}
+
+/*
+ * ### `grave_push`
+ * ```c
+ * static int grave_push(table_t ***arr, size_t *count, size_t *size,
+ *                       table_t *t);
+ * ```
+ *
+ * Append table `t` to the array `*arr`, growing it as needed.
+ * Returns 1 on success, 0 on failure (out of memory).
+ */
+
+static int
+grave_push(table_t ***arr, size_t *count, size_t *size, table_t *t)
+{
+    table_t **tmp;
+
+    if (*count == *size) {
+        if ((tmp = realloc(*arr, (*size ? 2 * *size : 8) * sizeof(*tmp)))
+            == NULL) return 0;
+        *arr = tmp;
+        *size = *size ? 2 * *size : 8;
+    }
+    (*arr)[(*count)++] = t;
+
+    return 1;
+}
+
+/*
+ * ### `grave_reaper`
+ * ```c
+ * static void *grave_reaper(void *arg);
+ * ```
+ *
+ * The reaper thread destroys the released tables queued by `iptm_gc`, until
+ * told to stop and the queue is empty.
+ */
+
+static void *
+grave_reaper(void *arg)
+{
+    grave_t *g = arg;
+    table_t *t;
+
+    pthread_mutex_lock(&g->mtx);
+    for (;;) {
+        while (g->qcount == 0 && !g->stop)
+            pthread_cond_wait(&g->cv, &g->mtx);
+        if (g->qcount == 0)
+            break;
+        t = g->queue[--g->qcount];
+        pthread_mutex_unlock(&g->mtx);
+        tbl_destroy(&t, NULL);
+        pthread_mutex_lock(&g->mtx);
+    }
+    pthread_mutex_unlock(&g->mtx);
+
+    return NULL;
+}
+
+/*
+ * ### `ipt_grave_gc`
+ * ```c
+ * static int ipt_grave_gc(lua_State *L);
+ * ```
+ *
+ * The garbage collector function of the `LUA_IPT_GRAVE` metatable, called
+ * when the Lua state is closed.  Destroys the parked tables, lets the reaper
+ * finish its queue and joins it, so no table outlives the state and no
+ * thread runs the library's code once it is unloaded.
+ */
+
+static int
+ipt_grave_gc(lua_State *L)
+{
+  dbg_stack("inc(.) <--");
+
+  grave_t *g = luaL_checkudata(L, 1, LUA_IPT_GRAVE);
+
+  g->closed = 1;
+  for (size_t i = 0; i < g->count; i++)
+      tbl_destroy(&g->tbl[i], L);
+  free(g->tbl);
+  g->tbl = NULL;
+  g->count = g->size = 0;
+
+  if (g->running) {
+      pthread_mutex_lock(&g->mtx);
+      g->stop = 1;
+      pthread_cond_signal(&g->cv);
+      pthread_mutex_unlock(&g->mtx);
+      pthread_join(g->reaper, NULL);
+      g->running = 0;
+  }
+  free(g->queue);
+  g->queue = NULL;
+  pthread_cond_destroy(&g->cv);
+  pthread_mutex_destroy(&g->mtx);
+
+  dbg_stack("out(.) ==>");
+
+  return 0;
+}
+
 /*
  * ### `iptL_pushitrgc`
  * ```c
@@ -1092,6 +1627,7 @@ iptL_pushitrgc(lua_State *L, table_t *t)
 
   g->t = t;       /* point the garbage collector to *this* table */
   t->itr_lock++;  /* register presence of an active iterator in *this* table */
+  tbl_trace(t, TRC_ITR, NULL, -1);
 
   /* get the LUA_IPT_ITR_GC metatable & associate it with this new userdata */
   luaL_newmetatable(L, LUA_IPT_ITR_GC);   // [... g M]
@@ -1120,31 +1656,46 @@ static int
 ipt_itr_gc(lua_State *L)
 {
   dbg_stack("inc(.) <--");
-  struct radix_node *rn, *nxt;
-  purge_t args;
 
   itr_gc_t *gc = luaL_checkudata(L, 1, LUA_IPT_ITR_GC);
 
   dbg_msg("gc->t is %p", (void *)gc->t);
+  tbl_trace(gc->t, TRC_END, NULL, -1);
   gc->t->itr_lock--;
   if (gc->t->itr_lock)
       return 0;  /* some iterators still active */
 
-  /* apparently all iterator activity has ceased: run deferred deletions */
-  args.purge = gc->t->purge;
-  args.args = L;
-  args.head = NULL; /* set per rn type (ipv4 vs ipv6) */
+  /* apparently all iterator activity has ceased: run deferred deletions,
+   * or only a first slice of them if the host does the rest (ipt:step) */
+  if (gc->t->gcslice)
+      tbl_gcstep(gc->t, L, gc->t->gcslice);
+  else
+      tbl_gc(gc->t, L);
 
-  rn = rdx_firstleaf(&gc->t->head4->rh);
+  dbg_stack("out(.) ==>");
 
-  while(rn) {
-    nxt = rdx_nextleaf(rn);
-    if (rn->rn_flags & IPTF_DELETE) {
-        args.head = KEY_IS_IP4(rn->rn_key) ? gc->t->head4 : gc->t->head6;
-        rdx_flush(rn, &args);
-    }
-    rn = nxt;
-  }
+  return 0;
+}
+
+/*
+ * ### `ipt_pool_gc`
+ * ```c
+ * static int ipt_pool_gc(lua_State *L);
+ * ```
+ *
+ * The garbage collector function of the `LUA_IPT_POOL` metatable.  A table's
+ * worker pool (see `iptm_lookup`) is kept as the user value of the table's
+ * userdata, so it is collected along with the table.  This stops and joins
+ * the pool's worker threads and frees its engines.
+ */
+
+static int
+ipt_pool_gc(lua_State *L)
+{
+  dbg_stack("inc(.) <--");
+
+  pool_t **p = luaL_checkudata(L, 1, LUA_IPT_POOL);
+  pool_destroy(p);
 
   dbg_stack("out(.) ==>");
 
@@ -1220,7 +1771,9 @@ iter_fail_f(lua_State *L)
  *
  * The actual iterator function for iptable.hosts(pfx), yields the next host ip
  * until its stop value is reached.  Ignores the stack: it uses upvalues for
- * next, stop
+ * next, stop, chunk and an optional iptable.  If chunk > 0, it yields an array
+ * of (at most) chunk hosts at a time.  Hosts that have a longest prefix match
+ * in the optional iptable are skipped.
  */
 
 static int
@@ -1231,28 +1784,51 @@ iter_hosts_f(lua_State *L)
     size_t nlen = 0, slen = 0;
     uint8_t next[MAX_BINKEY], stop[MAX_BINKEY];
     char buf[MAX_STRKEY];
+    lua_Integer chunk, n = 0;
+    table_t *t = NULL;
+    entry_t *e;
+    void **ud;
 
     lua_settop(L, 0);  /* clear stack */
     if (!iptL_getbinkey(L, lua_upvalueindex(1), next, &nlen))
         return lipt_error(L, LIPTE_LVAL, 1, "");
     if (!iptL_getbinkey(L, lua_upvalueindex(2), stop, &slen))
         return lipt_error(L, LIPTE_LVAL, 1, "");
+    chunk = lua_tointeger(L, lua_upvalueindex(3));
+    if ((ud = lua_touserdata(L, lua_upvalueindex(4))))
+        t = *ud;
+
+    if (chunk)
+        lua_createtable(L, chunk < 1024 ? (int)chunk : 1024, 0);
+
+    while (key_cmp(next, stop) != 0 && n < (chunk ? chunk : 1)) {
+        if (t && (e = tbl_rawlpm(t, next))) {
+            /* skip all hosts covered by the match */
+            key_broadcast(next, e->rn->rn_mask);
+            if (key_cmp(next, stop) >= 0) {
+                memcpy(next, stop, IPT_KEYLEN(stop));
+                continue;
+            }
+        } else {
+            if (! key_tostr(buf, next))
+                return lipt_error(L, LIPTE_TOSTR, 1, "");
+            lua_pushstring(L, buf);
+            if (chunk)
+                lua_rawseti(L, 1, n + 1);
+            n++;
+        }
+        key_incr(next, 1);
+    }
 
-    if (key_cmp(next, stop) == 0)
+    if (n == 0)
         return 0;  /* all done */
 
-    if (! key_tostr(buf, next))
-        return lipt_error(L, LIPTE_TOSTR, 1, "");
-    lua_pushstring(L, buf);
-
     /* setup the next val */
-    key_incr(next, 1);
     lua_pushlstring(L, (const char *)next, (size_t)IPT_KEYLEN(next));
     lua_replace(L, lua_upvalueindex(1));
 
     dbg_stack("out(1) ==>");
 
-
     return 1;
 }
 
@@ -1322,8 +1898,8 @@ iter_interval_f(lua_State *L)
  * ```
  *
  * The actual iterator function for `iter_subnets`.  Uses upvalues: `start`,
- * `stop`, `mask`, `mlen` and a `sentinal` which is used to signal address
- * space wrap around.
+ * `stop`, `mask`, `mlen`, a `sentinal` which is used to signal address space
+ * wrap around, `chunk` and an optional iptable.
  *
  * `stop` represents the broadcast address of the last prefix to return.  This
  * might actually be the max address possible in the AF's address space and
@@ -1335,6 +1911,9 @@ iter_interval_f(lua_State *L)
  *
  * `mlen` is stored as a convenience and represents the prefix length of the
  * binary `mask` and alleviates the need to calculate it on every iteration.
+ *
+ * If `chunk` > 0, an array of (at most) chunk subnets is yielded at a time.
+ * Subnets that overlap with any prefix in the optional iptable are skipped.
  */
 
 static int
@@ -1344,71 +1923,206 @@ iter_subnets_f(lua_State *L)
 
     uint8_t start[MAX_BINKEY], stop[MAX_BINKEY], mask[MAX_BINKEY];
     size_t klen;
-    int mlen;
+    int mlen, done;
     char buf[MAX_STRKEY];
+    lua_Integer chunk, n = 0;
+    table_t *t = NULL;
+    entry_t *e;
+    void **ud;
 
-    if (lua_tointeger(L, lua_upvalueindex(5)))
+    if ((done = lua_tointeger(L, lua_upvalueindex(5))))
         return 0; /* all done */
     if (! iptL_getbinkey(L, lua_upvalueindex(1), start, &klen))
         return lipt_error(L, LIPTE_LVAL, 1, "");
     if (! iptL_getbinkey(L, lua_upvalueindex(2), stop, &klen))
         return lipt_error(L, LIPTE_LVAL, 1, "");
+    if (! iptL_getbinkey(L, lua_upvalueindex(3), mask, &klen))
+        return lipt_error(L, LIPTE_LVAL, 1, "");
+    mlen = lua_tointeger(L, lua_upvalueindex(4));
+    chunk = lua_tointeger(L, lua_upvalueindex(6));
+    if ((ud = lua_touserdata(L, lua_upvalueindex(7))))
+        t = *ud;
+
+    lua_settop(L, 0);
+    if (chunk)
+        lua_createtable(L, chunk < 1024 ? (int)chunk : 1024, 0);
 
     /* are we done? */
-    if (key_cmp(start, stop) > 0)
-        return 0;
+    while (!done && n < (chunk ? chunk : 1) && key_cmp(start, stop) <= 0) {
+
+        /* skip all subnets covered by a less specific match */
+        if (t && (e = tbl_rawlpm(t, start))
+                && key_masklen(e->rn->rn_mask) <= mlen) {
+            key_broadcast(start, e->rn->rn_mask);
+            if (key_cmp(start, stop) >= 0)
+                done = 1;
+            else if (! key_incr(start, 1))
+                return lipt_error(L, LIPTE_BINOP, 1, "");
+            continue;
+        }
 
-    /* push start as the next subnet */
-    lua_settop(L, 0);
-    mlen = lua_tointeger(L, lua_upvalueindex(4));
-    lua_pushfstring(L, "%s/%d", key_tostr(buf, start), mlen);
+        /* push start as the next subnet */
+        if (t == NULL || ! tbl_overlaps(t, start, mlen)) {
+            lua_pushfstring(L, "%s/%d", key_tostr(buf, start), mlen);
+            if (chunk)
+                lua_rawseti(L, 1, n + 1);
+            n++;
+        }
 
-    /* setup next start address */
-    if (! iptL_getbinkey(L, lua_upvalueindex(3), mask, &klen))
-        return lipt_error(L, LIPTE_LVAL, 1, "");
-    if (! key_broadcast(start, mask))
-        return lipt_error(L, LIPTE_BINOP, 1, "");
+        /* setup next start address */
+        if (! key_broadcast(start, mask))
+            return lipt_error(L, LIPTE_BINOP, 1, "");
 
-    /* wrap around protection */
-    if (key_cmp(start, stop) == 0) {
-        lua_pushinteger(L, 1);
-        lua_replace(L, lua_upvalueindex(5));
-    } else {
-        if (! key_incr(start, 1))
+        /* wrap around protection */
+        if (key_cmp(start, stop) == 0)
+            done = 1;
+        else if (! key_incr(start, 1))
             return lipt_error(L, LIPTE_BINOP, 1, "");
-        lua_pushlstring(L, (const char *)start, (size_t)IPT_KEYLEN(start));
-        lua_replace(L, lua_upvalueindex(1));
     }
 
+    lua_pushinteger(L, done);
+    lua_replace(L, lua_upvalueindex(5));
+    lua_pushlstring(L, (const char *)start, (size_t)IPT_KEYLEN(start));
+    lua_replace(L, lua_upvalueindex(1));
+
+    if (n == 0)
+        return 0;  /* all done */
+
     dbg_stack("out(1) ==>");
 
     return 1;
 }
 
 /*
- * ### `iter_kv_f`
+ * ### `iter_changes_f`
  * ```c
- * static int iter_kv_f(lua_State *L)
+ * static int iter_changes_f(lua_State *L);
  * ```
  *
- * The actual iteration function for `iter_kv` yields all k,v pairs in the
- * tree(s).  When an iterator is active, deletion of entries are flagged and
- * only carried out when no iterators are active.  So it should be safe to
- * delete entries while iterating.
- *
- * Note: upvalue(1) is the leaf to process.
+ * The actual iteration function for `iter_changes`.  Its only upvalue is the
+ * sequence number of the last change yielded.  Each call reads the next
+ * journal record and pushes its sequence number, prefix, operation and the
+ * prefix's current value.  Lost records yield a single `seq, nil, "lost"`.
  */
 
 static int
-iter_kv_f(lua_State *L)
+iter_changes_f(lua_State *L)
 {
     dbg_stack("inc(.) <--");  // [t k]
 
     char saddr[MAX_STRKEY];
-
+    table_t *t = iptL_gettable(L, 1);
+    uint64_t seq = (uint64_t)lua_tointeger(L, lua_upvalueindex(1));
+    jrec_t *rec = NULL;
+    entry_t *e;
+    int rc;
+
+    if (t->journal == NULL) return 0;  // journal was disabled
+    if ((rc = tbl_jnext(t, &seq, &rec)) == 0) return 0;  // we're done
+
+    lua_pushinteger(L, (lua_Integer)seq);
+    lua_copy(L, -1, lua_upvalueindex(1));
+    if (rc < 0) {
+        lua_pushnil(L);
+        lua_pushliteral(L, "lost");
+        lua_pushnil(L);                              // [t k seq nil op nil]
+        return 4;
+    }
+
+    if (! key_tostr(saddr, rec->key))
+        return lipt_error(L, LIPTE_TOSTR, 4, "");
+    lua_pushfstring(L, "%s/%d", saddr, rec->mlen);   // [t k seq pfx]
+    lua_pushstring(L, rec->op == JRNL_SET ? "set" : "del");
+    e = tbl_rawget(t, lua_tostring(L, -2));
+    if (e)
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)e->value);
+    else
+        lua_pushnil(L);                              // [t k seq pfx op v]
+
+    dbg_stack("out(4) ==>");
+
+    return 4;                                        // [.., seq, pfx, op, v]
+}
+
+/*
+ * ### `iter_diff_f`
+ * ```c
+ * static int iter_diff_f(lua_State *L);
+ * ```
+ *
+ * The actual iteration function for `iter_diff`.  Its upvalues are:
+ * 1. the `diff_t` userdata holding the state of the merge
+ * 2. the other (new) table, so it stays alive during the iteration
+ * 3. the user supplied equality function, or nil
+ * 4. the iterator guard of the old table
+ * 5. the iterator guard of the new table
+ *
+ * Each call advances the merge to the next difference and pushes the prefix,
+ * the operation and the old and new values.
+ */
+
+static int
+iter_diff_f(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [t k]
+
+    static const char *const op_str[] = {
+        [TDIFF_ADD] = "added", [TDIFF_DEL] = "removed",
+        [TDIFF_CHG] = "changed",
+    };
+    char saddr[MAX_STRKEY];
+    diff_t *d = lua_touserdata(L, lua_upvalueindex(1));
+    entry_t *ea, *eb, *e;
+    int op;
+
+    d->eargs = L;
+    if ((op = tbl_diffnext(d, &ea, &eb)) == TDIFF_NONE)
+        return 0;  // we're done
+
+    e = ea ? ea : eb;
+    if (! key_tostr(saddr, e->rn->rn_key))
+        return lipt_error(L, LIPTE_TOSTR, 4, "");
+    lua_pushfstring(L, "%s/%d", saddr, key_masklen(e->rn->rn_mask));
+    lua_pushstring(L, op_str[op]);                   // [t k pfx op]
+    if (ea)
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)ea->value);
+    else
+        lua_pushnil(L);                              // [t k pfx op old]
+    if (eb)
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)eb->value);
+    else
+        lua_pushnil(L);                              // [t k pfx op old new]
+
+    dbg_stack("out(4) ==>");
+
+    return 4;                                        // [.., pfx, op, old, new]
+}
+
+/*
+ * ### `iter_kv_f`
+ * ```c
+ * static int iter_kv_f(lua_State *L)
+ * ```
+ *
+ * The actual iteration function for `iter_kv` yields all k,v pairs in the
+ * tree(s).  When an iterator is active, deletion of entries are flagged and
+ * only carried out when no iterators are active.  So it should be safe to
+ * delete entries while iterating.
+ *
+ * Note: upvalue(1) is the leaf to process.
+ */
+
+static int
+iter_kv_f(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [t k]
+
+    char saddr[MAX_STRKEY];
+
     table_t *t = iptL_gettable(L, 1);
     struct radix_node *rn = lua_touserdata(L, lua_upvalueindex(1));
     entry_t *e = (entry_t *)rn;
+    uint64_t t0;
 
     if (rn == NULL || RDX_ISROOT(rn)) return 0; // we're done
 
@@ -1418,6 +2132,8 @@ iter_kv_f(lua_State *L)
 
     if (rn == NULL || RDX_ISROOT(rn)) return 0; // we're done
     e = (entry_t *)rn;
+    tbl_trace(t, TRC_NEXT, NULL, -1);
+    t0 = tbl_latstart(t, LAT_ITR);
 
     /* push the next key, value onto stack */
     if (! key_tostr(saddr, rn->rn_key))
@@ -1436,6 +2152,7 @@ iter_kv_f(lua_State *L)
 
     lua_pushlightuserdata(L, rn);                            // [t k k' v' rn]
     lua_replace(L, lua_upvalueindex(1));                     // [t_ud k k' v']
+    tbl_latstop(t, LAT_ITR, t0);
 
     dbg_stack("out(2) ==>");
 
@@ -1538,7 +2255,7 @@ iter_less_f(lua_State *L)
         snprintf(buf, sizeof(buf), "%s/%d", pfx, mlen);
         buf[MAX_STRKEY-1] = '\0';
 
-        if ((e = tbl_get(t, buf))) {
+        if ((e = tbl_rawget(t, buf))) {
             lua_pushfstring(L, "%s/%d",
                     key_tostr(buf, e->rn->rn_key),
                     key_masklen(e->rn->rn_mask));
@@ -1731,6 +2448,57 @@ iter_radix(lua_State *L)
     return 0;
 }
 
+/*
+ * ### `iter_intervals_f`
+ * ```c
+ * static int iter_intervals_f(lua_State *L);
+ * ```
+ *
+ * The actual iterator function for `iter_intervals`, yields the start, stop
+ * and value of the next interval.  Notes:
+ *
+ * - upvalue(1) is the AF family of the array being iterated
+ * - upvalue(2) is the index of the next interval in that array
+ * - upvalue(3) is true if iteration continues with ipv6 after ipv4
+ */
+
+static int
+iter_intervals_f(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [r k]
+
+    char buf[MAX_STRKEY];
+    range_t *r = iptL_getrange(L, 1);
+    int af = lua_tointeger(L, lua_upvalueindex(1));
+    size_t idx = lua_tointeger(L, lua_upvalueindex(2));
+    interval_t *ivl;
+
+    /* switch to ipv6 intervals when ipv4 intervals are exhausted */
+    if (af == AF_INET && idx >= r->count4 &&
+        lua_toboolean(L, lua_upvalueindex(3))) {
+        af = AF_INET6;
+        idx = 0;
+        lua_pushinteger(L, af);
+        lua_replace(L, lua_upvalueindex(1));
+    }
+
+    if (idx >= (af == AF_INET ? r->count4 : r->count6))
+        return 0;  /* we're done */
+
+    ivl = (af == AF_INET ? r->ivl4 : r->ivl6) + idx;
+    lua_pushinteger(L, idx + 1);
+    lua_replace(L, lua_upvalueindex(2));
+
+    lua_settop(L, 0);
+    lua_pushstring(L, key_tostr(buf, ivl->start));          // [start]
+    lua_pushstring(L, key_tostr(buf, ivl->stop));           // [start stop]
+    lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)ivl->value);  // [start stop v]
+
+    dbg_stack("out(3) ==>");
+
+    return 3;
+}
+
 /* ## module functions
  *
  */
@@ -1744,13 +2512,19 @@ iter_radix(lua_State *L)
  * Creates a new userdata, sets its `iptable` metatable and returns it to Lua.
  * It also sets the purge function for the table to
  * [*`iptL_refpdelete`*](### `iptL_refpdelete`) which frees any memory held by
- * the user's data once a prefix is deleted from the radix tree.
+ * the user's data once a prefix is deleted from the radix tree.  An optional
+ * `size` reserves room for that many prefixes, see `tbl_reserve`, and for
+ * their values in the registry.
  */
 
 static int
 ipt_new(lua_State *L)
 {
-    dbg_stack("inc(.) <--");
+    dbg_stack("inc(.) <--");               // [[size]]
+
+    lua_Integer size = luaL_optinteger(L, 1, 0);
+    luaL_argcheck(L, size >= 0, 1, "size must be >= 0");
+    lua_settop(L, 0);
 
     table_t **t = lua_newuserdatauv(L, sizeof(void **), 1);
     *t = tbl_create(iptL_refpdelete);      // usr_delete func to free values
@@ -1760,6 +2534,9 @@ ipt_new(lua_State *L)
     luaL_getmetatable(L, LUA_IPTABLE_ID); // [t M]
     lua_setmetatable(L, 1);               // [t]
 
+    if (! tbl_reserve(*t, (size_t)size) || ! iptL_refreserve(L, size))
+        luaL_error(L, "error reserving %I prefixes", size);
+
     /* for debug: */
     /* lua_pushlightuserdata(L, (void *)L); */
     /* lua_gettable(L, LUA_REGISTRYINDEX); */
@@ -1772,6 +2549,136 @@ ipt_new(lua_State *L)
     return 1;
 }
 
+/*
+ * ### `iptable.background`
+ * ```c
+ * static int ipt_background(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * iptable.background(true)   --> true
+ * iptable.background()       --> true
+ * ```
+ *
+ * Get or set whether tables collected by Lua, that have no slice (see
+ * `ipt:slice`), are destroyed on a background thread.  The collector then
+ * only releases the table's values, which are Lua's, and a reaper thread
+ * frees the radix trees and entries.  Tables being iterated are always
+ * destroyed right away.  Returns the current setting.
+ */
+
+static int
+ipt_background(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [[on]]
+
+    grave_t *g = iptL_getgrave(L);
+
+    if (g == NULL)
+        return lipt_error(L, LIPTE_FAIL, 1, "");
+    if (! lua_isnoneornil(L, 1)) {
+        luaL_checktype(L, 1, LUA_TBOOLEAN);
+        g->background = lua_toboolean(L, 1);
+    }
+
+    lua_settop(L, 0);
+    lua_pushboolean(L, g->background);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;                              // [on]
+}
+
+/*
+ * ### `iptable.step`
+ * ```c
+ * static int ipt_step(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = iptable.new()
+ * ipt:slice(1000)
+ * -- ..
+ * ipt = nil
+ * collectgarbage()
+ * while iptable.step() do yield_to_event_loop() end
+ * ```
+ *
+ * Do one step of destroying the tables that were collected while they had a
+ * slice (see `ipt:slice`), oldest first.  Removes at most `n` prefixes or, by
+ * default, the table's slice, see `tbl_destroystep`.  Returns true if there
+ * is work left, false once all collected tables are gone.
+ */
+
+static int
+ipt_step(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [[n]]
+
+    grave_t *g = iptL_getgrave(L);
+    lua_Integer n = luaL_optinteger(L, 1, -1);
+
+    if (g == NULL)
+        return lipt_error(L, LIPTE_FAIL, 1, "");
+    if (! lua_isnoneornil(L, 1) && n < 0)
+        return lipt_error(L, LIPTE_ARG, 1, "");
+
+    if (g->count > 0) {
+        if (n < 0) n = (lua_Integer)g->tbl[0]->gcslice;
+        if (! tbl_destroystep(&g->tbl[0], L, (size_t)n)) {
+            g->count--;
+            memmove(g->tbl, g->tbl + 1, g->count * sizeof(*g->tbl));
+        }
+    }
+
+    lua_settop(L, 0);
+    lua_pushboolean(L, g->count > 0);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;                              // [more]
+}
+
+/*
+ * ### `iptable.ranges`
+ * ```c
+ * static int ipt_ranges(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * rng = iptable.ranges()     -- an empty range table
+ * rng = iptable.ranges(ipt)  -- ipt's address space as disjoint intervals
+ * ```
+ *
+ * Creates a new range table userdata, sets its `iprange` metatable and
+ * returns it to Lua.  If an iptable is given, its prefixes are flattened into
+ * disjoint intervals, honoring longest prefix match semantics.  Values are
+ * stored in the lua registry, like those of an iptable.
+ */
+
+static int
+ipt_ranges(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [[t]]
+
+    table_t *t = lua_isnoneornil(L, 1) ? NULL : iptL_gettable(L, 1);
+    range_t **r = lua_newuserdatauv(L, sizeof(void **), 1);  // [[t] r]
+
+    *r = rng_create(iptL_refpdelete);
+    if (*r == NULL)
+        return lipt_error(L, LIPTE_BUF, 1, "");
+
+    luaL_getmetatable(L, LUA_IPRANGE_ID);  // [[t] r M]
+    lua_setmetatable(L, -2);               // [[t] r]
+
+    if (t && ! rng_bytbl(*r, t, iptL_refpdup, L))
+        return lipt_error(L, LIPTE_BUF, 1, "");
+
+    dbg_stack("out(1) ==>");
+
+    return 1;                              // [.., r]
+}
+
 /*
  * ### `iptable.tobin`
  * ```c
@@ -2784,24 +3691,35 @@ ipt_mask(lua_State *L)
  * --> 10.10.10.1
  * --> 10.10.10.2
  * --> 10.10.10.4
+ * for hosts in iptable.hosts("10.10.10.0/24", false, 100, ipt) do
+ *   print(#hosts)  -- arrays of (at most) 100 hosts not matched by ipt
+ * end
  * ```
  *
  * Iterate across host adresses in a given prefix.  An optional second argument
  * defaults to false, but when given & true, the network and broadcast address
  * will be included in the iteration results.  If prefix has no mask, the af's
  * max mask is used.  In which case, unless the second argument is true, it
- * won't iterate anything.  In case of errors (it won't iterate), check out
- * `iptable.error` for clues.
+ * won't iterate anything.  An optional third argument, a chunk size, makes
+ * the iteration yield arrays of (at most) that many hosts at a time.  An
+ * optional fourth argument, an iptable, causes hosts that have a longest
+ * prefix match in that table to be skipped.  In case of errors (it won't
+ * iterate), check out `iptable.error` for clues.
  */
-static int iter_hosts(lua_State *L) { dbg_stack("inc(.) <--");  // [pfx [incl]]
+static int iter_hosts(lua_State *L) { dbg_stack("inc(.) <--");  // [pfx [incl [chunk [t]]]]
 
     size_t len = 0;
     int af = AF_UNSPEC, mlen = -1, inclusive = 0;
     uint8_t addr[MAX_BINKEY], mask[MAX_BINKEY], stop[MAX_BINKEY];
     const char *pfx = NULL;
+    lua_Integer chunk = 0;
 
-    if (lua_gettop(L) == 2 && lua_isboolean(L, 2))
+    if (lua_gettop(L) >= 2 && lua_isboolean(L, 2))
         inclusive = lua_toboolean(L, 2);  // include netw/bcast (or not)
+    if (! iptL_getchunk(L, 3, &chunk))
+        return iter_error(L, LIPTE_ARG, "chunk size?");
+    if (! lua_isnoneornil(L, 4) && ! luaL_testudata(L, 4, LUA_IPTABLE_ID))
+        return iter_error(L, LIPTE_ARG, "iptable?");
 
     if (! iptL_getpfxstr(L, 1, &pfx, &len))
         return iter_error(L, LIPTE_ARG, "?");
@@ -2821,16 +3739,90 @@ static int iter_hosts(lua_State *L) { dbg_stack("inc(.) <--");  // [pfx [incl]]
     else if (key_cmp(addr, stop) < 0)
         key_incr(addr, 1); // not inclusive, so donot 'iterate' a host ip addr.
 
+    lua_settop(L, 4);
     lua_pushlstring(L, (const char *)addr, IPT_KEYLEN(addr));
     lua_pushlstring(L, (const char *)stop, IPT_KEYLEN(stop));
-    dbg_stack("suc6! 2+");
-    lua_pushcclosure(L, iter_hosts_f, 2);  // [.., func]
+    lua_pushinteger(L, chunk);
+    lua_pushvalue(L, 4);
+    dbg_stack("suc6! 4+");
+    lua_pushcclosure(L, iter_hosts_f, 4);  // [.., func]
 
     dbg_stack("out(1) ==>");
 
     return 1;
 }
 
+/*
+ * ### `iptable.hostcount`
+ * ```c
+ * static int ipt_hostcount(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * num = iptable.hostcount("10.10.10.0/24")            -- 254
+ * num = iptable.hostcount("10.10.10.0/24", true)      -- 256
+ * num = iptable.hostcount("10.10.10.0/24", true, ipt) -- 256 minus matches
+ * ```
+ *
+ * Returns the number of hosts `iptable.hosts` would iterate across, given the
+ * same arguments (minus the chunk size), without actually iterating.  If an
+ * iptable is given, hosts covered by its prefixes are not counted.  The count
+ * is an integer if it can be represented exactly and a float otherwise.
+ * Returns nil & an error msg on errors.
+ */
+
+static int
+ipt_hostcount(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [pfx [incl [t]]]
+
+    uint8_t addr[MAX_BINKEY], mask[MAX_BINKEY];
+    size_t len = 0;
+    int af = AF_UNSPEC, mlen = -1, hlen, inclusive = 0;
+    const char *pfx = NULL;
+    table_t *t = NULL;
+    void **ud = NULL;
+    double count;
+
+    if (! iptL_getpfxstr(L, 1, &pfx, &len))
+        return lipt_error(L, LIPTE_ARG, 1, "");
+    if (! key_bystr(addr, &mlen, &af, pfx))
+        return lipt_error(L, LIPTE_PFX, 1, "");
+    if (AF_UNKNOWN(af))
+        return lipt_error(L, LIPTE_AF, 1, "");
+    if (lua_gettop(L) >= 2 && lua_isboolean(L, 2))
+        inclusive = lua_toboolean(L, 2);
+    if (! lua_isnoneornil(L, 3)
+            && (ud = luaL_testudata(L, 3, LUA_IPTABLE_ID)) == NULL)
+        return lipt_error(L, LIPTE_ARG, 1, "");
+    t = ud ? *ud : NULL;
+
+    mlen = mlen < 0 ? MAX_MASKLEN(af) : mlen;       // mlen<0 means host addr
+    if (! key_bylen(mask, mlen, af) || ! key_network(addr, mask))
+        return lipt_error(L, LIPTE_BINOP, 1, "");
+
+    hlen = MAX_MASKLEN(af) - mlen;
+    for (count = 1.0; hlen > 0; hlen--)
+        count *= 2;
+    if (t)
+        count -= tbl_covered(t, addr, mlen, MAX_MASKLEN(af));
+
+    if (! inclusive) {
+        /* excludes network & broadcast address, if not matched already */
+        if (MAX_MASKLEN(af) - mlen < 2)
+            count = 0;
+        else {
+            count -= (t == NULL || tbl_rawlpm(t, addr) == NULL);
+            key_broadcast(addr, mask);
+            count -= (t == NULL || tbl_rawlpm(t, addr) == NULL);
+        }
+    }
+    iptL_pushcount(L, count);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
 
 /*
  * ### `iptable.interval`
@@ -2908,7 +3900,10 @@ iter_interval(lua_State *L)
  *
  * Iterate across the smaller prefixes given a start prefix and a larger
  * network mask, which is optional and defaults to being 1 bit longer than
- * that of the given prefix (similar to split).  In case of errors, it won't
+ * that of the given prefix (similar to split).  An optional third argument, a
+ * chunk size, makes the iteration yield arrays of (at most) that many subnets
+ * at a time.  An optional fourth argument, an iptable, causes subnets that
+ * overlap with any of its prefixes to be skipped.  In case of errors, it won't
  * iterate anything in which case `iptable.error` might shed some light on the
  * error encountered.
  */
@@ -2916,12 +3911,18 @@ iter_interval(lua_State *L)
 static int
 iter_subnets(lua_State *L)
 {
-    dbg_stack("(inc) <--");   // <-- [pfx, mlen]
+    dbg_stack("(inc) <--");   // <-- [pfx, mlen [, chunk [, t]]]
 
     uint8_t start[MAX_BINKEY], stop[MAX_BINKEY], mask[MAX_BINKEY];
     const char *pfx = NULL;
     int mlen = -1, mlen2, af = AF_UNSPEC;
     size_t len;
+    lua_Integer chunk = 0;
+
+    if (! iptL_getchunk(L, 3, &chunk))
+        return iter_error(L, LIPTE_ARG, "chunk size?");
+    if (! lua_isnoneornil(L, 4) && ! luaL_testudata(L, 4, LUA_IPTABLE_ID))
+        return iter_error(L, LIPTE_ARG, "iptable?");
 
     /* pickup start */
     if (! iptL_getpfxstr(L, 1, &pfx, &len))
@@ -2941,7 +3942,7 @@ iter_subnets(lua_State *L)
 
     /* pick up new masklen, check validity and calculate binary mask*/
     mlen2 = mlen + 1;
-    if (lua_gettop(L) == 2 && lua_isinteger(L, 2))
+    if (lua_gettop(L) >= 2 && lua_isinteger(L, 2))
         mlen2 = lua_tointeger(L, 2);
     if (mlen2 < 0 || mlen2 <= mlen)
         return iter_error(L, LIPTE_ARG, "new mask %d ?", mlen2);
@@ -2962,13 +3963,78 @@ iter_subnets(lua_State *L)
     /* setup iterator function */
     if (! key_bylen(mask, mlen2, af))
         return iter_error(L, LIPTE_BINOP, "binmask for /%d", mlen2);
-    lua_settop(L, 0);
+    lua_settop(L, 4);
     lua_pushlstring(L, (const char *)start, IPT_KEYLEN(start));
     lua_pushlstring(L, (const char *)stop, IPT_KEYLEN(stop));
     lua_pushlstring(L, (const char *)mask, IPT_KEYLEN(stop));
     lua_pushinteger(L, mlen2);
     lua_pushinteger(L, 0); /* wrap around protection */
-    lua_pushcclosure(L, iter_subnets_f, 5);
+    lua_pushinteger(L, chunk);
+    lua_pushvalue(L, 4);
+    lua_pushcclosure(L, iter_subnets_f, 7);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+
+/*
+ * ### `iptable.subnetcount`
+ * ```c
+ * static int ipt_subnetcount(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * num = iptable.subnetcount("10.10.10.0/24", 26)       -- 4
+ * num = iptable.subnetcount("2001:db8::/32", 64)       -- 4294967296
+ * num = iptable.subnetcount("2001:db8::/32", 64, ipt)  -- minus used ones
+ * ```
+ *
+ * Returns the number of subnets `iptable.subnets` would iterate across, given
+ * the same arguments (minus the chunk size), without actually iterating.  If an
+ * iptable is given, subnets that overlap with any of its prefixes are not
+ * counted.  The count is an integer if it can be represented exactly and a
+ * float otherwise.  Returns nil & an error msg on errors.
+ */
+
+static int
+ipt_subnetcount(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [pfx [mlen [t]]]
+
+    uint8_t addr[MAX_BINKEY];
+    size_t len = 0;
+    int af = AF_UNSPEC, mlen = -1, mlen2, slen;
+    const char *pfx = NULL;
+    table_t *t = NULL;
+    void **ud = NULL;
+    double count;
+
+    if (! iptL_getpfxstr(L, 1, &pfx, &len))
+        return lipt_error(L, LIPTE_ARG, 1, "");
+    if (! key_bystr(addr, &mlen, &af, pfx))
+        return lipt_error(L, LIPTE_PFX, 1, "");
+    if (AF_UNKNOWN(af))
+        return lipt_error(L, LIPTE_AF, 1, "");
+    if (mlen < 0 || mlen == MAX_MASKLEN(af))
+        return lipt_error(L, LIPTE_SPLIT, 1, "");
+
+    mlen2 = mlen + 1;
+    if (lua_gettop(L) >= 2 && lua_isinteger(L, 2))
+        mlen2 = lua_tointeger(L, 2);
+    if (mlen2 <= mlen || mlen2 > MAX_MASKLEN(af))
+        return lipt_error(L, LIPTE_ARG, 1, "");
+    if (! lua_isnoneornil(L, 3)
+            && (ud = luaL_testudata(L, 3, LUA_IPTABLE_ID)) == NULL)
+        return lipt_error(L, LIPTE_ARG, 1, "");
+    t = ud ? *ud : NULL;
+
+    for (count = 1.0, slen = mlen2 - mlen; slen > 0; slen--)
+        count *= 2;
+    if (t)
+        count -= tbl_covered(t, addr, mlen, mlen2);
+    iptL_pushcount(L, count);
 
     dbg_stack("out(1) ==>");
 
@@ -3130,429 +4196,1994 @@ iptm_tostring(lua_State *L)
 }
 
 /*
- * ### `iptm_counts`
+ * ### `iptm_clone`
  * ```c
- * static int iptm_counts(lua_State *L);
+ * static int iptm_clone(lua_State *L);
  * ```
  * ```lua
  * -- lua
  * ipt = require"iptable".new()
- * ip4c, ip6c = ipt:counts()
- * --> 0  0
+ * ipt["10.10.10.0/24"] = {1, 2}
+ * copy = ipt:clone()
+ * copy["10.10.10.0/24"] == ipt["10.10.10.0/24"]  --> true
  * ```
  *
- * Return the number of entries in both the ipv4 and ipv6 radix tree.
+ * Return a new iptable with the same prefixes as the table being cloned.  The
+ * radix trees are rebuilt from the binary keys directly and the values are
+ * copied by reference, i.e. both tables refer to the same Lua values.
  */
 
 static int
-iptm_counts(lua_State *L)
+iptm_clone(lua_State *L)
 {
     dbg_stack("inc(.) <--");               // [t]
 
     table_t *t = iptL_gettable(L, 1);
-    lua_pushinteger(L, t->count4);         // [t count4]
-    lua_pushinteger(L, t->count6);         // [t count4 count6]
+    table_t **c = lua_newuserdatauv(L, sizeof(void **), 1);  // [t c]
 
-    dbg_stack("out(2) ==>");
+    *c = tbl_clone(t, iptL_refpdup, L);
+    if (*c == NULL)
+        return lipt_error(L, LIPTE_BUF, 1, "");
 
-    return 2;                              // [.., count4, count6]
+    luaL_getmetatable(L, LUA_IPTABLE_ID);  // [t c M]
+    lua_setmetatable(L, -2);               // [t c]
+
+    dbg_stack("out(1) ==>");
+
+    return 1;                              // [.., c]
 }
 
 /*
- * ### `iter_kv`
+ * ### `iptm_compact`
  * ```c
- * static int iter_kv(lua_State *L);
+ * static int iptm_compact(lua_State *L);
  * ```
  * ```lua
  * -- lua
  * ipt = require"iptable".new()
- * ipt["1.1.1.1"] = 1
- * ipt["2001:abab::"] = 2
- *
- * for k,v in pairs(ipt) do print(k,v) end
- * --> 1.1.1.1       1
- * --> 2001:abab::   2
+ * ipt["10.10.10.0/24"] = 24
+ * bytes = ipt:compact()
  * ```
  *
- * Iterate across key,value-pairs in the table.  The first ipv4 or ipv6
- * leaf node is pushed.  The `iter_kv_f` iterator uses nextleaf to go through
- * all leafs of the tree.  It will traverse ipv6 as well if we started with the
- * ipv4 tree first.  If an errors occurs, it won't iterate anything and
- * `iptable.error` should provide some information.
+ * Rebuild the table's radix trees into freshly allocated, contiguous storage
+ * in key order, see `tbl_compact`.  Values are kept as-is.  Returns the
+ * estimated number of bytes reclaimed, or nil and an error message, e.g. when
+ * called while iterating the table.  Iterators that ran to completion only
+ * release the table when collected, so a full garbage collection cycle is
+ * done first if the table appears to be iterated.
  */
 
 static int
-iter_kv(lua_State *L)
+iptm_compact(lua_State *L)
 {
-    dbg_stack("inc(.) <--");             // [t], for k,v in pairs(t) do.. end
+    dbg_stack("inc(.) <--");               // [t]
 
     table_t *t = iptL_gettable(L, 1);
-    struct radix_node *rn = rdx_firstleaf(&t->head4->rh);
+    size_t bytes = 0;
 
-    /* cannot start with a deleted key */
-    while(rn && (rn->rn_flags & IPTF_DELETE))
-        rn = rdx_nextleaf(rn);
+    if (t->itr_lock)
+        lua_gc(L, LUA_GCCOLLECT);          // release finished iterators
+    if (t->itr_lock)
+        return lipt_error(L, LIPTE_BUSY, 1, "");
+    if (! tbl_compact(t, &bytes, L))
+        return lipt_error(L, LIPTE_BUF, 1, "");
 
-    /* switch to ipv6 if ipv4 is empty tree */
-    if (rn == NULL)
-        rn = rdx_firstleaf(&t->head6->rh);
+    lua_settop(L, 0);
+    lua_pushinteger(L, (lua_Integer)bytes);
 
-    /* cannot start with a deleted key */
-    while(rn && (rn->rn_flags & IPTF_DELETE))
-        rn = rdx_nextleaf(rn);
-
-    if (rn == NULL) return iter_error(L, LIPTE_NONE, "");
-
-    lua_pushlightuserdata(L, rn);        // [t rn], rn is 1st node
-    iptL_pushitrgc(L, t);                // [t rn gc], itr garbage collector
-    lua_pushcclosure(L, iter_kv_f, 2);   // [t f]
-    lua_rotate(L, 1, 1);                 // [f t]
-    lua_pushnil(L);                      // [f t nil]
-
-    dbg_stack("out(3) ==>");
+    dbg_stack("out(1) ==>");
 
-    return 3;                            // [iter_f invariant ctl_var]
+    return 1;                              // [bytes]
 }
 
 /*
- * ### `iter_more`
+ * ### `iptm_cache`
  * ```c
- * static int iter_more(lua_State *L);
+ * static int iptm_cache(lua_State *L);
  * ```
- * ``` lua
+ * ```lua
  * -- lua
  * ipt = require"iptable".new()
- * for prefix in ipt:more("10.10.10.0/24") do ... end
- * for prefix in ipt:more("10.10.10.0/24", true) do ... end
+ * ipt:cache(4096)                  --> 4096  0  0
+ * x = ipt["10.10.10.10"]
+ * x = ipt["10.10.10.10"]
+ * size, hits, misses = ipt:cache() --> 4096  1  1
+ * ipt:cache(0)                     --> 0  0  0 (disabled)
  * ```
  *
- * Iterate across more specific prefixes. AF_family is deduced from the
- * prefix given.  Note this traverses the entire tree if pfx has a /0 mask.
- *
- * The second optional argument may be used to include the search prefix in the
- * search results should it exist in tree.
+ * Get or set the size of the table's longest prefix match cache.  An
+ * optional size (rounded up to a power of 2) replaces the current cache, a
+ * size of 0 disables it.  Returns the cache's size, its number of hits and
+ * misses.  Any change of prefixes in the table invalidates the cache.
  */
 
 static int
-iter_more(lua_State *L)
+iptm_cache(lua_State *L)
 {
-    dbg_stack("inc(.) <--");  // [t pfx bool], bool is optional
-
-    size_t len = 0;
-    int af = AF_UNSPEC, mlen = -1, maxb = -1;
-    uint8_t addr[MAX_BINKEY], mask[MAX_BINKEY];
-    struct radix_node_head *head = NULL;
-    struct radix_node *rn = NULL, *top = NULL;
-    int inclusive = 0;
+    dbg_stack("inc(.) <--");               // [t [size]]
 
     table_t *t = iptL_gettable(L, 1);
-    const char *pfx = NULL;
-    if (! iptL_getpfxstr(L, 2, &pfx, &len))
-        return lipt_error(L, LIPTE_ARG, 2, "");
-
-    if (! key_bystr(addr, &mlen, &af, pfx))
-        return iter_error(L, LIPTE_PFX, "");
-
-    if (lua_gettop(L) == 3 && lua_isboolean(L, 3))
-      inclusive = lua_toboolean(L, 3);
-    if (af == AF_INET) {
-      head = t->head4;
-      mlen = mlen < 0 ? IP4_MAXMASK : mlen;
-    } else if (af == AF_INET6) {
-      head = t->head6;
-      mlen = mlen < 0 ? IP6_MAXMASK : mlen;
-    } else
-      return iter_error(L, LIPTE_AF, "");
-
-    if (! key_bylen(mask, mlen, af))
-        return iter_error(L, LIPTE_MLEN, "");
-    if (! key_network(addr, mask))
-        return iter_error(L, LIPTE_BINOP, "");
-    lua_pop(L, lua_gettop(L) - 1);                // [t]
-
-    maxb = (mlen > 0) ? -1 - IPT_KEYOFFSET - mlen : -2;
-    for(top = head->rh.rnh_treetop; !RDX_ISLEAF(top) && top->rn_bit >= maxb;)
-        if (addr[top->rn_offset] & top->rn_bmask)
-            top = top->rn_right;
-        else
-            top = top->rn_left;
+    lua_Integer size;
 
-    /* iter_more_f deals with IPTF_DELETE'd nodes */
-    for (rn = top->rn_parent; !RDX_ISLEAF(rn);)   /* first, left-most, leaf */
-        rn = rn->rn_left;
+    if (! lua_isnoneornil(L, 2)) {
+        size = luaL_checkinteger(L, 2);
+        if (size < 0)
+            return lipt_error(L, LIPTE_ARG, 3, "");
+        if (! tbl_cache(t, (size_t)size))
+            return lipt_error(L, LIPTE_BUF, 3, "");
+    }
 
-    /* iterator upvalues: sub-treetop, fst-leaf, inclusive, addr, mask */
-    lua_pushlightuserdata(L, top);  // stay below this node
-    lua_pushlightuserdata(L, rn);   // first possible match in subtree
-    lua_pushinteger(L, inclusive);
-    lua_pushlstring(L, (const char *)addr, (size_t)IPT_KEYLEN(addr));
-    lua_pushlstring(L, (const char *)mask, (size_t)IPT_KEYLEN(mask));
-    iptL_pushitrgc(L, t);
-    lua_pushcclosure(L, iter_more_f, 6);            // [t f]
-    lua_rotate(L, 1, 1);                          // [f t]
+    lua_settop(L, 0);
+    lua_pushinteger(L, t->cache ? t->cache->size : 0);
+    lua_pushinteger(L, t->cache ? t->cache->hits : 0);
+    lua_pushinteger(L, t->cache ? t->cache->misses : 0);
 
-    dbg_stack("out(1) ==>");
+    dbg_stack("out(3) ==>");
 
-    return 2;                                     // [iter_f invariant]
+    return 3;                              // [size hits misses]
 }
 
 /*
- * ### `iter_less`
+ * ### `iptm_hindex`
  * ```c
- * static int iter_less(lua_State *L);
+ * static int iptm_hindex(lua_State *L);
  * ```
  * ```lua
  * -- lua
  * ipt = require"iptable".new()
- * for prefix in ipt:less("10.10.10.10/26") do ... end
- * for prefix in ipt:less("10.10.10.10/26", true) do ... end
+ * ipt["10.10.10.0/24"] = 1
+ * ipt:hindex(true)                 --> 16  1
+ * size, count = ipt:hindex()       --> 16  1
+ * ipt:hindex(false)                --> 0  0 (disabled)
  * ```
  *
- * Iterate across prefixes in the tree that are less specific than pfx.  The
- * optional second argumnet, when true, causes the search prefix to be included
- * in the search results should it be present in the table itself.
+ * Get or set the state of the table's exact match index.  An optional
+ * boolean enables or disables the index.  When enabled, exact lookups like
+ * `ipt["10.10.10.0/24"]` use the index rather than the radix tree.  Returns
+ * the index's number of slots and the number of entries indexed.
  */
 
 static int
-iter_less(lua_State *L)
+iptm_hindex(lua_State *L)
 {
-    dbg_stack("inc(.) <--");  // [t pfx incl]
+    dbg_stack("inc(.) <--");               // [t [enable]]
 
     table_t *t = iptL_gettable(L, 1);
-    size_t len = 0;
-    int mlen = 0, inclusive = 0, af = AF_UNSPEC;
-    uint8_t addr[MAX_BINKEY];
-    const char *pfx = NULL;
-    char buf[MAX_STRKEY];
 
-    iptL_getpfxstr(L, 2, &pfx, &len);
-    if (pfx == NULL || len < 1)
-        return iter_error(L, LIPTE_ARG, "");
-
-    if (lua_gettop(L) > 2 && lua_isboolean(L, 3))
-      inclusive = lua_toboolean(L, 3);
-
-    lua_pop(L, lua_gettop(L) - 1);                        // [t]
-
-    if (! key_bystr(addr, &mlen, &af, pfx))
-        return iter_error(L, LIPTE_PFX, "");
-    if (! key_tostr(buf, addr))
-        return iter_error(L, LIPTE_PFX, "");
-
-    if (af == AF_INET)
-      mlen = mlen < 0 ? IP4_MAXMASK : mlen;
-    else if (af == AF_INET6)
-      mlen = mlen < 0 ? IP6_MAXMASK : mlen;
-    else
-      return iter_error(L, LIPTE_AF, "");
-
-    mlen = inclusive ? mlen : mlen -1;
-    if (mlen < 0)
-        // less specific than /0 is a no-op if not allowed to include self
-        return iter_error(L, LIPTE_NONE, "");
+    if (! lua_isnoneornil(L, 2)) {
+        luaL_checktype(L, 2, LUA_TBOOLEAN);
+        if (! tbl_hindex(t, lua_toboolean(L, 2)))
+            return lipt_error(L, LIPTE_BUF, 2, "");
+    }
 
-    lua_pushstring(L, buf);                              // [t pfx]
-    lua_pushinteger(L, mlen);                            // [t pfx mlen]
-    iptL_pushitrgc(L, t);                              // [t pfx mlen gc]
-    lua_pushcclosure(L, iter_less_f, 3);                 // [t f]
-    lua_rotate(L, 1, 1);                                 // [f t]
+    lua_settop(L, 0);
+    lua_pushinteger(L, t->index ? t->index->size : 0);
+    lua_pushinteger(L, t->index ? t->index->count : 0);
 
     dbg_stack("out(2) ==>");
 
-    return 2;     // [iter_f invariant] (ctl_var not needed)
+    return 2;                              // [size count]
 }
 
 /*
- * ### `iter_masks`
+ * ### `iptm_lookup`
  * ```c
- * static int iter_masks(lua_State *L);
+ * static int iptm_lookup(lua_State *L);
  * ```
  * ```lua
  * -- lua
- * iptable = require"iptable"
- * ipt = iptable.new()
- * for mask in ipt:masks(iptable.AF_INET4) do ... end
- * for mask in ipt:masks(iptable.AF_INET6) do ... end
+ * ipt = require"iptable".new()
+ * ipt["10.10.10.0/24"] = "ten"
+ * vals, n = ipt:lookup({"10.10.10.1", "11.11.11.11", "10.10.10.2"})
+ * --> {"ten", nil, "ten"}  2
+ * vals, n = ipt:lookup(addrs, 4)   -- use 4 threads from now on
  * ```
  *
- * Iterate across all masks used in the given `af`-family's radix tree.
- * Notes:
- *
- * - a mask tree stores masks in rn_key fields.
- * - a mask's KEYLEN is the nr of non-zero mask bytes, not a real LEN byte
- * - a /0 (zeromask) is never stored in the radix mask tree (!).
- * - a /0 (zeromask) is stored in ROOT(0.0.0.0)'s *last* dupedkey-chain leaf.
- * - the AF_family cannot be deduced from the mask in rn_key.
+ * Do a longest prefix match for each address in the array `addrs` and return
+ * an array with the values found, at the same indices as their addresses,
+ * plus the number of addresses that had a match.  Misses (and elements that
+ * are not strings or not valid addresses) leave a `nil` at their index.  Like
+ * `ipt[addr]`, a mask is ignored, but unlike indexing a prefix never means an
+ * exact match.
  *
- * So, the iteration function needs the AF to properly format masks for the
- * given family (an ipv6/24 mask would otherwise come out as 255.255.255.0) and
- * an explicit flag needs to be passed to iter_f that a zeromask entry is
- * present.
+ * The lookups are split across a pool of worker threads, created on first
+ * use with one thread per cpu unless the optional `threads` says otherwise.
+ * Giving a different number of threads later on replaces the pool.  Workers
+ * use read-only snapshots of the table, rebuilt only after the table changed,
+ * and only produce entries: the Lua values are resolved on the calling
+ * thread.  Since the snapshots take time to build, this pays off for large
+ * batches on a table that does not change between calls.
  */
 
-static
-int iter_masks(lua_State *L) { 
-
-    dbg_stack("inc(.) <--");                         // [t af]
-
-    uint8_t binmask[MAX_BINKEY];
-    char strmask[MAX_STRKEY];
+static int
+iptm_lookup(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [t addrs [threads]]
 
-    struct radix_node_head *rnh;
-    struct radix_node *rn;
-    int isnum = 0, af = AF_UNSPEC;
     table_t *t = iptL_gettable(L, 1);
-
-    if (lua_gettop(L) != 2)
-        return iter_error(L, LIPTE_AF, "");            // no AF_family
-
-    af = lua_tointegerx(L, 2, &isnum);
-    if (!isnum || AF_UNKNOWN(af))
-        return iter_error(L, LIPTE_AF, "");            // bad AF_family
-    lua_pop(L, 1);                                   // [t]
-
-    rnh = (af == AF_INET) ? t->head4 : t->head6;
-
-    /*
-     * Do an explicit check for a /0 mask in af_family's key-radix tree
-     *
-     * The mask_tree stores all the masks used in the radix tree (for actual
-     * keys), except for the /0 mask itself. Its use is only visible as the
-     * last dupedkey key child of the left-end marker having rn_bit == -1.
-     * (i.e. -1 - networkindex (of 0) == -1).
-     *
-     */
-
-    rn = &rnh->rnh_nodes[0];
-    while (rn->rn_dupedkey)
-        rn = rn->rn_dupedkey;
-    if (!RDX_ISROOT(rn) && rn->rn_bit == -1) {
-        if (! key_bylen(binmask, 0, af))
-            return iter_error(L, LIPTE_TOBIN, "");
-        if (! key_tostr(strmask, binmask))
-            return iter_error(L, LIPTE_TOSTR, "");
-    } else {
-        strmask[0] = '\0';
+    pool_t **pp;
+    const char **addrs;
+    entry_t **res;
+    lua_Integer threads = 0, n, matched = 0;
+
+    luaL_checktype(L, 2, LUA_TTABLE);
+    if (! lua_isnoneornil(L, 3)) {
+        threads = luaL_checkinteger(L, 3);
+        if (threads < 1)
+            return lipt_error(L, LIPTE_ARG, 2, "");
+        if (threads > POOL_MAXTHREADS) threads = POOL_MAXTHREADS;
+    }
+    lua_settop(L, 2);                      // [t addrs]
+
+    /* the pool lives on as the table's user value */
+    lua_getiuservalue(L, 1, 1);            // [t addrs P|nil]
+    if ((pp = luaL_testudata(L, 3, LUA_IPT_POOL)) == NULL) {
+        lua_pop(L, 1);                     // [t addrs]
+        pp = lua_newuserdatauv(L, sizeof(void **), 0);
+        *pp = NULL;
+        luaL_getmetatable(L, LUA_IPT_POOL);
+        lua_setmetatable(L, -2);           // [t addrs P]
+        lua_pushvalue(L, -1);              // [t addrs P P]
+        lua_setiuservalue(L, 1, 1);        // [t addrs P]
+    }
+    if (*pp && threads && (*pp)->nthreads + 1 != threads)
+        pool_destroy(pp);
+    if (*pp == NULL && (*pp = pool_create(t, (int)threads)) == NULL)
+        return lipt_error(L, LIPTE_BUF, 2, "");
+
+    /* collect the strings, they stay anchored in addrs */
+    n = luaL_len(L, 2);
+    addrs = lua_newuserdatauv(L, (n ? n : 1) * sizeof(char *), 0);
+    res = lua_newuserdatauv(L, (n ? n : 1) * sizeof(entry_t *), 0);
+    for (lua_Integer i = 0; i < n; i++) {  // [t addrs P A R]
+        lua_rawgeti(L, 2, i + 1);
+        addrs[i] = lua_type(L, -1) == LUA_TSTRING ? lua_tostring(L, -1) : NULL;
+        lua_pop(L, 1);
     }
 
-    /*
-     * find first leaf in mask tree, maybe NULL if all that is stored in the
-     * tree is a single, explicit 0/0 entry in which case only the zero-mask
-     * needs to be returned by iter_masks_f
-     *
-     */
+    if (! pool_lpm(*pp, addrs, (size_t)n, res))
+        return lipt_error(L, LIPTE_BUF, 2, "");
 
-    rn = rdx_firstleaf(&rnh->rh.rnh_masks->head);
-    lua_pushlightuserdata(L, rn);                    // [t rn]
-    lua_pushinteger(L, af);                          // [t rn af]
-    lua_pushstring(L, strmask);                      // [t rn af zm]
-    lua_pushcclosure(L, iter_masks_f, 3);            // [t f]
-    lua_rotate(L, 1, 1);                             // [f t]
+    /* resolve values on this thread */
+    lua_createtable(L, (int)n, 0);         // [t addrs P A R V]
+    for (lua_Integer i = 0; i < n; i++) {
+        if (res[i] == NULL) continue;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)res[i]->value);
+        lua_rawseti(L, -2, i + 1);
+        matched++;
+    }
+    lua_pushinteger(L, matched);           // [t addrs P A R V n]
 
     dbg_stack("out(2) ==>");
 
-    return 2;                                        // [iter_f invariant]
+    return 2;                              // [.., vals, n]
 }
 
 /*
- * ### `iter_supernets`
+ * ### `iptm_journal`
  * ```c
- * static int iter_supernets(lua_State *L);
+ * static int iptm_journal(lua_State *L);
  * ```
  * ```lua
  * -- lua
- * iptable = require"iptable"
- * ipt = iptable.new()
- * for super, group in ipt:supernets(iptable.AF_INET) do ... end
- * for super, group in ipt:supernets(iptable.AF_INET6) do ... end
+ * ipt = require"iptable".new()
+ * ipt:journal(1024)                --> 1024  0
+ * ipt["10.10.10.0/24"] = 1
+ * size, seq = ipt:journal()        --> 1024  1
+ * ipt:journal(0)                   --> 0  0 (disabled)
  * ```
  *
- * Iterate across pairs of pfx's that may be combined into their parental
- * supernet whose prefix length is 1 less than that of its subnets.  The
- * iterator returns the supernet prefix (string) and a regular Lua table that
- * contains either 2 of 3 prefix,value-pairs.  In case the supernet itself is
- * also present in the table, it's included the group table as well.
+ * Get or set the size of the table's change journal, a ring buffer holding
+ * the most recent changes to the table's prefixes, see `ipt:changes`.  An
+ * optional size (rounded up to a power of 2) replaces the current journal,
+ * keeping its sequence number, a size of 0 disables it.  Returns the
+ * journal's size and the sequence number of the last change recorded.
  */
 
 static int
-iter_supernets(lua_State *L)
+iptm_journal(lua_State *L)
 {
-    dbg_stack("inc(.) <--");                  // [t af]
+    dbg_stack("inc(.) <--");               // [t [size]]
 
-    struct radix_node *rn;
     table_t *t = iptL_gettable(L, 1);
-    int af = AF_UNSPEC;
-    iptL_getaf(L, 2, &af);
-
-    lua_pop(L, 1);                            // [t]
-    if (af == AF_INET)
-      rn = rdx_firstleaf(&t->head4->rh);
-    else if (af == AF_INET6)
-      rn = rdx_firstleaf(&t->head6->rh);
-    else
-      return iter_error(L, LIPTE_AF, "");
+    lua_Integer size;
+
+    if (! lua_isnoneornil(L, 2)) {
+        size = luaL_checkinteger(L, 2);
+        if (size < 0)
+            return lipt_error(L, LIPTE_ARG, 2, "");
+        if (! tbl_journal(t, (size_t)size))
+            return lipt_error(L, LIPTE_BUF, 2, "");
+    }
 
-    lua_pushlightuserdata(L, rn);             // [t af rn]
-    lua_pushlightuserdata(L, NULL);           // [t af rn NULL]
-    iptL_pushitrgc(L, t);                     // [t af rn NULL gc]
-    lua_pushcclosure(L, iter_supernets_f, 3);     // [t f]
-    lua_rotate(L, 1, -1);                     // [f t]
+    lua_settop(L, 0);
+    lua_pushinteger(L, t->journal ? (lua_Integer)t->journal->size : 0);
+    lua_pushinteger(L, t->journal ? (lua_Integer)t->journal->seq : 0);
 
     dbg_stack("out(2) ==>");
 
-    return 2;                                 // [iter_f invariant]
+    return 2;                              // [size seq]
 }
 
 /*
- * ### `iter_radixes`
+ * ### `iptm_snapshot`
  * ```c
- * static int iter_radixes(lua_State *L);
+ * static int iptm_snapshot(lua_State *L);
  * ```
  * ```lua
  * -- lua
- * iptable = require"iptable"
- * ipt = iptable.new()
- * for rdx in ipt:radixes(iptable.AF_INET) do ... end
- * for rdx in ipt:radixes(iptable.AF_INET6) do ... end
+ * ipt = require"iptable".new()
+ * ipt["10.10.10.0/24"] = 1
+ * snap = ipt:snapshot()
+ * ipt["10.10.10.0/24"] = 2
+ * snap["10.10.10.10"], ipt["10.10.10.10"]  --> 1  2
  * ```
  *
- * Iterate across all nodes of all types in the given af's radix tree.  By
- * default it will only iterate across the prefix-tree.  To include the
- * radix nodes of the associated mask-tree include a second argument that
- * evaluates to `true`.
- *
- * The iterator will return the C-structs as Lua tables and is used to graph
- * the radix trees.  Useful for debugging iptable's code and for getting the
- * hang of the radix structures built by [*FreeBSD*](https://freebsd.org)'s
- * `radix.c` code.
+ * Return an immutable snapshot of the table's current prefixes and values.
+ * The first snapshot enables the table's persistent tree, which takes time
+ * proportional to the table's size.  From then on, taking a snapshot takes
+ * constant time and each change of the table copies only the nodes on the
+ * path of the prefix changed that are still shared with some snapshot.
+ */
+
+static int
+iptm_snapshot(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [t]
+
+    table_t *t = iptL_gettable(L, 1);
+    snap_t **s = lua_newuserdatauv(L, sizeof(void **), 0);  // [t s]
+
+    if (! tbl_persist(t, 1, iptL_refpdup, L))
+        return lipt_error(L, LIPTE_BUF, 1, "");
+    if ((*s = tbl_snapshot(t)) == NULL)
+        return lipt_error(L, LIPTE_BUF, 1, "");
+
+    luaL_getmetatable(L, LUA_IPT_SNAP);    // [t s M]
+    lua_setmetatable(L, -2);               // [t s]
+
+    dbg_stack("out(1) ==>");
+
+    return 1;                              // [.., s]
+}
+
+/*
+ * ### `iptm_shape`
+ * ```c
+ * static int iptm_shape(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * ipt["10.10.10.0/24"] = 42
+ * ip4, ip6 = ipt:shape()
+ * ip4.entries, ip4.maxdepth, ip4.mem.total  --> 1  2  640
+ * ```
+ *
+ * Describe the shape of both radix trees, see `tbl_shape`.  Returns a table
+ * per tree with the counts `entries`, `tombstones`, `internal`, `chains`,
+ * `rmasks` and `masks`, the `maxdepth`, `avgdepth`, `maxchain` and
+ * `maxmklist`, the histograms `depth`, `chain` and `mklist` (mapping a depth
+ * or length to its count, only those present) and `mem`, a table with the
+ * bytes held by `entries`, `rmasks`, `masks`, `paths`, `heads` and their
+ * `total`.
+ */
+
+static int
+iptm_shape(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [t]
+
+    table_t *t = iptL_gettable(L, 1);
+    const char *hnames[] = {"depth", "chain", "mklist"};
+    size_t *hists[3];
+    shape_t s;
+
+    lua_settop(L, 0);
+    for (int i = 0; i < 2; i++) {
+        if (! tbl_shape(t, i ? AF_INET6 : AF_INET, &s))
+            return lipt_error(L, LIPTE_FAIL, 1, "");
+        hists[0] = s.depth, hists[1] = s.chain, hists[2] = s.mklist;
+
+        lua_createtable(L, 0, 15);                         // [S]
+        lua_pushinteger(L, (lua_Integer)s.entries);
+        lua_setfield(L, -2, "entries");
+        lua_pushinteger(L, (lua_Integer)s.tombstones);
+        lua_setfield(L, -2, "tombstones");
+        lua_pushinteger(L, (lua_Integer)s.internal);
+        lua_setfield(L, -2, "internal");
+        lua_pushinteger(L, (lua_Integer)s.chains);
+        lua_setfield(L, -2, "chains");
+        lua_pushinteger(L, (lua_Integer)s.rmasks);
+        lua_setfield(L, -2, "rmasks");
+        lua_pushinteger(L, (lua_Integer)s.masks);
+        lua_setfield(L, -2, "masks");
+        lua_pushinteger(L, (lua_Integer)s.maxdepth);
+        lua_setfield(L, -2, "maxdepth");
+        lua_pushnumber(L, s.entries ? (double)s.sumdepth / s.entries : 0.0);
+        lua_setfield(L, -2, "avgdepth");
+        lua_pushinteger(L, (lua_Integer)s.maxchain);
+        lua_setfield(L, -2, "maxchain");
+        lua_pushinteger(L, (lua_Integer)s.maxmklist);
+        lua_setfield(L, -2, "maxmklist");
+
+        for (int h = 0; h < 3; h++) {
+            lua_newtable(L);                               // [S H]
+            for (int n = 0; n < SHP_MAXLEN; n++) {
+                if (hists[h][n] == 0) continue;
+                lua_pushinteger(L, (lua_Integer)hists[h][n]);
+                lua_rawseti(L, -2, n);
+            }
+            lua_setfield(L, -2, hnames[h]);                // [S]
+        }
+
+        lua_createtable(L, 0, 6);                          // [S M]
+        lua_pushinteger(L, (lua_Integer)s.mem_entries);
+        lua_setfield(L, -2, "entries");
+        lua_pushinteger(L, (lua_Integer)s.mem_rmasks);
+        lua_setfield(L, -2, "rmasks");
+        lua_pushinteger(L, (lua_Integer)s.mem_masks);
+        lua_setfield(L, -2, "masks");
+        lua_pushinteger(L, (lua_Integer)s.mem_paths);
+        lua_setfield(L, -2, "paths");
+        lua_pushinteger(L, (lua_Integer)s.mem_heads);
+        lua_setfield(L, -2, "heads");
+        lua_pushinteger(L, (lua_Integer)(s.mem_entries + s.mem_rmasks
+                    + s.mem_masks + s.mem_paths + s.mem_heads));
+        lua_setfield(L, -2, "total");
+        lua_setfield(L, -2, "mem");                        // [S]
+    }
+
+    dbg_stack("out(2) ==>");
+
+    return 2;                              // [ip4 ip6]
+}
+
+/*
+ * ### `iptm_slice`
+ * ```c
+ * static int iptm_slice(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * ipt:slice(1000)                  --> 1000  0
+ * for k, _ in pairs(ipt) do ipt[k] = nil end
+ * ipt:slice()                      --> 1000  (number of deletions pending)
+ * ```
+ *
+ * Get or set the number of leaves the table visits per step when it removes
+ * prefixes deleted while it was being iterated.  By default (0) they are all
+ * removed at once when the last iterator is collected, which takes time
+ * proportional to the table's size.  With a slice, the collector only does a
+ * first step and the host does the rest using `ipt:step()`, e.g. once per tick
+ * of its event loop.  Returns the slice and the number of deletions pending.
+ */
+
+static int
+iptm_slice(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [t [n]]
+
+    table_t *t = iptL_gettable(L, 1);
+    lua_Integer n;
+
+    if (! lua_isnoneornil(L, 2)) {
+        n = luaL_checkinteger(L, 2);
+        if (n < 0)
+            return lipt_error(L, LIPTE_ARG, 2, "");
+        t->gcslice = (size_t)n;
+    }
+
+    lua_settop(L, 0);
+    lua_pushinteger(L, (lua_Integer)t->gcslice);
+    lua_pushinteger(L, (lua_Integer)t->ndel);
+
+    dbg_stack("out(2) ==>");
+
+    return 2;                              // [slice pending]
+}
+
+/*
+ * ### `iptm_step`
+ * ```c
+ * static int iptm_step(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * ipt:slice(1000)
+ * -- ..
+ * while ipt:step() do yield_to_event_loop() end
+ * ```
+ *
+ * Do one step of removing the table's pending deletions, visiting at most `n`
+ * leaves or, by default, the table's slice, see `tbl_gcstep`.  Nothing is
+ * removed while the table is being iterated.  Returns true if there is work
+ * left, false once all pending deletions are gone.
+ */
+
+static int
+iptm_step(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [t [n]]
+
+    table_t *t = iptL_gettable(L, 1);
+    lua_Integer n = luaL_optinteger(L, 2, (lua_Integer)t->gcslice);
+
+    if (n < 0)
+        return lipt_error(L, LIPTE_ARG, 2, "");
+
+    lua_settop(L, 0);
+    lua_pushboolean(L, tbl_gcstep(t, L, (size_t)n));
+
+    dbg_stack("out(1) ==>");
+
+    return 1;                              // [more]
+}
+
+/*
+ * ### `iptm_stats`
+ * ```c
+ * static int iptm_stats(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * ipt:stats(16)                    --> {every=16, set={..}, .., iter={..}}
+ * ipt["10.10.10.0/24"] = 42
+ * ipt:stats().set.p99              --> 812 (nanoseconds)
+ * ipt:stats(0)                     --> nil
+ * ```
+ *
+ * Get the latency statistics of the table, after optionally enabling them to
+ * time one in `every` operations (rounded up to a power of 2) or disabling
+ * them altogether with an `every` of 0, see `tbl_latency`.  Returns nil when
+ * disabled, otherwise a table with the sampling rate `every` and for each of
+ * `set`, `get`, `lpm`, `del` and `iter` (a step of `pairs`) a table with the
+ * number of operations seen (`ops`), timed (`samples`) and the `mean`,
+ * `p50`, `p99`, `p999` and `max` latency in nanoseconds.
+ */
+
+static int
+iptm_stats(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [t [every]]
+
+    const char *names[] = {"set", "get", "lpm", "del", "iter"};
+    const double qs[] = {0.5, 0.99, 0.999};
+    const char *qnames[] = {"p50", "p99", "p999"};
+    table_t *t = iptL_gettable(L, 1);
+    latency_t *lat;
+    lua_Integer n;
+
+    if (! lua_isnoneornil(L, 2)) {
+        n = luaL_checkinteger(L, 2);
+        if (n < 0)
+            return lipt_error(L, LIPTE_ARG, 1, "");
+        if (! tbl_latency(t, (size_t)n))
+            return lipt_error(L, LIPTE_FAIL, 1, "");
+    }
+
+    lua_settop(L, 0);
+    if ((lat = t->lat) == NULL) {
+        lua_pushnil(L);
+        return 1;                          // [nil]
+    }
+
+    lua_createtable(L, 0, LAT_NOPS + 1);               // [S]
+    lua_pushinteger(L, (lua_Integer)(lat->mask + 1));  // [S e]
+    lua_setfield(L, -2, "every");                      // [S]
+    for (int op = 0; op < LAT_NOPS; op++) {
+        lua_createtable(L, 0, 7);                      // [S o]
+        lua_pushinteger(L, (lua_Integer)lat->ops[op]);
+        lua_setfield(L, -2, "ops");
+        lua_pushinteger(L, (lua_Integer)lat->samples[op]);
+        lua_setfield(L, -2, "samples");
+        lua_pushnumber(L, lat->samples[op]
+                ? (double)lat->sum[op] / lat->samples[op] : 0.0);
+        lua_setfield(L, -2, "mean");
+        for (int q = 0; q < 3; q++) {
+            lua_pushinteger(L, (lua_Integer)tbl_latq(t, op, qs[q]));
+            lua_setfield(L, -2, qnames[q]);
+        }
+        lua_pushinteger(L, (lua_Integer)lat->max[op]);
+        lua_setfield(L, -2, "max");
+        lua_setfield(L, -2, names[op]);                // [S]
+    }
+
+    dbg_stack("out(1) ==>");
+
+    return 1;                              // [S]
+}
+
+/*
+ * ### `iptm_counts`
+ * ```c
+ * static int iptm_counts(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * ip4c, ip6c = ipt:counts()
+ * --> 0  0
+ * ```
+ *
+ * Return the number of entries in both the ipv4 and ipv6 radix tree.
+ */
+
+static int
+iptm_counts(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [t]
+
+    table_t *t = iptL_gettable(L, 1);
+    lua_pushinteger(L, t->count4);         // [t count4]
+    lua_pushinteger(L, t->count6);         // [t count4 count6]
+
+    dbg_stack("out(2) ==>");
+
+    return 2;                              // [.., count4, count6]
+}
+
+/*
+ * ### `iptm_addpath`
+ * ```c
+ * static int iptm_addpath(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * ipt["10.10.10.0/24"] = "ecmp"
+ * ipt:addpath("10.10.10.0/24", "gw1")     --> true
+ * ipt:addpath("10.10.10.0/24", "gw2", 3)  --> true
+ * ipt:addpath("11.11.11.0/24", "gw1")     --> nil, prefix not found
+ * ```
+ *
+ * Add a path with value `v` and an optional `weight` (default 1) to the
+ * multipath set of an existing prefix.  Returns true on success, nil and an
+ * error message otherwise.
+ */
+
+static int
+iptm_addpath(lua_State *L)
+{
+    dbg_stack("inc(.) <--");   // [t pfx v [w]]
+
+    const char *pfx = NULL;
+    size_t len = 0;
+    table_t *t = iptL_gettable(L, 1);
+    lua_Integer weight = luaL_optinteger(L, 4, 1);
+    int *refp = NULL;
+
+    if (! iptL_getpfxstr(L, 2, &pfx, &len))
+        return lipt_error(L, LIPTE_ARG, 1, "");
+    if (lua_isnoneornil(L, 3) || weight < 1 || weight > UINT32_MAX)
+        return lipt_error(L, LIPTE_ARG, 1, "");
+
+    lua_settop(L, 3);                         // [t pfx v]
+    refp = iptL_refpcreate(L);                // [t pfx]
+    if (! tbl_addpath(t, pfx, refp, (uint32_t)weight)) {
+        /* only a failure needs to know why */
+        iptL_refpdelete(L, (void **)&refp);
+        if (tbl_rawget(t, pfx) == NULL)
+            return lipt_error(L, LIPTE_NOPFX, 1, "");
+        return lipt_error(L, LIPTE_BUF, 1, "");
+    }
+    lua_pushboolean(L, 1);                    // [t pfx true]
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `iptm_delpath`
+ * ```c
+ * static int iptm_delpath(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt:delpath("10.10.10.0/24", "gw1")  --> true
+ * ```
+ *
+ * Remove the first path whose value equals `v` (raw equality) from the
+ * multipath set of a prefix.  Returns true on success, nil and an error
+ * message otherwise.
+ */
+
+static int
+iptm_delpath(lua_State *L)
+{
+    dbg_stack("inc(.) <--");   // [t pfx v]
+
+    const char *pfx = NULL;
+    size_t len = 0, idx;
+    table_t *t = iptL_gettable(L, 1);
+    entry_t *e;
+    mpath_t *mp;
+
+    if (! iptL_getpfxstr(L, 2, &pfx, &len))
+        return lipt_error(L, LIPTE_ARG, 1, "");
+    if ((e = tbl_rawget(t, pfx)) == NULL)
+        return lipt_error(L, LIPTE_NOPFX, 1, "");
+
+    lua_settop(L, 3);
+    mp = e->mpath;
+    for (idx = 0; mp && idx < mp->count; idx++) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)mp->path[idx].value);
+        if (lua_rawequal(L, 3, 4))
+            break;
+        lua_pop(L, 1);
+    }
+    if (mp == NULL || idx == mp->count)
+        return lipt_error(L, LIPTE_NOPATH, 1, "");
+
+    tbl_delpath(t, pfx, idx, L);
+    lua_settop(L, 0);
+    lua_pushboolean(L, 1);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `iptm_paths`
+ * ```c
+ * static int iptm_paths(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * values, weights = ipt:paths("10.10.10.0/24")
+ * --> {"gw1", "gw2"}  {1, 3}
+ * ```
+ *
+ * Return two arrays: the values and the weights of the paths of a prefix.
+ * Both are empty if the prefix exists but has no paths.
+ */
+
+static int
+iptm_paths(lua_State *L)
+{
+    dbg_stack("inc(.) <--");   // [t pfx]
+
+    const char *pfx = NULL;
+    size_t len = 0, count;
+    table_t *t = iptL_gettable(L, 1);
+    entry_t *e;
+
+    if (! iptL_getpfxstr(L, 2, &pfx, &len))
+        return lipt_error(L, LIPTE_ARG, 2, "");
+    if ((e = tbl_rawget(t, pfx)) == NULL)
+        return lipt_error(L, LIPTE_NOPFX, 2, "");
+
+    lua_settop(L, 0);
+    count = e->mpath ? e->mpath->count : 0;
+    lua_createtable(L, count, 0);              // [vals]
+    lua_createtable(L, count, 0);              // [vals weights]
+    for (size_t i = 0; i < count; i++) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)e->mpath->path[i].value);
+        lua_rawseti(L, 1, i + 1);
+        lua_pushinteger(L, e->mpath->path[i].weight);
+        lua_rawseti(L, 2, i + 1);
+    }
+
+    dbg_stack("out(2) ==>");
+
+    return 2;
+}
+
+/*
+ * ### `iptm_record`
+ * ```c
+ * static int iptm_record(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * ipt:record("ops.iptr", 0x5eed)   --> 0
+ * ipt["10.10.10.0/24"] = 42
+ * ipt:record()                     --> 1
+ * ```
+ *
+ * Start recording the table's operations to a trace file, optionally with
+ * its keys anonymized using the (non-zero integer) `secret`, or stop the
+ * recording when called without a filename, see `tbl_record`.  Records sets,
+ * gets, lookups, deletions, `pairs` iteration steps and the start and finish
+ * of all iterators, but no values.  Returns the number of records written to
+ * the trace that was stopped, if any, or 0.
+ */
+
+static int
+iptm_record(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [t [fname [secret]]]
+
+    table_t *t = iptL_gettable(L, 1);
+    const char *fname = luaL_optstring(L, 2, NULL);
+    lua_Integer secret = luaL_optinteger(L, 3, 0);
+    lua_Integer count = t->trace ? (lua_Integer)t->trace->count : 0;
+
+    if (! tbl_record(t, fname, (uint64_t)secret))
+        return lipt_error(L, LIPTE_FAIL, 1, "");
+
+    lua_settop(L, 0);
+    lua_pushinteger(L, count);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;                              // [count]
+}
+
+/*
+ * ### `iptm_select`
+ * ```c
+ * static int iptm_select(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt:select("10.10.10.10", flowhash)  --> "gw2"
+ * ```
+ *
+ * Do a longest prefix match for an address and, if the matching prefix has
+ * paths, return the value of the path selected by the flow hash (an integer
+ * taken modulo 2^32).  Otherwise return the value of the prefix itself.  The
+ * same hash always selects the same path as long as the paths don't change.
+ */
+
+static int
+iptm_select(lua_State *L)
+{
+    dbg_stack("inc(.) <--");   // [t addr hash]
+
+    const char *pfx = NULL;
+    size_t len = 0;
+    table_t *t = iptL_gettable(L, 1);
+    uint32_t hash = (uint32_t)luaL_checkinteger(L, 3);
+    void *v;
+
+    if (! iptL_getpfxstr(L, 2, &pfx, &len))
+        return lipt_error(L, LIPTE_ARG, 1, "");
+    if ((v = tbl_select(t, pfx, hash)) == NULL)
+        return 0;
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)v);  // [t addr hash v]
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `iter_changes`
+ * ```c
+ * static int iter_changes(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * ipt:journal(1024)
+ * ipt["10.10.10.0/24"] = 1
+ * ipt["10.10.10.0/24"] = nil
+ * for seq, prefix, op, v in ipt:changes(0) do ... end
+ * --> 1  10.10.10.0/24  set  nil
+ * --> 2  10.10.10.0/24  del  nil
+ * ```
+ *
+ * Iterate across the changes recorded in the table's journal after the one
+ * with sequence number `since` (default 0), yielding the sequence number,
+ * the prefix, the operation (`set` or `del`) and the prefix's current value.
+ * The last sequence number seen is where a consumer resumes next time.  If
+ * changes after `since` were overwritten, a single `seq, nil, "lost"` is
+ * yielded first, after which the consumer should resynchronize (e.g. using
+ * `ipt:diff`) and may carry on with the changes that follow `seq`.  Without a
+ * journal, nothing is iterated.
+ */
+
+static int
+iter_changes(lua_State *L)
+{
+    dbg_stack("inc(.) <--");             // [t [since]]
+
+    table_t *t = iptL_gettable(L, 1);
+    lua_Integer since = luaL_optinteger(L, 2, 0);
+
+    if (t->journal == NULL) return iter_error(L, LIPTE_NONE, "");
+    if (since < 0) return iter_error(L, LIPTE_ARG, "");
+    lua_settop(L, 1);                    // [t]
+
+    lua_pushinteger(L, since);           // [t since]
+    lua_pushcclosure(L, iter_changes_f, 1); // [t f]
+    lua_rotate(L, 1, 1);                 // [f t]
+    lua_pushnil(L);                      // [f t nil]
+
+    dbg_stack("out(3) ==>");
+
+    return 3;                            // [iter_f invariant ctl_var]
+}
+
+/*
+ * ### `iter_diff`
+ * ```c
+ * static int iter_diff(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * old = require"iptable".new()
+ * new = old:clone()
+ * new["10.10.10.0/24"] = "new"
+ * for prefix, op, oldv, newv in old:diff(new) do ... end
+ * --> 10.10.10.0/24  added  nil  new
+ * ```
+ *
+ * Iterate across the differences between this (old) table and another (new)
+ * one: prefixes that were `added`, `removed` or `changed`, in key order (ipv4
+ * first).  A prefix present in both tables has `changed` if its values are not
+ * equal according to the optional function `eq(oldv, newv)`, or `==` if
+ * absent.  Both tables' leafs are merged in a single pass and prefix strings
+ * are only created for the differences reported.  Deletions in either table
+ * during the iteration are deferred as usual.
+ */
+
+static int
+iter_diff(lua_State *L)
+{
+    dbg_stack("inc(.) <--");             // [t o [eq]]
+
+    table_t *a = iptL_gettable(L, 1);
+    table_t *b = iptL_gettable(L, 2);
+    diff_t *d;
+
+    if (! lua_isnoneornil(L, 3))
+        luaL_checktype(L, 3, LUA_TFUNCTION);
+    lua_settop(L, 3);                    // [t o eq]
+
+    d = lua_newuserdatauv(L, sizeof(diff_t), 0);  // [t o eq d]
+    if (! tbl_diffinit(d, a, b, iptL_valeq, L))
+        return iter_error(L, LIPTE_FAIL, "");
+    lua_rotate(L, 2, 1);                 // [t d o eq]
+    iptL_pushitrgc(L, a);                // [t d o eq gca]
+    iptL_pushitrgc(L, b);                // [t d o eq gca gcb]
+    lua_pushcclosure(L, iter_diff_f, 5); // [t f]
+    lua_rotate(L, 1, 1);                 // [f t]
+    lua_pushnil(L);                      // [f t nil]
+
+    dbg_stack("out(3) ==>");
+
+    return 3;                            // [iter_f invariant ctl_var]
+}
+
+/*
+ * ### `iter_kv`
+ * ```c
+ * static int iter_kv(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * ipt["1.1.1.1"] = 1
+ * ipt["2001:abab::"] = 2
+ *
+ * for k,v in pairs(ipt) do print(k,v) end
+ * --> 1.1.1.1       1
+ * --> 2001:abab::   2
+ * ```
+ *
+ * Iterate across key,value-pairs in the table.  The first ipv4 or ipv6
+ * leaf node is pushed.  The `iter_kv_f` iterator uses nextleaf to go through
+ * all leafs of the tree.  It will traverse ipv6 as well if we started with the
+ * ipv4 tree first.  If an errors occurs, it won't iterate anything and
+ * `iptable.error` should provide some information.
+ */
+
+static int
+iter_kv(lua_State *L)
+{
+    dbg_stack("inc(.) <--");             // [t], for k,v in pairs(t) do.. end
+
+    table_t *t = iptL_gettable(L, 1);
+    struct radix_node *rn = rdx_firstleaf(&t->head4->rh);
+
+    /* cannot start with a deleted key */
+    while(rn && (rn->rn_flags & IPTF_DELETE))
+        rn = rdx_nextleaf(rn);
+
+    /* switch to ipv6 if ipv4 is empty tree */
+    if (rn == NULL)
+        rn = rdx_firstleaf(&t->head6->rh);
+
+    /* cannot start with a deleted key */
+    while(rn && (rn->rn_flags & IPTF_DELETE))
+        rn = rdx_nextleaf(rn);
+
+    if (rn == NULL) return iter_error(L, LIPTE_NONE, "");
+
+    lua_pushlightuserdata(L, rn);        // [t rn], rn is 1st node
+    iptL_pushitrgc(L, t);                // [t rn gc], itr garbage collector
+    lua_pushcclosure(L, iter_kv_f, 2);   // [t f]
+    lua_rotate(L, 1, 1);                 // [f t]
+    lua_pushnil(L);                      // [f t nil]
+
+    dbg_stack("out(3) ==>");
+
+    return 3;                            // [iter_f invariant ctl_var]
+}
+
+/*
+ * ### `iter_more`
+ * ```c
+ * static int iter_more(lua_State *L);
+ * ```
+ * ``` lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * for prefix in ipt:more("10.10.10.0/24") do ... end
+ * for prefix in ipt:more("10.10.10.0/24", true) do ... end
+ * ```
+ *
+ * Iterate across more specific prefixes. AF_family is deduced from the
+ * prefix given.  Note this traverses the entire tree if pfx has a /0 mask.
+ *
+ * The second optional argument may be used to include the search prefix in the
+ * search results should it exist in tree.
+ */
+
+static int
+iter_more(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [t pfx bool], bool is optional
+
+    size_t len = 0;
+    int af = AF_UNSPEC, mlen = -1, maxb = -1;
+    uint8_t addr[MAX_BINKEY], mask[MAX_BINKEY];
+    struct radix_node_head *head = NULL;
+    struct radix_node *rn = NULL, *top = NULL;
+    int inclusive = 0;
+
+    table_t *t = iptL_gettable(L, 1);
+    const char *pfx = NULL;
+    if (! iptL_getpfxstr(L, 2, &pfx, &len))
+        return lipt_error(L, LIPTE_ARG, 2, "");
+
+    if (! key_bystr(addr, &mlen, &af, pfx))
+        return iter_error(L, LIPTE_PFX, "");
+
+    if (lua_gettop(L) == 3 && lua_isboolean(L, 3))
+      inclusive = lua_toboolean(L, 3);
+    if (af == AF_INET) {
+      head = t->head4;
+      mlen = mlen < 0 ? IP4_MAXMASK : mlen;
+    } else if (af == AF_INET6) {
+      head = t->head6;
+      mlen = mlen < 0 ? IP6_MAXMASK : mlen;
+    } else
+      return iter_error(L, LIPTE_AF, "");
+
+    if (! key_bylen(mask, mlen, af))
+        return iter_error(L, LIPTE_MLEN, "");
+    if (! key_network(addr, mask))
+        return iter_error(L, LIPTE_BINOP, "");
+    lua_pop(L, lua_gettop(L) - 1);                // [t]
+
+    maxb = (mlen > 0) ? -1 - IPT_KEYOFFSET - mlen : -2;
+    for(top = head->rh.rnh_treetop; !RDX_ISLEAF(top) && top->rn_bit >= maxb;)
+        if (addr[top->rn_offset] & top->rn_bmask)
+            top = top->rn_right;
+        else
+            top = top->rn_left;
+
+    /* iter_more_f deals with IPTF_DELETE'd nodes */
+    for (rn = top->rn_parent; !RDX_ISLEAF(rn);)   /* first, left-most, leaf */
+        rn = rn->rn_left;
+
+    /* iterator upvalues: sub-treetop, fst-leaf, inclusive, addr, mask */
+    lua_pushlightuserdata(L, top);  // stay below this node
+    lua_pushlightuserdata(L, rn);   // first possible match in subtree
+    lua_pushinteger(L, inclusive);
+    lua_pushlstring(L, (const char *)addr, (size_t)IPT_KEYLEN(addr));
+    lua_pushlstring(L, (const char *)mask, (size_t)IPT_KEYLEN(mask));
+    iptL_pushitrgc(L, t);
+    lua_pushcclosure(L, iter_more_f, 6);            // [t f]
+    lua_rotate(L, 1, 1);                          // [f t]
+
+    dbg_stack("out(1) ==>");
+
+    return 2;                                     // [iter_f invariant]
+}
+
+/*
+ * ### `iter_less`
+ * ```c
+ * static int iter_less(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * ipt = require"iptable".new()
+ * for prefix in ipt:less("10.10.10.10/26") do ... end
+ * for prefix in ipt:less("10.10.10.10/26", true) do ... end
+ * ```
+ *
+ * Iterate across prefixes in the tree that are less specific than pfx.  The
+ * optional second argumnet, when true, causes the search prefix to be included
+ * in the search results should it be present in the table itself.
+ */
+
+static int
+iter_less(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [t pfx incl]
+
+    table_t *t = iptL_gettable(L, 1);
+    size_t len = 0;
+    int mlen = 0, inclusive = 0, af = AF_UNSPEC;
+    uint8_t addr[MAX_BINKEY];
+    const char *pfx = NULL;
+    char buf[MAX_STRKEY];
+
+    iptL_getpfxstr(L, 2, &pfx, &len);
+    if (pfx == NULL || len < 1)
+        return iter_error(L, LIPTE_ARG, "");
+
+    if (lua_gettop(L) > 2 && lua_isboolean(L, 3))
+      inclusive = lua_toboolean(L, 3);
+
+    lua_pop(L, lua_gettop(L) - 1);                        // [t]
+
+    if (! key_bystr(addr, &mlen, &af, pfx))
+        return iter_error(L, LIPTE_PFX, "");
+    if (! key_tostr(buf, addr))
+        return iter_error(L, LIPTE_PFX, "");
+
+    if (af == AF_INET)
+      mlen = mlen < 0 ? IP4_MAXMASK : mlen;
+    else if (af == AF_INET6)
+      mlen = mlen < 0 ? IP6_MAXMASK : mlen;
+    else
+      return iter_error(L, LIPTE_AF, "");
+
+    mlen = inclusive ? mlen : mlen -1;
+    if (mlen < 0)
+        // less specific than /0 is a no-op if not allowed to include self
+        return iter_error(L, LIPTE_NONE, "");
+
+    lua_pushstring(L, buf);                              // [t pfx]
+    lua_pushinteger(L, mlen);                            // [t pfx mlen]
+    iptL_pushitrgc(L, t);                              // [t pfx mlen gc]
+    lua_pushcclosure(L, iter_less_f, 3);                 // [t f]
+    lua_rotate(L, 1, 1);                                 // [f t]
+
+    dbg_stack("out(2) ==>");
+
+    return 2;     // [iter_f invariant] (ctl_var not needed)
+}
+
+/*
+ * ### `iter_masks`
+ * ```c
+ * static int iter_masks(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * iptable = require"iptable"
+ * ipt = iptable.new()
+ * for mask in ipt:masks(iptable.AF_INET4) do ... end
+ * for mask in ipt:masks(iptable.AF_INET6) do ... end
+ * ```
+ *
+ * Iterate across all masks used in the given `af`-family's radix tree.
+ * Notes:
+ *
+ * - a mask tree stores masks in rn_key fields.
+ * - a mask's KEYLEN is the nr of non-zero mask bytes, not a real LEN byte
+ * - a /0 (zeromask) is never stored in the radix mask tree (!).
+ * - a /0 (zeromask) is stored in ROOT(0.0.0.0)'s *last* dupedkey-chain leaf.
+ * - the AF_family cannot be deduced from the mask in rn_key.
+ *
+ * So, the iteration function needs the AF to properly format masks for the
+ * given family (an ipv6/24 mask would otherwise come out as 255.255.255.0) and
+ * an explicit flag needs to be passed to iter_f that a zeromask entry is
+ * present.
+ */
+
+static
+int iter_masks(lua_State *L) { 
+
+    dbg_stack("inc(.) <--");                         // [t af]
+
+    uint8_t binmask[MAX_BINKEY];
+    char strmask[MAX_STRKEY];
+
+    struct radix_node_head *rnh;
+    struct radix_node *rn;
+    int isnum = 0, af = AF_UNSPEC;
+    table_t *t = iptL_gettable(L, 1);
+
+    if (lua_gettop(L) != 2)
+        return iter_error(L, LIPTE_AF, "");            // no AF_family
+
+    af = lua_tointegerx(L, 2, &isnum);
+    if (!isnum || AF_UNKNOWN(af))
+        return iter_error(L, LIPTE_AF, "");            // bad AF_family
+    lua_pop(L, 1);                                   // [t]
+
+    rnh = (af == AF_INET) ? t->head4 : t->head6;
+
+    /*
+     * Do an explicit check for a /0 mask in af_family's key-radix tree
+     *
+     * The mask_tree stores all the masks used in the radix tree (for actual
+     * keys), except for the /0 mask itself. Its use is only visible as the
+     * last dupedkey key child of the left-end marker having rn_bit == -1.
+     * (i.e. -1 - networkindex (of 0) == -1).
+     *
+     */
+
+    rn = &rnh->rnh_nodes[0];
+    while (rn->rn_dupedkey)
+        rn = rn->rn_dupedkey;
+    if (!RDX_ISROOT(rn) && rn->rn_bit == -1) {
+        if (! key_bylen(binmask, 0, af))
+            return iter_error(L, LIPTE_TOBIN, "");
+        if (! key_tostr(strmask, binmask))
+            return iter_error(L, LIPTE_TOSTR, "");
+    } else {
+        strmask[0] = '\0';
+    }
+
+    /*
+     * find first leaf in mask tree, maybe NULL if all that is stored in the
+     * tree is a single, explicit 0/0 entry in which case only the zero-mask
+     * needs to be returned by iter_masks_f
+     *
+     */
+
+    rn = rdx_firstleaf(&rnh->rh.rnh_masks->head);
+    lua_pushlightuserdata(L, rn);                    // [t rn]
+    lua_pushinteger(L, af);                          // [t rn af]
+    lua_pushstring(L, strmask);                      // [t rn af zm]
+    lua_pushcclosure(L, iter_masks_f, 3);            // [t f]
+    lua_rotate(L, 1, 1);                             // [f t]
+
+    dbg_stack("out(2) ==>");
+
+    return 2;                                        // [iter_f invariant]
+}
+
+/*
+ * ### `iter_supernets`
+ * ```c
+ * static int iter_supernets(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * iptable = require"iptable"
+ * ipt = iptable.new()
+ * for super, group in ipt:supernets(iptable.AF_INET) do ... end
+ * for super, group in ipt:supernets(iptable.AF_INET6) do ... end
+ * ```
+ *
+ * Iterate across pairs of pfx's that may be combined into their parental
+ * supernet whose prefix length is 1 less than that of its subnets.  The
+ * iterator returns the supernet prefix (string) and a regular Lua table that
+ * contains either 2 of 3 prefix,value-pairs.  In case the supernet itself is
+ * also present in the table, it's included the group table as well.
+ */
+
+static int
+iter_supernets(lua_State *L)
+{
+    dbg_stack("inc(.) <--");                  // [t af]
+
+    struct radix_node *rn;
+    table_t *t = iptL_gettable(L, 1);
+    int af = AF_UNSPEC;
+    iptL_getaf(L, 2, &af);
+
+    lua_pop(L, 1);                            // [t]
+    if (af == AF_INET)
+      rn = rdx_firstleaf(&t->head4->rh);
+    else if (af == AF_INET6)
+      rn = rdx_firstleaf(&t->head6->rh);
+    else
+      return iter_error(L, LIPTE_AF, "");
+
+    lua_pushlightuserdata(L, rn);             // [t af rn]
+    lua_pushlightuserdata(L, NULL);           // [t af rn NULL]
+    iptL_pushitrgc(L, t);                     // [t af rn NULL gc]
+    lua_pushcclosure(L, iter_supernets_f, 3);     // [t f]
+    lua_rotate(L, 1, -1);                     // [f t]
+
+    dbg_stack("out(2) ==>");
+
+    return 2;                                 // [iter_f invariant]
+}
+
+/*
+ * ### `iter_radixes`
+ * ```c
+ * static int iter_radixes(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * iptable = require"iptable"
+ * ipt = iptable.new()
+ * for rdx in ipt:radixes(iptable.AF_INET) do ... end
+ * for rdx in ipt:radixes(iptable.AF_INET6) do ... end
+ * ```
+ *
+ * Iterate across all nodes of all types in the given af's radix tree.  By
+ * default it will only iterate across the prefix-tree.  To include the
+ * radix nodes of the associated mask-tree include a second argument that
+ * evaluates to `true`.
+ *
+ * The iterator will return the C-structs as Lua tables and is used to graph
+ * the radix trees.  Useful for debugging iptable's code and for getting the
+ * hang of the radix structures built by [*FreeBSD*](https://freebsd.org)'s
+ * `radix.c` code.
  */
 
 static int
 iter_radixes(lua_State *L)
 {
-    dbg_stack("inc(.) <--");                        // [t af maskp]
+    dbg_stack("inc(.) <--");                        // [t af maskp]
+
+    table_t *t = iptL_gettable(L, 1);
+    int maskp = lua_toboolean(L, 3);
+    int af = AF_UNSPEC;
+
+    iptL_getaf(L, 2, &af);
+    if (AF_UNKNOWN(af))
+        return iter_error(L, LIPTE_AF, "");
+
+    /* pushes af_fam's radix_node_head onto t's stack */
+    if (! rdx_firstnode(t, af))
+        return iter_error(L, LIPTE_NONE, "");
+
+    /* maskp & itr_gc as upvalues for iterator */
+    lua_settop(L, 1);                                // [t]
+    lua_pushboolean(L, maskp);                       // [t maskp]
+    iptL_pushitrgc(L, t);                            // [t maskp {}]
+    lua_pushcclosure(L, iter_radix, 2);              // [t f]
+    lua_rotate(L, 1, 1);                             // [f t]
+
+    dbg_stack("out(2) ==>");
+
+    return 2;                                       // [iter_f invariant]
+}
+
+/*
+ * ## range methods
+ *
+ * A range table (see `iptable.ranges`) maps disjoint start-stop address
+ * intervals to Lua values.  Unlike an iptable, its intervals need not align
+ * with prefix boundaries.
+ */
+
+/*
+ * ### `rngm_gc`
+ * ```c
+ * static int rngm_gc(lua_State *L);
+ * ```
+ *
+ * Garbage collector function (`__gc`) for the `LUA_IPRANGE_ID` metatable.
+ */
+
+static int
+rngm_gc(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [r]
+
+    range_t *r = iptL_getrange(L, 1);
+    rng_destroy(&r, L);
+
+    dbg_stack("out(0) ==>");
+
+    return 0;
+}
+
+/*
+ * ### `rngm_index`
+ * ```c
+ * static int rngm_index(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * rng = iptable.ranges()
+ * rng:set("10.10.10.10", "10.10.10.20", "odd")
+ * rng["10.10.10.15"]  --> odd
+ * rng["10.10.10.21"]  --> nil
+ * ```
+ *
+ * Given an index `k`, return the value of the interval containing address `k`
+ * or, if `k` is not an address, do a metatable lookup for the method named by
+ * `k`.
+ */
+
+static int
+rngm_index(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [r k]
+
+    uint8_t addr[MAX_BINKEY];
+    range_t *r = iptL_getrange(L, 1);
+    interval_t *ivl;
+
+    if (lua_type(L, 2) != LUA_TSTRING)
+        return lipt_error(L, LIPTE_ARG, 1, "");
+
+    if (iptL_getaddr(L, 2, addr)) {
+        if ((ivl = rng_get(r, addr)) == NULL)
+            return 0;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)ivl->value); // [r k v]
+    } else if (luaL_getmetafield(L, 1, lua_tostring(L, 2)) == LUA_TNIL)
+        return 0;
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `rngm_len`
+ * ```c
+ * static int rngm_len(lua_State *L);
+ * ```
+ *
+ * Return the total number of ipv4 and ipv6 intervals as the 'length' of the
+ * range table.
+ */
+
+static int
+rngm_len(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [r]
+
+    range_t *r = iptL_getrange(L, 1);
+    lua_pushinteger(L, r->count4 + r->count6);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `rngm_tostring`
+ * ```c
+ * static int rngm_tostring(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * iptable.ranges()  -- iprange{#ipv4=0, #ipv6=0}
+ * ```
+ */
+
+static int
+rngm_tostring(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [r]
+
+    range_t *r = iptL_getrange(L, 1);
+    lua_pushfstring(L, "iprange{#ipv4=%I, #ipv6=%I}",
+                    (lua_Integer)r->count4, (lua_Integer)r->count6);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `rngm_counts`
+ * ```c
+ * static int rngm_counts(lua_State *L);
+ * ```
+ *
+ * Return the number of ipv4 and ipv6 intervals.
+ */
+
+static int
+rngm_counts(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [r]
+
+    range_t *r = iptL_getrange(L, 1);
+    lua_pushinteger(L, r->count4);         // [r count4]
+    lua_pushinteger(L, r->count6);         // [r count4 count6]
+
+    dbg_stack("out(2) ==>");
+
+    return 2;                              // [.., count4, count6]
+}
+
+/*
+ * ### `rngm_set`
+ * ```c
+ * static int rngm_set(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * rng = iptable.ranges()
+ * rng:set("10.10.10.10", "10.10.10.20", "odd")  --> true
+ * rng:set("10.10.10.20", "10.10.10.30", "odd")  --> nil, errmsg (overlap)
+ * rng:set("10.10.10.10", "10.10.10.20", nil)    --> true (deleted)
+ * ```
+ *
+ * Store value `v` for the interval `start`-`stop` (inclusive).  The exact same
+ * interval has its value replaced, while an interval overlapping any other
+ * interval is refused.  A nil value deletes the (exact) interval.  Returns
+ * true on success, nil and an error message otherwise.
+ */
+
+static int
+rngm_set(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [r start stop v]
+
+    uint8_t start[MAX_BINKEY], stop[MAX_BINKEY];
+    range_t *r = iptL_getrange(L, 1);
+    int *refp = NULL;
+
+    if (! iptL_getaddr(L, 2, start) || ! iptL_getaddr(L, 3, stop))
+        return lipt_error(L, LIPTE_PFX, 1, "");
+
+    lua_settop(L, 4);
+    if (lua_isnil(L, 4)) {
+        if (! rng_del(r, start, stop, L))
+            return lipt_error(L, LIPTE_RANGE, 1, "");
+    } else {
+        refp = iptL_refpcreate(L);           // [r start stop]
+        if (! rng_set(r, start, stop, refp, L)) {
+            iptL_refpdelete(L, (void **)&refp);
+            return lipt_error(L, LIPTE_RANGE, 1, "");
+        }
+    }
+    lua_pushboolean(L, 1);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `rngm_load`
+ * ```c
+ * static int rngm_load(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * rng = iptable.ranges()
+ * rng:load({{"10.0.0.1", "10.0.0.9", 1}, {"2001:db8::", "2001:db8::ff", 2}})
+ * --> true
+ * ```
+ *
+ * Bulk load a list of `{start, stop, value}` intervals in one go, which is
+ * much faster than setting them one by one.  The load is all or nothing: if
+ * any interval is invalid or overlaps with another, nothing is added.  Returns
+ * true on success, nil and an error message otherwise.
+ */
+
+static int
+rngm_load(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [r list]
+
+    range_t *r = iptL_getrange(L, 1);
+    interval_t *ivl;
+    size_t n, i;
+    int err = LIPTE_NONE;
+
+    if (lua_type(L, 2) != LUA_TTABLE)
+        return lipt_error(L, LIPTE_ARG, 1, "");
+
+    lua_settop(L, 2);
+    n = lua_rawlen(L, 2);
+    if (n == 0) {
+        lua_pushboolean(L, 1);
+        return 1;
+    }
+    if ((ivl = calloc(n, sizeof(interval_t))) == NULL)
+        return lipt_error(L, LIPTE_BUF, 1, "");
+
+    for (i = 0; i < n; i++) {
+        lua_rawgeti(L, 2, i + 1);              // [r list e]
+        if (lua_type(L, 3) != LUA_TTABLE) {
+            err = LIPTE_ARG;
+            break;
+        }
+        lua_rawgeti(L, 3, 1);                  // [r list e start]
+        lua_rawgeti(L, 3, 2);                  // [r list e start stop]
+        if (! iptL_getaddr(L, 4, ivl[i].start) ||
+            ! iptL_getaddr(L, 5, ivl[i].stop)) {
+            err = LIPTE_PFX;
+            break;
+        }
+        lua_settop(L, 3);
+        if (lua_rawgeti(L, 3, 3) == LUA_TNIL) { // [r list e v]
+            err = LIPTE_ARG;
+            break;
+        }
+        ivl[i].value = iptL_refpcreate(L);     // [r list e]
+        lua_settop(L, 2);                      // [r list]
+    }
+
+    if (err == LIPTE_NONE && ! rng_load(r, ivl, n))
+        err = LIPTE_RANGE;
+
+    if (err != LIPTE_NONE) {
+        /* intervals may have been sorted, so check all of them */
+        for (size_t j = 0; j < n; j++)
+            iptL_refpdelete(L, &ivl[j].value);
+        free(ivl);
+        return lipt_error(L, err, 1, "");
+    }
+
+    free(ivl);
+    lua_settop(L, 0);
+    lua_pushboolean(L, 1);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `rngm_find`
+ * ```c
+ * static int rngm_find(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * rng = iptable.ranges()
+ * rng:set("10.10.10.10", "10.10.10.20", "odd")
+ * rng:find("10.10.10.15")  --> 10.10.10.10  10.10.10.20  odd
+ * ```
+ *
+ * Return the start, stop and value of the interval containing the address
+ * given, or nothing if there is no such interval.
+ */
+
+static int
+rngm_find(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [r addr]
+
+    char buf[MAX_STRKEY];
+    uint8_t addr[MAX_BINKEY];
+    range_t *r = iptL_getrange(L, 1);
+    interval_t *ivl;
+
+    if (! iptL_getaddr(L, 2, addr))
+        return lipt_error(L, LIPTE_PFX, 3, "");
+
+    if ((ivl = rng_get(r, addr)) == NULL)
+        return 0;
+
+    lua_settop(L, 0);
+    lua_pushstring(L, key_tostr(buf, ivl->start));          // [start]
+    lua_pushstring(L, key_tostr(buf, ivl->stop));           // [start stop]
+    lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)ivl->value);  // [start stop v]
+
+    dbg_stack("out(3) ==>");
+
+    return 3;
+}
+
+/*
+ * ### `rngm_totable`
+ * ```c
+ * static int rngm_totable(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * rng = iptable.ranges()
+ * rng:set("10.10.10.10", "10.10.10.20", "odd")
+ * for k, v in pairs(rng:totable()) do print(k, v) end
+ * --> 10.10.10.10/31  odd
+ * --> 10.10.10.12/30  odd
+ * --> 10.10.10.16/30  odd
+ * --> 10.10.10.20/32  odd
+ * ```
+ *
+ * Return a new iptable with each interval split into the smallest set of
+ * prefixes that cover it exactly.
+ */
+
+static int
+rngm_totable(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [r]
+
+    range_t *r = iptL_getrange(L, 1);
+    table_t **t = lua_newuserdatauv(L, sizeof(void **), 1);  // [r t]
+
+    *t = tbl_create(iptL_refpdelete);
+    if (*t == NULL)
+        return lipt_error(L, LIPTE_BUF, 1, "");
+
+    luaL_getmetatable(L, LUA_IPTABLE_ID);  // [r t M]
+    lua_setmetatable(L, -2);               // [r t]
+
+    if (! rng_totbl(r, *t, iptL_refpdup, L))
+        return lipt_error(L, LIPTE_BUF, 1, "");
+
+    dbg_stack("out(1) ==>");
+
+    return 1;                              // [.., t]
+}
+
+/*
+ * ### `iter_intervals`
+ * ```c
+ * static int iter_intervals(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * for start, stop, v in rng:intervals() do ... end
+ * for start, stop, v in rng:intervals(iptable.AF_INET6) do ... end
+ * ```
+ *
+ * Iterate across the intervals in order of their start address, optionally
+ * for a single AF family only.  By default, ipv4 intervals are yielded before
+ * those for ipv6.
+ */
+
+static int
+iter_intervals(lua_State *L)
+{
+    dbg_stack("inc(.) <--");                 // [r [af]]
 
-    table_t *t = iptL_gettable(L, 1);
-    int maskp = lua_toboolean(L, 3);
     int af = AF_UNSPEC;
 
-    iptL_getaf(L, 2, &af);
-    if (AF_UNKNOWN(af))
-        return iter_error(L, LIPTE_AF, "");
+    iptL_getrange(L, 1);
+    if (! lua_isnoneornil(L, 2))
+        if (! iptL_getaf(L, 2, &af) || AF_UNKNOWN(af))
+            return iter_error(L, LIPTE_AF, "");
 
-    /* pushes af_fam's radix_node_head onto t's stack */
-    if (! rdx_firstnode(t, af))
-        return iter_error(L, LIPTE_NONE, "");
+    lua_settop(L, 1);                        // [r]
+    lua_pushinteger(L, af == AF_INET6 ? AF_INET6 : AF_INET);
+    lua_pushinteger(L, 0);                   // [r af idx]
+    lua_pushboolean(L, af == AF_UNSPEC);     // [r af idx both]
+    lua_pushcclosure(L, iter_intervals_f, 3);// [r f]
+    lua_rotate(L, 1, 1);                     // [f r]
 
-    /* maskp & itr_gc as upvalues for iterator */
-    lua_settop(L, 1);                                // [t]
-    lua_pushboolean(L, maskp);                       // [t maskp]
-    iptL_pushitrgc(L, t);                            // [t maskp {}]
-    lua_pushcclosure(L, iter_radix, 2);              // [t f]
-    lua_rotate(L, 1, 1);                             // [f t]
+    dbg_stack("out(2) ==>");
+
+    return 2;                                // [iter_f invariant]
+}
+
+/*
+ * ## snapshot methods
+ *
+ * A snapshot (see `ipt:snapshot`) is a read-only view of an iptable as it was
+ * when the snapshot was taken.  It supports indexing, `#`, `pairs` and
+ * `counts` just like the iptable it came from, but cannot be modified.
+ */
+
+/*
+ * ### `snpm_gc`
+ * ```c
+ * static int snpm_gc(lua_State *L);
+ * ```
+ *
+ * Garbage collector function (`__gc`) for the `LUA_IPT_SNAP` metatable.
+ */
+
+static int
+snpm_gc(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [s]
+
+    snap_t *s = iptL_getsnap(L, 1);
+    snp_destroy(&s, L);
+
+    dbg_stack("out(0) ==>");
+
+    return 0;
+}
+
+/*
+ * ### `snpm_index`
+ * ```c
+ * static int snpm_index(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * snap = ipt:snapshot()
+ * snap["10.10.10.10"]    --> longest prefix match
+ * snap["10.10.10.0/24"]  --> exact match
+ * ```
+ *
+ * Given an index `k`, do a longest prefix match if `k` is a prefix without a
+ * mask, an exact match if it has a mask or, otherwise, a metatable lookup for
+ * the method named by `k`.
+ */
+
+static int
+snpm_index(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [s k]
+
+    uint8_t addr[MAX_BINKEY];
+    int mlen = -1, af = AF_UNSPEC;
+    size_t len = 0;
+    const char *pfx = NULL;
+    snap_t *s = iptL_getsnap(L, 1);
+    ptnode_t *n = NULL;
+
+    if (! iptL_getpfxstr(L, 2, &pfx, &len))
+        return lipt_error(L, LIPTE_ARG, 1, "");
+
+    if (key_bystr(addr, &mlen, &af, pfx))
+        n = strchr(pfx, '/') ? snp_get(s, addr, mlen) : snp_lpm(s, addr);
+
+    if (n)
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)n->val->value); // [s k v]
+    else if (luaL_getmetafield(L, 1, pfx) == LUA_TNIL)
+        return 0;
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `snpm_newindex`
+ * ```c
+ * static int snpm_newindex(lua_State *L);
+ * ```
+ *
+ * A snapshot is read-only, so any assignment raises an error.
+ */
+
+static int
+snpm_newindex(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [s k v]
+
+    iptL_getsnap(L, 1);
+
+    return luaL_error(L, "iptsnap is read-only");
+}
+
+/*
+ * ### `snpm_len`
+ * ```c
+ * static int snpm_len(lua_State *L);
+ * ```
+ *
+ * Return the total number of ipv4 and ipv6 prefixes in the snapshot.
+ */
+
+static int
+snpm_len(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [s]
+
+    snap_t *s = iptL_getsnap(L, 1);
+    lua_pushinteger(L, s->count4 + s->count6);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `snpm_tostring`
+ * ```c
+ * static int snpm_tostring(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * iptable.new():snapshot()  -- iptsnap{#ipv4=0, #ipv6=0}
+ * ```
+ */
+
+static int
+snpm_tostring(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [s]
+
+    snap_t *s = iptL_getsnap(L, 1);
+    lua_pushfstring(L, "iptsnap{#ipv4=%I, #ipv6=%I}",
+                    (lua_Integer)s->count4, (lua_Integer)s->count6);
+
+    dbg_stack("out(1) ==>");
+
+    return 1;
+}
+
+/*
+ * ### `snpm_counts`
+ * ```c
+ * static int snpm_counts(lua_State *L);
+ * ```
+ *
+ * Return the number of ipv4 and ipv6 prefixes in the snapshot.
+ */
+
+static int
+snpm_counts(lua_State *L)
+{
+    dbg_stack("inc(.) <--");               // [s]
+
+    snap_t *s = iptL_getsnap(L, 1);
+    lua_pushinteger(L, s->count4);         // [s count4]
+    lua_pushinteger(L, s->count6);         // [s count4 count6]
 
     dbg_stack("out(2) ==>");
 
-    return 2;                                       // [iter_f invariant]
+    return 2;                              // [.., count4, count6]
+}
+
+/*
+ * ### `iter_snap`
+ * ```c
+ * static int iter_snap(lua_State *L);
+ * ```
+ * ```lua
+ * -- lua
+ * for pfx, v in pairs(ipt:snapshot()) do ... end
+ * ```
+ *
+ * Iterate across the prefix,value-pairs of a snapshot, ipv4 before ipv6.
+ * Unlike `pairs(ipt)`, a prefix is yielded before the more specifics it
+ * covers.  Since a snapshot never changes, the table it came from can be
+ * modified freely during the iteration.
+ */
+
+static int
+iter_snap(lua_State *L)
+{
+    dbg_stack("inc(.) <--");                 // [s]
+
+    snap_t *s = iptL_getsnap(L, 1);
+    snpitr_t *itr = lua_newuserdatauv(L, sizeof(snpitr_t), 0); // [s itr]
+
+    lua_pushlightuserdata(L, snp_first(s, itr));  // [s itr n]
+    lua_pushcclosure(L, iter_snap_f, 2);     // [s f]
+    lua_rotate(L, 1, 1);                     // [f s]
+
+    dbg_stack("out(2) ==>");
+
+    return 2;                                // [iter_f invariant]
 }
 
+/*
+ * ### `iter_snap_f`
+ * ```c
+ * static int iter_snap_f(lua_State *L);
+ * ```
+ *
+ * The actual iterator function for `iter_snap`, yields the next prefix and
+ * its value.  Notes:
+ *
+ * - upvalue(1) is the walk's state, a `snpitr_t` userdata
+ * - upvalue(2) is the node to yield next, NULL when done
+ *
+ * The snapshot being the invariant, it stays alive during the iteration.
+ */
+
+static int
+iter_snap_f(lua_State *L)
+{
+    dbg_stack("inc(.) <--");  // [s k]
+
+    char buf[MAX_STRKEY];
+    snpitr_t *itr = lua_touserdata(L, lua_upvalueindex(1));
+    ptnode_t *n = lua_touserdata(L, lua_upvalueindex(2));
+
+    if (n == NULL) return 0;  /* we're done */
+
+    lua_pushlightuserdata(L, snp_next(itr));
+    lua_replace(L, lua_upvalueindex(2));
+
+    lua_settop(L, 0);
+    if (! key_tostr(buf, n->key))
+        return lipt_error(L, LIPTE_TOSTR, 2, "");
+    lua_pushfstring(L, "%s/%d", buf, n->mlen);                  // [pfx]
+    lua_rawgeti(L, LUA_REGISTRYINDEX, *(int *)n->val->value);  // [pfx v]
+
+    dbg_stack("out(2) ==>");
+
+    return 2;
+}
@@ -19,11 +19,31 @@
  *
  * ### `LUA_IPT_ITR_GC`
  * Identity for the `itr_gc_t`-userdata.
+ *
+ * ### `LUA_IPRANGE_ID`
+ * Identity for the `range_t`-userdata.
+ *
+ * ### `LUA_IPT_POOL`
+ * Identity for the `pool_t`-userdata.
+ *
+ * ### `LUA_IPT_SNAP`
+ * Identity for the `snap_t`-userdata.
+ *
+ * ### `LUA_IPT_GRAVE`
+ * Identity for the `grave_t`-userdata.
+ *
+ * ### `LUA_IPT_GRAVEYARD`
+ * Registry key for the Lua state's `grave_t`-userdata.
  */
 
 #define LUA_IPTABLE_VERSION "0.0.1rc0"
 #define LUA_IPTABLE_ID "iptable"
 #define LUA_IPT_ITR_GC "itr_gc"
+#define LUA_IPRANGE_ID "iprange"
+#define LUA_IPT_POOL "iptpool"
+#define LUA_IPT_SNAP "iptsnap"
+#define LUA_IPT_GRAVE "iptgrave"
+#define LUA_IPT_GRAVEYARD "iptgraveyard"
 
 /* ### LIPTE errno's
  * 0. LIPTE_NONE     none
@@ -32,12 +52,16 @@
  * 0. LIPTE_BIN      illegal binary key/mask
  * 0. LIPTE_BINOP    binary operation failed
  * 0. LIPTE_BUF      could not allocate memory
+ * 0. LIPTE_BUSY     table has active iterators
  * 0. LIPTE_FAIL     unspecified error
  * 0. LIPTE_ITER     internal iteration error
  * 0. LIPTE_LIDX     invalid Lua stack index
  * 0. LIPTE_LVAL     invalid Lua stack (up)value
  * 0. LIPTE_MLEN     invalid mask length
+ * 0. LIPTE_NOPATH   path not found
+ * 0. LIPTE_NOPFX    prefix not found
  * 0. LIPTE_PFX      invalid prefix string
+ * 0. LIPTE_RANGE    invalid or overlapping range
  * 0. LIPTE_RDX      unhandled radix node type
  * 0. LIPTE_SPLIT    prefix already at max length
  * 0. LIPTE_TOBIN    error converting string to binary
@@ -53,12 +77,16 @@ typedef enum {
     LIPTE_BIN,
     LIPTE_BINOP,
     LIPTE_BUF,
+    LIPTE_BUSY,
     LIPTE_FAIL,
     LIPTE_ITER,
     LIPTE_LIDX,
     LIPTE_LVAL,
     LIPTE_MLEN,
+    LIPTE_NOPATH,
+    LIPTE_NOPFX,
     LIPTE_PFX,
+    LIPTE_RANGE,
     LIPTE_RDX,
     LIPTE_SPLIT,
     LIPTE_TOBIN,
@@ -76,12 +104,16 @@ static const char *const LIPT_ERROR[] = {
     [LIPTE_BINOP]   = "binary operation failed",
     [LIPTE_BIN]     = "illegal binary key/mask",
     [LIPTE_BUF]     = "could not allocate memory",
+    [LIPTE_BUSY]    = "table has active iterators",
     [LIPTE_FAIL]    = "unspecified error",
     [LIPTE_ITER]    = "internal iteration error",
     [LIPTE_LIDX]    = "invalid Lua stack index",
     [LIPTE_LVAL]    = "invalid Lua stack (up)value",
     [LIPTE_MLEN]    = "invalid mask length",
+    [LIPTE_NOPATH]  = "path not found",
+    [LIPTE_NOPFX]   = "prefix not found",
     [LIPTE_PFX]     = "invalid prefix string",
+    [LIPTE_RANGE]   = "invalid or overlapping range",
     [LIPTE_RDX]     = "unhandled radix node type",
     [LIPTE_SPLIT]   = "prefix already at max length",
     [LIPTE_TOBIN]   = "error converting string to binary",
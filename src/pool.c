@@ -0,0 +1,236 @@
+/* # `pool.c`
+ * Worker thread pool for batches of longest prefix matches, see pool.h
+ */
+
+#include <stdio.h>        // printf
+#include <sys/types.h>    // u_char
+#include <stdint.h>       // uint64_t
+#include <stdlib.h>       // malloc / calloc
+#include <arpa/inet.h>    // AF_INET(6)
+#include <string.h>       // memcpy
+#include <unistd.h>       // sysconf
+#include <pthread.h>      // pthread_create
+
+#include "radix.h"
+#include "iptable.h"
+#include "bsl.h"
+#include "pool.h"
+
+/* ## helper functions
+ *
+ * ### `pool_engines`
+ * ```c
+ *   static int pool_engines(pool_t *p);
+ * ```
+ * (Re)build the lookup engines if missing or older than the table.  Only
+ * called while the workers are idle.
+ * - returns 1 on success, 0 on failure (out of memory)
+ */
+
+static int
+pool_engines(pool_t *p)
+{
+    if (p->bsl4 == NULL || p->bsl4->gen != p->t->gen) {
+        bsl_destroy(&p->bsl4);
+        p->bsl4 = bsl_create(p->t, AF_INET, 1);
+    }
+    if (p->bsl6 == NULL || p->bsl6->gen != p->t->gen) {
+        bsl_destroy(&p->bsl6);
+        p->bsl6 = bsl_create(p->t, AF_INET6, 1);
+    }
+
+    return p->bsl4 && p->bsl6;
+}
+
+/* ### `pool_work`
+ * ```c
+ *   static void pool_work(pool_t *p);
+ * ```
+ * Claim chunks of the current job and look up their addresses, until no
+ * chunks are left.  Run by the workers and the calling thread alike.
+ */
+
+static void
+pool_work(pool_t *p)
+{
+    uint8_t addr[MAX_BINKEY];
+    int mlen, af;
+    size_t i, stop;
+    bsl_t *b;
+
+    for (;;) {
+        i = __atomic_fetch_add(&p->next, POOL_CHUNK, __ATOMIC_RELAXED);
+        if (i >= p->n) break;
+        stop = i + POOL_CHUNK < p->n ? i + POOL_CHUNK : p->n;
+
+        for (; i < stop; i++) {
+            mlen = -1;
+            af = AF_UNSPEC;
+            p->res[i] = NULL;
+            if (p->addrs[i] == NULL) continue;
+            if (! key_bystr(addr, &mlen, &af, p->addrs[i])) continue;
+            b = af == AF_INET ? p->bsl4 : p->bsl6;
+            p->res[i] = bsl_lpm(b, addr);
+        }
+    }
+}
+
+/* ### `pool_worker`
+ * ```c
+ *   static void *pool_worker(void *arg);
+ * ```
+ * Thread function of a worker: wait for a new job, help finish it and report
+ * back, until the pool is stopped.
+ */
+
+static void *
+pool_worker(void *arg)
+{
+    pool_t *p = arg;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (! p->stop && p->job == seen)
+            pthread_cond_wait(&p->wake, &p->lock);
+        if (p->stop) break;
+        seen = p->job;
+
+        pthread_mutex_unlock(&p->lock);
+        pool_work(p);
+        pthread_mutex_lock(&p->lock);
+
+        if (--p->busy == 0)
+            pthread_cond_signal(&p->idle);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
+
+/* ## pool functions
+ *
+ * ### `pool_create`
+ * ```c
+ *   pool_t *pool_create(table_t *t, int threads);
+ * ```
+ * Create a pool for table `t` that uses `threads` threads for a batch,
+ * including the calling thread.  So `threads` equal to 1 starts no workers,
+ * while less than 1 means one thread per online cpu.  The number of threads
+ * is capped at `POOL_MAXTHREADS`.  The engines are built right away.
+ * - returns the pool on success, NULL on failure
+ */
+
+pool_t *
+pool_create(table_t *t, int threads)
+{
+    pool_t *p;
+    long ncpu;
+
+    if (t == NULL) return NULL;
+    if (threads < 1) {
+        ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = ncpu < 1 ? 1 : ncpu > POOL_MAXTHREADS ? POOL_MAXTHREADS
+                                                         : (int)ncpu;
+    }
+    if (threads > POOL_MAXTHREADS) threads = POOL_MAXTHREADS;
+
+    if ((p = calloc(1, sizeof(pool_t))) == NULL) return NULL;
+    p->t = t;
+    if (! pool_engines(p)) goto fail;
+    if (threads > 1 && (p->tid = calloc(threads - 1, sizeof(pthread_t))) == NULL)
+        goto fail;
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+    pthread_cond_init(&p->idle, NULL);
+
+    for (; p->nthreads < threads - 1; p->nthreads++)
+        if (pthread_create(p->tid + p->nthreads, NULL, pool_worker, p))
+            break;
+
+    if (p->nthreads < threads - 1) {
+        pool_destroy(&p);
+        return NULL;
+    }
+
+    return p;
+
+fail:
+    bsl_destroy(&p->bsl4);
+    bsl_destroy(&p->bsl6);
+    free(p);
+    return NULL;
+}
+
+/* ### `pool_lpm`
+ * ```c
+ *   int pool_lpm(pool_t *p, const char **addrs, size_t n, entry_t **res);
+ * ```
+ * Do a longest prefix match for each of the `n` address strings in `addrs`
+ * and store the matching entry, or NULL, in `res` at the same index.  Like
+ * `tbl_lpm`, a mask is ignored.  NULL or invalid addresses yield NULL.  The
+ * strings must stay valid until the call returns.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+pool_lpm(pool_t *p, const char **addrs, size_t n, entry_t **res)
+{
+    if (p == NULL || addrs == NULL || res == NULL) return 0;
+    if (! pool_engines(p)) return 0;
+    if (n == 0) return 1;
+
+    pthread_mutex_lock(&p->lock);
+    p->addrs = addrs;
+    p->res = res;
+    p->n = n;
+    p->next = 0;
+    p->busy = p->nthreads;
+    p->job++;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+
+    pool_work(p);
+
+    pthread_mutex_lock(&p->lock);
+    while (p->busy > 0)
+        pthread_cond_wait(&p->idle, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+
+    return 1;
+}
+
+/* ### `pool_destroy`
+ * ```c
+ *   int pool_destroy(pool_t **p);
+ * ```
+ * Stop and join the workers and free all resources of pool `*p`.  The table
+ * is left alone.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+pool_destroy(pool_t **p)
+{
+    if (p == NULL || *p == NULL) return 0;
+
+    pthread_mutex_lock(&(*p)->lock);
+    (*p)->stop = 1;
+    pthread_cond_broadcast(&(*p)->wake);
+    pthread_mutex_unlock(&(*p)->lock);
+
+    for (int i = 0; i < (*p)->nthreads; i++)
+        pthread_join((*p)->tid[i], NULL);
+
+    pthread_cond_destroy(&(*p)->idle);
+    pthread_cond_destroy(&(*p)->wake);
+    pthread_mutex_destroy(&(*p)->lock);
+    bsl_destroy(&(*p)->bsl4);
+    bsl_destroy(&(*p)->bsl6);
+    free((*p)->tid);
+    free(*p);
+    *p = NULL;
+
+    return 1;
+}
@@ -0,0 +1,84 @@
+/* ---
+ * title: pool reference
+ * author: hertogp
+ * tags: C api longest prefix match threads batch
+ * ...
+ *
+ * A fixed pool of worker threads doing batches of longest prefix matches.
+ *
+ */
+
+#ifndef pool_h
+#define pool_h
+
+/* # pool.h
+ *
+ * A pool owns a fixed number of worker threads, started when the pool is
+ * created and kept until it is destroyed.  `pool_lpm` hands a batch of
+ * addresses to the workers, which claim chunks of `POOL_CHUNK` addresses at a
+ * time until the batch is done.  The calling thread works along with them and
+ * returns once every address has a result, stored in input order.
+ *
+ * Workers never touch the table itself, since a lookup may write to the
+ * table's cache.  Instead, they use the pool's binary search on prefix
+ * lengths engines (see bsl.h), which are read-only snapshots of the table.
+ * These are rebuilt by `pool_lpm`, on the calling thread, when the table was
+ * modified since they were built.  The table must not be modified while
+ * `pool_lpm` runs.  Include pthread.h and bsl.h before this header.
+ *
+ * ## `#define's`
+ *
+ * `POOL_CHUNK`
+ * : number of addresses a worker claims in one go
+ *
+ * `POOL_MAXTHREADS`
+ * : the maximum number of threads (including the caller) in a pool
+ */
+
+#define POOL_CHUNK 512
+#define POOL_MAXTHREADS 64
+
+/* ## Structures
+ *
+ * ### `pool_t`
+ * A pool has the following members:
+ * - `table_t *t`, the table the engines are built from
+ * - `bsl_t *bsl4, *bsl6`, read-only snapshots of `t`, used by all threads
+ * - `int nthreads`, number of worker threads, the caller not included
+ * - `pthread_t *tid`, the worker threads
+ * - `pthread_mutex_t lock`, protects the job and the `busy` counter
+ * - `pthread_cond_t wake`, signals workers a new job (or stop) is posted
+ * - `pthread_cond_t idle`, signals the caller the last worker is done
+ * - `const char **addrs`, the addresses of the current job
+ * - `entry_t **res`, where the results of the current job go
+ * - `size_t n`, the number of addresses in the current job
+ * - `size_t next`, index of the next unclaimed chunk, updated atomically
+ * - `int busy`, number of workers still working on the current job
+ * - `uint64_t job`, sequence number of the current job
+ * - `int stop`, set when the pool is being destroyed
+ */
+
+typedef struct pool_t {
+    table_t *t;                     // table to match against
+    bsl_t *bsl4, *bsl6;             // lookup engines, snapshots of t
+    int nthreads;                   // workers, excluding the caller
+    pthread_t *tid;                 // worker threads
+    pthread_mutex_t lock;           // protects job, busy and stop
+    pthread_cond_t wake;            // new job posted
+    pthread_cond_t idle;            // all workers done
+    const char **addrs;             // current job's addresses
+    entry_t **res;                  // current job's results
+    size_t n;                       // current job's size
+    size_t next;                    // next unclaimed address
+    int busy;                       // workers still on the current job
+    uint64_t job;                   // current job's sequence number
+    int stop;                       // workers should exit
+} pool_t;
+
+// -- PROTOTYPES
+
+pool_t *pool_create(table_t *, int);
+int pool_lpm(pool_t *, const char **, size_t, entry_t **);
+int pool_destroy(pool_t **);
+
+#endif
@@ -178,6 +178,7 @@ struct radix_node *rn_addroute(void *, void *, struct radix_head *, struct radix
 struct radix_node *rn_delete(void *, void *, struct radix_head *);
 struct radix_node *rn_lookup (void *v_arg, void *m_arg, struct radix_head *head);
 struct radix_node *rn_match(void *, struct radix_head *);
+struct radix_node *rn_match4(void *, struct radix_head *);
 int               rn_walktree_from(struct radix_head *h, void *a, void *m, walktree_f_t *f, void *w);
 int               rn_walktree(struct radix_head *, walktree_f_t *, void *);
 
@@ -0,0 +1,557 @@
+/* # `tally.c`
+ * Per prefix traffic counters fed from capture files, see tally.h
+ */
+
+#include <stdio.h>        // printf
+#include <sys/types.h>    // u_char
+#include <stdint.h>       // uint64_t
+#include <stdlib.h>       // malloc / calloc
+#include <arpa/inet.h>    // AF_INET(6)
+#include <string.h>       // memcpy
+#include <fcntl.h>        // open
+#include <unistd.h>       // close
+#include <sys/mman.h>     // mmap
+#include <sys/stat.h>     // fstat
+
+#include "radix.h"
+#include "iptable.h"
+#include "bsl.h"
+#include "tally.h"
+
+/* link types, see https://www.tcpdump.org/linktypes.html */
+
+#define LT_NULL      0
+#define LT_EN10MB    1
+#define LT_RAW_OLD1  12
+#define LT_RAW_OLD2  14
+#define LT_RAW       101
+#define LT_LOOP      108
+#define LT_SLL       113
+#define LT_IPV4      228
+#define LT_IPV6      229
+#define LT_SLL2      276
+
+/* pcap & pcapng magic numbers and block types */
+
+#define PCAP_USEC    0xa1b2c3d4
+#define PCAP_NSEC    0xa1b23c4d
+#define PCAPNG_SHB   0x0a0d0d0a
+#define PCAPNG_BOM   0x1a2b3c4d
+#define PCAPNG_IDB   1
+#define PCAPNG_PB    2
+#define PCAPNG_SPB   3
+#define PCAPNG_EPB   6
+
+/* a batch of packets whose addresses still need to be looked up */
+
+typedef struct tlybatch_t {
+    int n;
+    uint32_t len[TLY_BATCH];
+    uint8_t src[TLY_BATCH][MAX_BINKEY];
+    uint8_t dst[TLY_BATCH][MAX_BINKEY];
+} tlybatch_t;
+
+/* ## helper functions
+ *
+ * ### `tly_rd16`, `tly_rd32`
+ * ```c
+ *   static uint16_t tly_rd16(const uint8_t *p, int swap);
+ *   static uint32_t tly_rd32(const uint8_t *p, int swap);
+ * ```
+ * Read a, possibly unaligned, number in the capture file's byte order.
+ */
+
+static inline uint16_t
+tly_rd16(const uint8_t *p, int swap)
+{
+    uint16_t x;
+
+    memcpy(&x, p, sizeof(x));
+    return swap ? __builtin_bswap16(x) : x;
+}
+
+static inline uint32_t
+tly_rd32(const uint8_t *p, int swap)
+{
+    uint32_t x;
+
+    memcpy(&x, p, sizeof(x));
+    return swap ? __builtin_bswap32(x) : x;
+}
+
+/* ### `tly_cmp`
+ * ```c
+ *   static int tly_cmp(const void *a, const void *b);
+ * ```
+ * Order counters on total bytes, then total packets, in descending order.
+ * Ties are ordered on prefix, ipv4 before ipv6, so reports are reproducible.
+ */
+
+static int
+tly_cmp(const void *a, const void *b)
+{
+    const tcount_t *x = a, *y = b;
+    uint8_t *kx, *ky;
+    int c;
+    uint64_t bx = x->sbytes + x->dbytes, by = y->sbytes + y->dbytes;
+    uint64_t px = x->spkts + x->dpkts, py = y->spkts + y->dpkts;
+
+    if (bx != by) return bx < by ? 1 : -1;
+    if (px != py) return px < py ? 1 : -1;
+
+    /* same traffic, order on prefix for a stable report, ipv4 first since
+     * key_cmp cannot order keys of different families */
+    kx = (uint8_t *)x->entry->rn->rn_key;
+    ky = (uint8_t *)y->entry->rn->rn_key;
+    if (IPT_KEYLEN(kx) != IPT_KEYLEN(ky))
+        return IPT_KEYLEN(kx) < IPT_KEYLEN(ky) ? -1 : 1;
+    if ((c = key_cmp(kx, ky)))
+        return c;
+    return key_masklen(x->entry->rn->rn_mask)
+           - key_masklen(y->entry->rn->rn_mask);
+}
+
+/* ### `tly_engines`
+ * ```c
+ *   static void tly_engines(tally_t *tly);
+ * ```
+ * (Re)build the lookup engines if missing or older than the table.  An
+ * engine that fails to build is left NULL, so its lookups use the table.
+ */
+
+static void
+tly_engines(tally_t *tly)
+{
+    if (tly->bsl4 == NULL || tly->bsl4->gen != tly->t->gen) {
+        bsl_destroy(&tly->bsl4);
+        tly->bsl4 = bsl_create(tly->t, AF_INET, 1);
+    }
+    if (tly->bsl6 == NULL || tly->bsl6->gen != tly->t->gen) {
+        bsl_destroy(&tly->bsl6);
+        tly->bsl6 = bsl_create(tly->t, AF_INET6, 1);
+    }
+}
+
+/* ### `tly_lpm`
+ * ```c
+ *   static entry_t *tly_lpm(tally_t *tly, uint8_t *addr);
+ * ```
+ * Longest prefix match for binary `addr`, using an engine if available.
+ */
+
+static inline entry_t *
+tly_lpm(tally_t *tly, uint8_t *addr)
+{
+    bsl_t *b = KEY_IS_IP4(addr) ? tly->bsl4 : tly->bsl6;
+
+    return b ? bsl_lpm(b, addr) : tbl_lpmkey(tly->t, addr);
+}
+
+/* ### `tly_slot`
+ * ```c
+ *   static tcount_t *tly_slot(tally_t *tly, entry_t *e);
+ * ```
+ * Return the counters for entry `e`, creating them if needed.  The counter
+ * hash uses linear probing and is doubled in size when 3/4 full.
+ * - returns NULL if out of memory
+ */
+
+static tcount_t *
+tly_slot(tally_t *tly, entry_t *e)
+{
+    tcount_t *slot, *old;
+    size_t idx, size;
+    uint64_t h;
+
+    if (e == NULL) return &tly->miss;
+
+    if (4 * (tly->count + 1) > 3 * tly->size) {
+        size = tly->size * 2;
+        if ((slot = calloc(size, sizeof(tcount_t))) == NULL)
+            return NULL;
+        old = tly->slot;
+        tly->slot = slot;
+        tly->size = size;
+        for (idx = 0; idx < size / 2; idx++) {
+            if (old[idx].entry == NULL) continue;
+            h = (uintptr_t)old[idx].entry * 0x9E3779B97F4A7C15ULL;
+            for (h >>= 17; slot[h & (size - 1)].entry; h++)
+                ;
+            slot[h & (size - 1)] = old[idx];
+        }
+        free(old);
+    }
+
+    h = (uintptr_t)e * 0x9E3779B97F4A7C15ULL;
+    for (h >>= 17;; h++) {
+        slot = tly->slot + (h & (tly->size - 1));
+        if (slot->entry == e)
+            return slot;
+        if (slot->entry == NULL) {
+            slot->entry = e;
+            tly->count++;
+            return slot;
+        }
+    }
+}
+
+/* ### `tly_flush`
+ * ```c
+ *   static int tly_flush(tally_t *tly, tlybatch_t *b);
+ * ```
+ * Lookup the addresses of all packets in the batch, then update the counters.
+ * - returns 1 on success, 0 if out of memory
+ */
+
+static int
+tly_flush(tally_t *tly, tlybatch_t *b)
+{
+    entry_t *se[TLY_BATCH], *de[TLY_BATCH];
+    tcount_t *c;
+    int i;
+
+    for (i = 0; i < b->n; i++) {
+        se[i] = tly_lpm(tly, b->src[i]);
+        de[i] = tly_lpm(tly, b->dst[i]);
+    }
+
+    for (i = 0; i < b->n; i++) {
+        if ((c = tly_slot(tly, se[i])) == NULL) return 0;
+        c->spkts++;
+        c->sbytes += b->len[i];
+        if ((c = tly_slot(tly, de[i])) == NULL) return 0;
+        c->dpkts++;
+        c->dbytes += b->len[i];
+        tly->pkts++;
+        tly->bytes += b->len[i];
+    }
+    b->n = 0;
+
+    return 1;
+}
+
+/* ### `tly_packet`
+ * ```c
+ *   static int tly_packet(tally_t *tly, tlybatch_t *b, uint32_t lt,
+ *                         const uint8_t *pkt, uint32_t caplen, uint32_t len);
+ * ```
+ * Find the IP header of a captured packet of link type `lt` and add its
+ * addresses to the batch, which is flushed when full.  Packets that are not
+ * IPv4/IPv6 or whose headers were not captured entirely are skipped.
+ * - returns 1 on success, 0 if out of memory
+ */
+
+static int
+tly_packet(tally_t *tly, tlybatch_t *b, uint32_t lt, const uint8_t *pkt,
+           uint32_t caplen, uint32_t len)
+{
+    uint32_t off = 0, etype = 0;
+    uint8_t *src = b->src[b->n], *dst = b->dst[b->n];
+
+    switch (lt) {
+    case LT_NULL:
+    case LT_LOOP:
+        off = 4;
+        break;
+    case LT_EN10MB:
+        for (off = 12; off + 2 <= caplen; off += 4) {
+            etype = (uint32_t)pkt[off] << 8 | pkt[off + 1];
+            if (etype != 0x8100 && etype != 0x88a8 && etype != 0x9100)
+                break;
+        }
+        off += 2;
+        if (etype != 0x0800 && etype != 0x86dd) off = caplen;
+        break;
+    case LT_RAW_OLD1:
+    case LT_RAW_OLD2:
+    case LT_RAW:
+    case LT_IPV4:
+    case LT_IPV6:
+        off = 0;
+        break;
+    case LT_SLL:
+        off = 16;
+        break;
+    case LT_SLL2:
+        off = 20;
+        break;
+    default:
+        off = caplen;
+    }
+
+    if (off >= caplen
+        || ! key_byhdr(src, pkt + off, caplen - off, HDR_SRC)
+        || ! key_byhdr(dst, pkt + off, caplen - off, HDR_DST)) {
+        tly->skipped++;
+        return 1;
+    }
+
+    b->len[b->n++] = len;
+    if (b->n == TLY_BATCH)
+        return tly_flush(tly, b);
+
+    return 1;
+}
+
+/* ### `tly_pcapng`
+ * ```c
+ *   static int tly_pcapng(tally_t *tly, tlybatch_t *b, const uint8_t *p,
+ *                         size_t size);
+ * ```
+ * Walk the blocks of a pcapng file.  Each section header resets the byte
+ * order and the list of interfaces, whose link types are needed to decode
+ * the packets.  Stops at the first malformed or truncated block.
+ * - returns 1 on success, 0 on errors
+ */
+
+static int
+tly_pcapng(tally_t *tly, tlybatch_t *b, const uint8_t *p, size_t size)
+{
+    uint32_t type, blen, ifc = 0, caplen, len, nif = 0, maxif = 0;
+    uint32_t *lt = NULL, *snap = NULL, *tmp;
+    const uint8_t *data;
+    int swap = 0, rc = 1;
+    size_t off;
+
+    for (off = 0; rc && off + 12 <= size; off += blen) {
+        type = tly_rd32(p + off, 0);
+        if (type == PCAPNG_SHB) {
+            if (off + 28 > size) break;
+            swap = tly_rd32(p + off + 8, 0) != PCAPNG_BOM;
+            nif = 0;
+        }
+        type = tly_rd32(p + off, swap);
+        blen = tly_rd32(p + off + 4, swap);
+        if (blen < 12 || blen % 4 || blen > size - off)
+            break;
+
+        data = NULL;
+        switch (type) {
+        case PCAPNG_IDB:
+            if (blen < 20) break;
+            if (nif == maxif) {
+                maxif = maxif ? 2 * maxif : 4;
+                if ((tmp = realloc(lt, maxif * sizeof(*lt))) == NULL) {
+                    rc = 0;
+                    break;
+                }
+                lt = tmp;
+                if ((tmp = realloc(snap, maxif * sizeof(*snap))) == NULL) {
+                    rc = 0;
+                    break;
+                }
+                snap = tmp;
+            }
+            lt[nif] = tly_rd16(p + off + 8, swap);
+            snap[nif++] = tly_rd32(p + off + 12, swap);
+            break;
+        case PCAPNG_EPB:
+        case PCAPNG_PB:
+            if (blen < 32) break;
+            ifc = type == PCAPNG_EPB ? tly_rd32(p + off + 8, swap)
+                                     : tly_rd16(p + off + 8, swap);
+            caplen = tly_rd32(p + off + 20, swap);
+            len = tly_rd32(p + off + 24, swap);
+            if (caplen <= blen - 32)
+                data = p + off + 28;
+            break;
+        case PCAPNG_SPB:
+            if (blen < 16) break;
+            ifc = 0;
+            len = tly_rd32(p + off + 8, swap);
+            caplen = len < blen - 16 ? len : blen - 16;
+            if (nif && snap[0] && caplen > snap[0])
+                caplen = snap[0];
+            data = p + off + 12;
+            break;
+        }
+
+        if (data && ifc < nif)
+            rc = tly_packet(tly, b, lt[ifc], data, caplen, len);
+    }
+
+    free(lt);
+    free(snap);
+
+    return rc;
+}
+
+/* ## tally functions
+ *
+ * ### `tly_create`
+ * ```c
+ *   tally_t *tly_create(table_t *t);
+ * ```
+ * Create a new tally, with all counters zero, for table `t`.
+ * - returns NULL on failure
+ */
+
+tally_t *
+tly_create(table_t *t)
+{
+    tally_t *tly;
+
+    if (t == NULL) return NULL;
+    if ((tly = calloc(1, sizeof(tally_t))) == NULL) return NULL;
+
+    tly->size = 1024;
+    if ((tly->slot = calloc(tly->size, sizeof(tcount_t))) == NULL) {
+        free(tly);
+        return NULL;
+    }
+    tly->t = t;
+    tly_engines(tly);
+
+    return tly;
+}
+
+/* ### `tly_add`
+ * ```c
+ *   int tly_add(tally_t *tly, uint8_t *src, uint8_t *dst, uint32_t len);
+ * ```
+ * Count a single packet of `len` bytes, given its binary source and
+ * destination keys.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tly_add(tally_t *tly, uint8_t *src, uint8_t *dst, uint32_t len)
+{
+    tcount_t *c;
+
+    if (tly == NULL || src == NULL || dst == NULL) return 0;
+
+    tly_engines(tly);
+    if ((c = tly_slot(tly, tly_lpm(tly, src))) == NULL) return 0;
+    c->spkts++;
+    c->sbytes += len;
+    if ((c = tly_slot(tly, tly_lpm(tly, dst))) == NULL) return 0;
+    c->dpkts++;
+    c->dbytes += len;
+    tly->pkts++;
+    tly->bytes += len;
+
+    return 1;
+}
+
+/* ### `tly_pcap`
+ * ```c
+ *   int tly_pcap(tally_t *tly, const char *fname);
+ * ```
+ * Count all IPv4/IPv6 packets in the pcap or pcapng file `fname`.  The file
+ * is mapped into memory and read sequentially, packets are never copied.  A
+ * truncated last packet, as left behind by an interrupted capture, ends the
+ * file without an error.
+ * - returns 1 on success, 0 on failure (e.g. unknown file format)
+ */
+
+int
+tly_pcap(tally_t *tly, const char *fname)
+{
+    tlybatch_t *b = NULL;
+    struct stat st;
+    const uint8_t *p;
+    void *map;
+    uint32_t magic, lt, caplen;
+    size_t off, size;
+    int fd, swap, rc = 0;
+
+    if (tly == NULL || fname == NULL) return 0;
+    if ((fd = open(fname, O_RDONLY)) < 0) return 0;
+    if (fstat(fd, &st) < 0 || st.st_size < 24) {
+        close(fd);
+        return 0;
+    }
+
+    size = st.st_size;
+    map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+    madvise(map, size, MADV_SEQUENTIAL);
+    p = map;
+
+    if ((b = malloc(sizeof(tlybatch_t))) == NULL)
+        goto done;
+    b->n = 0;
+    tly_engines(tly);
+
+    magic = tly_rd32(p, 0);
+    if (magic == PCAPNG_SHB) {
+        rc = tly_pcapng(tly, b, p, size);
+    } else if (magic == PCAP_USEC || magic == PCAP_NSEC
+               || magic == __builtin_bswap32(PCAP_USEC)
+               || magic == __builtin_bswap32(PCAP_NSEC)) {
+        swap = magic != PCAP_USEC && magic != PCAP_NSEC;
+        lt = tly_rd32(p + 20, swap) & 0xffff;
+        rc = 1;
+        for (off = 24; rc && off + 16 <= size; off += caplen) {
+            caplen = tly_rd32(p + off + 8, swap);
+            off += 16;
+            if (caplen > size - off)
+                break;  /* truncated */
+            rc = tly_packet(tly, b, lt, p + off, caplen,
+                            tly_rd32(p + off - 4, swap));
+        }
+    }
+
+    if (rc)
+        rc = tly_flush(tly, b);
+
+done:
+    free(b);
+    munmap(map, size);
+
+    return rc;
+}
+
+/* ### `tly_report`
+ * ```c
+ *   tcount_t *tly_report(tally_t *tly, size_t *n);
+ * ```
+ * Return a new array with the counters of all matched entries, sorted on
+ * bytes (source + destination) in descending order, packets second.  Sets
+ * `n` to the number of elements.  The caller must free the array.
+ * - returns NULL on failure, or if there are no matched entries
+ */
+
+tcount_t *
+tly_report(tally_t *tly, size_t *n)
+{
+    tcount_t *arr;
+    size_t i, j;
+
+    if (n) *n = 0;
+    if (tly == NULL || n == NULL || tly->count == 0) return NULL;
+    if ((arr = malloc(tly->count * sizeof(tcount_t))) == NULL) return NULL;
+
+    for (i = j = 0; i < tly->size; i++)
+        if (tly->slot[i].entry)
+            arr[j++] = tly->slot[i];
+    qsort(arr, j, sizeof(tcount_t), tly_cmp);
+    *n = j;
+
+    return arr;
+}
+
+/* ### `tly_destroy`
+ * ```c
+ *   int tly_destroy(tally_t **tly);
+ * ```
+ * Free all memory used by the tally and set `*tly` to NULL.  The table is
+ * left alone.
+ * - returns 1 on success, 0 on failure
+ */
+
+int
+tly_destroy(tally_t **tly)
+{
+    if (tly == NULL || *tly == NULL) return 0;
+
+    bsl_destroy(&(*tly)->bsl4);
+    bsl_destroy(&(*tly)->bsl6);
+    free((*tly)->slot);
+    free(*tly);
+    *tly = NULL;
+
+    return 1;
+}
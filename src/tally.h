@@ -0,0 +1,90 @@
+/* ---
+ * title: tally reference
+ * author: hertogp
+ * tags: C api traffic counters pcap pcapng
+ * ...
+ *
+ * Per prefix traffic counters, fed from pcap or pcapng capture files.
+ *
+ */
+
+#ifndef tally_h
+#define tally_h
+
+/* # tally.h
+ *
+ * A tally counts packets and bytes per entry of an iptable, using the longest
+ * prefix match for both the source and destination address of each packet.
+ * Packets are usually read from a capture file by `tly_pcap`, which maps the
+ * file into memory and extracts the addresses from the IPv4/IPv6 headers in
+ * place, without copying packets.  Addresses are looked up in batches of
+ * `TLY_BATCH` packets, using a binary search on prefix lengths engine (see
+ * bsl.h) per AF family, built from the table when needed.  If an engine can't
+ * be built, lookups fall back to the radix trees.
+ *
+ * Supported capture formats are classic pcap (microsecond or nanosecond
+ * timestamps, either byte order) and pcapng (enhanced, simple and obsolete
+ * packet blocks, multiple interfaces and sections).  Supported link types are
+ * Ethernet (including 802.1Q/802.1ad tags), raw IP, Linux cooked capture v1
+ * and v2, and BSD loopback.  Bytes are counted using the packet's original
+ * length on the wire, not its captured length.
+ *
+ * The table is only read.  Since the engines are snapshots, they are rebuilt
+ * by `tly_pcap` if the table was modified since they were built.  Include
+ * bsl.h before this header.
+ *
+ * ## `#define's`
+ *
+ * `TLY_BATCH`
+ * : number of packets whose addresses are looked up in one go
+ */
+
+#define TLY_BATCH 256
+
+/* ## Structures
+ *
+ * ### `tcount_t`
+ * The counters for a single entry:
+ * - `entry_t *entry`, the matching entry, NULL for addresses without a match
+ * - `uint64_t spkts, sbytes`, packets and bytes with a source address match
+ * - `uint64_t dpkts, dbytes`, packets and bytes with a destination match
+ */
+
+typedef struct tcount_t {
+    entry_t *entry;                 // matched entry, NULL means no match
+    uint64_t spkts, sbytes;         // counted as source
+    uint64_t dpkts, dbytes;         // counted as destination
+} tcount_t;
+
+/* ### `tally_t`
+ * A tally has the following members:
+ * - `table_t *t`, the table used for longest prefix matching
+ * - `bsl_t *bsl4, *bsl6`, lookup engines built from `t`, may be NULL
+ * - `size_t size`, number of slots in the counter hash, a power of 2
+ * - `size_t count`, number of slots in use
+ * - `tcount_t *slot`, the counter hash, keyed by entry pointer
+ * - `tcount_t miss`, counters for addresses without a match
+ * - `uint64_t pkts, bytes`, the IPv4/IPv6 packets and bytes counted
+ * - `uint64_t skipped`, packets skipped (not IP or truncated headers)
+ */
+
+typedef struct tally_t {
+    table_t *t;                     // table to match against
+    bsl_t *bsl4, *bsl6;             // lookup engines, snapshots of t
+    size_t size;                    // number of slots, a power of 2
+    size_t count;                   // slots in use
+    tcount_t *slot;                 // counters per entry
+    tcount_t miss;                  // counters for unmatched addresses
+    uint64_t pkts, bytes;           // ip packets & bytes counted
+    uint64_t skipped;               // non-ip or truncated packets
+} tally_t;
+
+// -- PROTOTYPES
+
+tally_t *tly_create(table_t *);
+int tly_add(tally_t *, uint8_t *, uint8_t *, uint32_t);
+int tly_pcap(tally_t *, const char *);
+tcount_t *tly_report(tally_t *, size_t *);
+int tly_destroy(tally_t **);
+
+#endif
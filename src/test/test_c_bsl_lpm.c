@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+#include "bsl.h"             // binary search on prefix lengths
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_bsl_lpm.h"
+
+
+/*
+ * Test bsl_lpm()
+ */
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+
+// xorshift, so runs are repeatable
+static uint64_t rnd_state = 88172645463325252ULL;
+uint64_t rnd(void);
+uint64_t
+rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 7;
+    rnd_state ^= rnd_state << 17;
+    return rnd_state;
+}
+
+// fill binary key with a random address of family af
+void rnd_key(uint8_t *key, int af);
+void
+rnd_key(uint8_t *key, int af)
+{
+    uint64_t w[2] = {rnd(), rnd()};
+
+    IPT_KEYLEN(key) = af == AF_INET ? 5 : 17;
+    memcpy(IPT_KEYPTR(key), w, IPT_KEYLEN(key) - 1);
+}
+
+void
+test_bsl_basic(void)
+{
+    const char *pfx[] = {
+        "10.0.0.0/8", "10.10.0.0/16", "10.10.10.0/24", "10.10.10.128/25",
+        "2001:db8::/32", "2001:db8:1::/48", "2001:db8:1:1::/64",
+        "2001:db8:1:1::1/128",
+    };
+    int val[NELEMS(pfx)];
+    table_t *t = tbl_create(NULL);
+    bsl_t *b;
+    entry_t *e;
+    uint8_t addr[MAX_BINKEY];
+    int mlen, af;
+
+    for (int i = 0; i < NELEMS(pfx); i++) {
+        val[i] = i;
+        mu_assert(tbl_set(t, pfx[i], &val[i], NULL));
+    }
+
+    mu_eq(NULL, (void *)bsl_create(NULL, AF_INET6, 0), "%p");
+    mu_eq(NULL, (void *)bsl_create(t, AF_UNSPEC, 0), "%p");
+
+    b = bsl_create(t, AF_INET6, 0);
+    mu_assert(b);
+    mu_eq(AF_INET6, b->af, "%d");
+    mu_eq(4, b->nlevels, "%d");
+    mu_eq(SIZE_T(4), b->prefixes, "%zu");
+    mu_eq(t->gen, b->gen, "%lu");
+
+    mu_assert(key_bystr(addr, &mlen, &af, "2001:db8:1:1::1"));
+    e = bsl_lpm(b, addr);
+    mu_assert(e);
+    mu_eq(7, INT_VALUE(e), "%d");
+
+    mu_assert(key_bystr(addr, &mlen, &af, "2001:db8:1:1::2"));
+    e = bsl_lpm(b, addr);
+    mu_assert(e);
+    mu_eq(6, INT_VALUE(e), "%d");
+
+    mu_assert(key_bystr(addr, &mlen, &af, "2001:db8:1:2::"));
+    e = bsl_lpm(b, addr);
+    mu_assert(e);
+    mu_eq(5, INT_VALUE(e), "%d");
+
+    mu_assert(key_bystr(addr, &mlen, &af, "2001:db9::"));
+    mu_eq(NULL, (void *)bsl_lpm(b, addr), "%p");
+
+    // wrong family
+    mu_assert(key_bystr(addr, &mlen, &af, "10.10.10.10"));
+    mu_eq(NULL, (void *)bsl_lpm(b, addr), "%p");
+    mu_eq(NULL, (void *)bsl_lpm(b, NULL), "%p");
+    mu_eq(NULL, (void *)bsl_lpm(NULL, addr), "%p");
+
+    mu_assert(bsl_destroy(&b));
+    mu_eq(NULL, (void *)b, "%p");
+    mu_false(bsl_destroy(&b));
+
+    // ipv4 works too
+    b = bsl_create(t, AF_INET, 1);
+    mu_assert(b);
+    mu_assert(key_bystr(addr, &mlen, &af, "10.10.10.129"));
+    e = bsl_lpm(b, addr);
+    mu_assert(e);
+    mu_eq(3, INT_VALUE(e), "%d");
+    mu_assert(key_bystr(addr, &mlen, &af, "10.11.0.0"));
+    e = bsl_lpm(b, addr);
+    mu_assert(e);
+    mu_eq(0, INT_VALUE(e), "%d");
+    bsl_destroy(&b);
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_bsl_default(void)
+{
+    int val[] = {0, 1, 2};
+    table_t *t = tbl_create(NULL);
+    bsl_t *b;
+    entry_t *e;
+    uint8_t addr[MAX_BINKEY];
+    int mlen, af;
+
+    mu_assert(tbl_set(t, "::/0", &val[0], NULL));
+    mu_assert(tbl_set(t, "2001:db8::/32", &val[1], NULL));
+    mu_assert(tbl_set(t, "3001:db8::/32", &val[2], NULL));
+
+    // flagged for deletion, so not seen by the engine
+    t->itr_lock = 1;
+    mu_assert(tbl_del(t, "3001:db8::/32", NULL));
+    t->itr_lock = 0;
+
+    b = bsl_create(t, AF_INET6, 0);
+    mu_assert(b);
+    mu_eq(SIZE_T(2), b->prefixes, "%zu");
+
+    mu_assert(key_bystr(addr, &mlen, &af, "3001:db8::1"));
+    e = bsl_lpm(b, addr);
+    mu_assert(e);
+    mu_eq(0, INT_VALUE(e), "%d");
+
+    mu_assert(key_bystr(addr, &mlen, &af, "2001:db8::1"));
+    e = bsl_lpm(b, addr);
+    mu_assert(e);
+    mu_eq(1, INT_VALUE(e), "%d");
+
+    // the engine is a snapshot
+    mu_assert(tbl_set(t, "2001:db8:1::/48", &val[2], NULL));
+    mu_true(t->gen != b->gen);
+
+    bsl_destroy(&b);
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_bsl_random(void)
+{
+    // random tables, both engines must agree on random addresses
+    int lens[] = {16, 19, 24, 28, 29, 32, 40, 44, 48, 52, 56, 60, 64, 96, 128};
+    table_t *t;
+    bsl_t *b, *bb;
+    uint8_t key[MAX_BINKEY], mask[MAX_BINKEY], addr[MAX_BINKEY];
+    static uint8_t keys[5000][MAX_BINKEY];
+    entry_t *e;
+    int mlen, bad = 0;
+
+    for (int af = AF_INET; af <= AF_INET6; af += AF_INET6 - AF_INET) {
+        t = tbl_create(NULL);
+        for (int i = 0; i < 5000; i++) {
+            mlen = lens[rnd() % NELEMS(lens)];
+            if (af == AF_INET && mlen > 32) mlen = 8 + mlen % 25;
+            rnd_key(key, af);
+            // cluster prefixes so lookups hit nested prefixes
+            IPT_KEYPTR(key)[0] = 0x20;
+            IPT_KEYPTR(key)[1] &= 0x0f;
+            key_bylen(mask, mlen, af);
+            key_network(key, mask);
+            tbl_setkey(t, key, mlen, &lens[0], NULL);
+            memcpy(keys[i], key, MAX_BINKEY);
+        }
+
+        b = bsl_create(t, af, 0);
+        bb = bsl_create(t, af, 1);
+        mu_assert(b);
+        mu_assert(bb);
+        mu_true(b->markers > 0);
+        mu_eq(af == AF_INET ? t->count4 : t->count6, b->prefixes, "%zu");
+
+        for (int i = 0; i < 100000; i++) {
+            // random host bits, below a random length, in a known prefix
+            rnd_key(addr, af);
+            key_bylen(mask, 8 + rnd() % (af == AF_INET ? 25 : 121), af);
+            for (int j = 0; j < IPT_KEYLEN(addr) - 1; j++)
+                IPT_KEYPTR(addr)[j] = (IPT_KEYPTR(addr)[j] & ~IPT_KEYPTR(mask)[j])
+                    | (IPT_KEYPTR(keys[i % 5000])[j] & IPT_KEYPTR(mask)[j]);
+            e = tbl_lpmkey(t, addr);
+            if (e != bsl_lpm(b, addr)) bad++;
+            if (e != bsl_lpm(bb, addr)) bad++;
+        }
+        mu_eq(0, bad, "%d");
+
+        bsl_destroy(&b);
+        bsl_destroy(&bb);
+        tbl_destroy(&t, NULL);
+    }
+}
@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <stdint.h>          // UINT32_MAX
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+#include "crx.h"             // compact radix trie
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_crx_lpm.h"
+
+
+/*
+ * Test crx_create() and crx_lpm()
+ */
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+
+// check the depth first layout: children come after their parent, a left
+// child right after it, and keys extend their parent's key
+static int
+layout_errors(crx_t *c)
+{
+    uint32_t *n, *m, j, msk;
+    int bad = 0, bits;
+
+    for (uint32_t i = 1; i < c->count; i++) {
+        n = c->node + (size_t)i * c->stride;
+        for (int b = 0; b < 2; b++) {
+            if ((j = n[CRX_CHILD + b]) == 0) continue;
+            if (j <= i || j >= c->count) { bad++; continue; }
+            if (b == 0 && j != i + 1) bad++;
+            m = c->node + (size_t)j * c->stride;
+            if (CRX_MLEN(m) <= CRX_MLEN(n)) bad++;
+            for (int k = 0; k < c->words; k++) {
+                bits = (int)CRX_MLEN(n) - 32 * k;
+                msk = bits >= 32 ? UINT32_MAX
+                      : bits <= 0 ? 0 : ~(UINT32_MAX >> bits);
+                if ((m[CRX_KEY + k] & msk) != n[CRX_KEY + k]) bad++;
+            }
+        }
+        if ((c->entry[i] != NULL) != !!(n[CRX_INFO] & CRXF_PREFIX)) bad++;
+    }
+
+    return bad;
+}
+
+// count the nodes that only exist to branch, the root excluded
+static int
+branch_nodes(crx_t *c)
+{
+    int count = 0;
+
+    for (uint32_t i = 2; i < c->count; i++)
+        if (!(c->node[(size_t)i * c->stride + CRX_INFO] & CRXF_PREFIX))
+            count++;
+
+    return count;
+}
+
+void
+test_crx_basic(void)
+{
+    const char *pfx[] = {
+        "10.0.0.0/8", "10.10.0.0/16", "10.10.10.0/24", "10.10.10.128/25",
+        "2001:db8::/32", "2001:db8:1::/48", "2001:db8:1:1::/64",
+        "2001:db8:1:1::1/128",
+    };
+    int val[NELEMS(pfx)];
+    table_t *t = tbl_create(NULL);
+    crx_t *c;
+    entry_t *e;
+    uint8_t addr[MAX_BINKEY];
+    int mlen, af;
+
+    for (int i = 0; i < NELEMS(pfx); i++) {
+        val[i] = i;
+        mu_assert(tbl_set(t, pfx[i], &val[i], NULL));
+    }
+
+    mu_eq(NULL, (void *)crx_create(NULL, AF_INET6), "%p");
+    mu_eq(NULL, (void *)crx_create(t, AF_UNSPEC), "%p");
+
+    c = crx_create(t, AF_INET6);
+    mu_assert(c);
+    mu_eq(AF_INET6, c->af, "%d");
+    mu_eq(4, c->words, "%d");
+    mu_eq(7, c->stride, "%d");
+    mu_eq(128, c->maxlen, "%d");
+    mu_eq(SIZE_T(4), c->prefixes, "%zu");
+    mu_eq(t->gen, c->gen, "%lu");
+    // nested prefixes need no branching nodes: node 0, root & 4 prefixes
+    mu_eq(6u, c->count, "%u");
+    mu_eq(c->count, c->size, "%u");
+    mu_true(crx_memsize(c) > c->count * 7 * sizeof(uint32_t));
+    mu_eq(SIZE_T(0), crx_memsize(NULL), "%zu");
+
+    mu_assert(key_bystr(addr, &mlen, &af, "2001:db8:1:1::1"));
+    e = crx_lpm(c, addr);
+    mu_assert(e);
+    mu_eq(7, INT_VALUE(e), "%d");
+
+    mu_assert(key_bystr(addr, &mlen, &af, "2001:db8:1:1::2"));
+    e = crx_lpm(c, addr);
+    mu_assert(e);
+    mu_eq(6, INT_VALUE(e), "%d");
+
+    mu_assert(key_bystr(addr, &mlen, &af, "2001:db8:1:2::"));
+    e = crx_lpm(c, addr);
+    mu_assert(e);
+    mu_eq(5, INT_VALUE(e), "%d");
+
+    mu_assert(key_bystr(addr, &mlen, &af, "2001:db9::"));
+    mu_eq(NULL, (void *)crx_lpm(c, addr), "%p");
+
+    // wrong family
+    mu_assert(key_bystr(addr, &mlen, &af, "10.10.10.10"));
+    mu_eq(NULL, (void *)crx_lpm(c, addr), "%p");
+    mu_eq(NULL, (void *)crx_lpm(c, NULL), "%p");
+    mu_eq(NULL, (void *)crx_lpm(NULL, addr), "%p");
+
+    mu_assert(crx_destroy(&c));
+    mu_eq(NULL, (void *)c, "%p");
+    mu_false(crx_destroy(&c));
+
+    // ipv4 works too
+    c = crx_create(t, AF_INET);
+    mu_assert(c);
+    mu_eq(1, c->words, "%d");
+    mu_eq(4 * 4, c->stride * (int)sizeof(uint32_t), "%d");
+    mu_assert(key_bystr(addr, &mlen, &af, "10.10.10.129"));
+    e = crx_lpm(c, addr);
+    mu_assert(e);
+    mu_eq(3, INT_VALUE(e), "%d");
+    mu_assert(key_bystr(addr, &mlen, &af, "10.11.0.0"));
+    e = crx_lpm(c, addr);
+    mu_assert(e);
+    mu_eq(0, INT_VALUE(e), "%d");
+    crx_destroy(&c);
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_crx_branch(void)
+{
+    const char *pfx[] = {"10.0.0.0/24", "10.0.1.0/24", "10.0.0.0/23"};
+    int val[] = {0, 1, 2};
+    table_t *t = tbl_create(NULL);
+    crx_t *c;
+    uint32_t *n;
+    entry_t *e;
+    uint8_t addr[MAX_BINKEY];
+    int mlen, af;
+
+    // siblings get a branching node at the first bit they differ in
+    mu_assert(tbl_set(t, pfx[0], &val[0], NULL));
+    mu_assert(tbl_set(t, pfx[1], &val[1], NULL));
+    c = crx_create(t, AF_INET);
+    mu_assert(c);
+    mu_eq(5u, c->count, "%u");
+    mu_eq(1, branch_nodes(c), "%d");
+    n = c->node + 2 * (size_t)c->stride;  // depth first: root's left child
+    mu_eq(23u, CRX_MLEN(n), "%u");
+    mu_eq(NULL, (void *)c->entry[2], "%p");
+    mu_eq(0, layout_errors(c), "%d");
+
+    // a branching node is never a match
+    mu_assert(key_bystr(addr, &mlen, &af, "10.0.2.1"));
+    mu_eq(NULL, (void *)crx_lpm(c, addr), "%p");
+    mu_assert(key_bystr(addr, &mlen, &af, "10.0.1.1"));
+    e = crx_lpm(c, addr);
+    mu_assert(e);
+    mu_eq(1, INT_VALUE(e), "%d");
+    crx_destroy(&c);
+
+    // a prefix at the branching point takes the branching node's place
+    mu_assert(tbl_set(t, pfx[2], &val[2], NULL));
+    c = crx_create(t, AF_INET);
+    mu_assert(c);
+    mu_eq(5u, c->count, "%u");
+    mu_eq(0, branch_nodes(c), "%d");
+    mu_eq(0, layout_errors(c), "%d");
+    mu_assert(key_bystr(addr, &mlen, &af, "10.0.1.1"));
+    e = crx_lpm(c, addr);
+    mu_assert(e);
+    mu_eq(1, INT_VALUE(e), "%d");
+    mu_assert(key_bystr(addr, &mlen, &af, "10.0.0.255"));
+    e = crx_lpm(c, addr);
+    mu_assert(e);
+    mu_eq(0, INT_VALUE(e), "%d");
+    mu_assert(key_bystr(addr, &mlen, &af, "10.0.2.1"));
+    mu_eq(NULL, (void *)crx_lpm(c, addr), "%p");
+    crx_destroy(&c);
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_crx_relayout(void)
+{
+    // the layout does not depend on the order the table was filled in
+    table_t *t[2];
+    crx_t *c[2];
+    char buf[MAX_STRKEY];
+    uint8_t addr[MAX_BINKEY];
+    int mlen, af, bad = 0, len = 0, val = 0;
+    static char pfx[600][MAX_STRKEY];
+
+    snprintf(pfx[len++], MAX_STRKEY, "10.0.0.0/16");
+    snprintf(pfx[len++], MAX_STRKEY, "10.0.0.0/20");
+    snprintf(pfx[len++], MAX_STRKEY, "10.0.64.0/18");
+    for (int i = 0; i < 256; i++) {
+        if (i % 3 == 0) snprintf(pfx[len++], MAX_STRKEY, "10.0.%d.0/24", i);
+        if (i % 5 == 0) snprintf(pfx[len++], MAX_STRKEY, "10.0.%d.128/25", i);
+        if (i % 7 == 0) snprintf(pfx[len++], MAX_STRKEY, "10.0.%d.%d/32", i, i);
+    }
+
+    t[0] = tbl_create(NULL);
+    t[1] = tbl_create(NULL);
+    for (int i = 0; i < len; i++) {
+        mu_assert(tbl_set(t[0], pfx[i], &val, NULL));
+        mu_assert(tbl_set(t[1], pfx[len - 1 - i], &val, NULL));
+    }
+    c[0] = crx_create(t[0], AF_INET);
+    c[1] = crx_create(t[1], AF_INET);
+    mu_assert(c[0]);
+    mu_assert(c[1]);
+
+    mu_eq(t[0]->count4, c[0]->prefixes, "%zu");
+    mu_eq(c[0]->count, c[0]->size, "%u");  // trimmed to the nodes in use
+    mu_true(c[0]->count <= 2 * c[0]->prefixes + 2);
+    mu_eq(0, layout_errors(c[0]), "%d");
+    mu_eq(c[0]->count, c[1]->count, "%u");
+    mu_eq(0, memcmp(c[0]->node, c[1]->node,
+                    (size_t)c[0]->count * c[0]->stride * sizeof(uint32_t)),
+          "%d");
+
+    // renumbered entries still belong to their node's prefix
+    for (uint32_t i = 1; i < c[0]->count; i++) {
+        if (c[0]->entry[i] == NULL) continue;
+        mu_assert(key_tostr(buf, c[0]->entry[i]->key));
+        snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), "/%u",
+                 CRX_MLEN(c[0]->node + (size_t)i * c[0]->stride));
+        if (tbl_get(t[0], buf) != c[0]->entry[i]) bad++;
+    }
+    mu_eq(0, bad, "%d");
+
+    // every address in 10.0.0.0/15 matches the radix tree's answer
+    mu_assert(key_bystr(addr, &mlen, &af, "10.0.0.0"));
+    for (int i = 0; i < 2 * 65536; i++, key_incr(addr, 1))
+        if (crx_lpm(c[0], addr) != tbl_lpmkey(t[0], addr)) bad++;
+    mu_eq(0, bad, "%d");
+
+    for (int i = 0; i < 2; i++) {
+        crx_destroy(&c[i]);
+        tbl_destroy(&t[i], NULL);
+    }
+}
+
+void
+test_crx_maxlen(void)
+{
+    const char *pfx4[] = {"0.0.0.0/0", "0.0.0.0/32", "128.0.0.0/1",
+                          "255.255.255.255/32"};
+    const char *pfx6[] = {"::/0", "::/128", "::1/128",
+                          "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff/128"};
+    struct { const char *addr; int val; } lpm4[] = {
+        {"0.0.0.0", 1}, {"0.0.0.1", 0}, {"127.255.255.255", 0},
+        {"128.0.0.0", 2}, {"255.255.255.254", 2}, {"255.255.255.255", 3},
+    }, lpm6[] = {
+        {"::", 1}, {"::1", 2}, {"::2", 0}, {"8000::", 0},
+        {"ffff:ffff:ffff:ffff:ffff:ffff:ffff:fffe", 0},
+        {"ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", 3},
+    };
+    int val[] = {0, 1, 2, 3};
+    table_t *t = tbl_create(NULL);
+    crx_t *c;
+    uint32_t *n;
+    entry_t *e;
+    uint8_t addr[MAX_BINKEY];
+    int mlen, af, bad = 0;
+
+    for (int i = 0; i < NELEMS(val); i++) {
+        mu_assert(tbl_set(t, pfx4[i], &val[i], NULL));
+        mu_assert(tbl_set(t, pfx6[i], &val[i], NULL));
+    }
+
+    // ipv4: a /0 root, no branching nodes needed
+    c = crx_create(t, AF_INET);
+    mu_assert(c);
+    mu_eq(32, c->maxlen, "%d");
+    mu_eq(5u, c->count, "%u");
+    mu_assert(c->node[c->stride + CRX_INFO] & CRXF_PREFIX);
+    for (int i = 0; i < NELEMS(lpm4); i++) {
+        mu_assert(key_bystr(addr, &mlen, &af, lpm4[i].addr));
+        e = crx_lpm(c, addr);
+        mu_assert(e);
+        mu_eq(lpm4[i].val, INT_VALUE(e), "%d");
+    }
+    mu_eq(0, layout_errors(c), "%d");
+    crx_destroy(&c);
+
+    // ipv6: ::/128 and ::1/128 branch at the very last bit
+    c = crx_create(t, AF_INET6);
+    mu_assert(c);
+    mu_eq(128, c->maxlen, "%d");
+    mu_eq(6u, c->count, "%u");
+    mu_eq(1, branch_nodes(c), "%d");
+    mu_eq(127u, CRX_MLEN(c->node + 2 * (size_t)c->stride), "%u");
+    for (int i = 0; i < NELEMS(lpm6); i++) {
+        mu_assert(key_bystr(addr, &mlen, &af, lpm6[i].addr));
+        e = crx_lpm(c, addr);
+        mu_assert(e);
+        mu_eq(lpm6[i].val, INT_VALUE(e), "%d");
+    }
+    mu_eq(0, layout_errors(c), "%d");
+
+    // nodes at maxlen are leaves, lookups stop there
+    for (uint32_t i = 1; i < c->count; i++) {
+        n = c->node + (size_t)i * c->stride;
+        if (CRX_MLEN(n) == (uint32_t)c->maxlen &&
+            (n[CRX_CHILD] || n[CRX_CHILD + 1])) bad++;
+    }
+    mu_eq(0, bad, "%d");
+
+    // a host route flagged for deletion is left out, as is its branch
+    t->itr_lock = 1;
+    mu_assert(tbl_del(t, "::1/128", NULL));
+    t->itr_lock = 0;
+    mu_true(t->gen != c->gen);
+    crx_destroy(&c);
+    c = crx_create(t, AF_INET6);
+    mu_assert(c);
+    mu_eq(SIZE_T(3), c->prefixes, "%zu");
+    mu_eq(0, branch_nodes(c), "%d");
+    mu_assert(key_bystr(addr, &mlen, &af, "::1"));
+    e = crx_lpm(c, addr);
+    mu_assert(e);
+    mu_eq(0, INT_VALUE(e), "%d");
+    crx_destroy(&c);
+
+    tbl_destroy(&t, NULL);
+}
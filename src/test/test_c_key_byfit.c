@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_key_byfit.h"
+
+
+/*
+ * Test key_byfit()
+ */
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+
+typedef struct testfit_t {
+    const char *a;
+    const char *b;
+    int mlen;
+} testfit_t;
+
+void
+test_key_byfit_good(void)
+{
+    testfit_t tests[] = {
+        {"10.10.10.10", "10.10.10.10", 32},
+        {"10.10.10.10", "10.10.10.20", 31},
+        {"10.10.10.12", "10.10.10.20", 30},
+        {"10.10.10.0", "10.10.10.255", 24},
+        {"10.10.10.0", "10.10.11.0", 24},
+        {"10.10.0.0", "10.10.255.254", 17},
+        {"0.0.0.0", "255.255.255.255", 0},
+        {"0.0.0.0", "255.255.255.254", 1},
+        {"128.0.0.0", "255.255.255.255", 1},
+        {"255.255.255.255", "255.255.255.255", 32},
+        // a's trailing bytes limit the mask beyond the 1st differing byte
+        {"10.10.0.1", "10.11.0.0", 32},
+        {"10.10.1.0", "10.11.0.0", 24},
+        {"2001:db8::7", "2001:db9::", 128},
+        {"2001:db8::8", "2001:db9::", 125},
+        {"2001:db8::", "2001:db9::", 32},
+        {"2001:db8::", "2001:db9:ffff:ffff:ffff:ffff:ffff:ffff", 31},
+        {"::", "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", 0},
+    };
+    uint8_t a[MAX_BINKEY], b[MAX_BINKEY], m[MAX_BINKEY];
+    int mlen, af;
+
+    for (int i = 0; i < NELEMS(tests); i++) {
+        mu_assert(key_bystr(a, &mlen, &af, tests[i].a));
+        mu_assert(key_bystr(b, &mlen, &af, tests[i].b));
+        mu_assert(key_byfit(m, a, b));
+        mu_eq(IPT_KEYLEN(a), IPT_KEYLEN(m), "%d");
+        mu_eq(tests[i].mlen, key_masklen(m), "%d");
+    }
+}
+
+void
+test_key_byfit_bad(void)
+{
+    uint8_t a[MAX_BINKEY], b[MAX_BINKEY], m[MAX_BINKEY];
+    int mlen, af;
+
+    mu_assert(key_bystr(a, &mlen, &af, "10.10.10.10"));
+    mu_assert(key_bystr(b, &mlen, &af, "2001:db8::"));
+    mu_eq(NULL, (void *)key_byfit(m, a, b), "%p");
+    mu_eq(NULL, (void *)key_byfit(NULL, a, a), "%p");
+    mu_eq(NULL, (void *)key_byfit(m, NULL, a), "%p");
+    mu_eq(NULL, (void *)key_byfit(m, a, NULL), "%p");
+}
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_key_words.h"
+
+
+/*
+ * Differential tests: word-wise key_x() versus byte-wise kref_x()
+ */
+
+#define ROUNDS 200000
+
+// xorshift, so runs are repeatable
+static uint32_t rnd_state = 2463534242u;
+uint32_t rnd(void);
+uint32_t
+rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+// random ipv4 or ipv6 key, with a bias towards all 0's/1's bytes
+void rnd_key(uint8_t *key, int len);
+void
+rnd_key(uint8_t *key, int len)
+{
+    uint32_t r;
+
+    memset(key, 0, MAX_BINKEY);
+    IPT_KEYLEN(key) = len;
+    for (int i = 1; i < len; i++) {
+        r = rnd();
+        key[i] = r % 4 == 0 ? 0x00 : r % 4 == 1 ? 0xff : (r >> 8) & 0xff;
+    }
+}
+
+// random mask, possibly with a radix style short LEN
+void rnd_mask(uint8_t *mask, int af);
+void
+rnd_mask(uint8_t *mask, int af)
+{
+    int mlen = rnd() % (af == AF_INET ? 33 : 129);
+
+    key_bylen(mask, mlen, af);
+    if (rnd() % 2)
+        IPT_KEYLEN(mask) = 1 + (mlen + 7) / 8;
+}
+
+void
+test_words_masklen(void)
+{
+    uint8_t mask[MAX_BINKEY];
+    int bad = 0;
+
+    for (int i = 0; i < ROUNDS; i++) {
+        rnd_mask(mask, i % 2 ? AF_INET : AF_INET6);
+        if (i % 7 == 0) rnd_key(mask, i % 2 ? 5 : 17);  // not a mask
+        if (key_masklen(mask) != kref_masklen(mask)) bad++;
+    }
+    mu_eq(0, bad, "%d");
+    mu_eq(-1, key_masklen(NULL), "%d");
+    mask[0] = 0;
+    mu_eq(kref_masklen(mask), key_masklen(mask), "%d");
+    mask[0] = 1;
+    mu_eq(kref_masklen(mask), key_masklen(mask), "%d");
+}
+
+void
+test_words_network(void)
+{
+    uint8_t k1[MAX_BINKEY], k2[MAX_BINKEY], mask[MAX_BINKEY];
+    int af, bad = 0;
+
+    for (int i = 0; i < ROUNDS; i++) {
+        af = i % 2 ? AF_INET : AF_INET6;
+        rnd_key(k1, KEY_LEN_FAM(af));
+        rnd_mask(mask, af);
+        memcpy(k2, k1, MAX_BINKEY);
+        if (key_network(k1, mask) != kref_network(k2, mask)) bad++;
+        if (memcmp(k1, k2, MAX_BINKEY)) bad++;
+
+        rnd_key(k1, KEY_LEN_FAM(af));
+        memcpy(k2, k1, MAX_BINKEY);
+        if (key_broadcast(k1, mask) != kref_broadcast(k2, mask)) bad++;
+        if (memcmp(k1, k2, MAX_BINKEY)) bad++;
+    }
+    mu_eq(0, bad, "%d");
+
+    // mask longer than key
+    rnd_key(k1, 5);
+    rnd_mask(mask, AF_INET6);
+    IPT_KEYLEN(mask) = 17;
+    mu_eq(0, key_network(k1, mask), "%d");
+    mu_eq(0, key_broadcast(k1, mask), "%d");
+}
+
+void
+test_words_cmp(void)
+{
+    uint8_t k1[MAX_BINKEY], k2[MAX_BINKEY], mask[MAX_BINKEY];
+    int af, bad = 0;
+
+    for (int i = 0; i < ROUNDS; i++) {
+        af = i % 2 ? AF_INET : AF_INET6;
+        rnd_key(k1, KEY_LEN_FAM(af));
+        if (i % 3 == 0) {
+            // same prefix, so the difference is in the last bytes
+            memcpy(k2, k1, MAX_BINKEY);
+            k2[KEY_LEN_FAM(af) - 1] = rnd() & 0xff;
+        } else
+            rnd_key(k2, KEY_LEN_FAM(af));
+        if (key_cmp(k1, k2) != kref_cmp(k1, k2)) bad++;
+
+        rnd_mask(mask, af);
+        key_network(k2, mask);
+        if (key_isin(k2, k1, mask) != kref_isin(k2, k1, mask)) bad++;
+        if (key_isin(k1, k2, NULL) != kref_isin(k1, k2, NULL)) bad++;
+    }
+    mu_eq(0, bad, "%d");
+
+    rnd_key(k1, 5);
+    rnd_key(k2, 17);
+    mu_eq(-2, key_cmp(k1, k2), "%d");
+    mu_eq(-2, key_cmp(k1, NULL), "%d");
+    mu_eq(kref_isin(k1, k2, NULL), key_isin(k1, k2, NULL), "%d");
+}
+
+void
+test_words_incr(void)
+{
+    uint8_t k1[MAX_BINKEY], k2[MAX_BINKEY];
+    size_t num;
+    int af, bad = 0;
+    uint8_t *r1, *r2;
+
+    for (int i = 0; i < ROUNDS; i++) {
+        af = i % 2 ? AF_INET : AF_INET6;
+        rnd_key(k1, KEY_LEN_FAM(af));
+        num = rnd() % 4 == 0 ? ((size_t)rnd() << 32 | rnd()) : rnd() % 1024;
+        memcpy(k2, k1, MAX_BINKEY);
+
+        r1 = key_incr(k1, num);
+        r2 = kref_incr(k2, num);
+        if ((r1 == NULL) != (r2 == NULL)) bad++;
+        if (r1 && memcmp(k1, k2, MAX_BINKEY)) bad++;
+
+        r1 = key_decr(k1, num);
+        r2 = kref_decr(k2, num);
+        if ((r1 == NULL) != (r2 == NULL)) bad++;
+        if (r1 && memcmp(k1, k2, MAX_BINKEY)) bad++;
+    }
+    mu_eq(0, bad, "%d");
+
+    // carry across all bytes
+    key_bystr(k1, &af, &af, "0.255.255.255");
+    mu_assert(key_incr(k1, 1));
+    key_bystr(k2, &af, &af, "1.0.0.0");
+    mu_eq(0, key_cmp(k1, k2), "%d");
+    key_bystr(k1, &af, &af, "::ffff:ffff:ffff:ffff");
+    mu_assert(key_incr(k1, 1));
+    key_bystr(k2, &af, &af, "0:0:0:1::");
+    mu_eq(0, key_cmp(k1, k2), "%d");
+    mu_assert(key_decr(k1, 1));
+    key_bystr(k2, &af, &af, "::ffff:ffff:ffff:ffff");
+    mu_eq(0, key_cmp(k1, k2), "%d");
+
+    // wrap arounds
+    key_bystr(k1, &af, &af, "255.255.255.255");
+    mu_eq(NULL, (void *)key_incr(k1, 1), "%p");
+    key_bystr(k1, &af, &af, "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
+    mu_eq(NULL, (void *)key_incr(k1, 1), "%p");
+    key_bystr(k1, &af, &af, "::");
+    mu_eq(NULL, (void *)key_decr(k1, 1), "%p");
+    key_bystr(k1, &af, &af, "0.0.0.0");
+    mu_eq(NULL, (void *)key_decr(k1, 1), "%p");
+    mu_eq(NULL, (void *)key_incr(NULL, 1), "%p");
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_mp_select.h"
+
+
+/*
+ * Test mp_add(), mp_del(), mp_select() and mp_destroy()
+ */
+
+#define SIZE_T(x) ((size_t)(x))
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+
+// Helpers
+
+void purge(void *, void **);
+
+void
+purge(void *args, void **dta)
+{
+    // counts purged values, which are not heap allocated
+    *(int *)args += 1;
+    *dta = NULL;
+}
+
+// Tests
+
+void
+test_mp_add(void)
+{
+    mpath_t *mp = NULL;
+    int num[10];
+
+    mu_false(mp_add(NULL, num, 1));
+
+    for (int i = 0; i < NELEMS(num); i++)
+        mu_assert(mp_add(&mp, num+i, i));
+
+    mu_assert(mp);
+    mu_eq(SIZE_T(10), mp->count, "%zu");
+    mu_true(mp->size >= mp->count);
+    // weight 0 counts as 1, so 1 + (1+2+...+9)
+    mu_eq(46, (int)mp->total, "%d");
+    for (int i = 0; i < NELEMS(num); i++)
+        mu_eq((void *)(num+i), mp->path[i].value, "%p");
+
+    mu_assert(mp_destroy(&mp, NULL, NULL));
+    mu_eq(NULL, (void *)mp, "%p");
+    mu_false(mp_destroy(&mp, NULL, NULL));
+}
+
+void
+test_mp_del(void)
+{
+    mpath_t *mp = NULL;
+    int num[4], purged = 0;
+
+    for (int i = 0; i < NELEMS(num); i++)
+        mu_assert(mp_add(&mp, num+i, 2));
+
+    mu_false(mp_del(&mp, 4, purge, &purged));
+    mu_false(mp_del(NULL, 0, purge, &purged));
+
+    // order of remaining paths is preserved
+    mu_assert(mp_del(&mp, 1, purge, &purged));
+    mu_eq(1, purged, "%d");
+    mu_eq(SIZE_T(3), mp->count, "%zu");
+    mu_eq(6, (int)mp->total, "%d");
+    mu_eq((void *)(num+0), mp->path[0].value, "%p");
+    mu_eq((void *)(num+2), mp->path[1].value, "%p");
+    mu_eq((void *)(num+3), mp->path[2].value, "%p");
+
+    // removing the last path frees the set
+    mu_assert(mp_del(&mp, 2, purge, &purged));
+    mu_assert(mp_del(&mp, 0, purge, &purged));
+    mu_assert(mp_del(&mp, 0, purge, &purged));
+    mu_eq(4, purged, "%d");
+    mu_eq(NULL, (void *)mp, "%p");
+
+    // destroy purges all remaining values
+    for (int i = 0; i < NELEMS(num); i++)
+        mu_assert(mp_add(&mp, num+i, 1));
+    mu_assert(mp_destroy(&mp, purge, &purged));
+    mu_eq(8, purged, "%d");
+}
+
+void
+test_mp_select(void)
+{
+    mpath_t *mp = NULL;
+    int num[3], hits[3] = {0, 0, 0};
+    void *v;
+
+    mu_eq(NULL, mp_select(NULL, 42), "%p");
+
+    // weights 1, 2, 3 -> hits in 1:2:3 proportion
+    for (int i = 0; i < NELEMS(num); i++)
+        mu_assert(mp_add(&mp, num+i, i+1));
+
+    for (uint32_t hash = 0; hash < 600; hash++) {
+        v = mp_select(mp, hash);
+        mu_assert(v);
+        hits[(int *)v - num]++;
+    }
+    mu_eq(100, hits[0], "%d");
+    mu_eq(200, hits[1], "%d");
+    mu_eq(300, hits[2], "%d");
+
+    // same hash, same path
+    mu_eq(mp_select(mp, 0xdeadbeef), mp_select(mp, 0xdeadbeef), "%p");
+    mu_eq((void *)(num+2), mp_select(mp, 0xffffffff), "%p");
+
+    mp_destroy(&mp, NULL, NULL);
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+#include <pthread.h>         // pthread_t
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+#include "bsl.h"             // binary search on prefix lengths
+#include "pool.h"            // worker pool for batch lookups
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_pool.h"
+
+
+
+/*
+ * Test pool_create(), pool_lpm() and pool_destroy()
+ */
+
+#define NADDR 5000
+
+table_t *mktable(void);
+table_t *
+mktable(void)
+{
+    table_t *t = tbl_create(NULL);
+    char pfx[MAX_STRKEY];
+    uint32_t r = 4321;
+
+    for (int i = 0; i < 2000; i++) {
+        r = r * 1103515245 + 12345;
+        snprintf(pfx, sizeof(pfx), "%u.%u.0.0/%u", 1 + (r >> 24) % 32,
+                 (r >> 16) & 0xff, 8 + (r >> 8) % 17);
+        tbl_set(t, pfx, NULL, NULL);
+        snprintf(pfx, sizeof(pfx), "2001:db8:%x::/%u", (r >> 16) & 0xff,
+                 32 + (r >> 8) % 33);
+        tbl_set(t, pfx, NULL, NULL);
+    }
+
+    return t;
+}
+
+void
+test_pool_create(void)
+{
+    table_t *t = mktable();
+    pool_t *p = NULL;
+
+    mu_eq(NULL, (void *)pool_create(NULL, 1), "%p");
+    mu_false(pool_destroy(NULL));
+    mu_false(pool_destroy(&p));
+
+    p = pool_create(t, 1);
+    mu_assert(p);
+    mu_eq(0, p->nthreads, "%d");
+    mu_assert(p->bsl4);
+    mu_assert(p->bsl6);
+    mu_true(pool_destroy(&p));
+    mu_eq(NULL, (void *)p, "%p");
+
+    p = pool_create(t, 4);
+    mu_eq(3, p->nthreads, "%d");
+    pool_destroy(&p);
+
+    p = pool_create(t, 1000);
+    mu_eq(POOL_MAXTHREADS - 1, p->nthreads, "%d");
+    pool_destroy(&p);
+
+    p = pool_create(t, 0);
+    mu_assert(p);
+    mu_true(p->nthreads >= 0 && p->nthreads < POOL_MAXTHREADS);
+    pool_destroy(&p);
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_pool_lpm(void)
+{
+    table_t *t = mktable();
+    pool_t *p;
+    const char *addrs[NADDR];
+    entry_t *res[NADDR];
+    static char buf[NADDR][MAX_STRKEY];
+    uint32_t r = 1234;
+
+    for (int i = 0; i < NADDR; i++) {
+        r = r * 1103515245 + 12345;
+        if (i % 3)
+            snprintf(buf[i], MAX_STRKEY, "%u.%u.%u.%u", 1 + (r >> 24) % 32,
+                     (r >> 16) & 0xff, (r >> 8) & 0xff, r & 0xff);
+        else
+            snprintf(buf[i], MAX_STRKEY, "2001:db8:%x::%x", (r >> 16) & 0xff,
+                     r & 0xffff);
+        addrs[i] = buf[i];
+    }
+    addrs[7] = NULL;
+    addrs[8] = "not an address";
+
+    for (int threads = 1; threads < 6; threads += 2) {
+        p = pool_create(t, threads);
+        mu_false(pool_lpm(NULL, addrs, NADDR, res));
+        mu_false(pool_lpm(p, NULL, NADDR, res));
+        mu_false(pool_lpm(p, addrs, NADDR, NULL));
+        mu_true(pool_lpm(p, addrs, 0, res));
+
+        // repeated jobs on the same pool
+        for (int round = 0; round < 3; round++) {
+            memset(res, 0xff, sizeof(res));
+            mu_true(pool_lpm(p, addrs, NADDR - round, res));
+            for (int i = 0; i < NADDR - round; i++)
+                mu_eq((void *)(addrs[i] ? tbl_lpm(t, addrs[i]) : NULL),
+                      (void *)res[i], "%p");
+        }
+        pool_destroy(&p);
+    }
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_pool_snapshot(void)
+{
+    table_t *t = tbl_create(NULL);
+    pool_t *p = pool_create(t, 3);
+    const char *addrs[] = {"10.10.10.10", "10.10.10.200"};
+    entry_t *res[2];
+
+    mu_true(pool_lpm(p, addrs, 2, res));
+    mu_eq(NULL, (void *)res[0], "%p");
+    mu_eq(NULL, (void *)res[1], "%p");
+
+    // engines are rebuilt once the table changes
+    tbl_set(t, "10.10.10.0/24", NULL, NULL);
+    tbl_set(t, "10.10.10.0/25", NULL, NULL);
+    mu_true(pool_lpm(p, addrs, 2, res));
+    mu_eq((void *)tbl_get(t, "10.10.10.0/25"), (void *)res[0], "%p");
+    mu_eq((void *)tbl_get(t, "10.10.10.0/24"), (void *)res[1], "%p");
+    mu_eq(t->gen, p->bsl4->gen, "%lu");
+
+    tbl_del(t, "10.10.10.0/25", NULL);
+    mu_true(pool_lpm(p, addrs, 2, res));
+    mu_eq((void *)tbl_get(t, "10.10.10.0/24"), (void *)res[0], "%p");
+
+    pool_destroy(&p);
+    tbl_destroy(&t, NULL);
+}
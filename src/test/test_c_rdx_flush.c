@@ -51,6 +51,7 @@ test_rdx_flush_freekey(void)
     purge.purge = NULL;
     purge.head = t->head4;
     purge.args = NULL;
+    purge.tbl = t;
 
     tbl_set(t, "1.1.1.1/24", &af, NULL);
     mu_true(key_bystr(addr, &mlen, &af, "1.1.1.1"));
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_rng_bytbl.h"
+
+
+/*
+ * Test rng_bytbl()
+ */
+
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+
+typedef struct testpfx_t {
+    const char *pfx;
+    int  dta;
+} testpfx_t;
+
+typedef struct testivl_t {
+    const char *start;
+    const char *stop;
+    int dta;
+} testivl_t;
+
+// Helpers
+
+int chk_ivl(interval_t *, testivl_t *);
+void *dup(void *, void *);
+void purge(void *, void **);
+
+int
+chk_ivl(interval_t *ivl, testivl_t *exp)
+{
+    // returns 1 if ivl matches the expected interval
+    char start[MAX_STRKEY], stop[MAX_STRKEY];
+    if (! key_tostr(start, ivl->start)) return 0;
+    if (! key_tostr(stop, ivl->stop)) return 0;
+    if (strcmp(start, exp->start) || strcmp(stop, exp->stop)) {
+        fprintf(stderr, "got %s-%s, expected %s-%s\n",
+                start, stop, exp->start, exp->stop);
+        return 0;
+    }
+    return *(int *)ivl->value == exp->dta;
+}
+
+void *
+dup(void *args, void *dta)
+{
+    int *copy = malloc(sizeof(int));
+    *copy = *(int *)dta;
+    *(int *)args += 1;
+    return copy;
+}
+
+void
+purge(void *args, void **dta)
+{
+    args = args ? args : args; /* not used */
+    free(*dta);
+    *dta = NULL;
+}
+
+// Tests
+
+void
+test_rng_bytbl_nested(void)
+{
+    testpfx_t pfx[] = {
+        {"10.0.0.0/8", 8},
+        {"10.10.0.0/16", 16},
+        {"10.10.10.0/24", 24},
+        {"10.10.10.0/25", 25},
+        {"10.10.255.0/24", 124},
+        {"11.0.0.0/8", 108},
+        {"2001:db8::/32", 32},
+        {"2001:db8:1::/48", 48},
+    };
+    testivl_t exp4[] = {
+        {"10.0.0.0", "10.9.255.255", 8},
+        {"10.10.0.0", "10.10.9.255", 16},
+        {"10.10.10.0", "10.10.10.127", 25},
+        {"10.10.10.128", "10.10.10.255", 24},
+        {"10.10.11.0", "10.10.254.255", 16},
+        {"10.10.255.0", "10.10.255.255", 124},
+        {"10.11.0.0", "10.255.255.255", 8},
+        {"11.0.0.0", "11.255.255.255", 108},
+    };
+    testivl_t exp6[] = {
+        {"2001:db8::", "2001:db8:0:ffff:ffff:ffff:ffff:ffff", 32},
+        {"2001:db8:1::", "2001:db8:1:ffff:ffff:ffff:ffff:ffff", 48},
+        {"2001:db8:2::", "2001:db8:ffff:ffff:ffff:ffff:ffff:ffff", 32},
+    };
+    table_t *t = tbl_create(NULL);
+    range_t *r = rng_create(NULL);
+
+    for (int i = 0; i < NELEMS(pfx); i++)
+        mu_assert(tbl_set(t, pfx[i].pfx, &pfx[i].dta, NULL));
+
+    mu_assert(rng_bytbl(r, t, NULL, NULL));
+    mu_eq(SIZE_T(NELEMS(exp4)), r->count4, "%zu");
+    mu_eq(SIZE_T(NELEMS(exp6)), r->count6, "%zu");
+    for (int i = 0; i < NELEMS(exp4); i++)
+        mu_assert(chk_ivl(r->ivl4 + i, exp4 + i));
+    for (int i = 0; i < NELEMS(exp6); i++)
+        mu_assert(chk_ivl(r->ivl6 + i, exp6 + i));
+
+    rng_destroy(&r, NULL);
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_rng_bytbl_edges(void)
+{
+    // the first & last address of the address space, same starts
+    testpfx_t pfx[] = {
+        {"0.0.0.0/0", 0},
+        {"0.0.0.0/1", 1},
+        {"0.0.0.0/32", 32},
+        {"255.255.255.255/32", 132},
+        {"255.255.255.0/24", 124},
+    };
+    testivl_t exp4[] = {
+        {"0.0.0.0", "0.0.0.0", 32},
+        {"0.0.0.1", "127.255.255.255", 1},
+        {"128.0.0.0", "255.255.254.255", 0},
+        {"255.255.255.0", "255.255.255.254", 124},
+        {"255.255.255.255", "255.255.255.255", 132},
+    };
+    table_t *t = tbl_create(NULL);
+    range_t *r = rng_create(NULL);
+
+    for (int i = 0; i < NELEMS(pfx); i++)
+        mu_assert(tbl_set(t, pfx[i].pfx, &pfx[i].dta, NULL));
+
+    mu_assert(rng_bytbl(r, t, NULL, NULL));
+    mu_eq(SIZE_T(NELEMS(exp4)), r->count4, "%zu");
+    for (int i = 0; i < NELEMS(exp4); i++)
+        mu_assert(chk_ivl(r->ivl4 + i, exp4 + i));
+
+    rng_destroy(&r, NULL);
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_rng_bytbl_dup(void)
+{
+    testpfx_t pfx[] = {
+        {"10.0.0.0/8", 8},
+        {"10.10.0.0/16", 16},
+        {"10.20.0.0/16", 20},
+    };
+    table_t *t = tbl_create(NULL);
+    range_t *r = rng_create(purge);
+    int dups = 0;
+
+    for (int i = 0; i < NELEMS(pfx); i++)
+        mu_assert(tbl_set(t, pfx[i].pfx, &pfx[i].dta, NULL));
+
+    // deleted prefixes are ignored
+    t->itr_lock = 1;
+    mu_assert(tbl_del(t, "10.20.0.0/16", NULL));
+    t->itr_lock = 0;
+
+    // /8 is split in two by the /16
+    mu_assert(rng_bytbl(r, t, dup, &dups));
+    mu_eq(3, dups, "%d");
+    mu_eq(SIZE_T(3), r->count4, "%zu");
+    mu_true(r->ivl4[0].value != r->ivl4[2].value);
+
+    // overlaps with existing intervals are refused & dups are purged
+    mu_false(rng_bytbl(r, t, dup, &dups));
+    mu_eq(SIZE_T(3), r->count4, "%zu");
+
+    rng_destroy(&r, NULL);
+    tbl_destroy(&t, NULL);
+}
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_rng_load.h"
+
+
+/*
+ * Test rng_load()
+ */
+
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+
+// Helpers
+
+interval_t *mk_ivl(interval_t *, const char *, const char *, int *);
+
+interval_t *
+mk_ivl(interval_t *ivl, const char *start, const char *stop, int *value)
+{
+    int mlen, af;
+    if (! key_bystr(ivl->start, &mlen, &af, start)) return NULL;
+    if (! key_bystr(ivl->stop, &mlen, &af, stop)) return NULL;
+    ivl->value = value;
+    return ivl;
+}
+
+// Tests
+
+void
+test_rng_load_good(void)
+{
+    range_t *r = rng_create(NULL);
+    interval_t ivl[5];
+    int num[5] = {0, 1, 2, 3, 4};
+    uint8_t addr[MAX_BINKEY];
+    int mlen, af;
+
+    mu_assert(rng_load(r, NULL, 0));
+    mu_assert(rng_load(r, ivl, 0));
+
+    // unsorted & mixed ipv4 and ipv6
+    mk_ivl(ivl+0, "10.10.10.10", "10.10.10.20", num+0);
+    mk_ivl(ivl+1, "2001:db8::", "2001:db8::ffff", num+1);
+    mk_ivl(ivl+2, "1.1.1.1", "1.1.1.1", num+2);
+    mk_ivl(ivl+3, "10.10.10.21", "10.10.11.2", num+3);
+    mk_ivl(ivl+4, "::", "::1", num+4);
+    mu_assert(rng_load(r, ivl, NELEMS(ivl)));
+    mu_eq(SIZE_T(3), r->count4, "%zu");
+    mu_eq(SIZE_T(2), r->count6, "%zu");
+
+    mu_eq(2, INT_VALUE((&r->ivl4[0])), "%d");
+    mu_eq(0, INT_VALUE((&r->ivl4[1])), "%d");
+    mu_eq(3, INT_VALUE((&r->ivl4[2])), "%d");
+    mu_eq(4, INT_VALUE((&r->ivl6[0])), "%d");
+    mu_eq(1, INT_VALUE((&r->ivl6[1])), "%d");
+
+    // a second load merges with intervals already present
+    mk_ivl(ivl+0, "10.10.11.3", "10.10.11.3", num+0);
+    mk_ivl(ivl+1, "0.0.0.0", "1.1.1.0", num+1);
+    mu_assert(rng_load(r, ivl, 2));
+    mu_eq(SIZE_T(5), r->count4, "%zu");
+    mu_eq(1, INT_VALUE((&r->ivl4[0])), "%d");
+    mu_eq(0, INT_VALUE((&r->ivl4[4])), "%d");
+
+    key_bystr(addr, &mlen, &af, "0.255.0.0");
+    mu_eq(1, INT_VALUE(rng_get(r, addr)), "%d");
+    key_bystr(addr, &mlen, &af, "10.10.11.3");
+    mu_eq(0, INT_VALUE(rng_get(r, addr)), "%d");
+
+    rng_destroy(&r, NULL);
+}
+
+void
+test_rng_load_bad(void)
+{
+    range_t *r = rng_create(NULL);
+    interval_t ivl[3];
+    int num[3] = {0, 1, 2};
+
+    mk_ivl(ivl+0, "10.10.10.10", "10.10.10.20", num+0);
+    mu_assert(rng_load(r, ivl, 1));
+
+    // overlaps among the new intervals
+    mk_ivl(ivl+0, "11.0.0.0", "11.0.0.10", num+0);
+    mk_ivl(ivl+1, "11.0.0.10", "11.0.0.20", num+1);
+    mu_false(rng_load(r, ivl, 2));
+
+    // overlaps with existing intervals
+    mk_ivl(ivl+0, "10.10.10.0", "10.10.10.10", num+0);
+    mu_false(rng_load(r, ivl, 1));
+
+    // all or nothing: ipv6 is fine, but ipv4 overlaps
+    mk_ivl(ivl+0, "2001:db8::", "2001:db8::1", num+0);
+    mk_ivl(ivl+1, "10.10.10.15", "10.10.10.16", num+1);
+    mu_false(rng_load(r, ivl, 2));
+
+    // start > stop and mixed AF's
+    mk_ivl(ivl+0, "12.0.0.10", "12.0.0.1", num+0);
+    mu_false(rng_load(r, ivl, 1));
+    mk_ivl(ivl+0, "12.0.0.10", "2001::", num+0);
+    mu_false(rng_load(r, ivl, 1));
+
+    mu_false(rng_load(NULL, ivl, 1));
+    mu_false(rng_load(r, NULL, 1));
+
+    mu_eq(SIZE_T(1), r->count4, "%zu");
+    mu_eq(SIZE_T(0), r->count6, "%zu");
+
+    rng_destroy(&r, NULL);
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_rng_set.h"
+
+/*
+ * Test rng_set(), rng_get(), rng_del() & rng_destroy()
+ */
+
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+
+// Helpers
+
+uint8_t *mk_key(uint8_t *, const char *);
+int *mk_data(int);
+void purge(void *, void **);
+
+uint8_t *
+mk_key(uint8_t *key, const char *s)
+{
+    int mlen, af;
+    return key_bystr(key, &mlen, &af, s);
+}
+
+int *
+mk_data(int num)
+{
+    int *value = calloc(1, sizeof(int));
+    *value = num;
+    return value;
+}
+
+void
+purge(void *args, void **dta)
+{
+    if (args) *(int *)args += 1;
+    if (*dta) free(*dta);
+    *dta = NULL;
+}
+
+// Tests
+
+void
+test_rng_create(void)
+{
+    range_t *r = rng_create(NULL);
+
+    mu_assert(r);
+    mu_eq(SIZE_T(0), r->count4, "%zu");
+    mu_eq(SIZE_T(0), r->count6, "%zu");
+    mu_assert(rng_destroy(&r, NULL));
+    mu_eq(NULL, (void *)r, "%p");
+    mu_false(rng_destroy(&r, NULL));
+    mu_false(rng_destroy(NULL, NULL));
+}
+
+void
+test_rng_set_get(void)
+{
+    range_t *r = rng_create(purge);
+    uint8_t a[MAX_BINKEY], b[MAX_BINKEY];
+    interval_t *e;
+    int purged = 0;
+
+    // insert out of order
+    mu_assert(rng_set(r, mk_key(a, "10.0.0.5"), mk_key(b, "10.0.0.9"),
+                      mk_data(2), NULL));
+    mu_assert(rng_set(r, mk_key(a, "1.1.1.1"), mk_key(b, "1.1.1.1"),
+                      mk_data(1), NULL));
+    mu_assert(rng_set(r, mk_key(a, "10.0.0.10"), mk_key(b, "10.0.1.3"),
+                      mk_data(3), NULL));
+    mu_assert(rng_set(r, mk_key(a, "2001:db8::3"), mk_key(b, "2001:db8::ff"),
+                      mk_data(6), NULL));
+    mu_eq(SIZE_T(3), r->count4, "%zu");
+    mu_eq(SIZE_T(1), r->count6, "%zu");
+
+    // intervals are sorted
+    mu_eq(1, INT_VALUE((&r->ivl4[0])), "%d");
+    mu_eq(2, INT_VALUE((&r->ivl4[1])), "%d");
+    mu_eq(3, INT_VALUE((&r->ivl4[2])), "%d");
+
+    // point lookups, including the edges
+    mu_eq(NULL, (void *)rng_get(r, mk_key(a, "10.0.0.4")), "%p");
+    e = rng_get(r, mk_key(a, "10.0.0.5"));
+    mu_assert(e);
+    mu_eq(2, INT_VALUE(e), "%d");
+    e = rng_get(r, mk_key(a, "10.0.0.9"));
+    mu_assert(e);
+    mu_eq(2, INT_VALUE(e), "%d");
+    e = rng_get(r, mk_key(a, "10.0.0.10"));
+    mu_assert(e);
+    mu_eq(3, INT_VALUE(e), "%d");
+    mu_eq(NULL, (void *)rng_get(r, mk_key(a, "10.0.1.4")), "%p");
+    mu_eq(NULL, (void *)rng_get(r, mk_key(a, "0.0.0.0")), "%p");
+    mu_eq(NULL, (void *)rng_get(r, mk_key(a, "255.255.255.255")), "%p");
+    e = rng_get(r, mk_key(a, "2001:db8::80"));
+    mu_assert(e);
+    mu_eq(6, INT_VALUE(e), "%d");
+    mu_eq(NULL, (void *)rng_get(r, mk_key(a, "2001:db8::2")), "%p");
+
+    // same interval replaces the value
+    mu_assert(rng_set(r, mk_key(a, "10.0.0.5"), mk_key(b, "10.0.0.9"),
+                      mk_data(4), &purged));
+    mu_eq(1, purged, "%d");
+    mu_eq(SIZE_T(3), r->count4, "%zu");
+    e = rng_get(r, mk_key(a, "10.0.0.7"));
+    mu_assert(e);
+    mu_eq(4, INT_VALUE(e), "%d");
+
+    rng_destroy(&r, &purged);
+    mu_eq(5, purged, "%d");
+}
+
+void
+test_rng_set_bad(void)
+{
+    range_t *r = rng_create(NULL);
+    uint8_t a[MAX_BINKEY], b[MAX_BINKEY];
+    int num = 1;
+
+    mu_assert(rng_set(r, mk_key(a, "10.0.0.5"), mk_key(b, "10.0.0.9"),
+                      &num, NULL));
+
+    // overlaps are refused
+    mu_false(rng_set(r, mk_key(a, "10.0.0.0"), mk_key(b, "10.0.0.5"),
+                     &num, NULL));
+    mu_false(rng_set(r, mk_key(a, "10.0.0.9"), mk_key(b, "10.0.0.10"),
+                     &num, NULL));
+    mu_false(rng_set(r, mk_key(a, "10.0.0.6"), mk_key(b, "10.0.0.7"),
+                     &num, NULL));
+    mu_false(rng_set(r, mk_key(a, "10.0.0.0"), mk_key(b, "10.0.0.255"),
+                     &num, NULL));
+    mu_false(rng_set(r, mk_key(a, "10.0.0.5"), mk_key(b, "10.0.0.8"),
+                     &num, NULL));
+
+    // start > stop, or mixed AF's
+    mu_false(rng_set(r, mk_key(a, "10.0.1.9"), mk_key(b, "10.0.1.5"),
+                     &num, NULL));
+    mu_false(rng_set(r, mk_key(a, "10.0.1.9"), mk_key(b, "2001::"),
+                     &num, NULL));
+    mu_false(rng_set(NULL, mk_key(a, "10.0.1.9"), mk_key(b, "10.0.1.9"),
+                     &num, NULL));
+
+    mu_eq(SIZE_T(1), r->count4, "%zu");
+    mu_eq(SIZE_T(0), r->count6, "%zu");
+
+    rng_destroy(&r, NULL);
+}
+
+void
+test_rng_del(void)
+{
+    range_t *r = rng_create(purge);
+    uint8_t a[MAX_BINKEY], b[MAX_BINKEY];
+    char buf[MAX_STRKEY];
+    int purged = 0;
+
+    // enough to force the arrays to grow a few times
+    for (int i = 0; i < 100; i++) {
+        snprintf(buf, sizeof(buf), "10.0.%d.0", i);
+        mk_key(a, buf);
+        snprintf(buf, sizeof(buf), "10.0.%d.99", i);
+        mk_key(b, buf);
+        mu_assert(rng_set(r, a, b, mk_data(i), NULL));
+    }
+    mu_eq(SIZE_T(100), r->count4, "%zu");
+
+    // needs an exact match
+    mu_false(rng_del(r, mk_key(a, "10.0.7.0"), mk_key(b, "10.0.7.98"),
+                     &purged));
+    mu_false(rng_del(r, mk_key(a, "10.0.7.1"), mk_key(b, "10.0.7.99"),
+                     &purged));
+    mu_eq(0, purged, "%d");
+
+    mu_assert(rng_del(r, mk_key(a, "10.0.7.0"), mk_key(b, "10.0.7.99"),
+                      &purged));
+    mu_eq(1, purged, "%d");
+    mu_eq(SIZE_T(99), r->count4, "%zu");
+    mu_eq(NULL, (void *)rng_get(r, mk_key(a, "10.0.7.50")), "%p");
+    mu_assert(rng_get(r, mk_key(a, "10.0.6.50")));
+    mu_assert(rng_get(r, mk_key(a, "10.0.8.50")));
+
+    // now the freed up space can be (re)used
+    mu_assert(rng_set(r, mk_key(a, "10.0.6.100"), mk_key(b, "10.0.7.255"),
+                      mk_data(7), NULL));
+    mu_eq(SIZE_T(100), r->count4, "%zu");
+
+    rng_destroy(&r, &purged);
+    mu_eq(101, purged, "%d");
+}
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_rng_totbl.h"
+
+
+/*
+ * Test rng_totbl()
+ */
+
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+
+// Helpers
+
+uint8_t *mk_key(uint8_t *, const char *);
+void *dup(void *, void *);
+void purge(void *, void **);
+
+uint8_t *
+mk_key(uint8_t *key, const char *s)
+{
+    int mlen, af;
+    return key_bystr(key, &mlen, &af, s);
+}
+
+void *
+dup(void *args, void *dta)
+{
+    int *copy = malloc(sizeof(int));
+    *copy = *(int *)dta;
+    *(int *)args += 1;
+    return copy;
+}
+
+void
+purge(void *args, void **dta)
+{
+    args = args ? args : args; /* not used */
+    free(*dta);
+    *dta = NULL;
+}
+
+// Tests
+
+void
+test_rng_totbl_good(void)
+{
+    range_t *r = rng_create(NULL);
+    table_t *t = tbl_create(NULL);
+    uint8_t a[MAX_BINKEY], b[MAX_BINKEY];
+    int num[3] = {1, 2, 3};
+    entry_t *e;
+
+    // 10.10.10.10-10.10.10.20 -> /31, /30, /30, /32
+    mu_assert(rng_set(r, mk_key(a, "10.10.10.10"), mk_key(b, "10.10.10.20"),
+                      num+0, NULL));
+    mu_assert(rng_set(r, mk_key(a, "255.255.255.255"),
+                      mk_key(b, "255.255.255.255"), num+1, NULL));
+    mu_assert(rng_set(r, mk_key(a, "::"),
+                      mk_key(b, "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"),
+                      num+2, NULL));
+
+    mu_assert(rng_totbl(r, t, NULL, NULL));
+    mu_eq(SIZE_T(5), t->count4, "%zu");
+    mu_eq(SIZE_T(1), t->count6, "%zu");
+    mu_assert(tbl_get(t, "10.10.10.10/31"));
+    mu_assert(tbl_get(t, "10.10.10.12/30"));
+    mu_assert(tbl_get(t, "10.10.10.16/30"));
+    mu_assert(tbl_get(t, "10.10.10.20/32"));
+    mu_assert(tbl_get(t, "255.255.255.255/32"));
+    mu_assert(tbl_get(t, "::/0"));
+
+    mu_eq(NULL, (void *)tbl_lpm(t, "10.10.10.9"), "%p");
+    mu_eq(NULL, (void *)tbl_lpm(t, "10.10.10.21"), "%p");
+    e = tbl_lpm(t, "10.10.10.15");
+    mu_assert(e);
+    mu_eq(1, INT_VALUE(e), "%d");
+
+    rng_destroy(&r, NULL);
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_rng_totbl_dup(void)
+{
+    range_t *r = rng_create(purge);
+    table_t *t = tbl_create(purge);
+    uint8_t a[MAX_BINKEY], b[MAX_BINKEY];
+    int *v = malloc(sizeof(int)), dups = 0;
+
+    *v = 42;
+    mu_assert(rng_set(r, mk_key(a, "10.0.0.1"), mk_key(b, "10.0.0.6"),
+                      v, NULL));
+    // .1/32, .2/31, .4/31, .6/32
+    mu_assert(rng_totbl(r, t, dup, &dups));
+    mu_eq(4, dups, "%d");
+    mu_eq(SIZE_T(4), t->count4, "%zu");
+
+    // both own their values
+    rng_destroy(&r, NULL);
+    mu_eq(42, INT_VALUE(tbl_lpm(t, "10.0.0.5")), "%d");
+    tbl_destroy(&t, NULL);
+
+    mu_false(rng_totbl(NULL, t, NULL, NULL));
+}
+
+void
+test_rng_roundtrip(void)
+{
+    range_t *r = rng_create(NULL), *r2 = rng_create(NULL);
+    table_t *t = tbl_create(NULL);
+    uint8_t a[MAX_BINKEY], b[MAX_BINKEY];
+    int num[2] = {1, 2};
+
+    mu_assert(rng_set(r, mk_key(a, "1.2.3.4"), mk_key(b, "5.6.7.8"),
+                      num+0, NULL));
+    mu_assert(rng_set(r, mk_key(a, "2001:db8::7"), mk_key(b, "2001:db9::"),
+                      num+1, NULL));
+
+    // ranges -> prefixes -> ranges, adjacent prefixes are not merged
+    mu_assert(rng_totbl(r, t, NULL, NULL));
+    mu_assert(rng_bytbl(r2, t, NULL, NULL));
+    mu_eq(t->count4, r2->count4, "%zu");
+    mu_eq(t->count6, r2->count6, "%zu");
+    mu_eq(0, key_cmp(r->ivl4[0].start, r2->ivl4[0].start), "%d");
+    mu_eq(0, key_cmp(r->ivl4[0].stop, r2->ivl4[r2->count4-1].stop), "%d");
+    mu_eq(0, key_cmp(r->ivl6[0].start, r2->ivl6[0].start), "%d");
+    mu_eq(0, key_cmp(r->ivl6[0].stop, r2->ivl6[r2->count6-1].stop), "%d");
+
+    rng_destroy(&r, NULL);
+    rng_destroy(&r2, NULL);
+    tbl_destroy(&t, NULL);
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_cache.h"
+
+
+/*
+ * Test tbl_cache() and tbl_lpmkey()
+ */
+
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+#define U64(x) ((unsigned long long)(x))
+
+// Helpers
+
+uint8_t *mk_key(uint8_t *, const char *);
+
+uint8_t *
+mk_key(uint8_t *key, const char *s)
+{
+    int mlen, af;
+    return key_bystr(key, &mlen, &af, s);
+}
+
+// Tests
+
+void
+test_tbl_cache_size(void)
+{
+    table_t *t = tbl_create(NULL);
+
+    mu_eq(NULL, (void *)t->cache, "%p");
+    mu_assert(tbl_cache(t, 1));
+    mu_eq(SIZE_T(1), t->cache->size, "%zu");
+    mu_assert(tbl_cache(t, 1000));
+    mu_eq(SIZE_T(1024), t->cache->size, "%zu");
+    mu_assert(tbl_cache(t, 1024));
+    mu_eq(SIZE_T(1024), t->cache->size, "%zu");
+    mu_assert(tbl_cache(t, 0));
+    mu_eq(NULL, (void *)t->cache, "%p");
+    mu_false(tbl_cache(NULL, 16));
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tbl_cache_hits(void)
+{
+    table_t *t = tbl_create(NULL);
+    uint8_t addr[MAX_BINKEY];
+    int num[3] = {8, 16, 24};
+    entry_t *e;
+
+    mu_assert(tbl_set(t, "10.0.0.0/8", num+0, NULL));
+    mu_assert(tbl_set(t, "10.10.0.0/16", num+1, NULL));
+    mu_assert(tbl_cache(t, 64));
+
+    // miss, then hit; both string & binary lookups use the cache
+    e = tbl_lpm(t, "10.10.10.10");
+    mu_eq(16, INT_VALUE(e), "%d");
+    mu_eq(0ULL, U64(t->cache->hits), "%llu");
+    mu_eq(1ULL, U64(t->cache->misses), "%llu");
+    mu_eq((void *)e, (void *)tbl_lpmkey(t, mk_key(addr, "10.10.10.10")), "%p");
+    mu_eq(1ULL, U64(t->cache->hits), "%llu");
+
+    // no match is cached as well
+    mu_eq(NULL, (void *)tbl_lpm(t, "11.11.11.11"), "%p");
+    mu_eq(NULL, (void *)tbl_lpm(t, "11.11.11.11"), "%p");
+    mu_eq(2ULL, U64(t->cache->hits), "%llu");
+    mu_eq(2ULL, U64(t->cache->misses), "%llu");
+
+    // a new, more specific prefix invalidates the cache
+    mu_assert(tbl_set(t, "10.10.10.0/24", num+2, NULL));
+    e = tbl_lpm(t, "10.10.10.10");
+    mu_eq(24, INT_VALUE(e), "%d");
+    mu_eq(3ULL, U64(t->cache->misses), "%llu");
+
+    // and so does deleting it, even when only flagged for deletion
+    t->itr_lock = 1;
+    mu_assert(tbl_del(t, "10.10.10.0/24", NULL));
+    e = tbl_lpm(t, "10.10.10.10");
+    mu_eq(16, INT_VALUE(e), "%d");
+    t->itr_lock = 0;
+    mu_assert(tbl_set(t, "10.10.10.0/24", num+2, NULL));
+    e = tbl_lpm(t, "10.10.10.10");
+    mu_eq(24, INT_VALUE(e), "%d");
+    mu_eq(5ULL, U64(t->cache->misses), "%llu");
+
+    // ipv6 lookups are cached as well, never confused with ipv4 ones
+    mu_assert(tbl_set(t, "::/0", num+0, NULL));
+    mu_eq(8, INT_VALUE(tbl_lpm(t, "::a0a:a0a")), "%d");
+    mu_eq(8, INT_VALUE(tbl_lpm(t, "::a0a:a0a")), "%d");
+    mu_eq(24, INT_VALUE(tbl_lpm(t, "10.10.10.10")), "%d");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tbl_cache_collide(void)
+{
+    // a single slot, so all lookups collide
+    table_t *t = tbl_create(NULL), *c;
+    int num[2] = {1, 2};
+
+    mu_assert(tbl_set(t, "1.1.1.0/24", num+0, NULL));
+    mu_assert(tbl_set(t, "2.2.2.0/24", num+1, NULL));
+    mu_assert(tbl_cache(t, 1));
+
+    for (int i = 0; i < 10; i++) {
+        mu_eq(1, INT_VALUE(tbl_lpm(t, "1.1.1.1")), "%d");
+        mu_eq(2, INT_VALUE(tbl_lpm(t, "2.2.2.2")), "%d");
+    }
+    mu_eq(0ULL, U64(t->cache->hits), "%llu");
+    mu_eq(20ULL, U64(t->cache->misses), "%llu");
+
+    // a clone gets a cache of its own, same size
+    c = tbl_clone(t, NULL, NULL);
+    mu_assert(c && c->cache && c->cache != t->cache);
+    mu_eq(t->cache->size, c->cache->size, "%zu");
+    mu_eq(0ULL, U64(c->cache->misses), "%llu");
+
+    tbl_destroy(&c, NULL);
+    tbl_destroy(&t, NULL);
+}
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_clone.h"
+
+/*
+ * Test tbl_clone()
+ */
+
+typedef struct testpfx_t {
+    const char *pfx;
+    int  dta;
+} testpfx_t;
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+
+// dup & purge callbacks for heap allocated int values
+void *dup(void *args, void *dta);
+void *
+dup(void *args, void *dta)
+{
+    int *copy = malloc(sizeof(int));
+    if (copy == NULL) return NULL;
+
+    *copy = *(int *)dta;
+    *(int *)args += 1;
+    return copy;
+}
+
+void purge(void *args, void **dta);
+void
+purge(void *args, void **dta)
+{
+    args = args ? args : args; /* not used */
+    free(*dta);
+    *dta = NULL;
+}
+
+void
+test_clone_empty(void)
+{
+    table_t *t = tbl_create(NULL);
+    table_t *c = tbl_clone(t, NULL, NULL);
+
+    mu_assert(c);
+    mu_true(c != t);
+    mu_eq(SIZE_T(0), c->count4, "%zu");
+    mu_eq(SIZE_T(0), c->count6, "%zu");
+    mu_eq(NULL, (void *)rdx_firstleaf(&c->head4->rh), "%p");
+    mu_eq(NULL, (void *)rdx_firstleaf(&c->head6->rh), "%p");
+
+    tbl_destroy(&c, NULL);
+    tbl_destroy(&t, NULL);
+    mu_eq(NULL, (void *)tbl_clone(NULL, NULL, NULL), "%p");
+}
+
+void
+test_clone_shared(void)
+{
+    // includes /0's and the all-broadcast hosts, which end up as dupedkeys of
+    // the left-end resp. right-end markers of the trees
+    testpfx_t pfx[] = {
+        {"0.0.0.0/0", 1},
+        {"10.10.10.0/24", 2},
+        {"10.10.10.0/25", 3},
+        {"10.10.10.128/25", 4},
+        {"10.10.0.0/16", 5},
+        {"255.255.255.255/32", 6},
+        {"::/0", 7},
+        {"2001:db8::/32", 8},
+        {"2001:db8::/48", 9},
+        {"ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff/128", 10},
+    };
+    table_t *t = tbl_create(NULL);
+    table_t *c;
+    entry_t *e1, *e2;
+    struct radix_node *rn1, *rn2;
+
+    for (int i = 0; i < NELEMS(pfx); i++)
+        mu_assert(tbl_set(t, pfx[i].pfx, &pfx[i].dta, NULL));
+
+    c = tbl_clone(t, NULL, NULL);
+    mu_assert(c);
+    mu_eq(t->count4, c->count4, "%zu");
+    mu_eq(t->count6, c->count6, "%zu");
+
+    // same prefixes, same values, different entries
+    for (int i = 0; i < NELEMS(pfx); i++) {
+        e1 = tbl_get(t, pfx[i].pfx);
+        e2 = tbl_get(c, pfx[i].pfx);
+        mu_assert(e1);
+        mu_assert(e2);
+        mu_true(e1 != e2);
+        mu_true(e1->value == e2->value);
+    }
+
+    // leafs are in the same order in both tables
+    rn1 = rdx_firstleaf(&t->head4->rh);
+    rn2 = rdx_firstleaf(&c->head4->rh);
+    for (; rn1 && rn2; rn1 = rdx_nextleaf(rn1), rn2 = rdx_nextleaf(rn2)) {
+        mu_eq(0, key_cmp(rn1->rn_key, rn2->rn_key), "%d");
+        mu_eq(key_masklen(rn1->rn_mask), key_masklen(rn2->rn_mask), "%d");
+    }
+    mu_eq(NULL, (void *)rn1, "%p");
+    mu_eq(NULL, (void *)rn2, "%p");
+
+    // lpm works on the clone
+    e2 = tbl_lpm(c, "10.10.10.129");
+    mu_assert(e2);
+    mu_eq(4, INT_VALUE(e2), "%d");
+    e2 = tbl_lpm(c, "2001:db8:1::1");
+    mu_assert(e2);
+    mu_eq(8, INT_VALUE(e2), "%d");
+
+    // tables are independent
+    mu_assert(tbl_del(c, "10.10.10.128/25", NULL));
+    mu_assert(tbl_get(t, "10.10.10.128/25"));
+    mu_eq(NULL, (void *)tbl_get(c, "10.10.10.128/25"), "%p");
+    mu_eq(t->count4 - 1, c->count4, "%zu");
+
+    tbl_destroy(&c, NULL);
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_clone_dup(void)
+{
+    const char *pfx[] = {"1.1.1.0/24", "2.2.2.0/24", "3.3.3.0/24", "2f::/64"};
+    table_t *t = tbl_create(purge);
+    table_t *c;
+    entry_t *e1, *e2;
+    int *v, dups = 0;
+
+    for (int i = 0; i < NELEMS(pfx); i++) {
+        v = malloc(sizeof(int));
+        *v = i;
+        mu_assert(tbl_set(t, pfx[i], v, NULL));
+    }
+
+    // flagged for deletion, so not cloned
+    t->itr_lock = 1;
+    mu_assert(tbl_del(t, "2.2.2.0/24", NULL));
+    t->itr_lock = 0;
+
+    c = tbl_clone(t, dup, &dups);
+    mu_assert(c);
+    mu_eq(3, dups, "%d");
+    mu_eq(SIZE_T(2), c->count4, "%zu");
+    mu_eq(SIZE_T(1), c->count6, "%zu");
+    mu_eq(NULL, (void *)tbl_get(c, "2.2.2.0/24"), "%p");
+
+    // values were copied by the dup callback
+    e1 = tbl_get(t, "3.3.3.0/24");
+    e2 = tbl_get(c, "3.3.3.0/24");
+    mu_assert(e1 && e2);
+    mu_true(e1->value != e2->value);
+    mu_eq(INT_VALUE(e1), INT_VALUE(e2), "%d");
+
+    // both tables free their own values
+    tbl_destroy(&t, NULL);
+    e2 = tbl_get(c, "2f::/64");
+    mu_assert(e2);
+    mu_eq(3, INT_VALUE(e2), "%d");
+    tbl_destroy(&c, NULL);
+}
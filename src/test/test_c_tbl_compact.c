@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_compact.h"
+
+
+/*
+ * Test tbl_compact()
+ */
+
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+
+static int purged = 0;
+
+static void
+purge(void *pargs, void **value)
+{
+    (void)pargs;
+    if (*value) purged++;
+    *value = NULL;
+}
+
+static int
+nmasks(struct radix_node_head *rnh)
+{
+    int n = 0;
+
+    for (struct radix_node *rn = rdx_firstleaf(&rnh->rh.rnh_masks->head); rn;
+         rn = rdx_nextleaf(rn))
+        n++;
+    return n;
+}
+
+void
+test_compact_basic(void)
+{
+    table_t *t = tbl_create(purge);
+    int val[3] = {0, 1, 2};
+    size_t bytes = 42;
+    entry_t *e;
+
+    mu_false(tbl_compact(NULL, &bytes, NULL));
+    mu_eq(SIZE_T(42), bytes, "%zu");
+
+    // an empty table
+    mu_true(tbl_compact(t, &bytes, NULL));
+    mu_eq(SIZE_T(0), t->count4 + t->count6, "%zu");
+    mu_true(tbl_compact(t, NULL, NULL));
+
+    mu_true(tbl_set(t, "10.10.10.0/24", &val[0], NULL));
+    mu_true(tbl_set(t, "10.10.10.0/25", &val[1], NULL));
+    mu_true(tbl_set(t, "2001:db8::/32", &val[2], NULL));
+    mu_true(tbl_addpath(t, "10.10.10.0/24", &val[2], 5));
+
+    mu_true(tbl_compact(t, &bytes, NULL));
+    mu_eq(SIZE_T(2), t->count4, "%zu");
+    mu_eq(SIZE_T(1), t->count6, "%zu");
+    mu_eq(0, purged, "%d");
+
+    // values & paths are moved along
+    e = tbl_get(t, "10.10.10.0/24");
+    mu_assert(e);
+    mu_eq((void *)&val[0], e->value, "%p");
+    mu_assert(e->mpath);
+    mu_eq(SIZE_T(1), e->mpath->count, "%zu");
+    e = tbl_lpm(t, "10.10.10.10");
+    mu_assert(e);
+    mu_eq(1, INT_VALUE(e), "%d");
+    e = tbl_lpm(t, "10.10.10.200");
+    mu_assert(e);
+    mu_eq(0, INT_VALUE(e), "%d");
+    e = tbl_get(t, "2001:db8::/32");
+    mu_assert(e);
+    mu_eq(2, INT_VALUE(e), "%d");
+
+    // in a single block, in key order (more specific first)
+    mu_assert(t->slab);
+    mu_eq(NULL, (void *)t->slab->next, "%p");
+    mu_eq(SIZE_T(3), t->slab->size, "%zu");
+    e = t->slab->e;
+    mu_eq((void *)e, (void *)tbl_get(t, "10.10.10.0/25"), "%p");
+    mu_eq((void *)(e + 1), (void *)tbl_get(t, "10.10.10.0/24"), "%p");
+    mu_eq((void *)(e + 2), (void *)tbl_get(t, "2001:db8::/32"), "%p");
+
+    // the table still works as usual
+    mu_true(tbl_del(t, "10.10.10.0/25", NULL));
+    mu_eq(1, purged, "%d");
+    mu_true(tbl_set(t, "11.11.11.0/24", &val[1], NULL));
+    mu_eq(SIZE_T(2), t->count4, "%zu");
+    mu_assert(tbl_get(t, "11.11.11.0/24"));
+
+    tbl_destroy(&t, NULL);
+    mu_eq(5, purged, "%d");                // 4 values and 1 path
+    purged = 0;
+}
+
+void
+test_compact_iterating(void)
+{
+    // refused while iterating, flagged entries are purged otherwise
+    table_t *t = tbl_create(purge);
+    int val = 1;
+    size_t bytes = 42;
+
+    mu_true(tbl_set(t, "10.10.10.0/24", &val, NULL));
+    mu_true(tbl_set(t, "10.10.11.0/24", &val, NULL));
+
+    t->itr_lock++;
+    mu_true(tbl_del(t, "10.10.10.0/24", NULL));
+    mu_false(tbl_compact(t, &bytes, NULL));
+    mu_eq(SIZE_T(42), bytes, "%zu");
+    mu_eq(0, purged, "%d");
+    t->itr_lock--;
+
+    mu_true(tbl_compact(t, &bytes, NULL));
+    mu_eq(1, purged, "%d");
+    mu_eq(SIZE_T(1), t->count4, "%zu");
+    mu_eq(NULL, (void *)tbl_get(t, "10.10.10.0/24"), "%p");
+    mu_assert(tbl_get(t, "10.10.11.0/24"));
+
+    tbl_destroy(&t, NULL);
+    purged = 0;
+}
+
+void
+test_compact_churn(void)
+{
+    // stale masks & reserved entries are reclaimed, the index is rebuilt
+    char buf[MAX_STRKEY];
+    table_t *t = tbl_create(NULL);
+    int val[1000], bad = 0;
+    uint64_t gen;
+    size_t bytes = 0;
+    entry_t *e;
+
+    mu_true(tbl_reserve(t, 2000));
+    mu_true(tbl_hindex(t, 1));
+    mu_true(tbl_cache(t, 64));
+    for (int i = 0; i < 1000; i++) {
+        val[i] = i;
+        snprintf(buf, sizeof(buf), "10.%d.%d.0/%d", i / 256, i % 256,
+                 24 + i % 8);
+        tbl_set(t, buf, &val[i], NULL);
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/%d", i, 48 + i % 64);
+        tbl_set(t, buf, &val[i], NULL);
+    }
+    for (int i = 0; i < 1000; i++) {
+        if (i % 8 == 0) continue;
+        snprintf(buf, sizeof(buf), "10.%d.%d.0/%d", i / 256, i % 256,
+                 24 + i % 8);
+        if (! tbl_del(t, buf, NULL)) bad++;
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/%d", i, 48 + i % 64);
+        if (! tbl_del(t, buf, NULL)) bad++;
+    }
+    mu_eq(0, bad, "%d");
+    mu_eq(SIZE_T(125), t->count4, "%zu");
+    mu_eq(SIZE_T(125), t->count6, "%zu");
+    mu_true(nmasks(t->head4) > 3);
+    mu_true(nmasks(t->head6) > 8);
+    e = tbl_lpm(t, "10.0.0.1");  // fills the cache
+
+    gen = t->gen;
+    mu_true(tbl_compact(t, &bytes, NULL));
+    mu_true(t->gen != gen);
+    mu_true(bytes >= 1750 * sizeof(entry_t));
+    mu_eq(1, nmasks(t->head4), "%d");    // only /24 is left
+    mu_eq(8, nmasks(t->head6), "%d");
+    mu_eq(SIZE_T(0), t->nfree, "%zu");
+    mu_eq(SIZE_T(250), t->slab->size, "%zu");
+    mu_assert(t->index);
+    mu_eq(SIZE_T(250), t->index->count, "%zu");
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "10.%d.%d.0/%d", i / 256, i % 256,
+                 24 + i % 8);
+        e = tbl_get(t, buf);
+        if ((e != NULL) != (i % 8 == 0)) bad++;
+        if (e && INT_VALUE(e) != i) bad++;
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/%d", i, 48 + i % 64);
+        e = tbl_get(t, buf);
+        if ((e != NULL) != (i % 8 == 0)) bad++;
+        if (e && INT_VALUE(e) != i) bad++;
+    }
+    mu_eq(0, bad, "%d");
+    e = tbl_lpm(t, "10.0.0.1");
+    mu_assert(e);
+    mu_eq(0, INT_VALUE(e), "%d");
+
+    // compacting a compact table reclaims nothing
+    mu_true(tbl_compact(t, &bytes, NULL));
+    mu_eq(SIZE_T(0), bytes, "%zu");
+
+    tbl_destroy(&t, NULL);
+}
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+#include <pthread.h>         // pthread_create
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_destroystep.h"
+
+
+/*
+ * Test tbl_destroystep() and tbl_release()
+ */
+
+#define SIZE_T(x) ((size_t)(x))
+
+static int purged = 0;
+
+static void
+purge(void *pargs, void **value)
+{
+    (void)pargs;
+    if (*value) purged++;
+    *value = NULL;
+}
+
+static void
+pfx4(char *buf, int i)
+{
+    snprintf(buf, MAX_STRKEY, "10.%d.%d.0/24", i / 256, i % 256);
+}
+
+static table_t *
+mktable(int n)
+{
+    table_t *t = tbl_create(purge);
+    char buf[MAX_STRKEY];
+    static int val = 1;
+
+    for (int i = 0; i < n; i++) {
+        pfx4(buf, i);
+        tbl_set(t, buf, &val, NULL);
+    }
+    tbl_set(t, "2001:db8::/32", &val, NULL);
+    tbl_set(t, "2001:db8:1::/48", &val, NULL);
+
+    return t;
+}
+
+static void *
+destroyer(void *arg)
+{
+    table_t *t = arg;
+
+    tbl_destroy(&t, NULL);
+
+    return t;
+}
+
+void
+test_destroystep_slices(void)
+{
+    table_t *t = mktable(100);
+    int steps = 0;
+
+    mu_false(tbl_destroystep(NULL, NULL, 10));
+
+    purged = 0;
+    while (tbl_destroystep(&t, NULL, 10))
+        steps++;
+    mu_eq(NULL, (void *)t, "%p");
+    mu_eq(10, steps, "%d");                    // 102 prefixes, 11th call done
+    mu_eq(102, purged, "%d");
+    mu_false(tbl_destroystep(&t, NULL, 10));
+}
+
+void
+test_destroystep_nolimit(void)
+{
+    table_t *t = mktable(100);
+
+    purged = 0;
+    mu_false(tbl_destroystep(&t, NULL, 0));
+    mu_eq(NULL, (void *)t, "%p");
+    mu_eq(102, purged, "%d");
+
+    t = tbl_create(purge);                     // an empty table
+    mu_false(tbl_destroystep(&t, NULL, 1));
+    mu_eq(NULL, (void *)t, "%p");
+}
+
+void
+test_destroystep_flagged(void)
+{
+    table_t *t = mktable(10);
+    char buf[MAX_STRKEY];
+
+    // entries flagged for deletion are still freed
+    t->itr_lock++;
+    for (int i = 0; i < 10; i += 2) {
+        pfx4(buf, i);
+        mu_true(tbl_del(t, buf, NULL));
+    }
+    t->itr_lock--;
+
+    purged = 0;
+    while (tbl_destroystep(&t, NULL, 3))
+        ;
+    mu_eq(NULL, (void *)t, "%p");
+    mu_eq(12, purged, "%d");
+}
+
+void
+test_release(void)
+{
+    table_t *t = mktable(100);
+    entry_t *e;
+
+    mu_false(tbl_release(NULL, NULL));
+
+    purged = 0;
+    mu_true(tbl_release(t, NULL));
+    mu_eq(102, purged, "%d");
+    mu_true(t->purge == NULL);
+    mu_eq(SIZE_T(100), t->count4, "%zu");      // prefixes are kept
+    e = tbl_get(t, "10.0.1.0/24");
+    mu_assert(e);
+    mu_eq(NULL, e->value, "%p");
+
+    // nothing left to purge
+    mu_true(tbl_release(t, NULL));
+    mu_eq(102, purged, "%d");
+    tbl_destroy(&t, NULL);
+    mu_eq(102, purged, "%d");
+}
+
+void
+test_release_thread(void)
+{
+    table_t *t = mktable(1000);
+    pthread_t tid;
+    void *res = &tid;
+
+    purged = 0;
+    mu_true(tbl_release(t, NULL));
+    mu_eq(1002, purged, "%d");
+    mu_eq(0, pthread_create(&tid, NULL, destroyer, t), "%d");
+    mu_eq(0, pthread_join(tid, &res), "%d");
+    mu_eq(NULL, res, "%p");
+    mu_eq(1002, purged, "%d");
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_diff.h"
+
+
+
+/*
+ * Test tbl_diffinit(), tbl_diffnext() and tbl_diff()
+ */
+
+typedef struct dcount_t {
+    int n[4];                       // counts per TDIFF_x
+    int stop;                       // stop after this many differences
+} dcount_t;
+
+int count_cb(void *, int, entry_t *, entry_t *);
+int
+count_cb(void *arg, int op, entry_t *a, entry_t *b)
+{
+    dcount_t *c = arg;
+    int total = c->n[1] + c->n[2] + c->n[3];
+
+    mu_true((a != NULL) == (op != TDIFF_ADD));
+    mu_true((b != NULL) == (op != TDIFF_DEL));
+    c->n[op]++;
+
+    return c->stop == 0 || total + 1 < c->stop;
+}
+
+int int_eq(void *, void *, void *);
+int
+int_eq(void *arg, void *a, void *b)
+{
+    (void)arg;
+    return *(int *)a == *(int *)b;
+}
+
+void
+test_tbl_diff_args(void)
+{
+    table_t *a = tbl_create(NULL), *b = tbl_create(NULL);
+    diff_t d;
+    entry_t *ea, *eb;
+    dcount_t c = {0};
+
+    mu_false(tbl_diffinit(NULL, a, b, NULL, NULL));
+    mu_false(tbl_diffinit(&d, NULL, b, NULL, NULL));
+    mu_false(tbl_diffinit(&d, a, NULL, NULL, NULL));
+    mu_true(tbl_diffinit(&d, a, b, NULL, NULL));
+    mu_eq(TDIFF_NONE, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_eq(TDIFF_NONE, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_eq(TDIFF_NONE, tbl_diffnext(NULL, &ea, &eb), "%d");
+
+    mu_false(tbl_diff(a, b, NULL, NULL, &c));
+    mu_false(tbl_diff(NULL, b, NULL, count_cb, &c));
+    mu_true(tbl_diff(a, b, NULL, count_cb, &c));
+    mu_eq(0, c.n[TDIFF_ADD] + c.n[TDIFF_DEL] + c.n[TDIFF_CHG], "%d");
+
+    tbl_destroy(&a, NULL);
+    tbl_destroy(&b, NULL);
+}
+
+void
+test_tbl_diff_ops(void)
+{
+    table_t *a = tbl_create(NULL), *b = tbl_create(NULL);
+    int v[] = {1, 2, 3, 3};
+    diff_t d;
+    entry_t *ea, *eb;
+    char buf[MAX_STRKEY];
+
+    tbl_set(a, "10.0.0.0/8", &v[0], NULL);
+    tbl_set(a, "10.0.0.0/16", &v[0], NULL);
+    tbl_set(a, "11.0.0.0/8", &v[2], NULL);
+    tbl_set(a, "2001:db8::/32", &v[0], NULL);
+    tbl_set(b, "10.0.0.0/8", &v[0], NULL);
+    tbl_set(b, "10.0.0.0/24", &v[1], NULL);
+    tbl_set(b, "11.0.0.0/8", &v[3], NULL);
+    tbl_set(b, "2001:db8::/48", &v[1], NULL);
+
+    // value pointers differ for 11/8
+    mu_true(tbl_diffinit(&d, a, b, NULL, NULL));
+    mu_eq(TDIFF_ADD, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_eq(NULL, (void *)ea, "%p");
+    mu_false(strcmp("10.0.0.0", key_tostr(buf, eb->rn->rn_key)));
+    mu_eq(24, key_masklen(eb->rn->rn_mask), "%d");
+    mu_eq(TDIFF_DEL, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_eq(NULL, (void *)eb, "%p");
+    mu_eq(16, key_masklen(ea->rn->rn_mask), "%d");
+    mu_eq(TDIFF_CHG, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_false(strcmp("11.0.0.0", key_tostr(buf, ea->rn->rn_key)));
+    mu_eq(ea->value, (void *)&v[2], "%p");
+    mu_eq(eb->value, (void *)&v[3], "%p");
+    mu_eq(TDIFF_ADD, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_eq(48, key_masklen(eb->rn->rn_mask), "%d");
+    mu_eq(TDIFF_DEL, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_eq(32, key_masklen(ea->rn->rn_mask), "%d");
+    mu_eq(TDIFF_NONE, tbl_diffnext(&d, &ea, &eb), "%d");
+
+    // equal values for 11/8
+    mu_true(tbl_diffinit(&d, a, b, int_eq, NULL));
+    mu_eq(TDIFF_ADD, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_eq(TDIFF_DEL, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_eq(TDIFF_ADD, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_eq(TDIFF_DEL, tbl_diffnext(&d, &ea, &eb), "%d");
+    mu_eq(TDIFF_NONE, tbl_diffnext(&d, &ea, &eb), "%d");
+
+    tbl_destroy(&a, NULL);
+    tbl_destroy(&b, NULL);
+}
+
+void
+test_tbl_diff_random(void)
+{
+    // diff counts agree with exact lookups of each prefix in the other table
+    table_t *a = tbl_create(NULL), *b = tbl_create(NULL);
+    int v[] = {0, 1};
+    dcount_t c = {0};
+    entry_t *e;
+    int add = 0, del = 0, chg = 0;
+    uint32_t r = 99;
+    char pfx[MAX_STRKEY], buf[MAX_STRKEY];
+    struct radix_node *rn;
+
+    for (int i = 0; i < 5000; i++) {
+        r = r * 1103515245 + 12345;
+        if (i % 2)
+            snprintf(pfx, sizeof(pfx), "%u.%u.0.0/%u", (r >> 24) % 8,
+                     (r >> 16) & 0xff, 8 + (r >> 8) % 17);
+        else
+            snprintf(pfx, sizeof(pfx), "2001:%x::/%u", (r >> 16) & 0xff,
+                     16 + (r >> 8) % 17);
+        if (r % 3) tbl_set(a, pfx, &v[(r >> 4) & 1], NULL);
+        if (r % 5) tbl_set(b, pfx, &v[(r >> 5) & 1], NULL);
+    }
+
+    for (int i = 0; i < 2; i++) {
+        rn = rdx_firstleaf(i ? &a->head6->rh : &a->head4->rh);
+        for (; rn && !RDX_ISROOT(rn); rn = rdx_nextleaf(rn)) {
+            snprintf(pfx, sizeof(pfx), "%s/%d", key_tostr(buf, rn->rn_key),
+                     key_masklen(rn->rn_mask));
+            if ((e = tbl_get(b, pfx)) == NULL) del++;
+            else if (e->value != ((entry_t *)rn)->value) chg++;
+        }
+        rn = rdx_firstleaf(i ? &b->head6->rh : &b->head4->rh);
+        for (; rn && !RDX_ISROOT(rn); rn = rdx_nextleaf(rn)) {
+            snprintf(pfx, sizeof(pfx), "%s/%d", key_tostr(buf, rn->rn_key),
+                     key_masklen(rn->rn_mask));
+            if (tbl_get(a, pfx) == NULL) add++;
+        }
+    }
+
+    mu_true(tbl_diff(a, b, NULL, count_cb, &c));
+    mu_eq(add, c.n[TDIFF_ADD], "%d");
+    mu_eq(del, c.n[TDIFF_DEL], "%d");
+    mu_eq(chg, c.n[TDIFF_CHG], "%d");
+    mu_true(add > 0 && del > 0 && chg > 0);
+
+    // stop early
+    memset(&c, 0, sizeof(c));
+    c.stop = 10;
+    mu_false(tbl_diff(a, b, NULL, count_cb, &c));
+    mu_eq(10, c.n[TDIFF_ADD] + c.n[TDIFF_DEL] + c.n[TDIFF_CHG], "%d");
+
+    // reversed
+    memset(&c, 0, sizeof(c));
+    mu_true(tbl_diff(b, a, NULL, count_cb, &c));
+    mu_eq(del, c.n[TDIFF_ADD], "%d");
+    mu_eq(add, c.n[TDIFF_DEL], "%d");
+
+    tbl_destroy(&a, NULL);
+    tbl_destroy(&b, NULL);
+}
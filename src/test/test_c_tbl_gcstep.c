@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_gcstep.h"
+
+
+/*
+ * Test tbl_gcstep()
+ */
+
+#define SIZE_T(x) ((size_t)(x))
+
+static int purged = 0;
+
+static void
+purge(void *pargs, void **value)
+{
+    (void)pargs;
+    if (*value) purged++;
+    *value = NULL;
+}
+
+static void
+pfx4(char *buf, int i)
+{
+    snprintf(buf, MAX_STRKEY, "10.%d.%d.0/24", i / 256, i % 256);
+}
+
+void
+test_gcstep_basic(void)
+{
+    table_t *t = tbl_create(purge);
+    char buf[MAX_STRKEY];
+    int val = 1, steps = 0;
+
+    mu_false(tbl_gcstep(NULL, NULL, 10));
+    mu_false(tbl_gcstep(t, NULL, 10));          // nothing to do
+
+    for (int i = 0; i < 100; i++) {
+        pfx4(buf, i);
+        mu_true(tbl_set(t, buf, &val, NULL));
+    }
+    mu_true(tbl_set(t, "2001:db8::/32", &val, NULL));
+
+    t->itr_lock++;
+    for (int i = 0; i < 100; i += 2) {
+        pfx4(buf, i);
+        mu_true(tbl_del(t, buf, NULL));
+    }
+    mu_true(tbl_del(t, "2001:db8::/32", NULL));
+    mu_eq(SIZE_T(51), t->ndel, "%zu");
+
+    // revived entries are no longer pending
+    pfx4(buf, 0);
+    mu_true(tbl_set(t, buf, &val, NULL));
+    mu_eq(SIZE_T(50), t->ndel, "%zu");
+    mu_eq(1, purged, "%d");                     // its old value
+    purged = 0;
+
+    // busy while iterating
+    mu_true(tbl_gcstep(t, NULL, 10));
+    mu_eq(0, purged, "%d");
+    t->itr_lock--;
+
+    // 101 leaves + switching trees and finishing, at most 10 per step
+    while (tbl_gcstep(t, NULL, 10))
+        steps++;
+    mu_eq(10, steps, "%d");
+    mu_eq(50, purged, "%d");
+    mu_eq(SIZE_T(0), t->ndel, "%zu");
+    mu_eq(0, t->gcaf, "%d");
+    mu_eq(SIZE_T(51), t->count4, "%zu");
+    mu_eq(SIZE_T(0), t->count6, "%zu");
+    mu_assert(tbl_get(t, "10.0.0.0/24"));
+    mu_assert(tbl_get(t, "10.0.1.0/24"));
+    mu_eq(NULL, (void *)tbl_get(t, "10.0.2.0/24"), "%p");
+
+    // a step of 0 leaves has no limit
+    t->itr_lock++;
+    mu_true(tbl_del(t, "10.0.1.0/24", NULL));
+    t->itr_lock--;
+    mu_false(tbl_gcstep(t, NULL, 0));
+    mu_eq(51, purged, "%d");
+
+    tbl_destroy(&t, NULL);
+    purged = 0;
+}
+
+void
+test_gcstep_changes(void)
+{
+    // the table changes in between steps
+    table_t *t = tbl_create(purge);
+    char buf[MAX_STRKEY];
+    int val = 1;
+
+    mu_true(tbl_hindex(t, 1));
+    for (int i = 0; i < 100; i++) {
+        pfx4(buf, i);
+        mu_true(tbl_set(t, buf, &val, NULL));
+    }
+    t->itr_lock++;
+    for (int i = 0; i < 100; i += 2) {
+        pfx4(buf, i);
+        mu_true(tbl_del(t, buf, NULL));
+    }
+    t->itr_lock--;
+
+    mu_true(tbl_gcstep(t, NULL, 5));
+    mu_assert(t->gcnext);
+
+    // delete the leaf the sweep is about to visit, and the one after it
+    mu_true(tbl_del(t, "10.0.5.0/24", NULL));
+    mu_true(tbl_del(t, "10.0.7.0/24", NULL));
+    // add prefixes ahead of and behind the sweep
+    mu_true(tbl_set(t, "10.0.99.128/25", &val, NULL));
+    mu_true(tbl_set(t, "10.0.0.128/25", &val, NULL));
+
+    // flagged behind the sweep, so it takes another one
+    t->itr_lock++;
+    mu_true(tbl_del(t, "10.0.1.0/24", NULL));
+    t->itr_lock--;
+
+    while (tbl_gcstep(t, NULL, 5))
+        ;
+    mu_eq(SIZE_T(0), t->ndel, "%zu");
+    mu_eq(SIZE_T(49), t->count4, "%zu");
+    mu_eq(SIZE_T(49), t->index->count, "%zu");
+    for (int i = 0, bad = 0; i < 100; i++) {
+        pfx4(buf, i);
+        if ((tbl_get(t, buf) != NULL) != (i % 2 && i != 1 && i != 5 && i != 7))
+            bad++;
+        if (i == 99) mu_eq(0, bad, "%d");
+    }
+    mu_assert(tbl_get(t, "10.0.99.128/25"));
+    mu_assert(tbl_get(t, "10.0.0.128/25"));
+
+    // a full gc ends a sweep in progress
+    t->itr_lock++;
+    mu_true(tbl_del(t, "10.0.3.0/24", NULL));
+    mu_true(tbl_del(t, "10.0.9.0/24", NULL));
+    t->itr_lock--;
+    mu_true(tbl_gcstep(t, NULL, 3));
+    mu_true(tbl_gc(t, NULL));
+    mu_eq(0, t->gcaf, "%d");
+    mu_eq(NULL, (void *)t->gcnext, "%p");
+    mu_false(tbl_gcstep(t, NULL, 3));
+    mu_eq(SIZE_T(47), t->count4, "%zu");
+
+    tbl_destroy(&t, NULL);
+    purged = 0;
+}
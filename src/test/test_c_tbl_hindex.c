@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_hindex.h"
+
+
+/*
+ * Test tbl_hindex() and tbl_gc()
+ */
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+
+void
+test_hindex_basic(void)
+{
+    const char *pfx[] = {
+        "0.0.0.0/0", "10.10.10.0/24", "10.10.10.0/25", "10.10.10.10",
+        "255.255.255.255", "::/0", "2001:db8::/32", "2001:db8::/48",
+        "2001:db8::1",
+    };
+    int val[NELEMS(pfx)];
+    table_t *t = tbl_create(NULL);
+    entry_t *e;
+
+    mu_false(tbl_hindex(NULL, 1));
+
+    for (int i = 0; i < NELEMS(pfx); i++) {
+        val[i] = i;
+        mu_assert(tbl_set(t, pfx[i], &val[i], NULL));
+    }
+
+    // index is built from existing entries
+    mu_assert(tbl_hindex(t, 1));
+    mu_assert(t->index);
+    mu_eq(SIZE_T(NELEMS(pfx)), t->index->count, "%zu");
+    for (int i = 0; i < NELEMS(pfx); i++) {
+        e = tbl_get(t, pfx[i]);
+        mu_assert(e);
+        mu_eq(i, INT_VALUE(e), "%d");
+    }
+
+    // same key, different mask length or missing mask
+    mu_eq(NULL, (void *)tbl_get(t, "10.10.10.0/26"), "%p");
+    mu_eq(NULL, (void *)tbl_get(t, "10.10.10.10/31"), "%p");
+    e = tbl_get(t, "10.10.10.10/32");
+    mu_assert(e);
+    mu_eq(3, INT_VALUE(e), "%d");
+    e = tbl_get(t, "10.10.10.129/24");
+    mu_assert(e);
+    mu_eq(1, INT_VALUE(e), "%d");
+    mu_eq(NULL, (void *)tbl_get(t, "2001:db8::/64"), "%p");
+
+    // set & del maintain the index
+    mu_assert(tbl_set(t, "11.11.11.0/24", &val[0], NULL));
+    mu_eq(SIZE_T(NELEMS(pfx) + 1), t->index->count, "%zu");
+    mu_assert(tbl_get(t, "11.11.11.0/24"));
+    mu_assert(tbl_set(t, "11.11.11.0/24", &val[1], NULL));
+    mu_eq(SIZE_T(NELEMS(pfx) + 1), t->index->count, "%zu");
+    e = tbl_get(t, "11.11.11.0/24");
+    mu_assert(e);
+    mu_eq(1, INT_VALUE(e), "%d");
+
+    mu_assert(tbl_del(t, "2001:db8::/48", NULL));
+    mu_eq(NULL, (void *)tbl_get(t, "2001:db8::/48"), "%p");
+    mu_assert(tbl_get(t, "2001:db8::/32"));
+    mu_false(tbl_del(t, "2001:db8::/48", NULL));
+    mu_eq(SIZE_T(NELEMS(pfx)), t->index->count, "%zu");
+
+    // disable
+    mu_assert(tbl_hindex(t, 0));
+    mu_eq(NULL, (void *)t->index, "%p");
+    mu_assert(tbl_get(t, "2001:db8::/32"));
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_hindex_tombstones(void)
+{
+    int val[] = {0, 1, 2, 3};
+    table_t *t = tbl_create(NULL);
+    table_t *c;
+    entry_t *e;
+
+    mu_assert(tbl_hindex(t, 1));
+    mu_assert(tbl_set(t, "10.10.10.0/24", &val[0], NULL));
+    mu_assert(tbl_set(t, "2001:db8::/32", &val[1], NULL));
+    mu_assert(tbl_set(t, "2001:db8::/48", &val[2], NULL));
+
+    // flagged entries remain indexed, but are not found
+    t->itr_lock = 1;
+    mu_assert(tbl_del(t, "10.10.10.0/24", NULL));
+    mu_assert(tbl_del(t, "2001:db8::/48", NULL));
+    mu_false(tbl_del(t, "2001:db8::/48", NULL));
+    mu_eq(SIZE_T(3), t->index->count, "%zu");
+    mu_eq(NULL, (void *)tbl_get(t, "10.10.10.0/24"), "%p");
+    mu_eq(NULL, (void *)tbl_get(t, "2001:db8::/48"), "%p");
+
+    // no gc while locked
+    mu_false(tbl_gc(t, NULL));
+
+    // a flagged entry can be resurrected
+    mu_assert(tbl_set(t, "10.10.10.0/24", &val[3], NULL));
+    e = tbl_get(t, "10.10.10.0/24");
+    mu_assert(e);
+    mu_eq(3, INT_VALUE(e), "%d");
+    mu_eq(SIZE_T(1), t->count4, "%zu");
+
+    // clone skips flagged entries and builds its own index
+    c = tbl_clone(t, NULL, NULL);
+    mu_assert(c);
+    mu_assert(c->index);
+    mu_eq(SIZE_T(2), c->index->count, "%zu");
+    tbl_destroy(&c, NULL);
+
+    // gc removes flagged entries, ipv6 included, from trees and index
+    t->itr_lock = 0;
+    mu_assert(tbl_gc(t, NULL));
+    mu_eq(SIZE_T(2), t->index->count, "%zu");
+    mu_eq(NULL, (void *)rdx_nextleaf(rdx_firstleaf(&t->head6->rh)), "%p");
+    mu_eq(NULL, (void *)tbl_get(t, "2001:db8::/48"), "%p");
+    mu_assert(tbl_get(t, "2001:db8::/32"));
+    mu_assert(tbl_get(t, "10.10.10.0/24"));
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_hindex_many(void)
+{
+    // grow the index & exercise backward shift deletion
+    char buf[MAX_STRKEY];
+    table_t *t = tbl_create(NULL);
+    int val = 0, bad = 0;
+
+    mu_assert(tbl_hindex(t, 1));
+    for (int i = 0; i < 20000; i++) {
+        snprintf(buf, sizeof(buf), "10.%d.%d.0/%d", i / 256, i % 256,
+                 24 - i % 3);
+        tbl_set(t, buf, &val, NULL);
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/%d", i, 48 + i % 5);
+        tbl_set(t, buf, &val, NULL);
+    }
+    mu_eq(t->count4 + t->count6, t->index->count, "%zu");
+    mu_true(4 * t->index->count <= 3 * t->index->size);
+
+    for (int i = 0; i < 20000; i += 2) {
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/%d", i, 48 + i % 5);
+        if (! tbl_del(t, buf, NULL)) bad++;
+    }
+    mu_eq(0, bad, "%d");
+    mu_eq(t->count4 + t->count6, t->index->count, "%zu");
+
+    for (int i = 0; i < 20000; i++) {
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/%d", i, 48 + i % 5);
+        if ((tbl_get(t, buf) == NULL) != (i % 2 == 0)) bad++;
+    }
+    mu_eq(0, bad, "%d");
+
+    tbl_destroy(&t, NULL);
+}
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_journal.h"
+
+
+
+/*
+ * Test tbl_journal(), tbl_subscribe() and tbl_jnext()
+ */
+
+#define SIZE_T(x) ((size_t)(x))
+
+typedef struct seen_t {
+    int count;
+    uint64_t seq;
+    int op;
+} seen_t;
+
+void seen_cb(void *, jrec_t *);
+void
+seen_cb(void *arg, jrec_t *rec)
+{
+    seen_t *s = arg;
+
+    s->count++;
+    s->seq = rec->seq;
+    s->op = rec->op;
+}
+
+void
+test_tbl_journal(void)
+{
+    table_t *t = tbl_create(NULL);
+    uint64_t seq = 0;
+    jrec_t *rec = NULL;
+    char buf[MAX_STRKEY];
+
+    mu_false(tbl_journal(NULL, 8));
+    mu_eq(-1, tbl_jnext(t, &seq, &rec), "%d");  // no journal
+    tbl_set(t, "10.10.10.0/24", NULL, NULL);
+
+    mu_true(tbl_journal(t, 5));
+    mu_assert(t->journal);
+    mu_eq(SIZE_T(8), t->journal->size, "%zu");
+    mu_eq(0, tbl_jnext(t, &seq, &rec), "%d");
+
+    mu_true(tbl_set(t, "10.10.10.10/24", NULL, NULL));
+    mu_true(tbl_set(t, "2001:db8::/32", NULL, NULL));
+    mu_true(tbl_del(t, "10.10.10.0/24", NULL));
+    mu_false(tbl_del(t, "10.10.10.0/24", NULL));
+    mu_false(tbl_set(t, "10.10.10.0/33", NULL, NULL));
+
+    mu_eq(1, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(1, (int)seq, "%d");
+    mu_eq(1, (int)rec->seq, "%d");
+    mu_eq(JRNL_SET, rec->op, "%d");
+    mu_eq(24, rec->mlen, "%d");
+    mu_false(strcmp("10.10.10.0", key_tostr(buf, rec->key)));
+    mu_eq(1, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(32, rec->mlen, "%d");
+    mu_false(strcmp("2001:db8::", key_tostr(buf, rec->key)));
+    mu_eq(1, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(JRNL_DEL, rec->op, "%d");
+    mu_eq(3, (int)seq, "%d");
+    mu_eq(0, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(3, (int)seq, "%d");
+
+    mu_true(tbl_journal(t, 0));
+    mu_eq(NULL, (void *)t->journal, "%p");
+    mu_true(tbl_set(t, "10.10.10.0/24", NULL, NULL));
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tbl_journal_lost(void)
+{
+    table_t *t = tbl_create(NULL);
+    uint64_t seq = 0;
+    jrec_t *rec = NULL;
+    char pfx[MAX_STRKEY];
+
+    tbl_journal(t, 4);
+    for (int i = 1; i <= 10; i++) {
+        snprintf(pfx, sizeof(pfx), "10.%d.0.0/16", i);
+        tbl_set(t, pfx, NULL, NULL);
+    }
+
+    mu_eq(-1, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(6, (int)seq, "%d");
+    for (int i = 7; i <= 10; i++) {
+        mu_eq(1, tbl_jnext(t, &seq, &rec), "%d");
+        mu_eq(i, (int)rec->seq, "%d");
+    }
+    mu_eq(0, tbl_jnext(t, &seq, &rec), "%d");
+
+    // a new journal keeps the sequence number, not the records
+    mu_true(tbl_journal(t, 16));
+    seq = 9;
+    mu_eq(-1, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(10, (int)seq, "%d");
+    tbl_set(t, "11.0.0.0/8", NULL, NULL);
+    mu_eq(1, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(11, (int)rec->seq, "%d");
+
+    // a cursor ahead of the journal
+    seq = 100;
+    mu_eq(-1, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(10, (int)seq, "%d");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tbl_subscribe(void)
+{
+    table_t *t = tbl_create(NULL);
+    seen_t s = {0};
+
+    mu_false(tbl_subscribe(t, seen_cb, &s));    // needs a journal
+    tbl_journal(t, 2);
+    mu_true(tbl_subscribe(t, seen_cb, &s));
+
+    tbl_set(t, "10.10.10.0/24", NULL, NULL);
+    mu_eq(1, s.count, "%d");
+    mu_eq(JRNL_SET, s.op, "%d");
+    tbl_set(t, "10.10.10.0/24", NULL, NULL);
+    mu_eq(2, s.count, "%d");
+
+    // deferred deletions are recorded once, when flagged
+    t->itr_lock++;
+    mu_true(tbl_del(t, "10.10.10.0/24", NULL));
+    mu_false(tbl_del(t, "10.10.10.0/24", NULL));
+    mu_eq(3, s.count, "%d");
+    mu_eq(JRNL_DEL, s.op, "%d");
+    t->itr_lock--;
+    tbl_gc(t, NULL);
+    mu_eq(3, s.count, "%d");
+
+    // resizing keeps the subscriber
+    tbl_journal(t, 64);
+    tbl_set(t, "10.10.10.0/25", NULL, NULL);
+    mu_eq(4, s.count, "%d");
+    mu_eq(4, (int)s.seq, "%d");
+
+    mu_true(tbl_subscribe(t, NULL, NULL));
+    tbl_set(t, "10.10.10.0/26", NULL, NULL);
+    mu_eq(4, s.count, "%d");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tbl_journal_paths(void)
+{
+    table_t *t = tbl_create(NULL);
+    uint64_t seq = 0;
+    jrec_t *rec = NULL;
+    char buf[MAX_STRKEY];
+    int v = 42;
+
+    tbl_set(t, "10.10.10.0/24", NULL, NULL);
+    tbl_set(t, "2001:db8::1", NULL, NULL);
+    tbl_journal(t, 8);
+
+    // path changes are recorded as a set of their prefix
+    mu_true(tbl_addpath(t, "10.10.10.0/24", &v, 1));
+    mu_true(tbl_addpath(t, "2001:db8::1", &v, 2));
+    mu_true(tbl_delpath(t, "10.10.10.0/24", 0, NULL));
+
+    // failures are not
+    mu_false(tbl_addpath(t, "11.0.0.0/8", &v, 1));
+    mu_false(tbl_delpath(t, "10.10.10.0/24", 0, NULL));
+
+    mu_eq(1, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(JRNL_SET, rec->op, "%d");
+    mu_eq(24, rec->mlen, "%d");
+    mu_false(strcmp("10.10.10.0", key_tostr(buf, rec->key)));
+    mu_eq(1, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(JRNL_SET, rec->op, "%d");
+    mu_eq(128, rec->mlen, "%d");
+    mu_false(strcmp("2001:db8::1", key_tostr(buf, rec->key)));
+    mu_eq(1, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(24, rec->mlen, "%d");
+    mu_eq(0, tbl_jnext(t, &seq, &rec), "%d");
+    mu_eq(3, (int)seq, "%d");
+
+    tbl_destroy(&t, NULL);
+}
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_latency.h"
+
+
+/*
+ * Test tbl_latency(), tbl_latq(), tbl_latstart() and tbl_latstop()
+ */
+
+#define U64(x) ((uint64_t)(x))
+
+static void
+pfx4(char *buf, int i)
+{
+    snprintf(buf, MAX_STRKEY, "10.%d.%d.0/24", i / 256, i % 256);
+}
+
+void
+test_latency_toggle(void)
+{
+    table_t *t = tbl_create(NULL);
+
+    mu_false(tbl_latency(NULL, 1));
+    mu_eq(NULL, (void *)t->lat, "%p");
+
+    mu_true(tbl_latency(t, 1));
+    mu_assert(t->lat);
+    mu_eq(U64(0), t->lat->mask, "%lu");
+    mu_true(tbl_latency(t, 100));              // rounded up to 128
+    mu_eq(U64(127), t->lat->mask, "%lu");
+    mu_true(tbl_latency(t, 0));
+    mu_eq(NULL, (void *)t->lat, "%p");
+    mu_true(tbl_latency(t, 0));                // already disabled
+
+    mu_true(tbl_latency(t, 4));
+    tbl_destroy(&t, NULL);                     // frees the histograms
+}
+
+void
+test_latency_counts(void)
+{
+    table_t *t = tbl_create(NULL);
+    char buf[MAX_STRKEY];
+    int val = 1;
+
+    // nothing is counted while disabled
+    mu_true(tbl_set(t, "10.0.0.0/8", &val, NULL));
+    mu_true(tbl_latency(t, 1));
+    mu_eq(U64(0), t->lat->ops[LAT_SET], "%lu");
+
+    for (int i = 0; i < 100; i++) {
+        pfx4(buf, i);
+        mu_true(tbl_set(t, buf, &val, NULL));
+    }
+    for (int i = 0; i < 50; i++) {
+        pfx4(buf, i);
+        mu_assert(tbl_get(t, buf));
+        mu_assert(tbl_lpm(t, "10.0.1.1"));
+    }
+    pfx4(buf, 0);
+    mu_true(tbl_del(t, buf, NULL));
+    mu_false(tbl_del(t, buf, NULL));           // failures count as well
+
+    mu_eq(U64(100), t->lat->ops[LAT_SET], "%lu");
+    mu_eq(U64(100), t->lat->samples[LAT_SET], "%lu");
+    mu_eq(U64(50), t->lat->ops[LAT_GET], "%lu");
+    mu_eq(U64(50), t->lat->ops[LAT_LPM], "%lu");
+    mu_eq(U64(2), t->lat->ops[LAT_DEL], "%lu");
+    mu_eq(U64(0), t->lat->ops[LAT_ITR], "%lu");
+
+    uint64_t sum = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++)
+        sum += t->lat->hist[LAT_SET][i];
+    mu_eq(U64(100), sum, "%lu");
+    mu_true(t->lat->max[LAT_SET] > 0);
+    mu_true(t->lat->sum[LAT_SET] >= t->lat->max[LAT_SET]);
+
+    // sampling, 1 in 8
+    mu_true(tbl_latency(t, 0));
+    mu_true(tbl_latency(t, 8));
+    for (int i = 0; i < 80; i++)
+        tbl_lpm(t, "10.0.1.1");
+    mu_eq(U64(80), t->lat->ops[LAT_LPM], "%lu");
+    mu_eq(U64(10), t->lat->samples[LAT_LPM], "%lu");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_latency_quantiles(void)
+{
+    table_t *t = tbl_create(NULL);
+    latency_t *lat;
+
+    mu_eq(U64(0), tbl_latq(t, LAT_GET, 0.5), "%lu");   // disabled
+    mu_true(tbl_latency(t, 1));
+    lat = t->lat;
+    mu_eq(U64(0), tbl_latq(t, LAT_GET, 0.5), "%lu");   // no samples
+
+    // 900 samples of 2ns, 90 of 100ns (bucket 96..111), 10 of 5000ns
+    lat->hist[LAT_GET][2] = 900;
+    lat->hist[LAT_GET][4 * (7 - 2) + 2] = 90;
+    lat->hist[LAT_GET][4 * (13 - 2) + 0] = 10;
+    lat->samples[LAT_GET] = 1000;
+    lat->max[LAT_GET] = 5000;
+
+    mu_eq(U64(2), tbl_latq(t, LAT_GET, 0.5), "%lu");
+    mu_eq(U64(2), tbl_latq(t, LAT_GET, 0.9), "%lu");
+    mu_eq(U64(111), tbl_latq(t, LAT_GET, 0.99), "%lu");
+    mu_eq(U64(5000), tbl_latq(t, LAT_GET, 0.999), "%lu");  // capped by max
+    mu_eq(U64(5000), tbl_latq(t, LAT_GET, 1.0), "%lu");
+
+    mu_eq(U64(0), tbl_latq(t, LAT_GET, 0.0), "%lu");
+    mu_eq(U64(0), tbl_latq(t, LAT_GET, 1.5), "%lu");
+    mu_eq(U64(0), tbl_latq(t, LAT_NOPS, 0.5), "%lu");
+    mu_eq(U64(0), tbl_latq(t, -1, 0.5), "%lu");
+    mu_eq(U64(0), tbl_latq(NULL, LAT_GET, 0.5), "%lu");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_latency_host(void)
+{
+    table_t *t = tbl_create(NULL);
+    uint64_t t0;
+
+    mu_eq(U64(0), tbl_latstart(t, LAT_ITR), "%lu");    // disabled
+    mu_true(tbl_latency(t, 2));
+
+    for (int i = 0; i < 10; i++) {
+        t0 = tbl_latstart(t, LAT_ITR);
+        mu_true(i % 2 ? t0 == 0 : t0 > 0);
+        tbl_latstop(t, LAT_ITR, t0);
+    }
+    mu_eq(U64(10), t->lat->ops[LAT_ITR], "%lu");
+    mu_eq(U64(5), t->lat->samples[LAT_ITR], "%lu");
+
+    mu_eq(U64(0), tbl_latstart(t, LAT_NOPS), "%lu");
+    mu_eq(U64(0), tbl_latstart(NULL, LAT_ITR), "%lu");
+    tbl_latstop(NULL, LAT_ITR, 1);
+    tbl_latstop(t, -1, 1);
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_latency_internal(void)
+{
+    // lookups done on behalf of other operations are not timed
+    table_t *t = tbl_create(NULL);
+    uint8_t addr[MAX_BINKEY];
+    int val = 1, mlen, af;
+
+    mu_assert(tbl_set(t, "10.10.10.0/24", &val, NULL));
+    mu_true(tbl_latency(t, 1));
+
+    mu_assert(tbl_addpath(t, "10.10.10.0/24", &val, 1));
+    mu_assert(tbl_delpath(t, "10.10.10.0/24", 0, NULL));
+    mu_false(tbl_addpath(t, "11.0.0.0/8", &val, 1));
+    mu_eq((void *)&val, tbl_select(t, "10.10.10.10", 0), "%p");
+    mu_assert(key_bystr(addr, &mlen, &af, "10.10.0.0"));
+    mu_true(tbl_covered(t, addr, 16, 24) == 1.0);
+    mu_true(tbl_overlaps(t, addr, 16));
+    mu_assert(tbl_rawget(t, "10.10.10.0/24"));
+    mu_assert(tbl_rawlpm(t, addr) == NULL);
+
+    for (int op = 0; op < LAT_NOPS; op++)
+        mu_eq(U64(0), t->lat->ops[op], "%lu");
+
+    mu_assert(tbl_get(t, "10.10.10.0/24"));
+    mu_eq(U64(1), t->lat->ops[LAT_GET], "%lu");
+
+    tbl_destroy(&t, NULL);
+}
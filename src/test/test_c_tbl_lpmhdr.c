@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_lpmhdr.h"
+
+
+/*
+ * Test key_bysockaddr(), key_byhdr(), tbl_lpmsa(), tbl_lpmhdr() and
+ * tbl_lpmhdrs()
+ */
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+
+// minimal headers, only version and addresses are filled in
+static void
+hdr4(uint8_t *hdr, const char *src, const char *dst)
+{
+    memset(hdr, 0, 20);
+    hdr[0] = 0x45;
+    inet_pton(AF_INET, src, hdr + 12);
+    inet_pton(AF_INET, dst, hdr + 16);
+}
+
+static void
+hdr6(uint8_t *hdr, const char *src, const char *dst)
+{
+    memset(hdr, 0, 40);
+    hdr[0] = 0x60;
+    inet_pton(AF_INET6, src, hdr + 8);
+    inet_pton(AF_INET6, dst, hdr + 24);
+}
+
+void
+test_key_bysockaddr(void)
+{
+    struct sockaddr_in sin;
+    struct sockaddr_in6 sin6;
+    uint8_t key[MAX_BINKEY];
+    char buf[MAX_STRKEY];
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    inet_pton(AF_INET, "10.10.10.10", &sin.sin_addr);
+    mu_assert(key_bysockaddr(key, (struct sockaddr *)&sin));
+    mu_eq(IP4_KEYLEN, IPT_KEYLEN(key), "%d");
+    mu_assert(key_tostr(buf, key));
+    mu_eq(0, strcmp("10.10.10.10", buf), "%d");
+
+    memset(&sin6, 0, sizeof(sin6));
+    sin6.sin6_family = AF_INET6;
+    inet_pton(AF_INET6, "2001:db8::1", &sin6.sin6_addr);
+    mu_assert(key_bysockaddr(key, (struct sockaddr *)&sin6));
+    mu_eq(IP6_KEYLEN, IPT_KEYLEN(key), "%d");
+    mu_assert(key_tostr(buf, key));
+    mu_eq(0, strcmp("2001:db8::1", buf), "%d");
+
+    sin.sin_family = AF_UNIX;
+    mu_false(key_bysockaddr(key, (struct sockaddr *)&sin));
+    mu_false(key_bysockaddr(key, NULL));
+    mu_false(key_bysockaddr(NULL, (struct sockaddr *)&sin6));
+}
+
+void
+test_key_byhdr(void)
+{
+    uint8_t hdr[40], key[MAX_BINKEY];
+    char buf[MAX_STRKEY];
+
+    hdr4(hdr, "1.2.3.4", "5.6.7.8");
+    mu_assert(key_byhdr(key, hdr, 20, HDR_SRC));
+    mu_assert(key_tostr(buf, key));
+    mu_eq(0, strcmp("1.2.3.4", buf), "%d");
+    mu_assert(key_byhdr(key, hdr, 20, HDR_DST));
+    mu_assert(key_tostr(buf, key));
+    mu_eq(0, strcmp("5.6.7.8", buf), "%d");
+    mu_false(key_byhdr(key, hdr, 19, HDR_SRC));  // truncated
+    mu_false(key_byhdr(key, hdr, 20, 2));        // neither src nor dst
+
+    hdr6(hdr, "2001:db8::1", "2001:db8::2");
+    mu_assert(key_byhdr(key, hdr, 40, HDR_SRC));
+    mu_assert(key_tostr(buf, key));
+    mu_eq(0, strcmp("2001:db8::1", buf), "%d");
+    mu_assert(key_byhdr(key, hdr, 40, HDR_DST));
+    mu_assert(key_tostr(buf, key));
+    mu_eq(0, strcmp("2001:db8::2", buf), "%d");
+    mu_false(key_byhdr(key, hdr, 39, HDR_DST));
+
+    hdr[0] = 0x50;                               // unknown version
+    mu_false(key_byhdr(key, hdr, 40, HDR_SRC));
+    mu_false(key_byhdr(key, hdr, 0, HDR_SRC));
+    mu_false(key_byhdr(key, NULL, 40, HDR_SRC));
+    mu_false(key_byhdr(NULL, hdr, 40, HDR_SRC));
+}
+
+void
+test_tbl_lpmsa(void)
+{
+    table_t *t = tbl_create(NULL);
+    struct sockaddr_in sin;
+    struct sockaddr_in6 sin6;
+    int val[] = {0, 1};
+    entry_t *e;
+
+    mu_assert(tbl_set(t, "10.10.10.0/24", &val[0], NULL));
+    mu_assert(tbl_set(t, "2001:db8::/32", &val[1], NULL));
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    inet_pton(AF_INET, "10.10.10.10", &sin.sin_addr);
+    e = tbl_lpmsa(t, (struct sockaddr *)&sin);
+    mu_assert(e);
+    mu_eq(0, INT_VALUE(e), "%d");
+    inet_pton(AF_INET, "10.10.11.10", &sin.sin_addr);
+    mu_eq(NULL, (void *)tbl_lpmsa(t, (struct sockaddr *)&sin), "%p");
+
+    memset(&sin6, 0, sizeof(sin6));
+    sin6.sin6_family = AF_INET6;
+    inet_pton(AF_INET6, "2001:db8:1::1", &sin6.sin6_addr);
+    e = tbl_lpmsa(t, (struct sockaddr *)&sin6);
+    mu_assert(e);
+    mu_eq(1, INT_VALUE(e), "%d");
+
+    mu_eq(NULL, (void *)tbl_lpmsa(NULL, (struct sockaddr *)&sin6), "%p");
+    mu_eq(NULL, (void *)tbl_lpmsa(t, NULL), "%p");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tbl_lpmhdr(void)
+{
+    table_t *t = tbl_create(NULL);
+    uint8_t hdr[40];
+    int val[] = {0, 1, 2};
+    entry_t *e;
+
+    mu_assert(tbl_set(t, "10.10.10.0/24", &val[0], NULL));
+    mu_assert(tbl_set(t, "11.0.0.0/8", &val[1], NULL));
+    mu_assert(tbl_set(t, "2001:db8::/32", &val[2], NULL));
+
+    hdr4(hdr, "10.10.10.10", "11.1.1.1");
+    e = tbl_lpmhdr(t, hdr, sizeof(hdr), HDR_SRC);
+    mu_assert(e);
+    mu_eq(0, INT_VALUE(e), "%d");
+    e = tbl_lpmhdr(t, hdr, sizeof(hdr), HDR_DST);
+    mu_assert(e);
+    mu_eq(1, INT_VALUE(e), "%d");
+
+    hdr6(hdr, "2001:db8::1", "2001:db9::1");
+    e = tbl_lpmhdr(t, hdr, sizeof(hdr), HDR_SRC);
+    mu_assert(e);
+    mu_eq(2, INT_VALUE(e), "%d");
+    mu_eq(NULL, (void *)tbl_lpmhdr(t, hdr, sizeof(hdr), HDR_DST), "%p");
+    mu_eq(NULL, (void *)tbl_lpmhdr(t, hdr, 20, HDR_SRC), "%p");
+    mu_eq(NULL, (void *)tbl_lpmhdr(NULL, hdr, 40, HDR_SRC), "%p");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tbl_lpmhdrs(void)
+{
+    // ethernet frames: 14 bytes of link layer header, then IP
+    table_t *t = tbl_create(NULL);
+    uint8_t frames[5][14 + 40];
+    const uint8_t *pkts[6];
+    size_t lens[6] = {14 + 20, 14 + 40, 14 + 20, 14 + 19, 14, 0};
+    entry_t *res[6];
+    int val[] = {0, 1};
+
+    mu_assert(tbl_set(t, "10.0.0.0/8", &val[0], NULL));
+    mu_assert(tbl_set(t, "2001:db8::/32", &val[1], NULL));
+
+    hdr4(frames[0] + 14, "1.1.1.1", "10.1.1.1");
+    hdr6(frames[1] + 14, "2001:db8::1", "2001:db8::2");
+    hdr4(frames[2] + 14, "10.1.1.1", "1.1.1.1");
+    hdr4(frames[3] + 14, "10.1.1.1", "10.1.1.1");
+    hdr4(frames[4] + 14, "10.1.1.1", "10.1.1.1");
+    for (int i = 0; i < 5; i++)
+        pkts[i] = frames[i];
+    pkts[5] = NULL;
+
+    mu_eq(SIZE_T(2), tbl_lpmhdrs(t, pkts, lens, 6, 14, HDR_DST, res), "%zu");
+    mu_assert(res[0]);
+    mu_eq(0, INT_VALUE(res[0]), "%d");
+    mu_assert(res[1]);
+    mu_eq(1, INT_VALUE(res[1]), "%d");
+    mu_eq(NULL, (void *)res[2], "%p");
+    mu_eq(NULL, (void *)res[3], "%p");  // truncated header
+    mu_eq(NULL, (void *)res[4], "%p");  // no header at all
+    mu_eq(NULL, (void *)res[5], "%p");  // no packet
+
+    mu_eq(SIZE_T(2), tbl_lpmhdrs(t, pkts, lens, 6, 14, HDR_SRC, res), "%zu");
+    mu_eq(NULL, (void *)res[0], "%p");
+    mu_assert(res[1]);
+    mu_assert(res[2]);
+    mu_eq(0, INT_VALUE(res[2]), "%d");
+
+    // without lengths, complete headers are assumed
+    mu_eq(SIZE_T(3), tbl_lpmhdrs(t, pkts, NULL, 4, 14, HDR_SRC, res), "%zu");
+    mu_assert(res[3]);
+
+    mu_eq(SIZE_T(0), tbl_lpmhdrs(t, pkts, lens, 0, 14, HDR_SRC, res), "%zu");
+    mu_eq(SIZE_T(0), tbl_lpmhdrs(NULL, pkts, lens, 6, 14, HDR_SRC, res), "%zu");
+    mu_eq(SIZE_T(0), tbl_lpmhdrs(t, NULL, lens, 6, 14, HDR_SRC, res), "%zu");
+    mu_eq(SIZE_T(0), tbl_lpmhdrs(t, pkts, lens, 6, 14, HDR_SRC, NULL), "%zu");
+
+    tbl_destroy(&t, NULL);
+}
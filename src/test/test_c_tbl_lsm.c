@@ -105,3 +105,36 @@ test_tbl_lsm_zeromask(void)
     tbl_destroy(&ipt, NULL);
 }
 
+
+void
+test_tbl_lsm_parent(void)
+{
+    /* the /16 is annotated on the /24's immediate parent, which must be
+     * searched before moving further up the tree */
+    table_t *ipt = tbl_create(NULL);
+    entry_t *e = NULL;
+    testpfx_t pfx[] = {
+        {"10.0.0.0/8",     8},
+        {"10.10.0.0/16",  16},
+        {"10.10.10.0/24", 24},
+    };
+
+    for (int i=0; i < NELEMS(pfx); i++)
+        mu_assert(tbl_set(ipt, pfx[i].pfx, &pfx[i].dta, NULL));
+
+    e = tbl_get(ipt, pfx[2].pfx);
+    mu_assert(e);
+    e = (entry_t *)tbl_lsm(e->rn);
+    mu_assert(e);
+    mu_eq(16, INT_VALUE(e), "%d");
+
+    /* lpm skips the /24 flagged for deletion and finds the /16 */
+    ipt->itr_lock = 1;
+    mu_assert(tbl_del(ipt, pfx[2].pfx, NULL));
+    e = tbl_lpm(ipt, "10.10.10.10");
+    mu_assert(e);
+    mu_eq(16, INT_VALUE(e), "%d");
+    ipt->itr_lock = 0;
+
+    tbl_destroy(&ipt, NULL);
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_match4.h"
+
+
+/*
+ * Test tbl_match4() and rn_match4()
+ */
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+#define INT_VALUE(x) (*(int *)x->value)
+
+// xorshift, so runs are repeatable
+static uint32_t rnd_state = 2463534242u;
+uint32_t rnd(void);
+uint32_t
+rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+void key4(uint8_t *key, uint32_t a);
+void
+key4(uint8_t *key, uint32_t a)
+{
+    IPT_KEYLEN(key) = IP4_KEYLEN;
+    for (int i = 4; i > 0; i--, a >>= 8)
+        key[i] = a & 0xff;
+}
+
+void
+test_match4_select(void)
+{
+    table_t *t = tbl_create(NULL);
+    table_t *c;
+
+    mu_false(tbl_match4(NULL, 1));
+
+    // on by default, ipv6 is not affected
+    mu_true(t->head4->rnh_matchaddr == rn_match4);
+    mu_true(t->head6->rnh_matchaddr == rn_match);
+
+    mu_assert(tbl_match4(t, 0));
+    mu_true(t->head4->rnh_matchaddr == rn_match);
+
+    // clone keeps the choice
+    c = tbl_clone(t, NULL, NULL);
+    mu_true(c->head4->rnh_matchaddr == rn_match);
+    tbl_destroy(&c, NULL);
+
+    mu_assert(tbl_match4(t, 1));
+    mu_true(t->head4->rnh_matchaddr == rn_match4);
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_match4_edges(void)
+{
+    const char *pfx[] = {
+        "0.0.0.0/0", "0.0.0.0/8", "0.0.0.0", "10.0.0.0/8", "10.10.0.0/16",
+        "10.10.10.0/24", "10.10.10.10", "10.10.10.11/32", "128.0.0.0/1",
+        "255.255.255.0/24", "255.255.255.255",
+    };
+    const char *addr[] = {
+        "0.0.0.0", "0.0.0.1", "0.1.0.0", "1.1.1.1", "10.0.0.0", "10.10.1.1",
+        "10.10.10.9", "10.10.10.10", "10.10.10.11", "10.10.10.12",
+        "127.255.255.255", "128.0.0.0", "255.255.255.254", "255.255.255.255",
+    };
+    int val[NELEMS(pfx)];
+    table_t *t = tbl_create(NULL);
+    uint8_t key[MAX_BINKEY];
+    int mlen, af;
+    struct radix_node *rn1, *rn2;
+
+    for (int i = 0; i < NELEMS(pfx); i++) {
+        val[i] = i;
+        mu_assert(tbl_set(t, pfx[i], &val[i], NULL));
+    }
+
+    for (int i = 0; i < NELEMS(addr); i++) {
+        mu_assert(key_bystr(key, &mlen, &af, addr[i]));
+        rn1 = rn_match(key, &t->head4->rh);
+        rn2 = rn_match4(key, &t->head4->rh);
+        mu_eq((void *)rn1, (void *)rn2, "%p");
+        mu_assert(rn2);
+    }
+
+    // without a default route
+    mu_assert(tbl_del(t, "0.0.0.0/0", NULL));
+    mu_assert(tbl_del(t, "128.0.0.0/1", NULL));
+    for (int i = 0; i < NELEMS(addr); i++) {
+        mu_assert(key_bystr(key, &mlen, &af, addr[i]));
+        rn1 = rn_match(key, &t->head4->rh);
+        rn2 = rn_match4(key, &t->head4->rh);
+        mu_eq((void *)rn1, (void *)rn2, "%p");
+    }
+    mu_assert(key_bystr(key, &mlen, &af, "127.0.0.1"));
+    mu_eq(NULL, (void *)rn_match4(key, &t->head4->rh), "%p");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_match4_random(void)
+{
+    table_t *t = tbl_create(NULL);
+    uint8_t key[MAX_BINKEY];
+    uint32_t a;
+    int val = 0, bad = 0, mlen;
+
+    for (int i = 0; i < 20000; i++) {
+        // keep addresses in 10/8 so prefixes nest
+        a = (rnd() & 0x00ffffff) | 0x0a000000;
+        mlen = 8 + rnd() % 25;
+        key4(key, a);
+        tbl_setkey(t, key, mlen, &val, NULL);
+    }
+
+    for (int i = 0; i < 500000; i++) {
+        a = i % 4 ? (rnd() & 0x00ffffff) | 0x0a000000 : rnd();
+        key4(key, a);
+        if (rn_match(key, &t->head4->rh) != rn_match4(key, &t->head4->rh))
+            bad++;
+    }
+    mu_eq(0, bad, "%d");
+
+    tbl_destroy(&t, NULL);
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+#include <unistd.h>          // close, unlink
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_record.h"
+
+
+/*
+ * Test tbl_record(), tbl_trace(), trc_header() and trc_read()
+ */
+
+#define U64(x) ((uint64_t)(x))
+
+static char fname[] = "/tmp/test_c_tbl_record_XXXXXX";
+
+static void
+mkname(void)
+{
+    int fd;
+
+    strcpy(fname + strlen(fname) - 6, "XXXXXX");
+    if ((fd = mkstemp(fname)) >= 0)
+        close(fd);
+}
+
+/* read a record and check its op, mlen and (string) key */
+
+static int
+expect(FILE *fp, int op, int mlen, const char *key)
+{
+    trec_t rec;
+    char buf[MAX_STRKEY];
+
+    if (trc_read(fp, &rec) != 1) return 0;
+    if (rec.op != op || rec.mlen != mlen) return 0;
+    if (key == NULL) return IPT_KEYLEN(rec.key) == 0;
+    if (! key_tostr(buf, rec.key)) return 0;
+
+    return strcmp(buf, key) == 0;
+}
+
+void
+test_record_ops(void)
+{
+    table_t *t = tbl_create(NULL);
+    uint8_t addr[MAX_BINKEY];
+    int val = 1, flags = -1, mlen, af;
+    FILE *fp;
+
+    mkname();
+    mu_false(tbl_record(NULL, fname, 0));
+    mu_false(tbl_trace(t, TRC_ITR, NULL, -1));        // not recording
+    mu_true(tbl_record(t, fname, 0));
+    mu_assert(t->trace);
+
+    mu_true(tbl_set(t, "10.10.10.0/24", &val, NULL));
+    mu_true(tbl_set(t, "10.10.10.10", &val, NULL));
+    mu_assert(tbl_get(t, "10.10.10.0/24"));
+    mu_assert(tbl_lpm(t, "10.10.10.1"));
+    mu_true(tbl_trace(t, TRC_ITR, NULL, -1));
+    mu_true(tbl_trace(t, TRC_NEXT, NULL, -1));
+    mu_true(tbl_trace(t, TRC_END, NULL, -1));
+    mu_true(tbl_del(t, "10.10.10.0/24", NULL));
+    mu_false(tbl_del(t, "10.10.10.0/24", NULL));      // failures are recorded
+    mu_false(tbl_set(t, "not a prefix", &val, NULL)); // but not non-prefixes
+    mu_false(tbl_trace(t, 0, NULL, -1));              // unknown op
+    mu_false(tbl_trace(t, TRC_NOPS, NULL, -1));
+    mu_false(tbl_trace(t, TRC_SET, NULL, 8));         // no key
+    mu_true(tbl_addpath(t, "10.10.10.10", &val, 2));
+    mu_true(tbl_delpath(t, "10.10.10.10/32", 0, NULL));
+    mu_eq(U64(11), t->trace->count, "%lu");
+
+    // internal lookups are not recorded
+    mu_eq((void *)&val, tbl_select(t, "10.10.10.10", 7), "%p");
+    mu_assert(key_bystr(addr, &mlen, &af, "10.10.0.0"));
+    mu_true(tbl_overlaps(t, addr, 16));
+    mu_assert(tbl_rawget(t, "10.10.10.10"));
+    mu_assert(tbl_rawlpm(t, addr) == NULL);
+    mu_eq(U64(11), t->trace->count, "%lu");
+
+    mu_true(tbl_record(t, NULL, 0));
+    mu_eq(NULL, (void *)t->trace, "%p");
+    mu_false(tbl_trace(t, TRC_ITR, NULL, -1));
+
+    fp = fopen(fname, "rb");
+    mu_assert(fp);
+    mu_true(trc_header(fp, &flags));
+    mu_eq(0, flags, "%d");
+    mu_true(expect(fp, TRC_SET, 24, "10.10.10.0"));
+    mu_true(expect(fp, TRC_SET, 255, "10.10.10.10"));
+    mu_true(expect(fp, TRC_GET, 24, "10.10.10.0"));
+    mu_true(expect(fp, TRC_LPM, 255, "10.10.10.1"));
+    mu_true(expect(fp, TRC_ITR, 255, NULL));
+    mu_true(expect(fp, TRC_NEXT, 255, NULL));
+    mu_true(expect(fp, TRC_END, 255, NULL));
+    mu_true(expect(fp, TRC_DEL, 24, "10.10.10.0"));
+    mu_true(expect(fp, TRC_DEL, 24, "10.10.10.0"));
+    mu_true(expect(fp, TRC_ADDPATH, 255, "10.10.10.10"));
+    mu_true(expect(fp, TRC_DELPATH, 32, "10.10.10.10"));
+    mu_eq(0, trc_read(fp, &(trec_t){0}), "%d");       // end of file
+    fclose(fp);
+
+    tbl_destroy(&t, NULL);
+    unlink(fname);
+}
+
+void
+test_record_anon(void)
+{
+    table_t *t = tbl_create(NULL);
+    const char *addrs[] = {"10.0.0.0", "10.0.0.1", "11.0.0.0", "10.0.0.0",
+                           "2001:db8::1", "2001:db8::2"};
+    uint8_t k[6][MAX_BINKEY];
+    trec_t rec;
+    int flags = 0;
+    FILE *fp;
+
+    mkname();
+    mu_true(tbl_record(t, fname, 0x5eed));
+    for (int i = 0; i < 6; i++)
+        tbl_lpm(t, addrs[i]);
+    tbl_destroy(&t, NULL);                  // stops the recording as well
+
+    fp = fopen(fname, "rb");
+    mu_assert(fp);
+    mu_true(trc_header(fp, &flags));
+    mu_eq(TRC_ANON, flags, "%d");
+    for (int i = 0; i < 6; i++) {
+        mu_eq(1, trc_read(fp, &rec), "%d");
+        memcpy(k[i], rec.key, IPT_KEYLEN(rec.key));
+    }
+    fclose(fp);
+    unlink(fname);
+
+    // the same key maps to the same key, others are changed
+    mu_eq(0, memcmp(k[0], k[3], IP4_KEYLEN), "%d");
+    mu_eq(IP4_KEYLEN, IPT_KEYLEN(k[0]), "%d");
+    mu_eq(IP6_KEYLEN, IPT_KEYLEN(k[4]), "%d");
+
+    // common prefixes are preserved, and no more than that
+    mu_eq(0, memcmp(k[0], k[1], IP4_KEYLEN - 1), "%d");
+    mu_eq(1, (k[0][4] ^ k[1][4]), "%d");
+    mu_eq(1, (k[0][1] ^ k[2][1]), "%d");
+    mu_eq(0, memcmp(k[4], k[5], IP6_KEYLEN - 1), "%d");
+    mu_eq(2, (k[4][16] ^ k[5][16]) & ~1, "%d");  // bit 127 depends on 126
+}
+
+void
+test_record_files(void)
+{
+    table_t *t = tbl_create(NULL);
+    trec_t rec;
+    FILE *fp;
+    int val = 1;
+
+    mu_false(tbl_record(t, "/nonexistent/dir/trace", 0));
+    mu_eq(NULL, (void *)t->trace, "%p");
+
+    // a truncated record
+    mkname();
+    mu_true(tbl_record(t, fname, 0));
+    mu_true(tbl_set(t, "2001:db8::/32", &val, NULL));
+    mu_true(tbl_record(t, NULL, 0));
+    mu_assert(truncate(fname, 6 + 10) == 0);
+    fp = fopen(fname, "rb");
+    mu_true(trc_header(fp, NULL));
+    mu_eq(-1, trc_read(fp, &rec), "%d");
+    fclose(fp);
+
+    // not a trace file
+    fp = fopen(fname, "wb");
+    fputs("IPTC\001\000 is a cache, not a trace", fp);
+    fclose(fp);
+    fp = fopen(fname, "rb");
+    mu_false(trc_header(fp, NULL));
+    fclose(fp);
+    mu_false(trc_header(NULL, NULL));
+    mu_eq(-1, trc_read(NULL, &rec), "%d");
+
+    unlink(fname);
+    tbl_destroy(&t, NULL);
+}
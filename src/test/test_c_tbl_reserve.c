@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_reserve.h"
+
+
+/*
+ * Test tbl_reserve()
+ */
+
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+
+static int
+in_slab(table_t *t, entry_t *e)
+{
+    for (eslab_t *s = t->slab; s; s = s->next)
+        if (e >= s->e && e < s->e + s->size) return 1;
+    return 0;
+}
+
+void
+test_reserve_basic(void)
+{
+    table_t *t = tbl_create(NULL);
+    int val[4] = {0, 1, 2, 3};
+    entry_t *e;
+
+    mu_false(tbl_reserve(NULL, 1));
+    mu_true(tbl_reserve(t, 0));
+    mu_eq(NULL, (void *)t->slab, "%p");
+    mu_eq(SIZE_T(0), t->nfree, "%zu");
+
+    mu_true(tbl_reserve(t, 3));
+    mu_assert(t->slab);
+    mu_eq(SIZE_T(3), t->nfree, "%zu");
+
+    // a smaller or equal reservation is a noop
+    mu_true(tbl_reserve(t, 2));
+    mu_true(tbl_reserve(t, 3));
+    mu_eq(SIZE_T(3), t->nfree, "%zu");
+    mu_eq(NULL, (void *)t->slab->next, "%p");
+
+    // new prefixes use reserved entries
+    mu_true(tbl_set(t, "10.10.10.0/24", &val[0], NULL));
+    mu_true(tbl_set(t, "2001:db8::/32", &val[1], NULL));
+    mu_eq(SIZE_T(1), t->nfree, "%zu");
+    e = tbl_get(t, "10.10.10.0/24");
+    mu_assert(e);
+    mu_true(in_slab(t, e));
+    mu_eq(0, INT_VALUE(e), "%d");
+
+    // updating a prefix takes no entry
+    mu_true(tbl_set(t, "10.10.10.0/24", &val[2], NULL));
+    mu_eq(SIZE_T(1), t->nfree, "%zu");
+
+    mu_true(tbl_set(t, "11.11.11.0/24", &val[3], NULL));
+    mu_eq(SIZE_T(0), t->nfree, "%zu");
+
+    // beyond the reservation, entries are allocated one by one
+    mu_true(tbl_set(t, "12.12.12.0/24", &val[3], NULL));
+    mu_eq(SIZE_T(0), t->nfree, "%zu");
+    e = tbl_get(t, "12.12.12.0/24");
+    mu_assert(e);
+    mu_false(in_slab(t, e));
+
+    // deleting puts reserved entries back on the free list only
+    mu_true(tbl_del(t, "12.12.12.0/24", NULL));
+    mu_eq(SIZE_T(0), t->nfree, "%zu");
+    mu_true(tbl_del(t, "10.10.10.0/24", NULL));
+    mu_eq(SIZE_T(1), t->nfree, "%zu");
+    mu_eq(NULL, (void *)tbl_get(t, "10.10.10.0/24"), "%p");
+
+    // which are reused
+    mu_true(tbl_set(t, "13.13.13.0/24", &val[0], NULL));
+    mu_eq(SIZE_T(0), t->nfree, "%zu");
+    e = tbl_get(t, "13.13.13.0/24");
+    mu_assert(e);
+    mu_true(in_slab(t, e));
+    mu_eq(0, INT_VALUE(e), "%d");
+    mu_eq(SIZE_T(2), t->count4, "%zu");
+    mu_eq(SIZE_T(1), t->count6, "%zu");
+
+    // another reservation adds a slab for the shortfall only
+    mu_true(tbl_reserve(t, 5));
+    mu_eq(SIZE_T(5), t->nfree, "%zu");
+    mu_assert(t->slab->next);
+    mu_eq(SIZE_T(5), t->slab->size, "%zu");
+
+    tbl_destroy(&t, NULL);
+    mu_eq(NULL, (void *)t, "%p");
+}
+
+void
+test_reserve_index(void)
+{
+    // a reservation pre-sizes the exact match index
+    table_t *t = tbl_create(NULL);
+    char buf[MAX_STRKEY];
+    int val = 0, bad = 0;
+    size_t size;
+
+    mu_true(tbl_hindex(t, 1));
+    mu_true(tbl_reserve(t, 10000));
+    size = t->index->size;
+    mu_true(4 * 10000 <= 3 * size);
+
+    for (int i = 0; i < 10000; i++) {
+        snprintf(buf, sizeof(buf), "10.%d.%d.0/24", i / 256, i % 256);
+        if (! tbl_set(t, buf, &val, NULL)) bad++;
+    }
+    mu_eq(0, bad, "%d");
+    mu_eq(size, t->index->size, "%zu");
+    mu_eq(SIZE_T(0), t->nfree, "%zu");
+
+    // enabling the index later also counts the reserved entries
+    mu_true(tbl_hindex(t, 0));
+    mu_true(tbl_reserve(t, 10000));
+    mu_true(tbl_hindex(t, 1));
+    mu_true(4 * 20000 <= 3 * t->index->size);
+
+    for (int i = 0; i < 10000; i++) {
+        snprintf(buf, sizeof(buf), "10.%d.%d.0/24", i / 256, i % 256);
+        if (tbl_get(t, buf) == NULL) bad++;
+    }
+    mu_eq(0, bad, "%d");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_reserve_gc(void)
+{
+    // flushing deleted entries puts reserved ones back on the free list
+    table_t *t = tbl_create(NULL);
+    char buf[MAX_STRKEY];
+    int val = 0, bad = 0;
+
+    mu_true(tbl_reserve(t, 100));
+    for (int i = 0; i < 100; i++) {
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/48", i);
+        if (! tbl_set(t, buf, &val, NULL)) bad++;
+    }
+    mu_eq(0, bad, "%d");
+    mu_eq(SIZE_T(0), t->nfree, "%zu");
+
+    // deletes during an iteration are postponed until the gc
+    t->itr_lock++;
+    for (int i = 0; i < 100; i += 2) {
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/48", i);
+        if (! tbl_del(t, buf, NULL)) bad++;
+    }
+    t->itr_lock--;
+    mu_eq(0, bad, "%d");
+    mu_eq(SIZE_T(0), t->nfree, "%zu");
+    tbl_gc(t, NULL);
+    mu_eq(SIZE_T(50), t->nfree, "%zu");
+    mu_eq(SIZE_T(50), t->count6, "%zu");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_reserve_clone(void)
+{
+    // a clone reserves its entries up front
+    table_t *t = tbl_create(NULL), *c;
+    char buf[MAX_STRKEY];
+    int val = 0, bad = 0;
+    entry_t *e;
+
+    for (int i = 0; i < 500; i++) {
+        snprintf(buf, sizeof(buf), "10.%d.%d.0/%d", i / 256, i % 256,
+                 24 - i % 3);
+        tbl_set(t, buf, &val, NULL);
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/48", i);
+        tbl_set(t, buf, &val, NULL);
+    }
+    mu_eq(NULL, (void *)t->slab, "%p");
+
+    c = tbl_clone(t, NULL, NULL);
+    mu_assert(c);
+    mu_assert(c->slab);
+    mu_eq(t->count4 + t->count6, c->slab->size, "%zu");
+    mu_eq(SIZE_T(0), c->nfree, "%zu");
+
+    for (int i = 0; i < 500; i++) {
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/48", i);
+        e = tbl_get(c, buf);
+        if (e == NULL || ! in_slab(c, e)) bad++;
+    }
+    mu_eq(0, bad, "%d");
+
+    tbl_destroy(&c, NULL);
+    tbl_destroy(&t, NULL);
+}
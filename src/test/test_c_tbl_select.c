@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_select.h"
+
+
+/*
+ * Test tbl_addpath(), tbl_delpath() and tbl_select()
+ */
+
+#define SIZE_T(x) ((size_t)(x))
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+
+// Helpers
+
+void *dup(void *, void *);
+void purge(void *, void **);
+
+void *
+dup(void *args, void *dta)
+{
+    int *copy = malloc(sizeof(int));
+    *copy = *(int *)dta;
+    *(int *)args += 1;
+    return copy;
+}
+
+void
+purge(void *args, void **dta)
+{
+    if (args) *(int *)args += 1;
+    free(*dta);
+    *dta = NULL;
+}
+
+int *mk_int(int);
+
+int *
+mk_int(int n)
+{
+    int *p = malloc(sizeof(int));
+    *p = n;
+    return p;
+}
+
+// Tests
+
+void
+test_tbl_select(void)
+{
+    table_t *t = tbl_create(NULL);
+    int num[4] = {0, 1, 2, 3};
+    int hits[4] = {0, 0, 0, 0};
+    entry_t *e;
+    void *v;
+
+    mu_assert(tbl_set(t, "10.10.10.0/24", num+0, NULL));
+    mu_assert(tbl_set(t, "10.10.10.0/25", num+0, NULL));
+
+    // prefix must exist
+    mu_false(tbl_addpath(t, "10.10.0.0/16", num+1, 1));
+    mu_false(tbl_addpath(NULL, "10.10.10.0/24", num+1, 1));
+
+    // without paths, the entry's value is selected
+    mu_eq((void *)(num+0), tbl_select(t, "10.10.10.200", 7), "%p");
+    mu_eq(NULL, tbl_select(t, "11.11.11.11", 7), "%p");
+
+    for (int i = 1; i < NELEMS(num); i++)
+        mu_assert(tbl_addpath(t, "10.10.10.0/24", num+i, 1));
+
+    e = tbl_get(t, "10.10.10.0/24");
+    mu_eq(SIZE_T(3), e->mpath->count, "%zu");
+
+    for (uint32_t hash = 0; hash < 300; hash++) {
+        v = tbl_select(t, "10.10.10.200", hash);
+        hits[(int *)v - num]++;
+    }
+    mu_eq(0, hits[0], "%d");
+    mu_eq(100, hits[1], "%d");
+    mu_eq(100, hits[2], "%d");
+    mu_eq(100, hits[3], "%d");
+
+    // the more specific /25 has no paths
+    mu_eq((void *)(num+0), tbl_select(t, "10.10.10.1", 1), "%p");
+
+    // removing a path does not touch the tree
+    mu_assert(tbl_delpath(t, "10.10.10.0/24", 0, NULL));
+    mu_eq((void *)e, (void *)tbl_get(t, "10.10.10.0/24"), "%p");
+    mu_eq(SIZE_T(2), e->mpath->count, "%zu");
+    mu_eq((void *)(num+2), tbl_select(t, "10.10.10.200", 0), "%p");
+    mu_false(tbl_delpath(t, "10.10.10.0/24", 2, NULL));
+    mu_false(tbl_delpath(t, "10.10.0.0/16", 0, NULL));
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tbl_select_purge(void)
+{
+    table_t *t = tbl_create(purge);
+    table_t *c;
+    int purged = 0, dups = 0;
+
+    mu_assert(tbl_set(t, "10.10.10.0/24", mk_int(0), NULL));
+    mu_assert(tbl_addpath(t, "10.10.10.0/24", mk_int(1), 1));
+    mu_assert(tbl_addpath(t, "10.10.10.0/24", mk_int(2), 1));
+    mu_assert(tbl_set(t, "2001:db8::/32", mk_int(0), NULL));
+    mu_assert(tbl_addpath(t, "2001:db8::/32", mk_int(1), 1));
+
+    // clone copies paths as well
+    c = tbl_clone(t, dup, &dups);
+    mu_assert(c);
+    mu_eq(5, dups, "%d");
+    mu_eq(SIZE_T(2), tbl_get(c, "10.10.10.0/24")->mpath->count, "%zu");
+    tbl_destroy(&c, &purged);
+    mu_eq(5, purged, "%d");
+
+    // delpath purges a single value
+    purged = 0;
+    mu_assert(tbl_delpath(t, "10.10.10.0/24", 1, &purged));
+    mu_eq(1, purged, "%d");
+
+    // deleting a prefix purges its value and its paths
+    mu_assert(tbl_del(t, "10.10.10.0/24", &purged));
+    mu_eq(3, purged, "%d");
+
+    // a prefix set again after being flagged for deletion, has no paths
+    t->itr_lock = 1;
+    mu_assert(tbl_del(t, "2001:db8::/32", &purged));
+    mu_assert(tbl_set(t, "2001:db8::/32", mk_int(0), &purged));
+    t->itr_lock = 0;
+    mu_eq(5, purged, "%d");
+    mu_eq(NULL, (void *)tbl_get(t, "2001:db8::/32")->mpath, "%p");
+
+    tbl_destroy(&t, &purged);
+    mu_eq(6, purged, "%d");
+}
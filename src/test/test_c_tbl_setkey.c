@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_setkey.h"
+
+/*
+ * Test tbl_setkey()
+ */
+
+#define INT_VALUE(x) (*(int *)x->value)
+#define SIZE_T(x) ((size_t)(x))
+
+void
+test_tbl_setkey_good(void)
+{
+    table_t *t = tbl_create(NULL);
+    uint8_t key[MAX_BINKEY], org[MAX_BINKEY];
+    int mlen, af, num[3] = {1, 2, 3};
+    entry_t *e;
+
+    // mask is applied to a copy, not to the caller's key
+    mu_assert(key_bystr(key, &mlen, &af, "10.10.10.10"));
+    memcpy(org, key, IPT_KEYLEN(key));
+    mu_assert(tbl_setkey(t, key, 24, num+0, NULL));
+    mu_eq(0, key_cmp(org, key), "%d");
+    mu_eq(SIZE_T(1), t->count4, "%zu");
+
+    e = tbl_get(t, "10.10.10.0/24");
+    mu_assert(e);
+    mu_eq(1, INT_VALUE(e), "%d");
+
+    // -1 means a host mask
+    mu_assert(tbl_setkey(t, key, -1, num+1, NULL));
+    e = tbl_get(t, "10.10.10.10/32");
+    mu_assert(e);
+    mu_eq(2, INT_VALUE(e), "%d");
+
+    // ipv6 works as well, existing entries get their value replaced
+    mu_assert(key_bystr(key, &mlen, &af, "2001:db8::1"));
+    mu_assert(tbl_setkey(t, key, 32, num+0, NULL));
+    mu_assert(tbl_setkey(t, key, 32, num+2, NULL));
+    mu_eq(SIZE_T(1), t->count6, "%zu");
+    e = tbl_lpm(t, "2001:db8:ffff::1");
+    mu_assert(e);
+    mu_eq(3, INT_VALUE(e), "%d");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tbl_setkey_bad(void)
+{
+    table_t *t = tbl_create(NULL);
+    uint8_t key[MAX_BINKEY];
+    int mlen, af, num = 1;
+
+    mu_assert(key_bystr(key, &mlen, &af, "10.10.10.10"));
+    mu_false(tbl_setkey(NULL, key, 24, &num, NULL));
+    mu_false(tbl_setkey(t, NULL, 24, &num, NULL));
+    mu_false(tbl_setkey(t, key, 33, &num, NULL));
+    mu_false(tbl_setkey(t, key, -2, &num, NULL));
+
+    key[0] = 6;  // illegal LEN byte
+    mu_false(tbl_setkey(t, key, 24, &num, NULL));
+    mu_eq(SIZE_T(0), t->count4, "%zu");
+
+    tbl_destroy(&t, NULL);
+}
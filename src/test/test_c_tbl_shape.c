@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_shape.h"
+
+
+/*
+ * Test tbl_shape()
+ */
+
+#define SIZE_T(x) ((size_t)(x))
+
+static size_t
+hsum(size_t *h)
+{
+    size_t sum = 0;
+
+    for (int i = 0; i < SHP_MAXLEN; i++)
+        sum += h[i];
+
+    return sum;
+}
+
+void
+test_shape_empty(void)
+{
+    table_t *t = tbl_create(NULL);
+    shape_t s;
+
+    mu_false(tbl_shape(NULL, AF_INET, &s));
+    mu_false(tbl_shape(t, AF_INET, NULL));
+    mu_false(tbl_shape(t, AF_UNSPEC, &s));
+
+    mu_true(tbl_shape(t, AF_INET, &s));
+    mu_eq(SIZE_T(0), s.entries, "%zu");
+    mu_eq(SIZE_T(1), s.internal, "%zu");       // the top of the tree
+    mu_eq(SIZE_T(0), s.chains, "%zu");
+    mu_eq(SIZE_T(0), s.masks, "%zu");
+    mu_eq(SIZE_T(0), s.maxdepth, "%zu");
+    mu_eq(SIZE_T(0), s.mem_entries, "%zu");
+    mu_true(s.mem_heads > 0);
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_shape_chains(void)
+{
+    table_t *t = tbl_create(NULL);
+    shape_t s;
+    int val = 1;
+
+    // one key, three masks: a single chain of 3
+    mu_true(tbl_set(t, "10.0.0.0/8", &val, NULL));
+    mu_true(tbl_set(t, "10.0.0.0/16", &val, NULL));
+    mu_true(tbl_set(t, "10.0.0.0/24", &val, NULL));
+    mu_true(tbl_set(t, "11.0.0.0/8", &val, NULL));
+
+    mu_true(tbl_shape(t, AF_INET, &s));
+    mu_eq(SIZE_T(4), s.entries, "%zu");
+    mu_eq(SIZE_T(2), s.chains, "%zu");
+    mu_eq(SIZE_T(3), s.maxchain, "%zu");
+    mu_eq(SIZE_T(1), s.chain[1], "%zu");
+    mu_eq(SIZE_T(1), s.chain[3], "%zu");
+    mu_eq(SIZE_T(3), s.masks, "%zu");
+    mu_eq(s.entries, hsum(s.depth), "%zu");
+    mu_eq(s.internal, hsum(s.mklist), "%zu");
+    mu_true(s.maxdepth >= 2);
+    mu_eq(s.entries * sizeof(entry_t), s.mem_entries, "%zu");
+    mu_eq(s.rmasks * sizeof(struct radix_mask), s.mem_rmasks, "%zu");
+
+    // a default route hangs off the left end marker
+    mu_true(tbl_set(t, "0.0.0.0/0", &val, NULL));
+    mu_true(tbl_shape(t, AF_INET, &s));
+    mu_eq(SIZE_T(5), s.entries, "%zu");
+    mu_eq(SIZE_T(3), s.chains, "%zu");
+
+    // the other tree is untouched
+    mu_true(tbl_shape(t, AF_INET6, &s));
+    mu_eq(SIZE_T(0), s.entries, "%zu");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_shape_tombstones(void)
+{
+    table_t *t = tbl_create(NULL);
+    char buf[MAX_STRKEY];
+    shape_t s;
+    int val = 1;
+
+    for (int i = 0; i < 100; i++) {
+        snprintf(buf, sizeof(buf), "2001:db8:%x::/48", i);
+        mu_true(tbl_set(t, buf, &val, NULL));
+    }
+    t->itr_lock++;
+    mu_true(tbl_del(t, "2001:db8:1::/48", NULL));
+    mu_true(tbl_del(t, "2001:db8:2::/48", NULL));
+    t->itr_lock--;
+
+    mu_true(tbl_shape(t, AF_INET6, &s));
+    mu_eq(SIZE_T(100), s.entries, "%zu");
+    mu_eq(SIZE_T(2), s.tombstones, "%zu");
+    mu_eq(SIZE_T(100), s.chains, "%zu");
+    mu_eq(SIZE_T(101), s.internal, "%zu");     // top plus one per chain
+    mu_eq(s.entries, hsum(s.depth), "%zu");
+    mu_true(s.sumdepth >= s.entries);
+
+    tbl_gc(t, NULL);
+    mu_true(tbl_shape(t, AF_INET6, &s));
+    mu_eq(SIZE_T(98), s.entries, "%zu");
+    mu_eq(SIZE_T(0), s.tombstones, "%zu");
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_shape_paths(void)
+{
+    table_t *t = tbl_create(NULL);
+    shape_t s;
+    int val = 1;
+
+    mu_true(tbl_set(t, "10.0.0.0/8", &val, NULL));
+    mu_true(tbl_shape(t, AF_INET, &s));
+    mu_eq(SIZE_T(0), s.mem_paths, "%zu");
+
+    mu_true(tbl_addpath(t, "10.0.0.0/8", &val, 1));
+    mu_true(tbl_shape(t, AF_INET, &s));
+    mu_true(s.mem_paths >= sizeof(mpath_t) + sizeof(path_t));
+
+    tbl_destroy(&t, NULL);
+}
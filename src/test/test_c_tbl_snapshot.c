@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <stdint.h>          // intptr_t
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tbl_snapshot.h"
+
+
+
+/*
+ * Test tbl_persist(), tbl_snapshot() and the snp_xxx functions
+ */
+
+#define SIZE_T(x) ((size_t)(x))
+#define VAL(x) ((void *)(intptr_t)(x))
+#define NUM(p) ((int)(intptr_t)(p))
+#define NPFX 400
+
+int live = 0;  // values allocated and not yet purged
+
+void *dup_int(void *, void *);
+void *
+dup_int(void *dargs, void *v)
+{
+    int *n = malloc(sizeof(int));
+
+    (void)dargs;
+    if (n == NULL) return NULL;
+    *n = *(int *)v;
+    live++;
+    return n;
+}
+
+void purge_int(void *, void **);
+void
+purge_int(void *pargs, void **v)
+{
+    (void)pargs;
+    if (v == NULL || *v == NULL) return;
+    free(*v);
+    *v = NULL;
+    live--;
+}
+
+int *new_int(int);
+int *
+new_int(int v)
+{
+    int *n = malloc(sizeof(int));
+
+    *n = v;
+    live++;
+    return n;
+}
+
+size_t snp_count(snap_t *);
+size_t
+snp_count(snap_t *s)
+{
+    snpitr_t itr;
+    size_t n = 0;
+
+    for (ptnode_t *p = snp_first(s, &itr); p; p = snp_next(&itr))
+        n++;
+
+    return n;
+}
+
+void
+test_tbl_snapshot(void)
+{
+    table_t *t = tbl_create(NULL);
+    snap_t *s1, *s2;
+    ptnode_t *n;
+    uint8_t key[MAX_BINKEY];
+    int mlen = -1, af = AF_UNSPEC;
+
+    mu_eq(NULL, (void *)tbl_snapshot(t), "%p");   // not enabled
+    tbl_set(t, "10.10.10.0/24", VAL(24), NULL);
+    tbl_set(t, "2001:db8::/32", VAL(32), NULL);
+
+    mu_false(tbl_persist(NULL, 1, NULL, NULL));
+    mu_true(tbl_persist(t, 1, NULL, NULL));
+    mu_true(tbl_persist(t, 1, NULL, NULL));       // no-op
+    s1 = tbl_snapshot(t);
+    mu_assert(s1);
+    mu_eq(SIZE_T(1), s1->count4, "%zu");
+    mu_eq(SIZE_T(1), s1->count6, "%zu");
+    mu_eq(SIZE_T(2), snp_count(s1), "%zu");
+
+    tbl_set(t, "10.10.10.0/25", VAL(25), NULL);
+    tbl_set(t, "10.10.10.0/24", VAL(-24), NULL);
+    tbl_del(t, "2001:db8::/32", NULL);
+    s2 = tbl_snapshot(t);
+    mu_eq(SIZE_T(2), s2->count4, "%zu");
+    mu_eq(SIZE_T(0), s2->count6, "%zu");
+
+    // s1 did not see the changes
+    key_bystr(key, &mlen, &af, "10.10.10.1");
+    n = snp_lpm(s1, key);
+    mu_assert(n);
+    mu_eq(24, NUM(n->val->value), "%d");
+    n = snp_lpm(s2, key);
+    mu_eq(25, NUM(n->val->value), "%d");
+    mu_eq(-24, NUM(snp_get(s2, key, 24)->val->value), "%d");
+    mu_eq(NULL, (void *)snp_get(s1, key, 25), "%p");
+    mu_eq(NULL, (void *)snp_get(s1, key, 23), "%p");
+    mu_eq(NULL, (void *)snp_get(s1, key, 33), "%p");
+
+    mlen = -1;
+    key_bystr(key, &mlen, &af, "2001:db8:1::1");
+    mu_eq(32, NUM(snp_lpm(s1, key)->val->value), "%d");
+    mu_eq(NULL, (void *)snp_lpm(s2, key), "%p");
+
+    // snapshots outlive the table and each other
+    tbl_destroy(&t, NULL);
+    mu_eq(SIZE_T(2), snp_count(s1), "%zu");
+    mu_true(snp_destroy(&s1, NULL));
+    mu_eq(NULL, (void *)s1, "%p");
+    mu_false(snp_destroy(&s1, NULL));
+    mu_eq(SIZE_T(2), snp_count(s2), "%zu");
+    snp_destroy(&s2, NULL);
+}
+
+void
+test_tbl_snapshot_paths(void)
+{
+    table_t *t = tbl_create(NULL);
+    snap_t *s;
+    ptnode_t *a, *b;
+    char pfx[MAX_STRKEY];
+
+    tbl_persist(t, 1, NULL, NULL);
+    for (int i = 0; i < 256; i++) {
+        snprintf(pfx, sizeof(pfx), "%d.0.0.0/8", i);
+        tbl_set(t, pfx, VAL(i), NULL);
+    }
+    s = tbl_snapshot(t);
+    a = t->persist->root[0];
+    mu_eq((void *)a, (void *)s->root[0], "%p");
+    mu_eq(SIZE_T(2), a->refs, "%zu");
+
+    // a change copies the path only, the other half is still shared
+    tbl_set(t, "1.0.0.0/8", VAL(-1), NULL);
+    b = t->persist->root[0];
+    mu_assert(a != b);
+    mu_eq(SIZE_T(1), a->refs, "%zu");
+    mu_eq(SIZE_T(1), b->refs, "%zu");
+    mu_assert(a->child[0] != b->child[0]);
+    mu_eq((void *)a->child[1], (void *)b->child[1], "%p");
+    mu_eq(SIZE_T(2), a->child[1]->refs, "%zu");
+
+    // without snapshots, nodes are changed in place
+    snp_destroy(&s, NULL);
+    mu_eq(SIZE_T(1), b->child[1]->refs, "%zu");
+    a = b->child[0];
+    tbl_set(t, "0.0.0.0/8", VAL(-2), NULL);
+    mu_eq((void *)b, (void *)t->persist->root[0], "%p");
+    mu_eq((void *)a, (void *)b->child[0], "%p");
+
+    // disabling drops the tree
+    mu_true(tbl_persist(t, 0, NULL, NULL));
+    mu_eq(NULL, (void *)t->persist, "%p");
+    mu_true(tbl_set(t, "1.0.0.0/8", VAL(1), NULL));
+    mu_true(tbl_del(t, "1.0.0.0/8", NULL));
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tbl_snapshot_values(void)
+{
+    table_t *t = tbl_create(purge_int);
+    snap_t *s;
+    int *v;
+
+    live = 0;
+    tbl_set(t, "10.10.10.0/24", new_int(1), NULL);
+    mu_true(tbl_persist(t, 1, dup_int, NULL));
+    mu_eq(2, live, "%d");
+    s = tbl_snapshot(t);
+
+    // the table and the snapshot have their own copy of a value
+    v = new_int(2);
+    tbl_set(t, "10.10.10.0/24", v, NULL);
+    mu_eq(3, live, "%d");
+    mu_eq(1, *(int *)snp_first(s, &(snpitr_t){0})->val->value, "%d");
+    mu_eq(2, *(int *)tbl_get(t, "10.10.10.0/24")->value, "%d");
+    tbl_del(t, "10.10.10.0/24", NULL);
+    mu_eq(1, live, "%d");
+
+    // deferred deletions leave the persistent tree right away
+    tbl_set(t, "11.0.0.0/8", new_int(11), NULL);
+    t->itr_lock++;
+    tbl_del(t, "11.0.0.0/8", NULL);
+    mu_eq(2, live, "%d");
+    tbl_set(t, "11.0.0.0/8", new_int(12), NULL);
+    t->itr_lock--;
+    tbl_gc(t, NULL);
+    mu_eq(3, live, "%d");
+
+    snp_destroy(&s, NULL);
+    mu_eq(2, live, "%d");
+    tbl_destroy(&t, NULL);
+    mu_eq(0, live, "%d");
+}
+
+void
+test_tbl_snapshot_random(void)
+{
+    table_t *t = tbl_create(NULL);
+    snap_t *snaps[8];
+    entry_t *want[8][NPFX], *e;
+    ptnode_t *n;
+    char pfx[NPFX][MAX_STRKEY];
+    uint8_t key[MAX_BINKEY];
+    int mlen, af, i, k;
+    unsigned int r = 7;
+
+    for (i = 0; i < NPFX; i++) {
+        r = r * 1103515245 + 12345;
+        if (i % 3)
+            snprintf(pfx[i], MAX_STRKEY, "%u.%u.%u.0/%u", (r >> 8) % 16,
+                     (r >> 12) & 0xff, (r >> 20) & 0xff, 4 + (r >> 4) % 21);
+        else
+            snprintf(pfx[i], MAX_STRKEY, "2001:db8:%x::/%u",
+                     (r >> 8) & 0xffff, 32 + (r >> 4) % 17);
+    }
+
+    tbl_persist(t, 1, NULL, NULL);
+    for (k = 0; k < 8; k++) {
+        for (i = 0; i < 3 * NPFX; i++) {
+            r = r * 1103515245 + 12345;
+            if ((r >> 16) % 3)
+                tbl_set(t, pfx[(r >> 4) % NPFX], VAL(k * 1000 + i), NULL);
+            else
+                tbl_del(t, pfx[(r >> 4) % NPFX], NULL);
+        }
+        snaps[k] = tbl_snapshot(t);
+        mu_eq(t->count4 + t->count6, snp_count(snaps[k]), "%zu");
+        for (i = 0; i < NPFX; i++)
+            want[k][i] = tbl_get(t, pfx[i]) ? tbl_get(t, pfx[i])->value : NULL;
+    }
+
+    // each snapshot still has the prefixes and values it was taken with
+    for (k = 0; k < 8; k++) {
+        for (i = 0; i < NPFX; i++) {
+            mlen = -1, af = AF_UNSPEC;
+            key_bystr(key, &mlen, &af, pfx[i]);
+            n = snp_get(snaps[k], key, mlen);
+            mu_eq((void *)want[k][i], n ? n->val->value : NULL, "%p");
+        }
+    }
+
+    // and the last one agrees with the table on longest prefix matches
+    for (i = 0; i < 4 * NPFX; i++) {
+        r = r * 1103515245 + 12345;
+        snprintf(pfx[0], MAX_STRKEY, "%u.%u.%u.%u", (r >> 8) % 16,
+                 (r >> 12) & 0xff, (r >> 20) & 0xff, r & 0xff);
+        mlen = -1, af = AF_UNSPEC;
+        key_bystr(key, &mlen, &af, pfx[0]);
+        e = tbl_lpm(t, pfx[0]);
+        n = snp_lpm(snaps[7], key);
+        mu_eq(e ? e->value : NULL, n ? n->val->value : NULL, "%p");
+    }
+
+    for (k = 0; k < 8; k++)
+        snp_destroy(&snaps[k], NULL);
+    tbl_destroy(&t, NULL);
+}
@@ -0,0 +1,417 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stddef.h>          // offsetof
+#include <stdlib.h>          // malloc
+#include <netinet/in.h>      // sockaddr_in
+#include <arpa/inet.h>       // inet_pton and friends
+#include <string.h>          // strlen
+#include <ctype.h>           // isdigit
+#include <unistd.h>          // close, unlink
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+#include "bsl.h"             // binary search on prefix lengths
+#include "tally.h"           // per entry traffic counters
+
+#include "minunit.h"         // the mu_test macros
+#include "test_c_tly.h"
+
+
+
+/*
+ * Test tly_create(), tly_add(), tly_pcap() and tly_report()
+ */
+
+#define NELEMS(x) (int)(sizeof(x) / sizeof(x[0]))
+#define U64(x) ((unsigned long long)(x))
+#define SIZE_T(x) ((size_t)(x))
+
+// packet templates: ipv4 in ethernet, ipv4 in 802.1Q, ipv6 and arp
+static uint8_t eth4[14 + 20] = {
+    [12] = 0x08, [13] = 0x00, [14] = 0x45,
+    [26] = 10, 1, 1, 1,                      // src 10.1.1.1
+    [30] = 192, 168, 1, 1,                   // dst 192.168.1.1
+};
+static uint8_t vlan4[18 + 20] = {
+    [12] = 0x81, [13] = 0x00, [16] = 0x08, [17] = 0x00, [18] = 0x45,
+    [30] = 10, 1, 1, 2,                      // src 10.1.1.2
+    [34] = 8, 8, 8, 8,                       // dst 8.8.8.8
+};
+static uint8_t eth6[14 + 40] = {
+    [12] = 0x86, [13] = 0xdd, [14] = 0x60,
+    [22] = 0x20, 0x01, 0x0d, 0xb8,           // src 2001:db8::1
+    [37] = 1,
+    [38] = 0x20, 0x01, 0x0d, 0xb8, 0, 1,     // dst 2001:db8:1::1
+    [53] = 1,
+};
+static uint8_t arp[14 + 28] = { [12] = 0x08, [13] = 0x06 };
+
+void put32(FILE *, uint32_t, int);
+void
+put32(FILE *fp, uint32_t x, int swap)
+{
+    if (swap) x = __builtin_bswap32(x);
+    fwrite(&x, 4, 1, fp);
+}
+
+void put16(FILE *, uint16_t, int);
+void
+put16(FILE *fp, uint16_t x, int swap)
+{
+    if (swap) x = __builtin_bswap16(x);
+    fwrite(&x, 2, 1, fp);
+}
+
+// classic pcap record, wire length is caplen + extra
+void pcap_rec(FILE *, const uint8_t *, uint32_t, uint32_t, int);
+void
+pcap_rec(FILE *fp, const uint8_t *pkt, uint32_t caplen, uint32_t extra, int swap)
+{
+    put32(fp, 0, swap);
+    put32(fp, 0, swap);
+    put32(fp, caplen, swap);
+    put32(fp, caplen + extra, swap);
+    fwrite(pkt, 1, caplen, fp);
+}
+
+// pcapng enhanced packet block
+void pcapng_epb(FILE *, uint32_t, const uint8_t *, uint32_t);
+void
+pcapng_epb(FILE *fp, uint32_t ifc, const uint8_t *pkt, uint32_t caplen)
+{
+    uint32_t pad = (4 - caplen % 4) % 4, blen = 32 + caplen + pad, zero = 0;
+
+    put32(fp, 6, 0);
+    put32(fp, blen, 0);
+    put32(fp, ifc, 0);
+    put32(fp, 0, 0);
+    put32(fp, 0, 0);
+    put32(fp, caplen, 0);
+    put32(fp, caplen, 0);
+    fwrite(pkt, 1, caplen, fp);
+    fwrite(&zero, 1, pad, fp);
+    put32(fp, blen, 0);
+}
+
+// create a temporary file name, the file itself is created by the caller
+char *tmpname(char *);
+char *
+tmpname(char *buf)
+{
+    int fd;
+
+    strcpy(buf, "/tmp/test_c_tly_XXXXXX");
+    if ((fd = mkstemp(buf)) < 0)
+        return NULL;
+    close(fd);
+
+    return buf;
+}
+
+table_t *mktable(void);
+table_t *
+mktable(void)
+{
+    const char *pfx[] = {
+        "10.0.0.0/8", "10.1.1.2/32", "192.168.0.0/16", "2001:db8::/32",
+    };
+    table_t *t = tbl_create(NULL);
+
+    for (int i = 0; i < NELEMS(pfx); i++)
+        tbl_set(t, pfx[i], NULL, NULL);
+
+    return t;
+}
+
+void
+test_tly_create(void)
+{
+    table_t *t = mktable();
+    tally_t *tly = NULL;
+
+    mu_eq(NULL, (void *)tly_create(NULL), "%p");
+    mu_false(tly_destroy(NULL));
+    mu_false(tly_destroy(&tly));
+
+    tly = tly_create(t);
+    mu_assert(tly);
+    mu_eq((void *)t, (void *)tly->t, "%p");
+    mu_assert(tly->bsl4);
+    mu_assert(tly->bsl6);
+    mu_eq(SIZE_T(0), tly->count, "%zu");
+    mu_eq(U64(0), U64(tly->pkts), "%llu");
+
+    mu_true(tly_destroy(&tly));
+    mu_eq(NULL, (void *)tly, "%p");
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tly_add(void)
+{
+    table_t *t = mktable();
+    tally_t *tly = tly_create(t);
+    uint8_t src[MAX_BINKEY], dst[MAX_BINKEY];
+    tcount_t *rpt;
+    size_t n;
+    int mlen, af;
+    char buf[MAX_STRKEY];
+
+    mu_false(tly_add(NULL, src, dst, 1));
+    mu_false(tly_add(tly, NULL, dst, 1));
+    mu_false(tly_add(tly, src, NULL, 1));
+
+    key_bystr(src, &mlen, &af, "10.1.1.1");
+    key_bystr(dst, &mlen, &af, "192.168.1.1");
+    mu_true(tly_add(tly, src, dst, 100));
+    mu_true(tly_add(tly, src, dst, 100));
+    key_bystr(src, &mlen, &af, "10.1.1.2");
+    key_bystr(dst, &mlen, &af, "11.1.1.1");
+    mu_true(tly_add(tly, src, dst, 1000));
+
+    mu_eq(U64(3), U64(tly->pkts), "%llu");
+    mu_eq(U64(1200), U64(tly->bytes), "%llu");
+    mu_eq(U64(1), U64(tly->miss.dpkts), "%llu");
+    mu_eq(U64(1000), U64(tly->miss.dbytes), "%llu");
+    mu_eq(U64(0), U64(tly->miss.spkts), "%llu");
+
+    rpt = tly_report(tly, &n);
+    mu_assert(rpt);
+    mu_eq(SIZE_T(3), n, "%zu");
+    mu_false(strcmp("10.1.1.2", key_tostr(buf, rpt[0].entry->rn->rn_key)));
+    mu_eq(U64(1000), U64(rpt[0].sbytes), "%llu");
+    // 10/8 and 192.168/16 both have 200 bytes, 2 packets; ordered on key
+    mu_false(strcmp("10.0.0.0", key_tostr(buf, rpt[1].entry->rn->rn_key)));
+    mu_eq(U64(2), U64(rpt[1].spkts), "%llu");
+    mu_eq(U64(0), U64(rpt[1].dpkts), "%llu");
+    mu_false(strcmp("192.168.0.0", key_tostr(buf, rpt[2].entry->rn->rn_key)));
+    mu_eq(U64(200), U64(rpt[2].dbytes), "%llu");
+    free(rpt);
+
+    tly_destroy(&tly);
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tly_report_families(void)
+{
+    table_t *t = mktable();
+    tally_t *tly;
+    uint8_t src[2][MAX_BINKEY], dst[2][MAX_BINKEY];
+    tcount_t *rpt;
+    size_t n;
+    int mlen, af;
+    char buf[MAX_STRKEY];
+
+    key_bystr(src[0], &mlen, &af, "10.1.1.1");
+    key_bystr(dst[0], &mlen, &af, "172.16.1.1");
+    key_bystr(src[1], &mlen, &af, "2001:db8::1");
+    key_bystr(dst[1], &mlen, &af, "2001:db9::1");
+
+    // an ipv4 and an ipv6 prefix with the same traffic, in either order
+    for (int first = 0; first < 2; first++) {
+        tly = tly_create(t);
+        mu_true(tly_add(tly, src[first], dst[first], 100));
+        mu_true(tly_add(tly, src[!first], dst[!first], 100));
+
+        rpt = tly_report(tly, &n);
+        mu_assert(rpt);
+        mu_eq(SIZE_T(2), n, "%zu");
+        mu_false(strcmp("10.0.0.0", key_tostr(buf, rpt[0].entry->rn->rn_key)));
+        mu_false(strcmp("2001:db8::", key_tostr(buf, rpt[1].entry->rn->rn_key)));
+        free(rpt);
+        tly_destroy(&tly);
+    }
+
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tly_pcap(void)
+{
+    table_t *t = mktable();
+    tally_t *tly = tly_create(t);
+    char fname[64];
+    FILE *fp;
+
+    mu_false(tly_pcap(tly, "/does/not/exist.pcap"));
+    mu_false(tly_pcap(NULL, "/does/not/exist.pcap"));
+
+    // classic pcap, native byte order, ethernet
+    mu_assert(tmpname(fname));
+    fp = fopen(fname, "wb");
+    put32(fp, 0xa1b2c3d4, 0);
+    put16(fp, 2, 0);
+    put16(fp, 4, 0);
+    put32(fp, 0, 0);
+    put32(fp, 0, 0);
+    put32(fp, 65535, 0);
+    put32(fp, 1, 0);
+    for (int i = 0; i < 1000; i++) {
+        pcap_rec(fp, eth4, sizeof(eth4), 66, 0);
+        pcap_rec(fp, vlan4, sizeof(vlan4), 62, 0);
+        pcap_rec(fp, eth6, sizeof(eth6), 46, 0);
+        pcap_rec(fp, arp, sizeof(arp), 0, 0);
+    }
+    pcap_rec(fp, eth4, sizeof(eth4) - 1, 0, 0);     // header not captured
+    put32(fp, 0, 0);                                // truncated record
+    fclose(fp);
+
+    mu_true(tly_pcap(tly, fname));
+    mu_eq(U64(3000), U64(tly->pkts), "%llu");
+    mu_eq(U64(300000), U64(tly->bytes), "%llu");
+    mu_eq(U64(1001), U64(tly->skipped), "%llu");
+    mu_eq(U64(1000), U64(tly->miss.dpkts), "%llu");  // 8.8.8.8
+    mu_eq(SIZE_T(4), tly->count, "%zu");
+
+    // garbage is not a capture file
+    fp = fopen(fname, "wb");
+    for (int i = 0; i < 10; i++)
+        put32(fp, 0x12345678, 0);
+    fclose(fp);
+    mu_false(tly_pcap(tly, fname));
+    mu_eq(U64(3000), U64(tly->pkts), "%llu");
+
+    // classic pcap, swapped byte order, raw ip, nanosecond timestamps
+    fp = fopen(fname, "wb");
+    put32(fp, 0xa1b23c4d, 1);
+    put16(fp, 2, 1);
+    put16(fp, 4, 1);
+    put32(fp, 0, 1);
+    put32(fp, 0, 1);
+    put32(fp, 65535, 1);
+    put32(fp, 101, 1);
+    pcap_rec(fp, eth4 + 14, 20, 80, 1);
+    pcap_rec(fp, eth6 + 14, 40, 60, 1);
+    fclose(fp);
+
+    tly_destroy(&tly);
+    tly = tly_create(t);
+    mu_true(tly_pcap(tly, fname));
+    mu_eq(U64(2), U64(tly->pkts), "%llu");
+    mu_eq(U64(200), U64(tly->bytes), "%llu");
+    mu_eq(U64(0), U64(tly->skipped), "%llu");
+
+    unlink(fname);
+    tly_destroy(&tly);
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tly_pcapng(void)
+{
+    table_t *t = mktable();
+    tally_t *tly = tly_create(t);
+    uint8_t sll[16 + 20] = { [14] = 0x08, [15] = 0x00 };
+    char fname[64];
+    FILE *fp;
+
+    memcpy(sll + 16, eth4 + 14, 20);
+
+    mu_assert(tmpname(fname));
+    fp = fopen(fname, "wb");
+    // section header block
+    put32(fp, 0x0a0d0d0a, 0);
+    put32(fp, 28, 0);
+    put32(fp, 0x1a2b3c4d, 0);
+    put16(fp, 1, 0);
+    put16(fp, 0, 0);
+    put32(fp, 0xffffffff, 0);
+    put32(fp, 0xffffffff, 0);
+    put32(fp, 28, 0);
+    // interface 0: ethernet, interface 1: linux cooked capture
+    for (int lt = 1; lt < 200; lt += 112) {
+        put32(fp, 1, 0);
+        put32(fp, 20, 0);
+        put16(fp, lt, 0);
+        put16(fp, 0, 0);
+        put32(fp, 0, 0);                            // no snaplen
+        put32(fp, 20, 0);
+    }
+    pcapng_epb(fp, 0, eth4, sizeof(eth4));
+    pcapng_epb(fp, 0, vlan4, sizeof(vlan4));
+    pcapng_epb(fp, 0, arp, sizeof(arp));
+    pcapng_epb(fp, 1, sll, sizeof(sll));
+    pcapng_epb(fp, 7, eth6, sizeof(eth6));        // unknown interface
+    // simple packet block, uses interface 0
+    put32(fp, 3, 0);
+    put32(fp, 16 + sizeof(eth6) + 2, 0);
+    put32(fp, sizeof(eth6), 0);
+    fwrite(eth6, 1, sizeof(eth6), fp);
+    put16(fp, 0, 0);                                // padding
+    put32(fp, 16 + sizeof(eth6) + 2, 0);
+    // truncated block
+    put32(fp, 6, 0);
+    put32(fp, 1000, 0);
+    fclose(fp);
+
+    mu_true(tly_pcap(tly, fname));
+    mu_eq(U64(4), U64(tly->pkts), "%llu");
+    mu_eq(U64(1), U64(tly->skipped), "%llu");
+    mu_eq(U64(sizeof(eth4) + sizeof(vlan4) + sizeof(sll) + sizeof(eth6)),
+          U64(tly->bytes), "%llu");
+
+    unlink(fname);
+    tly_destroy(&tly);
+    tbl_destroy(&t, NULL);
+}
+
+void
+test_tly_engines(void)
+{
+    // tallies match plain radix lookups, also after the table changes
+    table_t *t = tbl_create(NULL);
+    tally_t *tly;
+    uint8_t src[MAX_BINKEY], dst[MAX_BINKEY];
+    entry_t *se[5000], *de[5000];
+    tcount_t *rpt;
+    size_t n;
+    uint64_t spkts, dpkts, total;
+    uint32_t r = 12345;
+    char pfx[MAX_STRKEY];
+
+    tly = tly_create(t);
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 2000; i++) {
+            r = r * 1103515245 + 12345;
+            snprintf(pfx, sizeof(pfx), "%u.%u.0.0/%u", 1 + (r >> 24) % 32,
+                     (r >> 16) & 0xff, 12 + (r >> 8) % 13);
+            tbl_set(t, pfx, NULL, NULL);
+        }
+        tly_destroy(&tly);
+        tly = tly_create(t);
+
+        for (int i = 0; i < NELEMS(se); i++) {
+            r = r * 1103515245 + 12345;
+            src[0] = dst[0] = IP4_KEYLEN;
+            src[1] = 1 + (r >> 24) % 32;
+            memcpy(src + 2, &r, 3);
+            r = r * 1103515245 + 12345;
+            dst[1] = 1 + (r >> 24) % 32;
+            memcpy(dst + 2, &r, 3);
+            mu_true(tly_add(tly, src, dst, 1));
+            se[i] = tbl_lpmkey(t, src);
+            de[i] = tbl_lpmkey(t, dst);
+        }
+        mu_eq(U64(t->gen), U64(tly->bsl4->gen), "%llu");
+
+        rpt = tly_report(tly, &n);
+        mu_assert(rpt);
+        total = tly->miss.spkts + tly->miss.dpkts;
+        for (size_t i = 0; i < n; i++) {
+            spkts = dpkts = 0;
+            for (int j = 0; j < NELEMS(se); j++) {
+                spkts += se[j] == rpt[i].entry;
+                dpkts += de[j] == rpt[i].entry;
+            }
+            mu_eq(U64(spkts), U64(rpt[i].spkts), "%llu");
+            mu_eq(U64(dpkts), U64(rpt[i].dpkts), "%llu");
+            total += spkts + dpkts;
+        }
+        mu_eq(U64(2 * NELEMS(se)), U64(total), "%llu");
+        free(rpt);
+    }
+
+    tly_destroy(&tly);
+    tbl_destroy(&t, NULL);
+}
@@ -0,0 +1,69 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+-- tests
+
+describe("ipt:cache(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("is disabled by default", function()
+      local t = iptable.new();
+      local size, hits, misses = t:cache();
+      assert.are_equal(0, size);
+      assert.are_equal(0, hits);
+      assert.are_equal(0, misses);
+    end)
+
+    it("sizes to a power of 2", function()
+      local t = iptable.new();
+      assert.are_equal(1024, (t:cache(1000)));
+      assert.are_equal(1024, (t:cache()));
+      assert.are_equal(0, (t:cache(0)));
+      assert.are_equal(nil, (t:cache(-1)));
+    end)
+
+    it("counts hits and misses", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 24;
+      t:cache(64);
+      for i = 1, 10 do
+        assert.are_equal(24, t["10.10.10.10"]);
+        assert.are_equal(nil, t["11.11.11.11"]);
+      end
+      -- exact matches do not use the cache
+      assert.are_equal(24, t["10.10.10.0/24"]);
+      local size, hits, misses = t:cache();
+      assert.are_equal(64, size);
+      assert.are_equal(18, hits);
+      assert.are_equal(2, misses);
+    end)
+
+    it("is invalidated by changes", function()
+      local t = iptable.new();
+      t["10.10.0.0/16"] = 16;
+      t:cache(64);
+      assert.are_equal(16, t["10.10.10.10"]);
+      t["10.10.10.0/24"] = 24;
+      assert.are_equal(24, t["10.10.10.10"]);
+      for k, v in pairs(t) do
+        t["10.10.10.0/24"] = nil;
+        assert.are_equal(16, t["10.10.10.10"]);
+      end
+      assert.are_equal(16, t["10.10.10.10"]);
+      t["10.10.10.0/24"] = "again";
+      assert.are_equal("again", t["10.10.10.10"]);
+    end)
+
+  end)
+end)
@@ -0,0 +1,96 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+-- tests
+
+describe("ipt:clone(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+    ipt = iptable.new();
+    assert.is_truthy(ipt);
+
+    it("clones an empty table", function()
+      local t = iptable.new();
+      local c = t:clone();
+      assert.is_truthy(c);
+      assert.is_equal(0, #c);
+      assert.are_equal("iptable{#ipv4=0, #ipv6=0}", tostring(c));
+    end)
+
+    it("clones ipv4 and ipv6 prefixes", function()
+      local t = iptable.new();
+      t["0.0.0.0/0"] = 0;
+      t["10.10.10.0/24"] = 24;
+      t["10.10.10.0/25"] = 25;
+      t["255.255.255.255"] = 32;
+      t["::/0"] = 0;
+      t["2001:db8::/32"] = 32;
+      t["ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"] = 128;
+
+      local c = t:clone();
+      local v4, v6 = c:counts();
+      assert.are_equal(4, v4);
+      assert.are_equal(3, v6);
+
+      for k, v in pairs(t) do
+        assert.are_equal(v, c[k]);
+      end
+      assert.are_equal(25, c["10.10.10.1"]);
+      assert.are_equal(32, c["2001:db8::1"]);
+    end)
+
+    it("shares values by reference", function()
+      local t = iptable.new();
+      local v = {1, 2, 3};
+      t["10.10.10.0/24"] = v;
+      local c = t:clone();
+      assert.are_equal(v, c["10.10.10.0/24"]);
+      c["10.10.10.0/24"][1] = 42;
+      assert.are_equal(42, t["10.10.10.0/24"][1]);
+    end)
+
+    it("yields independent tables", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 1;
+      t["11.11.11.0/24"] = 2;
+      local c = t:clone();
+      c["10.10.10.0/24"] = nil;
+      c["12.12.12.0/24"] = 3;
+      assert.are_equal(1, t["10.10.10.0/24"]);
+      assert.are_equal(nil, t["12.12.12.0/24"]);
+      assert.are_equal(2, #t);
+      assert.are_equal(2, #c);
+
+      -- values survive the original table being collected
+      t = nil;
+      collectgarbage();
+      collectgarbage();
+      assert.are_equal(2, c["11.11.11.0/24"]);
+      assert.are_equal(3, c["12.12.12.0/24"]);
+    end)
+
+    it("skips entries deleted during iteration", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 1;
+      t["11.11.11.0/24"] = 2;
+      local c;
+      for k, v in pairs(t) do
+        t["11.11.11.0/24"] = nil;
+        c = t:clone();
+      end
+      assert.are_equal(1, #c);
+      assert.are_equal(nil, c["11.11.11.0/24"]);
+    end)
+
+  end)
+end)
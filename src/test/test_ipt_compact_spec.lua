@@ -0,0 +1,81 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+-- tests
+
+describe("ipt:compact(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("handles an empty table", function()
+      local t = iptable.new();
+      assert.are_equal(0, t:compact());
+      assert.are_equal(0, #t);
+    end)
+
+    it("keeps prefixes, values and paths", function()
+      local t = iptable.new();
+      local v = {42};
+      t["10.10.10.0/24"] = v;
+      t["10.10.10.0/25"] = 25;
+      t["2001:db8::/32"] = "six";
+      t:addpath("10.10.10.0/24", "nh1", 2);
+      local before = {};
+      for k, val in pairs(t) do before[k] = val end
+      assert.is_true(t:compact() >= 0);
+      local after = {};
+      for k, val in pairs(t) do after[k] = val end
+      assert.are_same(before, after);
+      assert.are_equal(v, t["10.10.10.0/24"]);
+      assert.are_equal(25, t["10.10.10.10"]);
+      assert.are_equal(1, #t:paths("10.10.10.0/24"));
+      t["10.10.10.0/25"] = nil;
+      assert.are_equal(v, t["10.10.10.10"]);
+    end)
+
+    it("reclaims after churn", function()
+      local t = iptable.new(1000);
+      t:hindex(true);
+      t:cache(64);
+      for i = 0, 999 do
+        t[F("10.%d.%d.0/%d", i // 256, i % 256, 24 + i % 8)] = i;
+      end
+      for i = 0, 999 do
+        if i % 4 ~= 0 then
+          t[F("10.%d.%d.0/%d", i // 256, i % 256, 24 + i % 8)] = nil;
+        end
+      end
+      assert.is_true(t:compact() > 0);
+      assert.are_equal(250, #t);
+      for i = 0, 999, 4 do
+        assert.are_equal(i, t[F("10.%d.%d.0/%d", i // 256, i % 256,
+                                24 + i % 8)]);
+      end
+    end)
+
+    it("refuses while iterating", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 1;
+      t["10.10.11.0/24"] = 2;
+      for k, _ in pairs(t) do
+        t[k] = nil;
+        local bytes, err = t:compact();
+        assert.is_nil(bytes);
+        assert.is_truthy(err);
+      end
+      assert.are_equal(0, #t);
+      assert.is_truthy(t:compact());
+    end)
+
+  end)
+end)
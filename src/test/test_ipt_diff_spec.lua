@@ -0,0 +1,158 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+local function diff(a, b, eq)
+  local rv = {};
+  for pfx, op, old, new in a:diff(b, eq) do
+    rv[#rv + 1] = {pfx, op, old, new};
+  end
+  return rv;
+end
+
+-- tests
+
+describe("ipt:diff(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("finds nothing for identical tables", function()
+      local a = iptable.new();
+      local b = iptable.new();
+      assert.are_same({}, diff(a, b));
+      a["10.10.10.0/24"] = 1;
+      a["2001:db8::/32"] = "x";
+      b["10.10.10.0/24"] = 1;
+      b["2001:db8::/32"] = "x";
+      assert.are_same({}, diff(a, b));
+      assert.are_same({}, diff(a, a));
+      assert.are_same({}, diff(a, a:clone()));
+    end)
+
+    it("reports added, removed and changed in key order", function()
+      local a = iptable.new();
+      local b = iptable.new();
+      a["10.0.0.0/8"] = 8;
+      a["10.0.0.0/16"] = 16;
+      a["11.0.0.0/8"] = 11;
+      a["2001:db8::/32"] = 32;
+      b["0.0.0.0/0"] = 0;
+      b["10.0.0.0/8"] = 8;
+      b["10.0.0.0/24"] = 24;
+      b["11.0.0.0/8"] = "eleven";
+      b["2001:db8::/48"] = 48;
+      assert.are_same({
+        {"0.0.0.0/0", "added", nil, 0},
+        {"10.0.0.0/24", "added", nil, 24},
+        {"10.0.0.0/16", "removed", 16, nil},
+        {"11.0.0.0/8", "changed", 11, "eleven"},
+        {"2001:db8::/48", "added", nil, 48},
+        {"2001:db8::/32", "removed", 32, nil},
+      }, diff(a, b));
+      assert.are_same({
+        {"0.0.0.0/0", "removed", 0, nil},
+        {"10.0.0.0/24", "removed", 24, nil},
+        {"10.0.0.0/16", "added", nil, 16},
+        {"11.0.0.0/8", "changed", "eleven", 11},
+        {"2001:db8::/48", "removed", 48, nil},
+        {"2001:db8::/32", "added", nil, 32},
+      }, diff(b, a));
+    end)
+
+    it("handles empty tables", function()
+      local a = iptable.new();
+      local b = iptable.new();
+      b["255.255.255.255"] = 1;
+      b["::/0"] = 2;
+      assert.are_same({
+        {"255.255.255.255/32", "added", nil, 1},
+        {"::/0", "added", nil, 2},
+      }, diff(a, b));
+      assert.are_same({
+        {"255.255.255.255/32", "removed", 1, nil},
+        {"::/0", "removed", 2, nil},
+      }, diff(b, a));
+    end)
+
+    it("uses an optional equality function", function()
+      local a = iptable.new();
+      local b = iptable.new();
+      a["10.10.10.0/24"] = {nh = "1.1.1.1"};
+      b["10.10.10.0/24"] = {nh = "1.1.1.1"};
+      a["10.10.11.0/24"] = {nh = "1.1.1.1"};
+      b["10.10.11.0/24"] = {nh = "2.2.2.2"};
+      assert.are_equal(2, #diff(a, b));
+      local same = function(x, y) return x.nh == y.nh end;
+      local d = diff(a, b, same);
+      assert.are_equal(1, #d);
+      assert.are_equal("10.10.11.0/24", d[1][1]);
+      assert.are_equal("changed", d[1][2]);
+      assert.are_same({}, diff(a, b, function() return true end));
+      assert.has_error(function() diff(a, b, "same") end);
+      assert.has_error(function() diff(a, b, function() error("x") end) end);
+    end)
+
+    it("agrees with probing each key", function()
+      local a = iptable.new();
+      local b = iptable.new();
+      for i = 1, 3000 do
+        local pfx = F("%d.%d.%d.0/%d", i % 7, (i * 31) % 256, i % 256,
+                      16 + i % 9);
+        if i % 3 ~= 0 then a[pfx] = i % 5 end
+        if i % 4 ~= 0 then b[pfx] = i % 6 end
+        pfx = F("2001:db8:%x::/%d", i % 97, 40 + i % 9);
+        if i % 2 == 0 then a[pfx] = 1 else b[pfx] = 1 end
+      end
+      local want = {};
+      for k, v in pairs(a) do
+        if b[k] == nil then want[k] = "removed"
+        elseif b[k] ~= v then want[k] = "changed" end
+      end
+      for k, v in pairs(b) do
+        if a[k] == nil then want[k] = "added" end
+      end
+      local got = {};
+      for pfx, op, old, new in a:diff(b) do
+        assert.is_nil(got[pfx]);
+        got[pfx] = op;
+        assert.are_equal(a[pfx], old);
+        assert.are_equal(b[pfx], new);
+      end
+      assert.are_same(want, got);
+    end)
+
+    it("survives deletions during iteration", function()
+      local a = iptable.new();
+      local b = iptable.new();
+      for i = 0, 9 do
+        a[F("10.%d.0.0/16", i)] = i;
+        b[F("10.%d.0.0/16", i + 5)] = i;
+      end
+      local n = 0;
+      for pfx, op in a:diff(b) do
+        n = n + 1;
+        a[pfx] = nil;
+        b[pfx] = nil;
+      end
+      assert.are_equal(15, n);
+      assert.are_equal(0, #a);
+      assert.are_equal(0, #b);
+    end)
+
+    it("requires tables", function()
+      local a = iptable.new();
+      assert.has_error(function() a:diff() end);
+      assert.has_error(function() a:diff({}) end);
+    end)
+
+  end)
+end)
@@ -0,0 +1,75 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+-- tests
+
+describe("ipt:hindex(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("is disabled by default", function()
+      local t = iptable.new();
+      local size, count = t:hindex();
+      assert.are_equal(0, size);
+      assert.are_equal(0, count);
+    end)
+
+    it("indexes existing and new prefixes", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 24;
+      t["2001:db8::/32"] = 32;
+      local size, count = t:hindex(true);
+      assert.are_equal(16, size);
+      assert.are_equal(2, count);
+      t["10.10.10.0/25"] = 25;
+      assert.are_equal(3, select(2, t:hindex()));
+      assert.are_equal(24, t["10.10.10.0/24"]);
+      assert.are_equal(25, t["10.10.10.0/25"]);
+      assert.are_equal(32, t["2001:db8::/32"]);
+      assert.are_equal(nil, t["2001:db8::/33"]);
+      -- longest prefix match is unaffected
+      assert.are_equal(25, t["10.10.10.10"]);
+      t["10.10.10.0/25"] = nil;
+      assert.are_equal(nil, t["10.10.10.0/25"]);
+      assert.are_equal(2, select(2, t:hindex()));
+      assert.are_equal(0, (t:hindex(false)));
+      assert.are_equal(24, t["10.10.10.0/24"]);
+    end)
+
+    it("requires a boolean", function()
+      local t = iptable.new();
+      assert.has_error(function() t:hindex(1) end);
+    end)
+
+    it("handles deletes during iteration", function()
+      local t = iptable.new();
+      t:hindex(true);
+      t["10.10.10.0/24"] = 1;
+      t["2001:db8::/32"] = 2;
+      t["2001:db8::/48"] = 3;
+      for k, v in pairs(t) do
+        t["10.10.10.0/24"] = nil;
+        t["2001:db8::/48"] = nil;
+        assert.are_equal(nil, t["2001:db8::/48"]);
+      end
+      collectgarbage();
+      collectgarbage();
+      assert.are_equal(1, select(2, t:hindex()));
+      assert.are_equal(2, t["2001:db8::/32"]);
+      assert.are_equal(nil, t["2001:db8::/48"]);
+      t["2001:db8::/48"] = 4;
+      assert.are_equal(4, t["2001:db8::/48"]);
+    end)
+
+  end)
+end)
@@ -0,0 +1,140 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+local function changes(t, since)
+  local rv = {};
+  for seq, pfx, op, v in t:changes(since) do
+    rv[#rv + 1] = {seq, pfx, op, v};
+  end
+  return rv;
+end
+
+-- tests
+
+describe("ipt:journal(), ipt:changes(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("is disabled by default", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 1;
+      assert.are_same({0, 0}, {t:journal()});
+      assert.are_same({}, changes(t));
+    end)
+
+    it("records sets and deletes", function()
+      local t = iptable.new();
+      assert.are_same({16, 0}, {t:journal(10)});
+      t["10.10.10.10/24"] = 1;
+      t["2001:db8::/32"] = 2;
+      t["10.10.10.0/24"] = 3;
+      t["2001:db8::/32"] = nil;
+      t["11.11.11.11"] = nil;              -- not there, not recorded
+      t["1.2.3.4/33"] = 1;                 -- invalid, not recorded
+      assert.are_same({16, 4}, {t:journal()});
+      assert.are_same({
+        {1, "10.10.10.0/24", "set", 3},
+        {2, "2001:db8::/32", "set", nil},
+        {3, "10.10.10.0/24", "set", 3},
+        {4, "2001:db8::/32", "del", nil},
+      }, changes(t));
+      assert.are_same({{4, "2001:db8::/32", "del", nil}}, changes(t, 3));
+      assert.are_same({}, changes(t, 4));
+    end)
+
+    it("records path changes as sets of the prefix", function()
+      local t = iptable.new();
+      t:journal(8);
+      t["10.10.10.0/24"] = 1;
+      t["1.2.3.4"] = 2;
+      assert.is_true(t:addpath("10.10.10.0/24", "gw1"));
+      assert.is_true(t:addpath("1.2.3.4", "gw2"));
+      assert.is_true(t:delpath("10.10.10.0/24", "gw1"));
+      assert.are_equal(nil, t:addpath("11.0.0.0/8", "gw3"));
+      assert.are_equal(nil, t:delpath("1.2.3.4", "gw1"));
+      assert.are_same({
+        {3, "10.10.10.0/24", "set", 1},
+        {4, "1.2.3.4/32", "set", 2},
+        {5, "10.10.10.0/24", "set", 1},
+      }, changes(t, 2));
+    end)
+
+    it("lets consumers resume and drain incrementally", function()
+      local t = iptable.new();
+      local mirror = {};
+      local last = 0;
+      local function drain()
+        for seq, pfx, op, v in t:changes(last) do
+          mirror[pfx] = v;
+          last = seq;
+        end
+      end
+      t:journal(64);
+      for i = 1, 20 do t[F("10.%d.0.0/16", i)] = i end
+      drain();
+      for i = 1, 20, 2 do t[F("10.%d.0.0/16", i)] = nil end
+      t["10.2.0.0/16"] = "two";
+      drain();
+      local want = {};
+      for k, v in pairs(t) do want[k] = v end
+      assert.are_same(want, mirror);
+      assert.are_equal(31, last);
+    end)
+
+    it("reports lost changes", function()
+      local t = iptable.new();
+      t:journal(4);
+      for i = 1, 10 do t[F("10.%d.0.0/16", i)] = i end
+      local c = changes(t, 2);
+      assert.are_equal(5, #c);
+      assert.are_same({6, nil, "lost", nil}, c[1]);
+      assert.are_equal(7, c[2][1]);
+      assert.are_equal("10.7.0.0/16", c[2][2]);
+      assert.are_equal(10, c[5][1]);
+      -- resizing keeps the sequence number, but not the records
+      assert.are_same({8, 10}, {t:journal(8)});
+      assert.are_same({}, changes(t, 10));
+      assert.are_same({10, nil, "lost", nil}, changes(t, 9)[1]);
+      -- disabling resets it
+      assert.are_same({0, 0}, {t:journal(0)});
+      t:journal(8);
+      t["11.0.0.0/8"] = 11;
+      assert.are_same({{0, nil, "lost", nil}, {1, "11.0.0.0/8", "set", 11}},
+                      changes(t, 10));
+    end)
+
+    it("records deletes during iteration once", function()
+      local t = iptable.new();
+      t:journal(16);
+      t["10.10.10.0/24"] = 1;
+      t["10.10.11.0/24"] = 2;
+      for k, _ in pairs(t) do t[k] = nil end
+      t["10.10.10.0/24"] = 3;
+      local c = changes(t, 2);
+      assert.are_same({
+        {3, "10.10.10.0/24", "del", 3},
+        {4, "10.10.11.0/24", "del", nil},
+        {5, "10.10.10.0/24", "set", 3},
+      }, c);
+    end)
+
+    it("checks its arguments", function()
+      local t = iptable.new();
+      assert.has_error(function() t:journal("big") end);
+      assert.are_equal(nil, (t:journal(-1)));
+      t:journal(4);
+      assert.are_same({}, changes(t, -1));
+    end)
+
+  end)
+end)
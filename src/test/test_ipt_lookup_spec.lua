@@ -0,0 +1,114 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+-- tests
+
+describe("ipt:lookup(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("returns values in input order", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 24;
+      t["10.10.10.0/25"] = 25;
+      t["2001:db8::/32"] = {32};
+      local addrs = {"10.10.10.1", "11.11.11.11", "10.10.10.129",
+                     "2001:db8::1", "10.10.10.1/8", 42, "nonsense"};
+      local vals, n = t:lookup(addrs);
+      assert.are_equal(4, n);
+      assert.are_equal(25, vals[1]);
+      assert.are_equal(nil, vals[2]);
+      assert.are_equal(24, vals[3]);
+      assert.are_equal(t["2001:db8::/32"], vals[4]);
+      assert.are_equal(25, vals[5]);  -- mask is ignored
+      assert.are_equal(nil, vals[6]);
+      assert.are_equal(nil, vals[7]);
+    end)
+
+    it("handles empty tables and arrays", function()
+      local t = iptable.new();
+      local vals, n = t:lookup({});
+      assert.are_same({}, vals);
+      assert.are_equal(0, n);
+      vals, n = t:lookup({"10.10.10.10", "2001:db8::1"});
+      assert.are_same({}, vals);
+      assert.are_equal(0, n);
+    end)
+
+    it("agrees with indexing, for any number of threads", function()
+      local t = iptable.new();
+      local addrs = {};
+      for i = 0, 255 do
+        t[F("10.%d.0.0/16", i)] = i;
+        t[F("10.%d.%d.0/24", i, i)] = -i;
+        t[F("2001:db8:%x::/48", i)] = i;
+      end
+      for i = 1, 20000 do
+        local a, b = (i * 7) % 256, (i * 13) % 256;
+        addrs[#addrs + 1] = i % 3 == 0 and F("2001:db8:%x::%x", a, i) or
+                            F("%d.%d.%d.%d", 10 + i % 2, a, b, i % 256);
+      end
+      for _, threads in ipairs({1, 2, 7}) do
+        local vals, n = t:lookup(addrs, threads);
+        local m = 0;
+        for i, addr in ipairs(addrs) do
+          assert.are_equal(t[addr], vals[i]);
+          if vals[i] ~= nil then m = m + 1 end
+        end
+        assert.are_equal(m, n);
+      end
+    end)
+
+    it("sees changes to the table", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 24;
+      local addrs = {"10.10.10.10", "10.10.10.250"};
+      local vals, n = t:lookup(addrs, 2);
+      assert.are_same({24, 24}, vals);
+      t["10.10.10.0/25"] = 25;
+      vals, n = t:lookup(addrs);
+      assert.are_same({25, 24}, vals);
+      t["10.10.10.0/24"] = nil;
+      vals, n = t:lookup(addrs);
+      assert.are_equal(25, vals[1]);
+      assert.are_equal(nil, vals[2]);
+      assert.are_equal(1, n);
+      t["10.10.10.0/25"] = "new";
+      vals, n = t:lookup(addrs);
+      assert.are_equal("new", vals[1]);
+    end)
+
+    it("sees deletions during iteration", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 24;
+      t["10.10.10.0/25"] = 25;
+      for k, _ in pairs(t) do
+        t[k] = nil;
+        local vals, n = t:lookup({"10.10.10.10"});
+        assert.are_equal(t["10.10.10.10"], vals[1]);
+      end
+    end)
+
+    it("checks its arguments", function()
+      local t = iptable.new();
+      assert.has_error(function() t:lookup() end);
+      assert.has_error(function() t:lookup("10.10.10.10") end);
+      assert.has_error(function() t:lookup({}, "two") end);
+      local vals, n, err = t:lookup({}, 0);
+      assert.are_equal(nil, vals);
+      assert.are_equal(nil, n);
+      assert.is_truthy(err);
+    end)
+
+  end)
+end)
@@ -0,0 +1,104 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+local function slurp(fname)
+  local fh = io.open(fname, "rb");
+  local data = fh:read("a");
+  fh:close();
+  return data
+end
+
+-- tests
+
+describe("ipt:record(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("returns 0 when not recording", function()
+      local t = iptable.new();
+      assert.are_equal(0, t:record());
+    end)
+
+    it("records operations", function()
+      local fname = os.tmpname();
+      local t = iptable.new();
+      assert.are_equal(0, t:record(fname));
+      t["10.10.10.0/24"] = 1;                  -- set
+      local _ = t["10.10.10.10"];              -- lpm
+      t["10.10.10.0/24"] = nil;                -- del
+      assert.are_equal(3, t:record());
+      assert.are_equal(0, t:record());         -- already stopped
+
+      local data = slurp(fname);
+      os.remove(fname);
+      assert.are_equal("IPTR", data:sub(1, 4));
+      assert.are_equal(1, data:byte(5));       -- version
+      assert.are_equal(0, data:byte(6));       -- not anonymized
+      -- set: op mlen key, lpm: op key, del: op mlen key
+      assert.are_equal(6 + 7 + 6 + 7, #data);
+    end)
+
+    it("records iterators", function()
+      local fname = os.tmpname();
+      local t = iptable.new();
+      for i = 0, 9 do t[F("10.0.%d.0/24", i)] = i end
+      t:record(fname);
+      for _, _ in pairs(t) do end
+      collectgarbage();
+      collectgarbage();
+      -- start, 10 steps and the finish
+      assert.are_equal(12, t:record());
+      local data = slurp(fname);
+      os.remove(fname);
+      assert.are_equal(6 + 12, #data);
+      assert.are_equal(5, data:byte(7));
+      assert.are_equal(7, data:byte(#data));
+    end)
+
+    it("records path changes, but not internal lookups", function()
+      local fname = os.tmpname();
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 1;
+      t:record(fname);
+      assert.is_true(t:addpath("10.10.10.0/24", "gw1", 2));
+      assert.are_equal("gw1", t:select("10.10.10.10", 7));
+      assert.are_equal(0, iptable.hostcount("10.10.10.0/24", false, t));
+      for _ in iptable.hosts("10.10.10.0/23", false, t) do end
+      assert.is_true(t:delpath("10.10.10.0/24", "gw1"));
+      assert.are_equal(2, t:record());
+      local data = slurp(fname);
+      os.remove(fname);
+      assert.are_equal(6 + 7 + 7, #data);
+      assert.are_equal(8, data:byte(7));       -- addpath
+      assert.are_equal(9, data:byte(14));      -- delpath
+    end)
+
+    it("anonymizes keys", function()
+      local fname = os.tmpname();
+      local t = iptable.new();
+      t:record(fname, 42);
+      t["10.10.10.0/24"] = 1;
+      assert.are_equal(1, t:record());
+      local data = slurp(fname);
+      os.remove(fname);
+      assert.are_equal(1, data:byte(6));       -- anonymized
+      assert.is_false(string.char(10, 10, 10) == data:sub(10, 12));
+    end)
+
+    it("fails on files it cannot write", function()
+      local t = iptable.new();
+      assert.is_nil(t:record("/nonexistent/dir/trace"));
+    end)
+
+  end)
+end)
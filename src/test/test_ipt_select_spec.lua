@@ -0,0 +1,91 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+-- tests
+
+describe("ipt:select(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("selects the prefix value without paths", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = "pfx";
+      assert.are_equal("pfx", t:select("10.10.10.10", 42));
+      assert.are_equal(nil, t:select("11.11.11.11", 42));
+      local vals, weights = t:paths("10.10.10.0/24");
+      assert.are_same({}, vals);
+      assert.are_same({}, weights);
+    end)
+
+    it("adds paths to existing prefixes only", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = "pfx";
+      assert.is_true(t:addpath("10.10.10.0/24", "gw1"));
+      assert.is_true(t:addpath("10.10.10.0/24", "gw2", 2));
+      local ok, err = t:addpath("11.11.11.0/24", "gw1");
+      assert.are_equal(nil, ok);
+      assert.are_equal("prefix not found", err);
+      assert.are_equal(nil, t:addpath("10.10.10.0/24", "gw3", 0));
+      assert.are_equal(nil, t:addpath("10.10.10.0/24", nil));
+
+      local vals, weights = t:paths("10.10.10.0/24");
+      assert.are_same({"gw1", "gw2"}, vals);
+      assert.are_same({1, 2}, weights);
+      assert.are_equal(1, #t);
+      assert.are_equal("pfx", t["10.10.10.0/24"]);
+    end)
+
+    it("selects paths by weight and hash", function()
+      local t = iptable.new();
+      t["2001:db8::/32"] = "pfx";
+      t:addpath("2001:db8::/32", "gw1", 1);
+      t:addpath("2001:db8::/32", "gw2", 3);
+      local hits = {gw1 = 0, gw2 = 0};
+      for hash = 1, 400 do
+        local v = t:select("2001:db8::1", hash);
+        hits[v] = hits[v] + 1;
+        assert.are_equal(v, t:select("2001:db8:ffff::", hash));
+      end
+      assert.are_equal(100, hits.gw1);
+      assert.are_equal(300, hits.gw2);
+    end)
+
+    it("deletes paths by value", function()
+      local t = iptable.new();
+      local gw = {"gw"};
+      t["10.10.10.0/24"] = "pfx";
+      t:addpath("10.10.10.0/24", gw);
+      t:addpath("10.10.10.0/24", "gw2");
+      assert.are_equal(nil, t:delpath("10.10.10.0/24", {"gw"}));
+      assert.is_true(t:delpath("10.10.10.0/24", gw));
+      assert.are_equal(nil, t:delpath("10.10.10.0/24", gw));
+      for hash = 1, 10 do
+        assert.are_equal("gw2", t:select("10.10.10.10", hash));
+      end
+      assert.is_true(t:delpath("10.10.10.0/24", "gw2"));
+      assert.are_equal("pfx", t:select("10.10.10.10", 1));
+    end)
+
+    it("drops paths with their prefix and clones them", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = "pfx";
+      t:addpath("10.10.10.0/24", "gw1");
+      local c = t:clone();
+      t["10.10.10.0/24"] = nil;
+      t["10.10.10.0/24"] = "again";
+      assert.are_same({}, (t:paths("10.10.10.0/24")));
+      assert.are_same({"gw1"}, (c:paths("10.10.10.0/24")));
+    end)
+
+  end)
+end)
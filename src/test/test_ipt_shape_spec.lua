@@ -0,0 +1,84 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+local function sum(h)
+  local n = 0
+  for _, v in pairs(h) do n = n + v end
+  return n
+end
+
+-- tests
+
+describe("ipt:shape(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("describes empty trees", function()
+      local t = iptable.new();
+      local ip4, ip6 = t:shape();
+      for _, s in ipairs{ip4, ip6} do
+        assert.are_equal(0, s.entries);
+        assert.are_equal(1, s.internal);
+        assert.are_equal(0, s.chains);
+        assert.are_equal(0, s.avgdepth);
+        assert.is_nil(next(s.depth));
+        assert.is_nil(next(s.chain));
+        assert.are_equal(s.mem.heads, s.mem.total);
+      end
+    end)
+
+    it("describes both trees", function()
+      local t = iptable.new();
+      for i = 0, 255 do t[F("10.0.%d.0/24", i)] = i end
+      t["10.0.0.0/16"] = 1;
+      t["10.0.0.0/8"] = 1;
+      for i = 0, 9 do t[F("2001:db8:%x::/48", i)] = i end
+
+      local ip4, ip6 = t:shape();
+      assert.are_equal(258, ip4.entries);
+      assert.are_equal(256, ip4.chains);
+      assert.are_equal(3, ip4.maxchain);
+      assert.are_equal(1, ip4.chain[3]);
+      assert.are_equal(255, ip4.chain[1]);
+      assert.are_equal(3, ip4.masks);
+      assert.are_equal(ip4.entries, sum(ip4.depth));
+      assert.are_equal(ip4.internal, sum(ip4.mklist));
+      assert.is_true(ip4.avgdepth > 1);
+      assert.is_true(ip4.maxdepth >= ip4.avgdepth);
+      assert.are_equal(ip4.mem.entries + ip4.mem.rmasks + ip4.mem.masks
+                       + ip4.mem.paths + ip4.mem.heads, ip4.mem.total);
+
+      assert.are_equal(10, ip6.entries);
+      assert.are_equal(11, ip6.internal);
+      assert.are_equal(1, ip6.masks);
+    end)
+
+    it("counts tombstones", function()
+      local t = iptable.new();
+      for i = 0, 9 do t[F("10.0.%d.0/24", i)] = i end
+      local ip4;
+      for k, _ in pairs(t) do
+        t[k] = nil;
+        ip4 = t:shape();
+      end
+      assert.are_equal(10, ip4.entries);
+      assert.are_equal(10, ip4.tombstones);
+      collectgarbage();
+      collectgarbage();
+      ip4 = t:shape();
+      assert.are_equal(0, ip4.entries);
+      assert.are_equal(0, ip4.tombstones);
+    end)
+
+  end)
+end)
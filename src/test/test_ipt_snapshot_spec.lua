@@ -0,0 +1,126 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+local function contents(t)
+  local rv = {};
+  for k, v in pairs(t) do rv[k] = v end
+  return rv;
+end
+
+-- tests
+
+describe("ipt:snapshot(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("takes a snapshot of an empty table", function()
+      local t = iptable.new();
+      local s = t:snapshot();
+      assert.are_equal(0, #s);
+      assert.are_same({0, 0}, {s:counts()});
+      assert.are_same({}, contents(s));
+      assert.are_equal("iptsnap{#ipv4=0, #ipv6=0}", tostring(s));
+      assert.is_nil(s["10.10.10.10"]);
+    end)
+
+    it("does not see later changes", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 24;
+      t["2001:db8::/32"] = {32};
+      local s1 = t:snapshot();
+      t["10.10.10.0/25"] = 25;
+      t["10.10.10.0/24"] = "new";
+      t["2001:db8::/32"] = nil;
+      local s2 = t:snapshot();
+
+      assert.are_equal(2, #s1);
+      assert.are_same({1, 1}, {s1:counts()});
+      assert.are_equal(24, s1["10.10.10.10"]);
+      assert.are_equal(24, s1["10.10.10.0/24"]);
+      assert.is_nil(s1["10.10.10.0/25"]);
+      assert.are_same({32}, s1["2001:db8::1"]);
+
+      assert.are_same({2, 0}, {s2:counts()});
+      assert.are_equal(25, s2["10.10.10.10"]);
+      assert.are_equal("new", s2["10.10.10.200"]);
+      assert.is_nil(s2["2001:db8::1"]);
+      assert.are_same(contents(t), contents(s2));
+    end)
+
+    it("iterates less specifics first", function()
+      local t = iptable.new();
+      t["10.0.0.0/16"] = 16;
+      t["10.0.0.0/8"] = 8;
+      t["11.0.0.0/8"] = 11;
+      t["2001:db8::/32"] = 32;
+      local pfxs = {};
+      for pfx, _ in pairs(t:snapshot()) do pfxs[#pfxs + 1] = pfx end
+      assert.are_same({"10.0.0.0/8", "10.0.0.0/16", "11.0.0.0/8",
+                       "2001:db8::/32"}, pfxs);
+    end)
+
+    it("stays consistent while the table changes", function()
+      local t = iptable.new();
+      for i = 0, 255 do t[F("10.%d.0.0/16", i)] = i end
+      local s = t:snapshot();
+      local n = 0;
+      for pfx, v in pairs(s) do
+        n = n + 1;
+        t[pfx] = nil;
+        t[F("11.%d.0.0/16", v)] = v;
+        assert.are_equal(v, s[pfx]);
+      end
+      assert.are_equal(256, n);
+      assert.are_equal(256, #s);
+      assert.is_nil(t["10.1.1.1"]);
+      assert.are_equal(1, s["10.1.1.1"]);
+      assert.are_equal(1, t["11.1.1.1"]);
+    end)
+
+    it("agrees with the table it was taken from", function()
+      local t = iptable.new();
+      local snaps, want = {}, {};
+      for k = 1, 5 do
+        for i = 1, 400 do
+          local j = (i * 7919 + k * 104729) % 997;
+          local pfx = j % 4 == 0 and F("2001:db8:%x::/%d", j, 32 + j % 17)
+                      or F("%d.%d.%d.0/%d", j % 13, (j * 3) % 256, j % 256,
+                           8 + j % 17);
+          if (i + k) % 3 == 0 then t[pfx] = nil else t[pfx] = j end
+        end
+        snaps[k], want[k] = t:snapshot(), contents(t);
+      end
+      t = nil;
+      collectgarbage();
+      for k = 1, 5 do
+        assert.are_same(want[k], contents(snaps[k]));
+        for pfx, v in pairs(want[k]) do
+          assert.are_equal(v, snaps[k][pfx]);
+        end
+      end
+    end)
+
+    it("is read-only", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 1;
+      local s = t:snapshot();
+      assert.has_error(function() s["10.10.10.0/24"] = 2 end);
+      assert.has_error(function() s["10.10.10.0/24"] = nil end);
+      assert.has_error(function() s.foo = 1 end);
+      assert.are_equal(1, s["10.10.10.0/24"]);
+      assert.is_nil(s.foo);
+      assert.is_nil(s[42]);
+    end)
+
+  end)
+end)
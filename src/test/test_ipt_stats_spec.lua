@@ -0,0 +1,95 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+-- tests
+
+describe("ipt:stats(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("is disabled by default", function()
+      local t = iptable.new();
+      assert.is_nil(t:stats());
+    end)
+
+    it("enables and disables the statistics", function()
+      local t = iptable.new();
+      local s = t:stats(100);
+      assert.is_truthy(s);
+      assert.are_equal(128, s.every);
+      assert.are_equal(1, t:stats(1).every);
+      assert.is_nil(t:stats(0));
+      assert.is_nil(t:stats());
+    end)
+
+    it("rejects a negative rate", function()
+      local t = iptable.new();
+      assert.is_nil(t:stats(-1));
+      assert.is_nil(t:stats());
+    end)
+
+    it("times each kind of operation", function()
+      local t = iptable.new();
+      t:stats(1);
+      for i = 0, 99 do t[F("10.0.%d.0/24", i)] = i end
+      for i = 0, 49 do local _ = t[F("10.0.%d.0/24", i)] end
+      for i = 0, 49 do local _ = t[F("10.0.%d.1", i)] end
+      for _, _ in pairs(t) do end
+      for i = 0, 9 do t[F("10.0.%d.0/24", i)] = nil end
+
+      local s = t:stats();
+      assert.are_equal(100, s.set.ops);
+      assert.are_equal(100, s.set.samples);
+      assert.are_equal(100, s.iter.ops);
+      assert.are_equal(10, s.del.ops);
+      assert.is_true(s.get.ops + s.lpm.ops >= 100);
+      for _, op in ipairs{"set", "get", "lpm", "del", "iter"} do
+        local o = s[op];
+        assert.is_truthy(o);
+        assert.is_true(o.p50 <= o.p99);
+        assert.is_true(o.p99 <= o.p999);
+        assert.is_true(o.p999 <= o.max);
+      end
+      assert.is_true(s.set.max > 0);
+      assert.is_true(s.set.mean > 0);
+    end)
+
+    it("samples operations", function()
+      local t = iptable.new();
+      t:stats(4);
+      for i = 0, 99 do t[F("10.0.%d.0/24", i)] = i end
+      local s = t:stats();
+      assert.are_equal(100, s.set.ops);
+      assert.are_equal(25, s.set.samples);
+      assert.are_equal(0, s.del.samples);
+      assert.are_equal(0, s.del.p99);
+    end)
+
+    it("does not time internal lookups", function()
+      local t = iptable.new();
+      t["10.10.10.0/24"] = 1;
+      t:stats(1);
+      assert.is_true(t:addpath("10.10.10.0/24", "gw1"));
+      assert.is_true(t:delpath("10.10.10.0/24", "gw1"));
+      assert.is_nil(t:addpath("11.0.0.0/8", "gw1"));
+      assert.are_equal(254, iptable.hostcount("10.10.11.0/24", false, t));
+      assert.are_equal(0, iptable.hostcount("10.10.10.0/24", false, t));
+      for _ in iptable.hosts("10.10.9.0/23", false, t) do end
+      local s = t:stats();
+      for _, op in ipairs{"set", "get", "lpm", "del"} do
+        assert.are_equal(0, s[op].ops);
+      end
+    end)
+
+  end)
+end)
@@ -0,0 +1,91 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+-- tests
+
+describe("ipt:slice(), ipt:step(): ", function()
+
+  expose("instance ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("has no slice by default", function()
+      local t = iptable.new();
+      local slice, pending = t:slice();
+      assert.are_equal(0, slice);
+      assert.are_equal(0, pending);
+      assert.is_false(t:step());
+    end)
+
+    it("sets the slice", function()
+      local t = iptable.new();
+      assert.are_equal(100, t:slice(100));
+      assert.are_equal(100, t:slice());
+      assert.are_equal(0, t:slice(0));
+      assert.is_nil(t:slice(-1));
+    end)
+
+    it("flushes all deletions at once without a slice", function()
+      local t = iptable.new();
+      for i = 0, 99 do t[F("10.0.%d.0/24", i)] = i end
+      for k, _ in pairs(t) do t[k] = nil end
+      collectgarbage();
+      collectgarbage();
+      local _, pending = t:slice();
+      assert.are_equal(0, pending);
+      assert.is_false(t:step());
+    end)
+
+    it("leaves deletions to ipt:step() with a slice", function()
+      local t = iptable.new();
+      t:slice(10);
+      for i = 0, 99 do t[F("10.0.%d.0/24", i)] = i end
+      for k, v in pairs(t) do
+        if v % 2 == 0 then t[k] = nil end
+      end
+      collectgarbage();
+      collectgarbage();
+      local _, pending = t:slice();
+      assert.is_true(pending > 0 and pending < 50);
+      assert.are_equal(50, #t);
+
+      local steps = 0;
+      while t:step() do
+        steps = steps + 1;
+        assert.is_true(steps < 100);
+      end
+      assert.is_true(steps > 1);
+      _, pending = t:slice();
+      assert.are_equal(0, pending);
+      assert.are_equal(50, #t);
+      for i = 0, 99 do
+        if i % 2 == 0 then
+          assert.is_nil(t[F("10.0.%d.0/24", i)]);
+        else
+          assert.are_equal(i, t[F("10.0.%d.0/24", i)]);
+        end
+      end
+    end)
+
+    it("steps with an explicit number of leaves", function()
+      local t = iptable.new();
+      t:slice(1);
+      for i = 0, 9 do t[F("10.0.%d.0/24", i)] = i end
+      for k, _ in pairs(t) do t[k] = nil end
+      collectgarbage();
+      collectgarbage();
+      assert.is_false(t:step(0));
+      assert.are_equal(0, #t);
+      assert.is_nil(t:step(-1));
+    end)
+
+  end)
+end)
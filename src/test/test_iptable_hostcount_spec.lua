@@ -0,0 +1,66 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+describe("iptable.hostcount(pfx): ", function()
+
+  expose("ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("counts what hosts iterates across", function()
+      for _, pfx in ipairs{"10.10.10.0/24", "10.10.10.0/30", "10.10.10.0/31",
+                           "10.10.10.0/32", "10.10.10.10", "2f::/120"} do
+        for _, incl in ipairs{true, false} do
+          local cnt = 0
+          for host in iptable.hosts(pfx, incl) do cnt = cnt + 1 end
+          assert.are_equal(cnt, iptable.hostcount(pfx, incl));
+        end
+      end
+    end)
+
+    it("counts exactly as an integer when possible", function()
+      assert.are_equal(254, iptable.hostcount("10.10.10.0/24"));
+      assert.is_true(math.type(iptable.hostcount("0.0.0.0/0", true)) == "integer");
+      assert.are_equal(2^32, iptable.hostcount("0.0.0.0/0", true));
+      assert.is_true(math.type(iptable.hostcount("2f::/0")) == "float");
+    end)
+
+    it("does not count hosts matched by the iptable given", function()
+      local t = iptable.new();
+      t["10.10.10.0/26"] = 1;
+      t["10.10.10.200"] = 2;
+      t["10.10.10.128/25"] = 3;
+      t["10.10.10.128/25"] = nil;
+      for _, incl in ipairs{true, false} do
+        local cnt = 0
+        for host in iptable.hosts("10.10.10.0/24", incl, nil, t) do
+          cnt = cnt + 1
+        end
+        assert.are_equal(cnt, iptable.hostcount("10.10.10.0/24", incl, t));
+      end
+      assert.are_equal(0, iptable.hostcount("10.10.10.0/28", true, t));
+    end)
+
+    it("counts large ipv6 blocks without iterating", function()
+      local t = iptable.new();
+      t["2001:db8::/33"] = 1;
+      t["2001:db8:8000::/48"] = 2;
+      t["2001:db8:8000::/64"] = 3;
+      assert.are_equal(2^95 - 2^80, iptable.hostcount("2001:db8::/32", true, t));
+    end)
+
+    it("returns nil and an error on invalid arguments", function()
+      local num, err = iptable.hostcount("10.10.10.300/24");
+      assert.is_nil(num);
+      assert.is_truthy(err);
+      num, err = iptable.hostcount("10.10.10.0/24", true, {});
+      assert.is_nil(num);
+      assert.is_truthy(err);
+    end)
+
+  end)
+end)
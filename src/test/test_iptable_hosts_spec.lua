@@ -77,6 +77,69 @@ describe("iptable.hosts(): ", function()
       assert.are_equal(256, cnt);
     end)
 
+    it("chunks yields arrays of at most chunk hosts", function()
+      local cnt, sizes = 0, {}
+      for hosts in iptable.hosts("10.11.12.13/24", false, 100) do
+        cnt = cnt + #hosts;
+        sizes[#sizes+1] = #hosts;
+      end
+      assert.are_equal(254, cnt);
+      assert.are_same({100, 100, 54}, sizes);
+    end)
+
+    it("chunks keeps the order of hosts", function()
+      local all = {}
+      for host in iptable.hosts("10.11.12.0/29", true) do
+        all[#all+1] = host;
+      end
+      local n = 0
+      for hosts in iptable.hosts("10.11.12.0/29", true, 3) do
+        for _, host in ipairs(hosts) do
+          n = n + 1;
+          assert.are_equal(all[n], host);
+        end
+      end
+      assert.are_equal(8, n);
+    end)
+
+    it("skips hosts matched by the iptable given", function()
+      local t = iptable.new();
+      t["10.11.12.0/26"] = 1;
+      t["10.11.12.200"] = 2;
+      local cnt = 0
+      for host in iptable.hosts("10.11.12.0/24", true, nil, t) do
+        assert.is_nil(t[host]);
+        cnt = cnt + 1;
+      end
+      assert.are_equal(191, cnt);
+      cnt = 0
+      for hosts in iptable.hosts("10.11.12.0/24", false, 50, t) do
+        cnt = cnt + #hosts;
+      end
+      assert.are_equal(190, cnt);
+    end)
+
+    it("iterates nothing when all hosts are matched", function()
+      local t = iptable.new();
+      t["0.0.0.0/0"] = 1;
+      local cnt = 0
+      for hosts in iptable.hosts("10.11.12.0/24", false, 50, t) do
+        cnt = cnt + 1;
+      end
+      assert.are_equal(0, cnt);
+    end)
+
+    it("won't iterate with invalid chunk or iptable", function()
+      local cnt = 0
+      for hosts in iptable.hosts("10.11.12.0/24", false, 0) do
+        cnt = cnt + 1;
+      end
+      for hosts in iptable.hosts("10.11.12.0/24", false, 10, {}) do
+        cnt = cnt + 1;
+      end
+      assert.are_equal(0, cnt);
+    end)
+
   end)
 end)
 
@@ -0,0 +1,71 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+-- tests
+
+describe("iptable.new(): ", function()
+
+  expose("module iptable: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("creates an empty table", function()
+      local t = iptable.new();
+      assert.are_equal(0, #t);
+      assert.are_same({0, 0}, {t:counts()});
+      t = iptable.new(nil);
+      assert.are_equal(0, #t);
+    end)
+
+    it("takes an optional size", function()
+      local t = iptable.new(0);
+      assert.are_equal(0, #t);
+      t = iptable.new(1000);
+      assert.are_equal(0, #t);
+      for i = 1, 1500 do
+        t[F("10.%d.%d.0/24", i // 256, i % 256)] = i;
+        t[F("2001:db8:%x::/48", i)] = {i};
+      end
+      assert.are_same({1500, 1500}, {t:counts()});
+      for i = 1, 1500, 2 do
+        t[F("10.%d.%d.0/24", i // 256, i % 256)] = nil;
+      end
+      assert.are_same({750, 1500}, {t:counts()});
+      for i = 1, 1500 do
+        local v = t[F("10.%d.%d.1", i // 256, i % 256)];
+        if i % 2 == 0 then
+          assert.are_equal(i, v);
+        else
+          assert.is_nil(v);
+        end
+        assert.are_equal(i, t[F("2001:db8:%x::/48", i)][1]);
+      end
+    end)
+
+    it("works with clones and the index", function()
+      local t = iptable.new(64);
+      t:hindex(true);
+      for i = 1, 100 do t[F("11.11.%d.0/24", i)] = i end
+      local c = t:clone();
+      for i = 1, 100 do
+        assert.are_equal(i, t[F("11.11.%d.0/24", i)]);
+        assert.are_equal(i, c[F("11.11.%d.0/24", i)]);
+      end
+    end)
+
+    it("checks its argument", function()
+      assert.has_error(function() iptable.new(-1) end);
+      assert.has_error(function() iptable.new("many") end);
+      assert.has_error(function() iptable.new(1.5) end);
+    end)
+
+  end)
+end)
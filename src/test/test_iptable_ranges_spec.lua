@@ -0,0 +1,138 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+-- tests
+
+describe("iptable.ranges(): ", function()
+
+  expose("module: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("creates an empty range table", function()
+      local rng = iptable.ranges();
+      assert.is_truthy(rng);
+      assert.are_equal(0, #rng);
+      assert.are_equal("iprange{#ipv4=0, #ipv6=0}", tostring(rng));
+    end)
+
+    it("sets, finds and deletes intervals", function()
+      local rng = iptable.ranges();
+      assert.is_true(rng:set("10.10.10.10", "10.10.10.20", "a"));
+      assert.is_true(rng:set("2001:db8::7", "2001:db9::", "b"));
+      assert.are_equal(2, #rng);
+
+      assert.are_equal("a", rng["10.10.10.10"]);
+      assert.are_equal("a", rng["10.10.10.20"]);
+      assert.are_equal(nil, rng["10.10.10.21"]);
+      assert.are_equal("b", rng["2001:db8:ffff::"]);
+
+      local start, stop, v = rng:find("10.10.10.15");
+      assert.are_equal("10.10.10.10", start);
+      assert.are_equal("10.10.10.20", stop);
+      assert.are_equal("a", v);
+      assert.are_equal(nil, rng:find("10.10.10.9"));
+
+      -- replace value, then delete
+      assert.is_true(rng:set("10.10.10.10", "10.10.10.20", "c"));
+      assert.are_equal("c", rng["10.10.10.15"]);
+      assert.is_true(rng:set("10.10.10.10", "10.10.10.20", nil));
+      assert.are_equal(nil, rng["10.10.10.15"]);
+      assert.are_equal(1, #rng);
+    end)
+
+    it("refuses bad intervals", function()
+      local rng = iptable.ranges();
+      assert.is_true(rng:set("10.10.10.10", "10.10.10.20", 1));
+      local ok, err = rng:set("10.10.10.20", "10.10.10.30", 2);
+      assert.are_equal(nil, ok);
+      assert.are_equal("invalid or overlapping range", err);
+      assert.are_equal(nil, rng:set("10.10.10.30", "10.10.10.25", 2));
+      assert.are_equal(nil, rng:set("10.10.10.30", "2001:db8::", 2));
+      assert.are_equal(nil, rng:set("10.10.10.300", "10.10.10.310", 2));
+      assert.are_equal(nil, rng:set("10.10.10.10", "10.10.10.19", nil));
+      assert.are_equal(1, #rng);
+    end)
+
+    it("loads intervals all or nothing", function()
+      local rng = iptable.ranges();
+      assert.is_true(rng:load({
+        {"2001:db8::", "2001:db8::ff", 3},
+        {"10.0.0.100", "10.0.0.200", 2},
+        {"10.0.0.1", "10.0.0.99", 1},
+      }));
+      local v4, v6 = rng:counts();
+      assert.are_equal(2, v4);
+      assert.are_equal(1, v6);
+
+      assert.are_equal(nil, rng:load({
+        {"11.0.0.1", "11.0.0.9", 1},
+        {"10.0.0.50", "10.0.0.60", 2},
+      }));
+      assert.are_equal(nil, rng:load({{"11.0.0.1", "11.0.0.9"}}));
+      assert.are_equal(nil, rng:load({{"11.0.0.1", "x", 1}}));
+      assert.are_equal(3, #rng);
+      assert.are_equal(nil, rng["11.0.0.5"]);
+    end)
+
+    it("iterates intervals in order", function()
+      local rng = iptable.ranges();
+      rng:set("2001:db8::", "2001:db8::ff", 3);
+      rng:set("10.0.0.100", "10.0.0.200", 2);
+      rng:set("10.0.0.1", "10.0.0.99", 1);
+
+      local seen = {};
+      for start, stop, v in rng:intervals() do
+        seen[#seen+1] = F("%s-%s=%s", start, stop, v);
+      end
+      assert.are_same({
+        "10.0.0.1-10.0.0.99=1",
+        "10.0.0.100-10.0.0.200=2",
+        "2001:db8::-2001:db8::ff=3"}, seen);
+
+      seen = {};
+      for start, stop, v in rng:intervals(iptable.AF_INET6) do
+        seen[#seen+1] = v;
+      end
+      assert.are_same({3}, seen);
+    end)
+
+    it("flattens an iptable", function()
+      local ipt = iptable.new();
+      ipt["10.0.0.0/8"] = 8;
+      ipt["10.10.0.0/16"] = 16;
+      local rng = iptable.ranges(ipt);
+      assert.are_equal(3, #rng);
+      assert.are_equal(8, rng["10.9.255.255"]);
+      assert.are_equal(16, rng["10.10.0.0"]);
+      assert.are_equal(8, rng["10.11.0.0"]);
+      assert.are_equal(nil, rng["11.0.0.0"]);
+    end)
+
+    it("converts to an iptable", function()
+      local rng = iptable.ranges();
+      local v = {1};
+      rng:set("10.10.10.10", "10.10.10.20", v);
+      local ipt = rng:totable();
+      assert.are_equal(4, #ipt);
+      assert.are_equal(v, ipt["10.10.10.10/31"]);
+      assert.are_equal(v, ipt["10.10.10.20/32"]);
+      assert.are_equal(nil, ipt["10.10.10.21"]);
+
+      -- values survive the range table being collected
+      rng = nil;
+      collectgarbage();
+      collectgarbage();
+      assert.are_equal(v, ipt["10.10.10.15"]);
+    end)
+
+  end)
+end)
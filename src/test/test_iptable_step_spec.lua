@@ -0,0 +1,115 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+-- helpers
+
+F = string.format
+
+local function fill(t, n)
+  for i = 0, n - 1 do t[F("10.%d.%d.0/24", i // 256, i % 256)] = {i} end
+  t["2001:db8::/32"] = {n}
+end
+
+-- tests
+
+describe("iptable.step(), iptable.background(): ", function()
+
+  expose("module iptable: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("has nothing to step by default", function()
+      collectgarbage();
+      assert.is_false(iptable.step());
+      assert.is_false(iptable.step(0));
+      assert.is_nil(iptable.step(-1));
+    end)
+
+    it("destroys collected tables without a slice right away", function()
+      local t = iptable.new();
+      fill(t, 100);
+      t = nil;
+      collectgarbage();
+      collectgarbage();
+      assert.is_false(iptable.step());
+    end)
+
+    it("leaves collected tables with a slice to iptable.step()", function()
+      local t = iptable.new();
+      t:slice(10);
+      fill(t, 100);
+      t = nil;
+      collectgarbage();
+      collectgarbage();
+      local steps = 0;
+      while iptable.step() do steps = steps + 1 end
+      -- 101 prefixes, the collector did the first 10
+      assert.are_equal(9, steps);
+      assert.is_false(iptable.step());
+    end)
+
+    it("steps by the given amount", function()
+      local t = iptable.new();
+      t:slice(10);
+      fill(t, 100);
+      t = nil;
+      collectgarbage();
+      collectgarbage();
+      assert.is_true(iptable.step(50));
+      assert.is_false(iptable.step(0));
+    end)
+
+    it("steps through several tables", function()
+      for _ = 1, 3 do
+        local t = iptable.new();
+        t:slice(50);
+        fill(t, 100);
+      end
+      collectgarbage();
+      collectgarbage();
+      local steps = 0;
+      while iptable.step() do steps = steps + 1 end
+      assert.are_equal(5, steps);
+    end)
+
+    it("toggles background destruction", function()
+      assert.is_false(iptable.background());
+      assert.is_true(iptable.background(true));
+      assert.is_true(iptable.background());
+      assert.is_false(iptable.background(false));
+      assert.has_error(function() iptable.background(1) end);
+    end)
+
+    it("destroys collected tables in the background", function()
+      iptable.background(true);
+      for _ = 1, 5 do
+        local t = iptable.new();
+        fill(t, 1000);
+      end
+      collectgarbage();
+      collectgarbage();
+      assert.is_false(iptable.step());
+      iptable.background(false);
+    end)
+
+    it("handles tables collected halfway an iteration", function()
+      local t = iptable.new();
+      t:slice(10);
+      fill(t, 100);
+      local co = coroutine.wrap(function()
+        for k, v in pairs(t) do coroutine.yield(k) end
+      end)
+      co();
+      t, co = nil, nil;
+      collectgarbage();
+      collectgarbage();
+      while iptable.step() do end
+      assert.is_false(iptable.step());
+    end)
+
+  end)
+end)
@@ -0,0 +1,66 @@
+#!/usr/bin/env lua
+-------------------------------------------------------------------------------
+--  Description:  unit test file for iptable
+-------------------------------------------------------------------------------
+
+package.cpath = "./build/?.so;"
+
+describe("iptable.subnetcount(pfx, mlen): ", function()
+
+  expose("ipt: ", function()
+    iptable = require("iptable");
+    assert.is_truthy(iptable);
+
+    it("counts what subnets iterates across", function()
+      assert.are_equal(2, iptable.subnetcount("10.10.10.0/24"));
+      assert.are_equal(4, iptable.subnetcount("10.10.10.0/24", 26));
+      assert.are_equal(256, iptable.subnetcount("10.10.10.0/24", 32));
+      assert.are_equal(2^32, iptable.subnetcount("2001:db8::/32", 64));
+      assert.are_equal(2^128, iptable.subnetcount("::/0", 128));
+    end)
+
+    it("does not count subnets overlapping the iptable given", function()
+      local t = iptable.new();
+      t["10.10.10.0/26"] = 1;
+      t["10.10.10.200"] = 2;
+      t["10.10.10.201"] = 2;
+      local cnt = 0
+      for pfx in iptable.subnets("10.10.10.0/24", 28, nil, t) do
+        cnt = cnt + 1
+      end
+      assert.are_equal(11, cnt);
+      assert.are_equal(cnt, iptable.subnetcount("10.10.10.0/24", 28, t));
+      t["10.0.0.0/8"] = 3;
+      assert.are_equal(0, iptable.subnetcount("10.10.10.0/24", 28, t));
+    end)
+
+    it("counts free /64's in a /32", function()
+      local t = iptable.new();
+      t["2001:db8::/48"] = 1;
+      t["2001:db8::/56"] = 1;
+      t["2001:db8:1::1"] = 1;
+      t["2001:db8:ffff:ffff::/64"] = 1;
+      assert.are_equal(2^32 - 2^16 - 2, iptable.subnetcount("2001:db8::/32", 64, t));
+    end)
+
+    it("handles the edges of the address space", function()
+      local t = iptable.new();
+      t["0.0.0.0"] = 1;
+      t["255.255.255.255"] = 1;
+      assert.are_equal(255, iptable.subnetcount("0.0.0.0/24", 32, t));
+      assert.are_equal(255, iptable.subnetcount("255.255.255.0/24", 32, t));
+      assert.are_equal(2^32 - 2, iptable.subnetcount("0.0.0.0/0", 32, t));
+    end)
+
+    it("returns nil and an error on invalid arguments", function()
+      local num, err = iptable.subnetcount("10.10.10.0/24", 24);
+      assert.is_nil(num);
+      assert.is_truthy(err);
+      num, err = iptable.subnetcount("10.10.10.0/24", 33);
+      assert.is_nil(num);
+      num, err = iptable.subnetcount("10.10.10.10");
+      assert.is_nil(num);
+    end)
+
+  end)
+end)
@@ -145,6 +145,49 @@ describe("iptable.subnets(): ", function()
     assert.is_falsy(iptable.error)
   end)
 
+  it("yields arrays of at most chunk subnets", function()
+    local cnt, sizes = 0, {}
+    for pfxs in iptable.subnets("11.12.13.0/24", 28, 6) do
+      cnt = cnt + #pfxs
+      sizes[#sizes+1] = #pfxs
+    end
+    assert.are_equal(16, cnt)
+    assert.are_same({6, 6, 4}, sizes)
+  end)
+
+  it("chunks handle address space wrap around", function()
+    local cnt = 0
+    for pfxs in iptable.subnets("255.255.255.0/24", 26, 3) do
+      cnt = cnt + #pfxs
+    end
+    assert.are_equal(4, cnt)
+  end)
+
+  it("skips subnets overlapping with the iptable given", function()
+    local t = iptable.new()
+    t["11.12.13.0/26"] = 1    -- covers 4 subnets
+    t["11.12.13.200"] = 2     -- inside 1 subnet
+    t["11.0.0.0/8"] = 3
+    t["11.0.0.0/8"] = nil
+    local seen = {}
+    for pfx in iptable.subnets("11.12.13.0/24", 28, nil, t) do
+      seen[#seen+1] = pfx
+    end
+    assert.are_equal(11, #seen)
+    assert.are_equal("11.12.13.64/28", seen[1])
+    assert.are_equal("11.12.13.208/28", seen[9])
+  end)
+
+  it("skips subnets covered by a less specific prefix", function()
+    local t = iptable.new()
+    t["2001:db8::/16"] = 1
+    local cnt = 0
+    for pfxs in iptable.subnets("2001:db8::/32", 64, 1000, t) do
+      cnt = cnt + 1
+    end
+    assert.are_equal(0, cnt)
+  end)
+
 
   end)
 end)
@@ -0,0 +1,197 @@
+#!/bin/bash
+# :vim:ft=SH:
+
+# test_tools.sh - run the command line tools in src/tools on small inputs
+#
+# Usage: test_tools.sh [builddir]
+#
+# Expects the tools to be built in builddir (default: build), runs them in a
+# scratch directory and reports like the C unit tests do.  Exits with 1 if
+# any check failed.
+
+BLD=$(cd "${1:-build}" && pwd) || exit 2
+export LD_LIBRARY_PATH="$BLD${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}"
+TMP=$(mktemp -d) || exit 2
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP" || exit 2
+export LC_ALL=C                  # for sort
+
+OK=0
+FAIL=0
+
+# check <description> <expected> <actual>
+check() {
+    if [ "$2" == "$3" ]; then
+        OK=$((OK + 1))
+    else
+        FAIL=$((FAIL + 1))
+        echo "test_tools.sh: $1 - expected:"
+        echo "$2"
+        echo "  got:"
+        echo "$3"
+    fi
+}
+
+IPT="$BLD/iptable -q"
+
+# -- iptable lookup & cache
+
+printf '10.0.0.0/8 ten\n2001:db8::/32 doc\n1.2.3.4/32 with spaces\n' > pfx
+EXPECT=$(printf '10.1.1.1\t10.0.0.0/8\tten\n2001:db8::1\t2001:db8::/32\tdoc\n1.2.3.4\t1.2.3.4/32\twith spaces\n9.9.9.9\t-\t-')
+
+check "lookup" "$EXPECT" "$($IPT lookup pfx 10.1.1.1 2001:db8::1 1.2.3.4 9.9.9.9)"
+check "lookup from stdin" "$EXPECT" \
+      "$(printf '10.1.1.1\n 2001:db8::1 x\n\n1.2.3.4\n9.9.9.9\n' | $IPT lookup pfx)"
+
+# first run writes the cache, the second one loads it
+check "cache written" "(text, cache written)" \
+      "$($BLD/iptable -c lookup pfx 1.1.1.1 2>&1 >/dev/null | grep -o '(.*)')"
+check "cache exists" "yes" "$([ -s pfx.iptc ] && echo yes)"
+check "cache used" "(cache)" \
+      "$($BLD/iptable -c lookup pfx 1.1.1.1 2>&1 >/dev/null | grep -o '(.*)')"
+check "lookup via cache" "$EXPECT" \
+      "$($IPT -c lookup pfx 10.1.1.1 2001:db8::1 1.2.3.4 9.9.9.9)"
+cp pfx.iptc good.iptc
+
+# a stale cache is rewritten
+touch -d '2000-01-01' pfx
+check "stale cache" "(text, cache written)" \
+      "$($BLD/iptable -c lookup pfx 1.1.1.1 2>&1 >/dev/null | grep -o '(.*)')"
+cp pfx.iptc good.iptc
+
+# broken caches fall back to the text file, header is 40 bytes followed by
+# records of key (5 or 17 bytes), mask length (1 byte) and value length
+patch_cache() {
+    printf "$2" | dd of=pfx.iptc bs=1 seek="$1" conv=notrunc 2>/dev/null
+}
+for broken in "truncate -s 60 pfx.iptc" "truncate -s 10 pfx.iptc" \
+              "patch_cache 0 XXXX" "patch_cache 4 '\x02'" \
+              "patch_cache 8 '\xff\xff\xff\xff\xff\xff\x00\x00'" \
+              "patch_cache 8 '\x05'" "patch_cache 8 '\x01'" \
+              "patch_cache 40 '\x09'" "patch_cache 45 '\x63'" \
+              "patch_cache 46 '\xff\xff\xff\x7f'"; do
+    cp good.iptc pfx.iptc
+    eval "$broken"
+    check "$broken, falls back" "(text, cache written)" \
+          "$($BLD/iptable -c lookup pfx 1.1.1.1 2>&1 >/dev/null | grep -o '(.*)')"
+    check "$broken, lookup" "$EXPECT" \
+          "$($IPT -c lookup pfx 10.1.1.1 2001:db8::1 1.2.3.4 9.9.9.9)"
+done
+
+# -- iptable aggregate
+
+printf '255.255.255.254/32\n255.255.255.255/32\n' > ones
+check "aggregate all ones" "255.255.255.254/31" "$($IPT aggregate ones)"
+
+printf '0.0.0.0/1\n128.0.0.0/1\n' > halves
+check "aggregate halves" "0.0.0.0/0" "$($IPT aggregate halves)"
+
+printf '10.0.0.0/8 a\n10.0.0.0/24 b\n10.255.255.255/32\n11.0.0.0/9\n'  > mix
+printf '11.128.0.0/9\n13.0.0.0/8\n12.0.0.0/8\n20.0.0.0/16\n20.0.1.0/24\n' >> mix
+printf '2001:db8::/33\n2001:db8:8000::/33\n2001:db9::/48\n' >> mix
+printf 'ffff:ffff:ffff:ffff:ffff:ffff:ffff:fffe/128\n' >> mix
+printf 'ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff/128\n' >> mix
+EXPECT=$(printf '10.0.0.0/7\n12.0.0.0/7\n20.0.0.0/16\n2001:db8::/32\n')
+EXPECT=$(printf '%s\n2001:db9::/48\nffff:ffff:ffff:ffff:ffff:ffff:ffff:fffe/127' "$EXPECT")
+check "aggregate adjacent & overlapping" "$EXPECT" "$($IPT aggregate mix)"
+
+# 11/8 and 12/8 are adjacent but do not form a prefix
+printf '11.0.0.0/8\n12.0.0.0/8\n' > odd
+check "aggregate unaligned" "$(printf '11.0.0.0/8\n12.0.0.0/8')" \
+      "$($IPT aggregate odd)"
+
+: > empty
+check "aggregate empty" "" "$($IPT aggregate empty)"
+
+# -- iptable diff
+
+printf '10.0.0.0/8 x\n11.0.0.0/8 y\n' > old
+cp old same
+printf '10.0.0.0/8 z\n12.0.0.0/8 y\n' > new
+$IPT diff old same > out
+check "diff same, exit code" "0" "$?"
+check "diff same, output" "" "$(cat out)"
+$IPT diff old new > out
+check "diff changed, exit code" "1" "$?"
+check "diff changed, output" \
+      "$(printf '~ 10.0.0.0/8\tx\tz\n- 11.0.0.0/8\ty\n+ 12.0.0.0/8\ty')" \
+      "$(sort -k2 out)"
+$IPT diff old missing 2>/dev/null
+check "diff missing file, exit code" "2" "$?"
+$IPT diff old 2>/dev/null
+check "diff usage, exit code" "2" "$?"
+$IPT bogus 2>/dev/null
+check "unknown command, exit code" "2" "$?"
+
+# -- ipt_enrich, output matches iptable lookup, whatever the batching
+
+for i in $(seq 0 2999); do
+    echo "10.$((i % 7)).$((i % 251)).$((i % 13))"
+    echo "2001:db8:$((i % 3))::$i"
+done > addrs
+printf '10.0.0.0/8 a\n10.1.0.0/16 b\n10.2.3.0/24 c\n2001:db8:1::/48 d\n' > epfx
+EXPECT=$($IPT lookup epfx < addrs)
+check "enrich" "$EXPECT" "$($BLD/ipt_enrich -q epfx addrs)"
+check "enrich, small batches" "$EXPECT" \
+      "$($BLD/ipt_enrich -q -t 4 -b 100 epfx < addrs)"
+check "enrich, field & delim" \
+      "$(printf 'x,10.2.3.4\t10.2.3.0/24\tc\ny,11.0.0.1\t-\t-')" \
+      "$(printf 'x,10.2.3.4\ny,11.0.0.1\n' | $BLD/ipt_enrich -q -f 2 -d , epfx)"
+
+# -- ipt_pcap, classic pcap of raw ip packets
+
+bytes() {  # bytes n .., write the byte values n
+    printf "$(printf '\\x%02x' "$@")"
+}
+pkt() {  # pkt src dst len, a pcap record holding a minimal ipv4 header
+    bytes 0 0 0 0 0 0 0 0 20 0 0 0 "$3" 0 0 0
+    bytes 0x45 0 0 "$3" 0 0 0 0 64 17 0 0 ${1//./ } ${2//./ }
+}
+{
+    printf '\xd4\xc3\xb2\xa1\x02\x00\x04\x00\x00\x00\x00\x00\x00\x00\x00\x00'
+    printf '\xff\xff\x00\x00\x65\x00\x00\x00'
+    pkt 10.1.1.1 10.2.3.4 100
+    pkt 10.2.3.5 10.1.0.1 60
+    pkt 10.1.1.1 192.168.1.1 40
+} > cap.pcap
+$BLD/ipt_pcap -q epfx cap.pcap > out
+check "pcap, exit code" "0" "$?"
+check "pcap, counts" \
+      "$(printf '# 0 0 1 40\n10.1.0.0/16 2 140 1 60\n10.2.3.0/24 1 60 1 100')" \
+      "$(grep -v '^# prefix' out | awk '{print $1, $(NF-4), $(NF-3), $(NF-2), $(NF-1)}' | sort)"
+$BLD/ipt_pcap -q epfx missing.pcap > /dev/null 2>&1
+check "pcap, missing capture" "1" "$?"
+
+# -- ipt_replay, a hand made trace: header, then set/lpm/get/iter/del
+
+key4() { bytes 5 ${1//./ }; }
+{
+    printf 'IPTR\x01\x00'
+    printf '\x01\x18'; key4 10.0.0.0             # set 10.0.0.0/24
+    printf '\x01\x10'; key4 10.1.0.0             # set 10.1.0.0/16
+    printf '\x01\xff'; key4 10.9.9.9             # set host, no mask
+    printf '\x04';     key4 10.0.0.1             # lpm
+    printf '\x03\x18'; key4 10.0.0.0             # get
+    printf '\x05\x06\x06'                        # iterate twice
+    printf '\x02\x10'; key4 10.1.0.0             # del, deferred
+    printf '\x07'                                # end iteration
+    printf '\x08\x18'; key4 10.0.0.0             # add a path
+    printf '\x09\x18'; key4 10.0.0.0             # and delete it
+} > trace
+$BLD/ipt_replay -r 2 trace > out 2> err
+check "replay, exit code" "0" "$?"
+check "replay, records" "ipt_replay: 12 records, 3 sets, 1 gets, 1 lpms, 1 dels, 1 iterators, 2 path changes" \
+      "$(head -1 err)"
+check "replay, prefixes left" "2" "$(grep -c '2 ipv4 + 0 ipv6' err)"
+check "replay, throughput" "1" "$(grep -c '^throughput' out)"
+printf '\x04\x05\x0a' >> trace                   # truncated lpm
+$BLD/ipt_replay -q trace > /dev/null 2> err
+check "replay, truncated trace" "1" "$(grep -c 'invalid record 13' err)"
+printf 'IPTX\x01\x00' > notrace
+$BLD/ipt_replay -q notrace > /dev/null 2>&1
+check "replay, not a trace" "1" "$?"
+
+echo "-------------------------------------"
+echo "Ran $((OK + FAIL)) tests -> ok ($OK), fail ($FAIL)"
+echo
+[ "$FAIL" -eq 0 ]
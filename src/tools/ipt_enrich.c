@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stdint.h>          // uint8_t
+#include <stdlib.h>          // malloc
+#include <arpa/inet.h>       // AF_INET(6)
+#include <string.h>          // memcpy
+#include <unistd.h>          // getopt, sysconf
+#include <pthread.h>
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+#include "tools.h"           // shared helpers
+
+/*
+ * ipt_enrich - annotate log lines with their longest prefix match
+ *
+ * Usage: ipt_enrich [-t threads] [-f field] [-d delim] [-b size] [-q]
+ *                   prefixfile [logfile]
+ *
+ * Loads prefixes from `prefixfile`, one per line as "prefix [value]", and
+ * reads log lines from `logfile` (or stdin).  Each line is written to stdout
+ * with a tab, the longest matching prefix and its value appended, or "-" for
+ * both if the address in the line has no match.  The address is taken from
+ * the `field`'th field (default 1) of the line, fields are separated by `delim`
+ * or, by default, whitespace.
+ *
+ * The input is processed as a pipeline: a reader cuts the input into batches
+ * of whole lines, a pool of worker threads (default: one per core) does the
+ * lookups and formats the output of a batch, and a writer emits the batches
+ * in their original order.  The table is read-only once loaded, so workers
+ * can share it without locking.  Throughput is reported on stderr, unless -q
+ * is given.
+ */
+
+#define BATCH_SIZE  (256 * 1024)     // default bytes of input per batch
+#define MAX_THREADS 256
+
+/* batch states */
+#define B_FREE   0                   // available to the reader
+#define B_FILLED 1                   // holds input lines, awaits a worker
+#define B_BUSY   2                   // being processed by a worker
+#define B_DONE   3                   // holds output, awaits the writer
+
+typedef struct batch_t {
+    size_t seq;                      // sequence number of the batch
+    int state;                       // B_xxx
+    char *in;                        // input lines
+    size_t inlen, incap;
+    char *out;                       // output lines
+    size_t outlen, outcap;
+    size_t lines, matched;           // counters for this batch
+} batch_t;
+
+typedef struct pipe_t {
+    table_t *t;                      // the prefixes to match against
+    FILE *fin, *fout;
+    int field;                       // 1-based field holding the address
+    int delim;                       // field separator, 0 means whitespace
+    size_t bsize;                    // input bytes per batch
+
+    pthread_mutex_t mtx;
+    pthread_cond_t can_read;         // a batch became free
+    pthread_cond_t can_work;         // a batch was filled or input ended
+    pthread_cond_t can_write;        // a batch is done
+    batch_t *batch;                  // the ring of batches
+    size_t nbatch;
+    size_t nread, nwork, nwrite;     // next seq to read, process, write
+    int eof;                         // reader is done
+    int error;                       // out of memory
+
+    size_t lines, matched;           // totals, updated by the writer
+} pipe_t;
+
+static int usage(const char *);
+static int grow(char **, size_t *, size_t);
+static int fill(pipe_t *, batch_t *, char **, size_t *, size_t *);
+static const char *field(const char *, const char *, int, int, size_t *);
+static int enrich(pipe_t *, batch_t *);
+static void *reader(void *);
+static void *worker(void *);
+static void *writer(void *);
+
+static int
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-t threads] [-f field] [-d delim] [-b size] [-q] "
+            "prefixfile [logfile]\n"
+            "  -t  number of lookup threads (default: number of cores)\n"
+            "  -f  field holding the address (default: 1)\n"
+            "  -d  field separator (default: whitespace)\n"
+            "  -b  input bytes per batch (default: %d)\n"
+            "  -q  do not report throughput on stderr\n",
+            prog, BATCH_SIZE);
+    return 2;
+}
+
+/* make sure buf has room for at least need bytes */
+
+static int
+grow(char **buf, size_t *cap, size_t need)
+{
+    char *tmp;
+    size_t ncap = *cap ? *cap : 4096;
+
+    if (need <= *cap) return 1;
+    while (ncap < need)
+        ncap *= 2;
+    if ((tmp = realloc(*buf, ncap)) == NULL)
+        return 0;
+    *buf = tmp;
+    *cap = ncap;
+
+    return 1;
+}
+
+/*
+ * Fill batch `b` with whole lines: the left-over of the previous read (in
+ * carry) and up to bsize more bytes of input.  Whatever follows the last
+ * newline is carried over to the next batch, unless the input ended.
+ * Returns 1 if the batch holds lines, 0 if the input is exhausted and -1 if
+ * out of memory.
+ */
+
+static int
+fill(pipe_t *p, batch_t *b, char **carry, size_t *clen, size_t *ccap)
+{
+    size_t n;
+    char *nl;
+
+    if (!grow(&b->in, &b->incap, *clen + p->bsize + 1))
+        return -1;
+    memcpy(b->in, *carry, *clen);
+    b->inlen = *clen;
+    *clen = 0;
+
+    /* read until the batch holds at least one complete line */
+    do {
+        n = fread(b->in + b->inlen, 1, b->incap - b->inlen - 1, p->fin);
+        b->inlen += n;
+        for (nl = b->in + b->inlen; nl > b->in && nl[-1] != '\n'; nl--)
+            ;
+        nl = nl > b->in ? nl - 1 : NULL;
+        if (nl == NULL && n > 0 && !grow(&b->in, &b->incap, 2 * b->incap))
+            return -1;
+    } while (nl == NULL && n > 0);
+
+    if (nl == NULL) {
+        /* input ended without a final newline */
+        if (b->inlen)
+            b->in[b->inlen++] = '\n';
+        return b->inlen > 0;
+    }
+
+    n = b->in + b->inlen - (nl + 1);
+    if (n) {
+        if (!grow(carry, ccap, n))
+            return -1;
+        memcpy(*carry, nl + 1, n);
+        *clen = n;
+        b->inlen -= n;
+    }
+
+    return 1;
+}
+
+/*
+ * Return the start of the n'th field of the line [s, e), set len to its
+ * length.  Returns NULL if the line has less than n fields.
+ */
+
+static const char *
+field(const char *s, const char *e, int n, int delim, size_t *len)
+{
+    const char *f;
+
+    if (delim) {
+        for (; n > 1 && s < e; s++)
+            if (*s == delim) n--;
+        if (n > 1) return NULL;
+        for (f = s; f < e && *f != delim; f++)
+            ;
+    } else {
+        for (;;) {
+            while (s < e && isspace((unsigned char)*s))
+                s++;
+            if (s == e) return NULL;
+            for (f = s; f < e && !isspace((unsigned char)*f); f++)
+                ;
+            if (--n == 0) break;
+            s = f;
+        }
+    }
+    *len = f - s;
+
+    return s;
+}
+
+/* do the lookups for all lines in a batch, formatting its output */
+
+static int
+enrich(pipe_t *p, batch_t *b)
+{
+    char addr[MAX_STRKEY], pfx[MAX_STRKEY];
+    uint8_t key[MAX_BINKEY];
+    const char *s, *e, *f, *val;
+    size_t flen, llen, vlen, plen;
+    int mlen, af;
+    entry_t *entry;
+
+    b->outlen = b->lines = b->matched = 0;
+    for (s = b->in; s < b->in + b->inlen; s = e + 1) {
+        e = memchr(s, '\n', b->in + b->inlen - s);
+        llen = e - s;
+        if (llen && s[llen - 1] == '\r')
+            llen--;
+        b->lines++;
+
+        entry = NULL;
+        f = field(s, s + llen, p->field, p->delim, &flen);
+        if (f && flen < MAX_STRKEY) {
+            memcpy(addr, f, flen);
+            addr[flen] = '\0';
+            mlen = -1;
+            af = AF_UNSPEC;
+            if (key_bystr(key, &mlen, &af, addr))
+                entry = tbl_lpmkey(p->t, key);
+        }
+
+        if (entry) {
+            b->matched++;
+            key_tostr(pfx, entry->rn->rn_key);
+            plen = strlen(pfx);
+            plen += snprintf(pfx + plen, sizeof(pfx) - plen, "/%d",
+                             key_masklen(entry->rn->rn_mask));
+            val = entry->value;
+        } else {
+            pfx[0] = '-';
+            plen = 1;
+            val = "-";
+        }
+        vlen = strlen(val);
+
+        if (!grow(&b->out, &b->outcap, b->outlen + llen + plen + vlen + 3))
+            return 0;
+        memcpy(b->out + b->outlen, s, llen);
+        b->outlen += llen;
+        b->out[b->outlen++] = '\t';
+        memcpy(b->out + b->outlen, pfx, plen);
+        b->outlen += plen;
+        b->out[b->outlen++] = '\t';
+        memcpy(b->out + b->outlen, val, vlen);
+        b->outlen += vlen;
+        b->out[b->outlen++] = '\n';
+    }
+
+    return 1;
+}
+
+static void *
+reader(void *arg)
+{
+    pipe_t *p = arg;
+    batch_t *b;
+    char *carry = NULL;
+    size_t clen = 0, ccap = 0;
+    int rc;
+
+    for (;;) {
+        pthread_mutex_lock(&p->mtx);
+        b = p->batch + p->nread % p->nbatch;
+        while (b->state != B_FREE && !p->error)
+            pthread_cond_wait(&p->can_read, &p->mtx);
+        rc = p->error;
+        pthread_mutex_unlock(&p->mtx);
+        if (rc) break;
+
+        /* only the reader touches a free batch */
+        rc = fill(p, b, &carry, &clen, &ccap);
+
+        pthread_mutex_lock(&p->mtx);
+        if (rc < 0)
+            p->error = 1;
+        if (rc <= 0) {
+            pthread_mutex_unlock(&p->mtx);
+            break;
+        }
+        b->seq = p->nread++;
+        b->state = B_FILLED;
+        pthread_cond_signal(&p->can_work);
+        pthread_mutex_unlock(&p->mtx);
+    }
+
+    pthread_mutex_lock(&p->mtx);
+    p->eof = 1;
+    pthread_cond_broadcast(&p->can_work);
+    pthread_cond_broadcast(&p->can_write);
+    pthread_mutex_unlock(&p->mtx);
+    free(carry);
+
+    return NULL;
+}
+
+static void *
+worker(void *arg)
+{
+    pipe_t *p = arg;
+    batch_t *b;
+    int ok;
+
+    for (;;) {
+        pthread_mutex_lock(&p->mtx);
+        while (p->nwork == p->nread && !p->eof && !p->error)
+            pthread_cond_wait(&p->can_work, &p->mtx);
+        if (p->nwork == p->nread || p->error) {
+            pthread_mutex_unlock(&p->mtx);
+            break;
+        }
+        b = p->batch + p->nwork++ % p->nbatch;
+        b->state = B_BUSY;
+        pthread_mutex_unlock(&p->mtx);
+
+        ok = enrich(p, b);
+
+        pthread_mutex_lock(&p->mtx);
+        if (!ok) {
+            p->error = 1;
+            pthread_cond_broadcast(&p->can_read);
+            pthread_cond_broadcast(&p->can_work);
+        }
+        b->state = B_DONE;
+        pthread_cond_broadcast(&p->can_write);
+        pthread_mutex_unlock(&p->mtx);
+    }
+
+    return NULL;
+}
+
+static void *
+writer(void *arg)
+{
+    pipe_t *p = arg;
+    batch_t *b;
+
+    for (;;) {
+        pthread_mutex_lock(&p->mtx);
+        b = p->batch + p->nwrite % p->nbatch;
+        while (!p->error && !(p->nwrite < p->nread && b->state == B_DONE)
+               && !(p->eof && p->nwrite == p->nread))
+            pthread_cond_wait(&p->can_write, &p->mtx);
+        if (p->error || p->nwrite == p->nread) {
+            pthread_mutex_unlock(&p->mtx);
+            break;
+        }
+        pthread_mutex_unlock(&p->mtx);
+
+        /* only the writer touches a done batch */
+        fwrite(b->out, 1, b->outlen, p->fout);
+        p->lines += b->lines;
+        p->matched += b->matched;
+
+        pthread_mutex_lock(&p->mtx);
+        b->state = B_FREE;
+        p->nwrite++;
+        pthread_cond_signal(&p->can_read);
+        pthread_mutex_unlock(&p->mtx);
+    }
+    fflush(p->fout);
+
+    return NULL;
+}
+
+int
+main(int argc, char *argv[])
+{
+    pipe_t p;
+    pthread_t rd, wr, wk[MAX_THREADS];
+    long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt, quiet = 0, rc = 0;
+    double t0, t1;
+
+    memset(&p, 0, sizeof(p));
+    p.field = 1;
+    p.bsize = BATCH_SIZE;
+
+    while ((opt = getopt(argc, argv, "t:f:d:b:q")) != -1) {
+        switch (opt) {
+        case 't': nthreads = atol(optarg); break;
+        case 'f': p.field = atoi(optarg); break;
+        case 'd': p.delim = (unsigned char)optarg[0]; break;
+        case 'b': p.bsize = (size_t)atol(optarg); break;
+        case 'q': quiet = 1; break;
+        default: return usage(argv[0]);
+        }
+    }
+    if (optind + 1 != argc && optind + 2 != argc)
+        return usage(argv[0]);
+    if (nthreads < 1 || p.field < 1 || p.bsize < 1)
+        return usage(argv[0]);
+    nthreads = nthreads > MAX_THREADS ? MAX_THREADS : nthreads;
+
+    t0 = now();
+    if ((p.t = load(argv[optind])) == NULL)
+        return 1;
+    t1 = now();
+    if (!quiet)
+        fprintf(stderr, "ipt_enrich: loaded %zu ipv4 + %zu ipv6 prefixes "
+                "in %.2fs\n", p.t->count4, p.t->count6, t1 - t0);
+
+    p.fin = stdin;
+    if (optind + 2 == argc && (p.fin = fopen(argv[optind + 1], "r")) == NULL) {
+        perror(argv[optind + 1]);
+        tbl_destroy(&p.t, NULL);
+        return 1;
+    }
+    p.fout = stdout;
+
+    /* enough batches to keep all workers busy while the writer waits */
+    p.nbatch = 2 * nthreads + 2;
+    if ((p.batch = calloc(p.nbatch, sizeof(batch_t))) == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    pthread_mutex_init(&p.mtx, NULL);
+    pthread_cond_init(&p.can_read, NULL);
+    pthread_cond_init(&p.can_work, NULL);
+    pthread_cond_init(&p.can_write, NULL);
+
+    t0 = now();
+    pthread_create(&rd, NULL, reader, &p);
+    pthread_create(&wr, NULL, writer, &p);
+    for (long i = 0; i < nthreads; i++)
+        pthread_create(&wk[i], NULL, worker, &p);
+
+    pthread_join(rd, NULL);
+    for (long i = 0; i < nthreads; i++)
+        pthread_join(wk[i], NULL);
+    pthread_join(wr, NULL);
+    t1 = now();
+
+    if (p.error) {
+        fprintf(stderr, "ipt_enrich: out of memory\n");
+        rc = 1;
+    } else if (!quiet)
+        fprintf(stderr, "ipt_enrich: %zu lines, %zu matched, %ld threads, "
+                "%.2fs, %.0f lines/sec\n", p.lines, p.matched, nthreads,
+                t1 - t0, t1 > t0 ? p.lines / (t1 - t0) : 0.0);
+
+    for (size_t i = 0; i < p.nbatch; i++) {
+        free(p.batch[i].in);
+        free(p.batch[i].out);
+    }
+    free(p.batch);
+    pthread_mutex_destroy(&p.mtx);
+    pthread_cond_destroy(&p.can_read);
+    pthread_cond_destroy(&p.can_work);
+    pthread_cond_destroy(&p.can_write);
+    if (p.fin != stdin)
+        fclose(p.fin);
+    tbl_destroy(&p.t, NULL);
+
+    return rc;
+}
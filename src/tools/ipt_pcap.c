@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stdint.h>          // uint64_t
+#include <stdlib.h>          // malloc
+#include <arpa/inet.h>       // AF_INET(6)
+#include <string.h>          // memcpy
+#include <unistd.h>          // getopt
+#include <sys/stat.h>        // stat
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+#include "bsl.h"             // lookup engine used by tally
+#include "tally.h"           // per entry counters
+#include "tools.h"           // shared helpers
+
+/*
+ * ipt_pcap - count packets and bytes per matching prefix in capture files
+ *
+ * Usage: ipt_pcap [-n rows] [-q] prefixfile capture [capture ..]
+ *
+ * Loads prefixes from `prefixfile`, one per line as "prefix [value]", and
+ * counts the IPv4/IPv6 packets in the pcap or pcapng capture files per
+ * longest matching prefix, separately for source and destination addresses.
+ * Prints a report, sorted on total bytes, with one line per matched prefix
+ * (or only the top `rows`) followed by the counters for addresses without a
+ * match.  Throughput is reported on stderr, unless -q is given.
+ */
+
+static int usage(const char *);
+static void row(const char *, const char *, tcount_t *);
+
+static int
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-n rows] [-q] prefixfile capture [..]\n"
+            "  -n  only report the top rows prefixes (default: all)\n"
+            "  -q  do not report throughput on stderr\n", prog);
+    return 2;
+}
+
+static void
+row(const char *pfx, const char *val, tcount_t *c)
+{
+    printf("%-43s %12llu %15llu %12llu %15llu  %s\n", pfx,
+           (unsigned long long)c->spkts, (unsigned long long)c->sbytes,
+           (unsigned long long)c->dpkts, (unsigned long long)c->dbytes, val);
+}
+
+int
+main(int argc, char *argv[])
+{
+    table_t *t;
+    tally_t *tly;
+    tcount_t *rpt;
+    struct stat st;
+    char buf[MAX_STRKEY + 4];
+    size_t n, rows = SIZE_MAX, fbytes = 0;
+    int opt, quiet = 0, rc = 0;
+    double t0, t1;
+
+    while ((opt = getopt(argc, argv, "n:q")) != -1) {
+        switch (opt) {
+        case 'n': rows = (size_t)atol(optarg); break;
+        case 'q': quiet = 1; break;
+        default: return usage(argv[0]);
+        }
+    }
+    if (optind + 2 > argc)
+        return usage(argv[0]);
+
+    if ((t = load(argv[optind])) == NULL)
+        return 1;
+    if ((tly = tly_create(t)) == NULL) {
+        fprintf(stderr, "ipt_pcap: out of memory\n");
+        tbl_destroy(&t, NULL);
+        return 1;
+    }
+
+    t0 = now();
+    for (int i = optind + 1; i < argc; i++) {
+        if (!tly_pcap(tly, argv[i])) {
+            fprintf(stderr, "ipt_pcap: cannot read '%s'\n", argv[i]);
+            rc = 1;
+        } else if (stat(argv[i], &st) == 0)
+            fbytes += st.st_size;
+    }
+    t1 = now();
+
+    rpt = tly_report(tly, &n);
+    printf("%-43s %12s %15s %12s %15s  %s\n", "# prefix", "src_pkts",
+           "src_bytes", "dst_pkts", "dst_bytes", "value");
+    for (size_t i = 0; i < n && i < rows; i++) {
+        key_tostr(buf, rpt[i].entry->rn->rn_key);
+        snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), "/%d",
+                 key_masklen(rpt[i].entry->rn->rn_mask));
+        row(buf, rpt[i].entry->value, rpt + i);
+    }
+    row("# no match", "-", &tly->miss);
+
+    if (!quiet)
+        fprintf(stderr, "ipt_pcap: %llu ip packets, %llu bytes, %llu skipped, "
+                "%zu prefixes matched, %.2fs, %.0f pkts/sec, %.1f MB/s\n",
+                (unsigned long long)tly->pkts, (unsigned long long)tly->bytes,
+                (unsigned long long)tly->skipped, n, t1 - t0,
+                t1 > t0 ? (tly->pkts + tly->skipped) / (t1 - t0) : 0.0,
+                t1 > t0 ? fbytes / (t1 - t0) / 1048576 : 0.0);
+
+    free(rpt);
+    tly_destroy(&tly);
+    tbl_destroy(&t, NULL);
+
+    return rc;
+}
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stdint.h>          // uint8_t
+#include <stdlib.h>          // malloc
+#include <arpa/inet.h>       // AF_INET(6)
+#include <string.h>          // memcpy
+#include <unistd.h>          // getopt
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+#include "tools.h"           // shared helpers
+
+/*
+ * ipt_replay - replay a trace of table operations and time it
+ *
+ * Usage: ipt_replay [-r runs] [-q] tracefile
+ *
+ * Reads a trace recorded by `tbl_record` (e.g. through `ipt:record()` in
+ * Lua) and replays it `runs` times (default 5) against a new, empty table
+ * using the C table API.  Sets store a dummy value, gets, deletions and path
+ * changes use the prefix strings that were recorded, lookups use binary keys.
+ * Paths are added with weight 1 and deleted from the front, since a trace
+ * does not record weights or indices.  Iterators
+ * are replayed by holding the table's iterator lock between their start and
+ * finish, so deletions are deferred just like they were, and by stepping a
+ * cursor through the leafs for each of their steps.
+ *
+ * Reports the throughput of the fastest run and, using an extra run with the
+ * table's latency histograms enabled, the p50/p99/p999 and max latency per
+ * operation.  Strings for gets and deletions are prepared up front, so only
+ * the table operations are timed.  The replay is deterministic: the final
+ * prefix counts are printed to show that identical inputs were used.
+ */
+
+#define MAX_DEPTH 64                 // nested iterators replayed
+
+typedef struct op_t {
+    uint8_t op;                      // TRC_xxx
+    uint8_t mlen;                    // 255 for none
+    uint8_t key[MAX_BINKEY];         // binary key, if any
+    char *pfx;                       // prefix string, if needed
+} op_t;
+
+typedef struct trace_ops_t {
+    op_t *ops;
+    size_t count, size;
+    size_t per[TRC_NOPS];            // records per operation
+} trace_ops_t;
+
+static int value = 1;                // the value set by every set
+
+static int
+usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-r runs] [-q] tracefile\n", prog);
+    return 2;
+}
+
+static int
+load_trace(const char *fname, trace_ops_t *tr)
+{
+    FILE *fp = fopen(fname, "rb");
+    char buf[MAX_STRKEY];
+    trec_t rec;
+    op_t *op;
+    int rc, flags = 0;
+
+    if (fp == NULL) {
+        perror(fname);
+        return 0;
+    }
+    if (! trc_header(fp, &flags)) {
+        fprintf(stderr, "%s: not a trace file\n", fname);
+        fclose(fp);
+        return 0;
+    }
+
+    while ((rc = trc_read(fp, &rec)) == 1) {
+        if (tr->count == tr->size) {
+            size_t size = tr->size ? 2 * tr->size : 4096;
+            op_t *tmp = realloc(tr->ops, size * sizeof(*tmp));
+            if (tmp == NULL) {
+                fprintf(stderr, "out of memory\n");
+                fclose(fp);
+                return 0;
+            }
+            tr->ops = tmp;
+            tr->size = size;
+        }
+        op = tr->ops + tr->count++;
+        op->op = rec.op;
+        op->mlen = rec.mlen;
+        op->pfx = NULL;
+        memcpy(op->key, rec.key, IPT_KEYLEN(rec.key) ? IPT_KEYLEN(rec.key) : 1);
+        tr->per[rec.op]++;
+
+        if (rec.op == TRC_GET || rec.op == TRC_DEL || rec.op == TRC_ADDPATH
+            || rec.op == TRC_DELPATH) {
+            size_t len;
+            if (! key_tostr(buf, rec.key)) continue;
+            len = strlen(buf);
+            if (rec.mlen != 255)
+                snprintf(buf + len, sizeof(buf) - len, "/%d", rec.mlen);
+            if ((op->pfx = strdup(buf)) == NULL) {
+                fprintf(stderr, "out of memory\n");
+                fclose(fp);
+                return 0;
+            }
+        }
+    }
+    fclose(fp);
+    if (rc < 0)
+        fprintf(stderr, "%s: invalid record %zu, replaying the ones before\n",
+                fname, tr->count + 1);
+    if (flags & TRC_ANON)
+        fprintf(stderr, "%s: keys are anonymized\n", fname);
+
+    return 1;
+}
+
+/* step a cursor to the next live leaf, moving on to the ipv6 tree */
+
+static struct radix_node *
+next_leaf(table_t *t, struct radix_node *rn)
+{
+    int ip4 = rn && KEY_IS_IP4(rn->rn_key);
+
+    rn = rdx_nextleaf(rn);
+    while (rn && (rn->rn_flags & IPTF_DELETE))
+        rn = rdx_nextleaf(rn);
+    if (rn == NULL && ip4)
+        for (rn = rdx_firstleaf(&t->head6->rh);
+             rn && (rn->rn_flags & IPTF_DELETE); rn = rdx_nextleaf(rn))
+            ;
+
+    return rn;
+}
+
+static struct radix_node *
+first_leaf(table_t *t)
+{
+    struct radix_node *rn = rdx_firstleaf(&t->head4->rh);
+
+    if (rn == NULL)
+        rn = rdx_firstleaf(&t->head6->rh);
+    if (rn && (rn->rn_flags & IPTF_DELETE))
+        rn = next_leaf(t, rn);
+
+    return rn;
+}
+
+static void
+itr_end(table_t *t)
+{
+    if (t->itr_lock > 0 && --t->itr_lock == 0)
+        tbl_gc(t, NULL);
+}
+
+/* replay all operations on t, returns the elapsed time */
+
+static double
+replay(table_t *t, trace_ops_t *tr)
+{
+    struct radix_node *cursor[MAX_DEPTH];
+    int depth = 0;
+    uint64_t t0;
+    double start = now();
+
+    for (size_t i = 0; i < tr->count; i++) {
+        op_t *op = tr->ops + i;
+
+        switch (op->op) {
+        case TRC_SET:
+            tbl_setkey(t, op->key, op->mlen == 255 ? -1 : op->mlen, &value,
+                       NULL);
+            break;
+        case TRC_GET:
+            tbl_get(t, op->pfx);
+            break;
+        case TRC_DEL:
+            tbl_del(t, op->pfx, NULL);
+            break;
+        case TRC_LPM:
+            tbl_lpmkey(t, op->key);
+            break;
+        case TRC_ADDPATH:
+            tbl_addpath(t, op->pfx, &value, 1);
+            break;
+        case TRC_DELPATH:
+            tbl_delpath(t, op->pfx, 0, NULL);
+            break;
+        case TRC_ITR:
+            t->itr_lock++;
+            if (depth < MAX_DEPTH)
+                cursor[depth] = first_leaf(t);
+            depth++;
+            break;
+        case TRC_NEXT:
+            if (depth == 0 || depth > MAX_DEPTH) break;
+            t0 = tbl_latstart(t, LAT_ITR);
+            if (cursor[depth - 1] &&
+                (cursor[depth - 1]->rn_flags & IPTF_DELETE))
+                cursor[depth - 1] = next_leaf(t, cursor[depth - 1]);
+            if (cursor[depth - 1])
+                cursor[depth - 1] = next_leaf(t, cursor[depth - 1]);
+            tbl_latstop(t, LAT_ITR, t0);
+            break;
+        case TRC_END:
+            if (depth == 0) break;
+            depth--;
+            itr_end(t);
+            break;
+        }
+    }
+    while (depth-- > 0)
+        itr_end(t);
+
+    return now() - start;
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char *names[] = {"set", "get", "lpm", "del", "iter"};
+    const int trc[] = {TRC_SET, TRC_GET, TRC_LPM, TRC_DEL, TRC_NEXT};
+    trace_ops_t tr;
+    table_t *t;
+    double best = 0, secs;
+    int opt, runs = 5, quiet = 0;
+
+    while ((opt = getopt(argc, argv, "r:q")) != -1) {
+        switch (opt) {
+        case 'r': runs = atoi(optarg); break;
+        case 'q': quiet = 1; break;
+        default: return usage(argv[0]);
+        }
+    }
+    if (optind + 1 != argc || runs < 1)
+        return usage(argv[0]);
+
+    memset(&tr, 0, sizeof(tr));
+    if (! load_trace(argv[optind], &tr))
+        return 1;
+    if (!quiet)
+        fprintf(stderr, "ipt_replay: %zu records, %zu sets, %zu gets, "
+                "%zu lpms, %zu dels, %zu iterators, %zu path changes\n",
+                tr.count, tr.per[TRC_SET], tr.per[TRC_GET], tr.per[TRC_LPM],
+                tr.per[TRC_DEL], tr.per[TRC_ITR],
+                tr.per[TRC_ADDPATH] + tr.per[TRC_DELPATH]);
+
+    for (int r = 0; r < runs; r++) {
+        if ((t = tbl_create(NULL)) == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        secs = replay(t, &tr);
+        if (!quiet)
+            fprintf(stderr, "run %d: %.3fs, %zu ipv4 + %zu ipv6 prefixes\n",
+                    r + 1, secs, t->count4, t->count6);
+        if (r == 0 || secs < best)
+            best = secs;
+        tbl_destroy(&t, NULL);
+    }
+    printf("throughput %.0f ops/s (%.1f ns/op, best of %d)\n",
+           best > 0 ? tr.count / best : 0.0,
+           tr.count ? 1e9 * best / tr.count : 0.0, runs);
+
+    /* one more run to collect latencies, timing skews the run above */
+    if ((t = tbl_create(NULL)) == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    if (! tbl_latency(t, 1)) {
+        printf("latency n/a (built with IPT_NOSTATS)\n");
+    } else {
+        replay(t, &tr);
+        printf("%-5s %10s %8s %8s %8s %8s (ns)\n",
+               "op", "count", "p50", "p99", "p999", "max");
+        for (int op = 0; op < LAT_NOPS; op++) {
+            if (tr.per[trc[op]] == 0) continue;
+            printf("%-5s %10zu %8lu %8lu %8lu %8lu\n", names[op],
+                   tr.per[trc[op]],
+                   (unsigned long)tbl_latq(t, op, 0.5),
+                   (unsigned long)tbl_latq(t, op, 0.99),
+                   (unsigned long)tbl_latq(t, op, 0.999),
+                   (unsigned long)t->lat->max[op]);
+        }
+    }
+    tbl_destroy(&t, NULL);
+
+    for (size_t i = 0; i < tr.count; i++)
+        free(tr.ops[i].pfx);
+    free(tr.ops);
+
+    return 0;
+}
@@ -0,0 +1,495 @@
+#include <stdio.h>
+#include <sys/types.h>       // required for u_char
+#include <stdint.h>          // uint64_t
+#include <stdlib.h>          // malloc
+#include <arpa/inet.h>       // AF_INET(6)
+#include <string.h>          // memcpy
+#include <unistd.h>          // getopt
+#include <sys/stat.h>        // stat
+
+#include "radix.h"           // the radix tree
+#include "iptable.h"         // iptable layered on top of radix.c
+#include "tools.h"           // shared helpers
+
+/*
+ * iptable - query and compare prefix files from the command line
+ *
+ * Usage: iptable [-c] [-q] command [args]
+ *
+ * Commands:
+ *   lookup prefixfile [address ..]   longest prefix match per address
+ *   diff oldfile newfile             prefixes added, deleted or changed
+ *   aggregate prefixfile             the minimal set of covering prefixes
+ *   stats prefixfile                 prefix counts and address coverage
+ *
+ * Prefix files hold "prefix [value]" lines, as for the other tools.  Lookup
+ * reads addresses from stdin when none are given on the command line and
+ * prints the address, the longest matching prefix and its value, or "-" for
+ * both.  Diff prints "+", "-" or "~" lines and exits with 1 if the files
+ * differ, like diff(1) does.  Aggregate ignores values and prints the fewest
+ * prefixes that cover exactly the same addresses.
+ *
+ * With -c, a prefix file is loaded from a binary cache next to it, named
+ * `prefixfile.iptc`, which is (re)written whenever it is missing or the
+ * prefix file's size or modification time changed.  The cache holds binary
+ * keys and mask lengths, so loading it skips parsing the prefix strings and
+ * reserves all entries up front.  It uses the host's byte order and is not
+ * meant to be shared between machines.  Load times are reported on stderr,
+ * unless -q is given.
+ */
+
+#define CACHE_MAGIC   "IPTC"
+#define CACHE_VERSION 1
+#define CACHE_SUFFIX  ".iptc"
+
+/* cache file header, followed by count records of:
+ * key (IPT_KEYLEN bytes), mask length (1 byte), value length (uint32_t) and
+ * the value bytes */
+
+typedef struct hdr_t {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;                  // number of records
+    uint64_t size;                   // prefix file size at the time
+    int64_t mtime_sec;               // prefix file mtime at the time
+    int64_t mtime_nsec;
+} hdr_t;
+
+static int quiet = 0;
+static int cached = 0;
+
+static int usage(const char *);
+static char *cache_name(const char *);
+static table_t *cache_load(const char *, struct stat *);
+static int cache_save(table_t *, const char *, struct stat *);
+static table_t *open_table(const char *);
+static const char *pfx_tostr(char *, struct radix_node *);
+static void lookup(table_t *, char *);
+static int eq(void *, void *, void *);
+static int show(void *, int, entry_t *, entry_t *);
+static void span(uint8_t *, uint8_t *);
+static int cmd_lookup(int, char **);
+static int cmd_diff(int, char **);
+static int cmd_aggregate(int, char **);
+static int cmd_stats(int, char **);
+
+static int
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-c] [-q] command [args]\n"
+            "  lookup prefixfile [address ..]  longest prefix match\n"
+            "  diff oldfile newfile            show changed prefixes\n"
+            "  aggregate prefixfile            minimal covering prefixes\n"
+            "  stats prefixfile                counts and coverage\n"
+            "  -c  use (and refresh) a binary cache 'prefixfile%s'\n"
+            "  -q  do not report load times on stderr\n", prog, CACHE_SUFFIX);
+    return 2;
+}
+
+static char *
+cache_name(const char *fname)
+{
+    size_t len = strlen(fname);
+    char *cname = malloc(len + sizeof(CACHE_SUFFIX));
+
+    if (cname) {
+        memcpy(cname, fname, len);
+        memcpy(cname + len, CACHE_SUFFIX, sizeof(CACHE_SUFFIX));
+    }
+    return cname;
+}
+
+/*
+ * Load the cache for prefix file `st`, provided it is still current.
+ * Returns NULL if there is no usable cache.
+ */
+
+static table_t *
+cache_load(const char *cname, struct stat *st)
+{
+    FILE *fp = fopen(cname, "rb");
+    table_t *t = NULL;
+    uint8_t *buf = NULL, *p, *end;
+    struct stat cst;
+    hdr_t hdr;
+    uint32_t vlen;
+    char *val;
+    int mlen;
+
+    if (fp == NULL) return NULL;
+    if (fstat(fileno(fp), &cst) != 0 || cst.st_size < (off_t)sizeof(hdr))
+        goto done;
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1) goto done;
+    if (memcmp(hdr.magic, CACHE_MAGIC, 4) || hdr.version != CACHE_VERSION
+        || hdr.size != (uint64_t)st->st_size
+        || hdr.mtime_sec != (int64_t)st->st_mtim.tv_sec
+        || hdr.mtime_nsec != (int64_t)st->st_mtim.tv_nsec)
+        goto done;
+
+    if ((buf = malloc(cst.st_size - sizeof(hdr) + 1)) == NULL) goto done;
+    end = buf + fread(buf, 1, cst.st_size - sizeof(hdr), fp);
+    /* a bogus count must not reserve more entries than the records fit */
+    if (hdr.count > (uint64_t)(end - buf) / (IP4_KEYLEN + 1 + sizeof(vlen)))
+        goto done;
+    if ((t = tbl_create(purge)) == NULL) goto done;
+    if (! tbl_reserve(t, hdr.count)) goto fail;
+
+    for (p = buf; hdr.count > 0; hdr.count--) {
+        if (p >= end
+            || (IPT_KEYLEN(p) != IP4_KEYLEN && IPT_KEYLEN(p) != IP6_KEYLEN)
+            || (size_t)(end - p) < IPT_KEYLEN(p) + 1 + sizeof(vlen))
+            goto fail;
+        mlen = p[IPT_KEYLEN(p)];
+        memcpy(&vlen, p + IPT_KEYLEN(p) + 1, sizeof(vlen));
+        if ((size_t)(end - p) < IPT_KEYLEN(p) + 1 + sizeof(vlen) + vlen)
+            goto fail;
+        if ((val = malloc(vlen + 1)) == NULL) goto fail;
+        memcpy(val, p + IPT_KEYLEN(p) + 1 + sizeof(vlen), vlen);
+        val[vlen] = '\0';
+        if (! tbl_setkey(t, p, mlen, val, NULL)) {
+            free(val);
+            goto fail;
+        }
+        p += IPT_KEYLEN(p) + 1 + sizeof(vlen) + vlen;
+    }
+    if (p != end) goto fail;        /* records beyond count */
+    goto done;
+
+fail:
+    tbl_destroy(&t, NULL);
+done:
+    free(buf);
+    fclose(fp);
+
+    return t;
+}
+
+/*
+ * Write the cache for table `t`, loaded from prefix file `st`.  It is written
+ * to a temporary file first and then renamed, so readers never see a partial
+ * cache.
+ */
+
+static int
+cache_save(table_t *t, const char *cname, struct stat *st)
+{
+    struct radix_node_head *heads[] = {t->head4, t->head6};
+    struct radix_node *rn;
+    char *tmp = malloc(strlen(cname) + 5);
+    FILE *fp;
+    hdr_t hdr;
+    uint32_t vlen;
+    uint8_t mlen;
+    int ok = 1;
+
+    if (tmp == NULL) return 0;
+    sprintf(tmp, "%s.tmp", cname);
+    if ((fp = fopen(tmp, "wb")) == NULL) {
+        free(tmp);
+        return 0;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CACHE_MAGIC, 4);
+    hdr.version = CACHE_VERSION;
+    hdr.count = t->count4 + t->count6;
+    hdr.size = st->st_size;
+    hdr.mtime_sec = st->st_mtim.tv_sec;
+    hdr.mtime_nsec = st->st_mtim.tv_nsec;
+    ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+
+    for (int i = 0; ok && i < 2; i++)
+        for (rn = rdx_firstleaf(&heads[i]->rh); ok && rn;
+             rn = rdx_nextleaf(rn)) {
+            if (rn->rn_flags & IPTF_DELETE) continue;
+            mlen = key_masklen(rn->rn_mask);
+            vlen = strlen(((entry_t *)rn)->value);
+            ok = fwrite(rn->rn_key, IPT_KEYLEN(rn->rn_key), 1, fp) == 1
+                 && fwrite(&mlen, 1, 1, fp) == 1
+                 && fwrite(&vlen, sizeof(vlen), 1, fp) == 1
+                 && fwrite(((entry_t *)rn)->value, 1, vlen, fp) == vlen;
+        }
+
+    ok = (fclose(fp) == 0) && ok && rename(tmp, cname) == 0;
+    if (!ok) remove(tmp);
+    free(tmp);
+
+    return ok;
+}
+
+/*
+ * Load a prefix file, through its cache if -c was given.
+ */
+
+static table_t *
+open_table(const char *fname)
+{
+    table_t *t = NULL;
+    struct stat st;
+    char *cname = NULL;
+    const char *how = "text";
+    double t0 = now();
+
+    if (stat(fname, &st) != 0) {
+        perror(fname);
+        return NULL;
+    }
+
+    if (cached) {
+        if ((cname = cache_name(fname)) == NULL) {
+            fprintf(stderr, "iptable: out of memory\n");
+            return NULL;
+        }
+        if ((t = cache_load(cname, &st)) != NULL)
+            how = "cache";
+    }
+
+    if (t == NULL && (t = load(fname)) != NULL && cname) {
+        if (cache_save(t, cname, &st))
+            how = "text, cache written";
+        else
+            fprintf(stderr, "iptable: cannot write cache '%s'\n", cname);
+    }
+    free(cname);
+
+    if (t && !quiet)
+        fprintf(stderr, "iptable: loaded %zu ipv4 + %zu ipv6 prefixes from "
+                "%s (%s) in %.2fs\n", t->count4, t->count6, fname, how,
+                now() - t0);
+
+    return t;
+}
+
+static const char *
+pfx_tostr(char *buf, struct radix_node *rn)
+{
+    key_tostr(buf, rn->rn_key);
+    snprintf(buf + strlen(buf), MAX_STRKEY + 4 - strlen(buf), "/%d",
+             key_masklen(rn->rn_mask));
+    return buf;
+}
+
+/* print the longest prefix match for one address */
+
+static void
+lookup(table_t *t, char *addr)
+{
+    char buf[MAX_STRKEY + 4];
+    entry_t *e = tbl_lpm(t, addr);
+
+    if (e)
+        printf("%s\t%s\t%s\n", addr, pfx_tostr(buf, e->rn), (char *)e->value);
+    else
+        printf("%s\t-\t-\n", addr);
+}
+
+static int
+cmd_lookup(int argc, char **argv)
+{
+    table_t *t;
+    char *line = NULL, *addr, *end;
+    size_t cap = 0;
+
+    if (argc < 2) return usage("iptable");
+    if ((t = open_table(argv[1])) == NULL) return 1;
+
+    if (argc > 2)
+        for (int i = 2; i < argc; i++)
+            lookup(t, argv[i]);
+    else
+        while (getline(&line, &cap, stdin) != -1) {
+            for (addr = line; isspace((unsigned char)*addr); addr++)
+                ;
+            for (end = addr; *end && !isspace((unsigned char)*end); end++)
+                ;
+            *end = '\0';
+            if (*addr)
+                lookup(t, addr);
+        }
+
+    free(line);
+    tbl_destroy(&t, NULL);
+
+    return 0;
+}
+
+static int
+eq(void *args, void *va, void *vb)
+{
+    (void)args;
+    return strcmp(va, vb) == 0;
+}
+
+static int
+show(void *args, int op, entry_t *ea, entry_t *eb)
+{
+    char buf[MAX_STRKEY + 4];
+
+    (*(size_t *)args)++;
+    if (op == TDIFF_ADD)
+        printf("+ %s\t%s\n", pfx_tostr(buf, eb->rn), (char *)eb->value);
+    else if (op == TDIFF_DEL)
+        printf("- %s\t%s\n", pfx_tostr(buf, ea->rn), (char *)ea->value);
+    else
+        printf("~ %s\t%s\t%s\n", pfx_tostr(buf, eb->rn), (char *)ea->value,
+               (char *)eb->value);
+
+    return 1;
+}
+
+static int
+cmd_diff(int argc, char **argv)
+{
+    table_t *a, *b = NULL;
+    size_t ndiff = 0;
+    int rc = 2;
+
+    if (argc != 3) return usage("iptable");
+    if ((a = open_table(argv[1])) == NULL || (b = open_table(argv[2])) == NULL)
+        goto done;
+
+    /* show's args is the counter, eq ignores its args */
+    if (tbl_diff(a, b, eq, show, &ndiff))
+        rc = ndiff > 0;
+
+done:
+    tbl_destroy(&a, NULL);
+    tbl_destroy(&b, NULL);
+
+    return rc;
+}
+
+/* print the fewest prefixes that span lo..hi exactly */
+
+static void
+span(uint8_t *lo, uint8_t *hi)
+{
+    uint8_t a[MAX_BINKEY], m[MAX_BINKEY];
+    char buf[MAX_STRKEY];
+
+    memcpy(a, lo, IPT_KEYLEN(lo));
+    for (;;) {
+        key_byfit(m, a, hi);
+        printf("%s/%d\n", key_tostr(buf, a), key_masklen(m));
+        key_broadcast(a, m);
+        if (key_cmp(a, hi) >= 0 || key_incr(a, 1) == NULL)
+            break;
+    }
+}
+
+static int
+cmd_aggregate(int argc, char **argv)
+{
+    struct radix_node *rn;
+    table_t *t;
+    uint8_t lo[MAX_BINKEY], hi[MAX_BINKEY], next[MAX_BINKEY], bc[MAX_BINKEY];
+    int have;
+
+    if (argc != 2) return usage("iptable");
+    if ((t = open_table(argv[1])) == NULL) return 1;
+
+    /* leafs come in key order, so overlapping or adjacent ranges follow each
+     * other and merge into a single range */
+    for (int i = 0; i < 2; i++) {
+        have = 0;
+        rn = rdx_firstleaf(i ? &t->head6->rh : &t->head4->rh);
+        for (; rn; rn = rdx_nextleaf(rn)) {
+            if (rn->rn_flags & IPTF_DELETE) continue;
+            memcpy(bc, rn->rn_key, IPT_KEYLEN(rn->rn_key));
+            key_broadcast(bc, rn->rn_mask);
+            if (have) {
+                memcpy(next, hi, IPT_KEYLEN(hi));
+                if (key_cmp(rn->rn_key, hi) <= 0
+                    || (key_incr(next, 1) && key_cmp(rn->rn_key, next) <= 0)) {
+                    if (key_cmp(bc, hi) > 0)
+                        memcpy(hi, bc, IPT_KEYLEN(bc));
+                    continue;
+                }
+                span(lo, hi);
+            }
+            memcpy(lo, rn->rn_key, IPT_KEYLEN(rn->rn_key));
+            memcpy(hi, bc, IPT_KEYLEN(bc));
+            have = 1;
+        }
+        if (have)
+            span(lo, hi);
+    }
+
+    tbl_destroy(&t, NULL);
+
+    return 0;
+}
+
+static int
+cmd_stats(int argc, char **argv)
+{
+    struct radix_node *rn;
+    table_t *t;
+    size_t mlens[IP6_MAXMASK + 1];
+    uint8_t zero[MAX_BINKEY];
+    int af, maxlen;
+
+    if (argc != 2) return usage("iptable");
+    if ((t = open_table(argv[1])) == NULL) return 1;
+
+    for (int i = 0; i < 2; i++) {
+        af = i ? AF_INET6 : AF_INET;
+        maxlen = i ? IP6_MAXMASK : IP4_MAXMASK;
+        memset(mlens, 0, sizeof(mlens));
+        rn = rdx_firstleaf(i ? &t->head6->rh : &t->head4->rh);
+        for (; rn; rn = rdx_nextleaf(rn))
+            if (!(rn->rn_flags & IPTF_DELETE))
+                mlens[key_masklen(rn->rn_mask)]++;
+
+        /* an all zeros key of the right length */
+        key_bylen(zero, 0, af);
+        printf("ipv%d prefixes %zu", i ? 6 : 4, i ? t->count6 : t->count4);
+        if (i)
+            printf(", covering %.0f /48s, %.0f /64s\n",
+                   tbl_covered(t, zero, 0, 48), tbl_covered(t, zero, 0, 64));
+        else
+            printf(", covering %.0f /24s, %.0f addresses\n",
+                   tbl_covered(t, zero, 0, 24), tbl_covered(t, zero, 0, 32));
+        for (int m = 0; m <= maxlen; m++)
+            if (mlens[m])
+                printf("  /%-3d %zu\n", m, mlens[m]);
+    }
+
+    tbl_destroy(&t, NULL);
+
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct {
+        const char *name;
+        int (*cmd)(int, char **);
+    } cmds[] = {
+        {"lookup", cmd_lookup},
+        {"diff", cmd_diff},
+        {"aggregate", cmd_aggregate},
+        {"stats", cmd_stats},
+    };
+    int opt;
+
+    /* options stop at the command */
+    while ((opt = getopt(argc, argv, "+cq")) != -1) {
+        switch (opt) {
+        case 'c': cached = 1; break;
+        case 'q': quiet = 1; break;
+        default: return usage(argv[0]);
+        }
+    }
+    if (optind >= argc)
+        return usage(argv[0]);
+
+    for (size_t i = 0; i < sizeof(cmds) / sizeof(cmds[0]); i++)
+        if (strcmp(argv[optind], cmds[i].name) == 0)
+            return cmds[i].cmd(argc - optind, argv + optind);
+
+    fprintf(stderr, "iptable: unknown command '%s'\n", argv[optind]);
+    return usage(argv[0]);
+}
@@ -0,0 +1,84 @@
+/*
+ * Helpers shared by the command line tools in src/tools.
+ */
+
+#ifndef tools_h
+#define tools_h
+
+#include <time.h>            // clock_gettime
+#include <ctype.h>           // isspace
+
+/* seconds since some fixed point in time */
+
+static inline double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* values are strdup'd strings */
+
+static inline void
+purge(void *pargs, void **value)
+{
+    (void)pargs;
+    free(*value);
+    *value = NULL;
+}
+
+/*
+ * Load "prefix [value]" lines into a new table.  Empty lines and lines
+ * starting with '#' are skipped, invalid prefixes are reported and ignored.
+ */
+
+static inline table_t *
+load(const char *fname)
+{
+    FILE *fp = fopen(fname, "r");
+    table_t *t = NULL;
+    char *line = NULL, *pfx, *val, *end;
+    size_t cap = 0, lnr = 0;
+    ssize_t len;
+
+    if (fp == NULL) {
+        perror(fname);
+        return NULL;
+    }
+    if ((t = tbl_create(purge)) == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+
+    while ((len = getline(&line, &cap, fp)) != -1) {
+        lnr++;
+        for (end = line + len; end > line && isspace((unsigned char)end[-1]);)
+            *--end = '\0';
+        for (pfx = line; isspace((unsigned char)*pfx); pfx++)
+            ;
+        if (*pfx == '\0' || *pfx == '#')
+            continue;
+
+        for (val = pfx; *val && !isspace((unsigned char)*val); val++)
+            ;
+        if (*val) {
+            *val++ = '\0';
+            while (isspace((unsigned char)*val))
+                val++;
+        }
+
+        if ((val = strdup(val)) == NULL || !tbl_set(t, pfx, val, NULL)) {
+            fprintf(stderr, "%s:%zu: ignoring '%s'\n", fname, lnr, pfx);
+            free(val);
+        }
+    }
+
+    free(line);
+    fclose(fp);
+
+    return t;
+}
+
+#endif